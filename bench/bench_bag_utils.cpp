@@ -0,0 +1,92 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <benchmark/benchmark.h>
+
+#include <boost/filesystem.hpp>
+
+#include <sensor_msgs/CompressedImage.h>
+
+#include "a2d2_to_ros/bag_utils.hpp"
+
+namespace a2d2_to_ros {
+
+namespace {
+
+void message_sizes(benchmark::internal::Benchmark* b) {
+  for (const auto compression :
+       {rosbag::compression::Uncompressed, rosbag::compression::LZ4}) {
+    // camera_info and bus signal sized, PNG sized, and point cloud sized
+    for (const auto size : {1 << 8, 1 << 16, 1 << 21}) {
+      b->Args({size, static_cast<int64_t>(compression)});
+    }
+  }
+}
+
+}  // namespace
+
+//------------------------------------------------------------------------------
+
+/**
+ * @brief Throughput of writing messages of range(0) bytes through a
+ * SplitBagWriter with compression range(1).
+ */
+static void BM_SplitBagWriter_write(benchmark::State& state) {
+  const auto size = static_cast<size_t>(state.range(0));
+  const auto dir = (boost::filesystem::temp_directory_path() /
+                    boost::filesystem::unique_path("a2d2_to_ros-bench-%%%%%%"));
+  boost::filesystem::create_directories(dir);
+
+  BagOptions options;
+  options.compression =
+      static_cast<rosbag::compression::CompressionType>(state.range(1));
+
+  sensor_msgs::CompressedImage msg;
+  msg.format = "png";
+  msg.data.resize(size);
+  for (size_t i = 0; i < size; ++i) {
+    msg.data[i] = static_cast<uint8_t>((i * 31) ^ (i >> 7));
+  }
+
+  {
+    SplitBagWriter bag(dir.string(), "bench.bag", 0.0, 0.0, options);
+    auto stamp = ros::Time(1554121595, 0);
+    for (auto _ : state) {
+      bag.write("/a2d2/bench", (stamp - ros::Time(1554121595, 0)).toSec(),
+                stamp, msg);
+      stamp.fromNSec(stamp.toNSec() + 1000000);
+    }
+    // include the queued (and compressed) writes in the measurement
+    bag.close();
+  }
+
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(size));
+  boost::system::error_code ec;
+  boost::filesystem::remove_all(dir, ec);
+}
+BENCHMARK(BM_SplitBagWriter_write)->Apply(message_sizes)->UseRealTime();
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
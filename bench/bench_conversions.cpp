@@ -0,0 +1,102 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "a2d2_to_ros/conversions.hpp"
+#include "a2d2_to_ros/data_pair.hpp"
+
+namespace a2d2_to_ros {
+
+//------------------------------------------------------------------------------
+
+/** @brief Convert a chunk of values with a unit resolved once per chunk. */
+static void BM_to_ros_units(benchmark::State& state) {
+  const auto n = static_cast<size_t>(state.range(0));
+  std::vector<double> in(n);
+  for (size_t i = 0; i < n; ++i) {
+    in[i] = (0.001 * static_cast<double>(i));
+  }
+  std::vector<double> out(n);
+  const auto units = get_unit_enum("Unit_KiloMeterPerHour");
+
+  for (auto _ : state) {
+    to_ros_units(units, in.data(), out.data(), n);
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n));
+}
+BENCHMARK(BM_to_ros_units)->Arg(1 << 12)->Arg(1 << 16);
+
+//------------------------------------------------------------------------------
+
+/** @brief Convert one value at a time, looking the unit up by name. */
+static void BM_to_ros_units_by_name(benchmark::State& state) {
+  const auto n = static_cast<size_t>(state.range(0));
+  const std::string unit("Unit_KiloMeterPerHour");
+  for (auto _ : state) {
+    double sum = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+      sum += to_ros_units(unit, 0.001 * static_cast<double>(i));
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n));
+}
+BENCHMARK(BM_to_ros_units_by_name)->Arg(1 << 12);
+
+//------------------------------------------------------------------------------
+
+/** @brief Build a new DataPair (and its frame string) per sample. */
+static void BM_DataPair_build(benchmark::State& state) {
+  uint64_t time = 1554121593909500;
+  for (auto _ : state) {
+    auto pair = DataPair::build(0.5, time, "wheels");
+    benchmark::DoNotOptimize(pair.header.stamp);
+    time += 10000;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DataPair_build);
+
+//------------------------------------------------------------------------------
+
+/** @brief Update a reused MutableDataPair per sample. */
+static void BM_MutableDataPair_set(benchmark::State& state) {
+  MutableDataPair pair("wheels");
+  uint64_t time = 1554121593909500;
+  for (auto _ : state) {
+    pair.set(0.5, time);
+    benchmark::DoNotOptimize(pair.header.stamp);
+    time += 10000;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MutableDataPair_set);
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
@@ -0,0 +1,130 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <benchmark/benchmark.h>
+
+#include "a2d2_to_ros/bus_signal_reader.hpp"
+#include "a2d2_to_ros/file_utils.hpp"
+#include "a2d2_to_ros/json_utils.hpp"
+#include "synthetic_data.hpp"
+
+namespace a2d2_to_ros {
+
+//------------------------------------------------------------------------------
+
+/**
+ * @brief Read and parse a camera frame info file into a DOM, then validate it
+ * against the schema, as the converters did before FrameTimestampReader.
+ */
+static void BM_get_rapidjson_dom_validate(benchmark::State& state) {
+  const bench::TempFile file(bench::make_camera_frame_json(1554121595035037),
+                             ".json");
+  auto schema_d = get_rapidjson_dom(
+      bench::get_schema_path("sensor_fusion_camera_frame.schema"));
+  if (!schema_d) {
+    state.SkipWithError("failed to load schema");
+    return;
+  }
+  const rapidjson::SchemaDocument schema(*schema_d);
+
+  for (auto _ : state) {
+    auto d = get_rapidjson_dom(file.path());
+    rapidjson::SchemaValidator validator(schema);
+    if (!d || !d->Accept(validator)) {
+      state.SkipWithError("synthetic frame info is not valid");
+      break;
+    }
+    benchmark::DoNotOptimize(*d);
+  }
+}
+BENCHMARK(BM_get_rapidjson_dom_validate);
+
+//------------------------------------------------------------------------------
+
+/**
+ * @brief Read the timestamp of a frame info file with (range(0) == 1) and
+ * without schema validation.
+ */
+static void BM_FrameTimestampReader(benchmark::State& state) {
+  const bench::TempFile file(bench::make_camera_frame_json(1554121595035037),
+                             ".json");
+  auto schema_d = get_rapidjson_dom(
+      bench::get_schema_path("sensor_fusion_camera_frame.schema"));
+  if (!schema_d) {
+    state.SkipWithError("failed to load schema");
+    return;
+  }
+  const rapidjson::SchemaDocument schema(*schema_d);
+  FrameTimestampReader reader(schema);
+  const auto validate = (state.range(0) != 0);
+
+  for (auto _ : state) {
+    const auto json = get_file_as_string(file.path());
+    const auto timestamp = reader.read(json, validate);
+    if (!timestamp) {
+      state.SkipWithError(reader.get_error_string().c_str());
+      break;
+    }
+    benchmark::DoNotOptimize(*timestamp);
+  }
+}
+BENCHMARK(BM_FrameTimestampReader)->Arg(0)->Arg(1);
+
+//------------------------------------------------------------------------------
+
+/** @brief Stream and validate a bus signal file, converting every signal. */
+static void BM_read_bus_signals(benchmark::State& state) {
+  const auto n = static_cast<size_t>(state.range(0));
+  const bench::TempFile file(bench::make_bus_signal_json(n), ".json");
+  auto schema_d = get_rapidjson_dom(
+      bench::get_schema_path("sensor_fusion_bus_signal.schema"));
+  if (!schema_d) {
+    state.SkipWithError("failed to load schema");
+    return;
+  }
+  const rapidjson::SchemaDocument schema(*schema_d);
+
+  size_t num_samples = 0;
+  for (auto _ : state) {
+    BusSignalHandler handler(
+        std::set<std::string>(), [](const std::string&) { return true; },
+        [&num_samples](const std::string&, const std::string&,
+                       const std::vector<uint64_t>& times,
+                       const std::vector<double>&) {
+          num_samples += times.size();
+          return true;
+        });
+    std::string err_string;
+    if (!read_bus_signals(file.path(), schema, handler, err_string)) {
+      state.SkipWithError(err_string.c_str());
+      break;
+    }
+  }
+  benchmark::DoNotOptimize(num_samples);
+  state.SetItemsProcessed(static_cast<int64_t>(num_samples));
+}
+BENCHMARK(BM_read_bus_signals)->Arg(1 << 10)->Arg(1 << 14);
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
@@ -0,0 +1,134 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <benchmark/benchmark.h>
+
+#include "a2d2_to_ros/msg_utils.hpp"
+#include "a2d2_to_ros/npz.hpp"
+#include "synthetic_data.hpp"
+
+namespace a2d2_to_ros {
+
+//------------------------------------------------------------------------------
+
+/** @brief Build (and so allocate) a message for a frame. */
+static void BM_build_pc2_msg(benchmark::State& state) {
+  const auto n = static_cast<uint32_t>(state.range(0));
+  for (auto _ : state) {
+    auto msg = build_pc2_msg("frame", ros::Time(1, 0), true, n);
+    benchmark::DoNotOptimize(msg.data.data());
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n));
+}
+BENCHMARK(BM_build_pc2_msg)->Arg(1 << 14)->Arg(1 << 16)->Arg(1 << 18);
+
+//------------------------------------------------------------------------------
+
+/**
+ * @brief Rebuild a message that has been written, as the lidar converter does
+ * with the clouds that it recycles.
+ */
+static void BM_rebuild_pc2_msg(benchmark::State& state) {
+  const auto n = static_cast<uint32_t>(state.range(0));
+  const auto layout = get_full_point_layout();
+  sensor_msgs::PointCloud2 msg;
+  for (auto _ : state) {
+    rebuild_pc2_msg(layout, "frame", ros::Time(1, 0), true, n, msg);
+    benchmark::DoNotOptimize(msg.data.data());
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n));
+}
+BENCHMARK(BM_rebuild_pc2_msg)->Arg(1 << 14)->Arg(1 << 16)->Arg(1 << 18);
+
+//------------------------------------------------------------------------------
+
+/**
+ * @brief Fill a prebuilt message from the columns of a mapped frame, for the
+ * full layout (range(1) == 0) and the compact 'xyzi' layout.
+ */
+static void BM_fill_pc2_msg(benchmark::State& state) {
+  const auto n = static_cast<size_t>(state.range(0));
+  const auto layout =
+      *get_point_layout((state.range(1) == 0) ? "all" : "xyzi");
+  const bench::TempFile file(bench::make_lidar_npz(n, false), ".npz");
+  npz::MappedNpz npz;
+  if (!npz.open(file.path())) {
+    state.SkipWithError("failed to load synthetic npz");
+    return;
+  }
+  const auto columns = npz::get_columns(npz);
+
+  // stamped at the first point so that timestamp offsets would fit
+  auto msg = build_pc2_msg(layout, "frame", ros::Time(1554121595, 35037000),
+                           true, static_cast<uint32_t>(n));
+  for (auto _ : state) {
+    if (!fill_pc2_msg(layout, columns, msg)) {
+      state.SkipWithError("failed to fill message");
+      break;
+    }
+    benchmark::DoNotOptimize(msg.data.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n));
+  state.SetBytesProcessed(state.iterations() *
+                          static_cast<int64_t>(msg.data.size()));
+}
+BENCHMARK(BM_fill_pc2_msg)
+    ->Args({1 << 14, 0})
+    ->Args({1 << 16, 0})
+    ->Args({1 << 18, 0})
+    ->Args({1 << 16, 1});
+
+//------------------------------------------------------------------------------
+
+/** @brief Fill a prebuilt message and a depth map in the same pass. */
+static void BM_fill_pc2_msg_depth_image(benchmark::State& state) {
+  const auto n = static_cast<size_t>(state.range(0));
+  const bench::TempFile file(bench::make_lidar_npz(n, false), ".npz");
+  npz::MappedNpz npz;
+  if (!npz.open(file.path())) {
+    state.SkipWithError("failed to load synthetic npz");
+    return;
+  }
+  const auto columns = npz::get_columns(npz);
+
+  auto msg = build_pc2_msg("frame", ros::Time(1, 0), true,
+                           static_cast<uint32_t>(n));
+  auto depth = build_depth_image_msg("camera", ros::Time(1, 0), 1920, 1208);
+  for (auto _ : state) {
+    depth = build_depth_image_msg("camera", ros::Time(1, 0), 1920, 1208,
+                                  std::move(depth.data));
+    if (!fill_pc2_msg(columns, msg, depth)) {
+      state.SkipWithError("failed to fill message");
+      break;
+    }
+    benchmark::DoNotOptimize(depth.data.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n));
+}
+BENCHMARK(BM_fill_pc2_msg_depth_image)->Arg(1 << 16);
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
@@ -0,0 +1,84 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <benchmark/benchmark.h>
+
+#include "a2d2_to_ros/npz.hpp"
+#include "synthetic_data.hpp"
+
+namespace a2d2_to_ros {
+
+namespace {
+
+/// points per frame: about the size of a single A2D2 lidar frame and larger
+void point_counts(benchmark::internal::Benchmark* b) {
+  for (const auto deflate : {0, 1}) {
+    for (const auto n : {1 << 14, 1 << 16, 1 << 18}) {
+      b->Args({n, deflate});
+    }
+  }
+}
+
+}  // namespace
+
+//------------------------------------------------------------------------------
+
+/** @brief Open (map and parse, or inflate) an npz file and verify it. */
+static void BM_npz_open_verify_structure(benchmark::State& state) {
+  const auto n = static_cast<size_t>(state.range(0));
+  const bench::TempFile file(bench::make_lidar_npz(n, state.range(1) != 0),
+                             ".npz");
+  for (auto _ : state) {
+    npz::MappedNpz npz;
+    if (!npz.open(file.path()) || !npz::verify_structure(npz)) {
+      state.SkipWithError("failed to load synthetic npz");
+      break;
+    }
+    benchmark::DoNotOptimize(npz.get_arrays().size());
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n));
+}
+BENCHMARK(BM_npz_open_verify_structure)->Apply(point_counts);
+
+//------------------------------------------------------------------------------
+
+/** @brief Verify and summarize an already opened frame. */
+static void BM_npz_verify_frame(benchmark::State& state) {
+  const auto n = static_cast<size_t>(state.range(0));
+  const bench::TempFile file(bench::make_lidar_npz(n, false), ".npz");
+  npz::MappedNpz npz;
+  if (!npz.open(file.path())) {
+    state.SkipWithError("failed to load synthetic npz");
+    return;
+  }
+  for (auto _ : state) {
+    const auto summary = npz::verify_frame(npz);
+    benchmark::DoNotOptimize(summary.valid);
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n));
+}
+BENCHMARK(BM_npz_verify_frame)->Arg(1 << 14)->Arg(1 << 16)->Arg(1 << 18);
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
@@ -0,0 +1,318 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "synthetic_data.hpp"
+
+#include <zlib.h>
+
+#include <cstring>
+#include <fstream>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "a2d2_to_ros/npz.hpp"
+
+namespace {
+
+void append_u16(std::string& s, uint16_t v) {
+  s += static_cast<char>(v & 0xFF);
+  s += static_cast<char>(v >> 8);
+}
+
+void append_u32(std::string& s, uint32_t v) {
+  append_u16(s, static_cast<uint16_t>(v & 0xFFFF));
+  append_u16(s, static_cast<uint16_t>(v >> 16));
+}
+
+/** @brief Build a .npy file with a 1.0 header, padded the way numpy does. */
+template <typename T>
+std::string make_npy(const std::string& descr, const std::string& shape,
+                     const std::vector<T>& values) {
+  auto header = ("{'descr': '" + descr +
+                 "', 'fortran_order': False, 'shape': " + shape + ", }");
+  const auto unpadded_size = (10 + header.size() + 1);
+  header.append((64 - (unpadded_size % 64)) % 64, ' ');
+  header += '\n';
+
+  std::string npy("\x93NUMPY\x01\x00", 8);
+  append_u16(npy, static_cast<uint16_t>(header.size()));
+  npy += header;
+  npy.append(reinterpret_cast<const char*>(values.data()),
+             values.size() * sizeof(T));
+  return npy;
+}
+
+std::string deflate_raw(const std::string& data) {
+  z_stream stream;
+  std::memset(&stream, 0, sizeof(stream));
+  deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+               Z_DEFAULT_STRATEGY);
+  std::string out(deflateBound(&stream, data.size()), '\0');
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in = static_cast<uInt>(data.size());
+  stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+  stream.avail_out = static_cast<uInt>(out.size());
+  deflate(&stream, Z_FINISH);
+  out.resize(stream.total_out);
+  deflateEnd(&stream);
+  return out;
+}
+
+/** @brief Build a zip archive of (name, contents) members. */
+std::string make_zip(const std::vector<std::pair<std::string, std::string>>& m,
+                     bool deflate) {
+  std::string zip;
+  std::string directory;
+  for (const auto& member : m) {
+    const auto& name = member.first;
+    const auto& npy = member.second;
+    const auto payload = (deflate ? deflate_raw(npy) : npy);
+    const auto crc = static_cast<uint32_t>(
+        crc32(0, reinterpret_cast<const Bytef*>(npy.data()),
+              static_cast<uInt>(npy.size())));
+    const auto method = static_cast<uint16_t>(deflate ? 8 : 0);
+    const auto offset = static_cast<uint32_t>(zip.size());
+
+    append_u32(zip, 0x04034b50);
+    append_u16(zip, 20);  // version needed
+    append_u16(zip, 0);   // flags
+    append_u16(zip, method);
+    append_u32(zip, 0);  // time and date
+    append_u32(zip, crc);
+    append_u32(zip, static_cast<uint32_t>(payload.size()));
+    append_u32(zip, static_cast<uint32_t>(npy.size()));
+    append_u16(zip, static_cast<uint16_t>(name.size()));
+    append_u16(zip, 0);  // extra field length
+    zip += name;
+    zip += payload;
+
+    append_u32(directory, 0x02014b50);
+    append_u16(directory, 20);  // version made by
+    append_u16(directory, 20);  // version needed
+    append_u16(directory, 0);   // flags
+    append_u16(directory, method);
+    append_u32(directory, 0);  // time and date
+    append_u32(directory, crc);
+    append_u32(directory, static_cast<uint32_t>(payload.size()));
+    append_u32(directory, static_cast<uint32_t>(npy.size()));
+    append_u16(directory, static_cast<uint16_t>(name.size()));
+    append_u16(directory, 0);  // extra field length
+    append_u16(directory, 0);  // comment length
+    append_u16(directory, 0);  // disk number
+    append_u16(directory, 0);  // internal attributes
+    append_u32(directory, 0);  // external attributes
+    append_u32(directory, offset);
+    directory += name;
+  }
+
+  const auto directory_offset = static_cast<uint32_t>(zip.size());
+  zip += directory;
+  append_u32(zip, 0x06054b50);
+  append_u16(zip, 0);  // disk number
+  append_u16(zip, 0);  // disk with the central directory
+  append_u16(zip, static_cast<uint16_t>(m.size()));
+  append_u16(zip, static_cast<uint16_t>(m.size()));
+  append_u32(zip, static_cast<uint32_t>(directory.size()));
+  append_u32(zip, directory_offset);
+  append_u16(zip, 0);  // comment length
+  return zip;
+}
+
+}  // namespace
+
+namespace a2d2_to_ros {
+namespace bench {
+
+//------------------------------------------------------------------------------
+
+std::string make_lidar_npz(size_t num_points, bool deflate) {
+  namespace npz = a2d2_to_ros::npz;
+  const auto n = num_points;
+  const auto shape = ("(" + std::to_string(n) + ",)");
+
+  // values vary per point so that compression does not degenerate
+  const auto f8 = [&](double offset, double scale) {
+    std::vector<double> v(n);
+    for (size_t i = 0; i < n; ++i) {
+      v[i] = (offset + (scale * static_cast<double>(i % 1021)));
+    }
+    return make_npy("<f8", shape, v);
+  };
+  const auto i8 = [&](int64_t offset, int64_t modulus) {
+    std::vector<int64_t> v(n);
+    for (size_t i = 0; i < n; ++i) {
+      v[i] = (offset + (static_cast<int64_t>(i) % modulus));
+    }
+    return make_npy("<i8", shape, v);
+  };
+
+  std::vector<double> points(3 * n);
+  for (size_t i = 0; i < points.size(); ++i) {
+    points[i] = (0.01 * static_cast<double>(i % 4099));
+  }
+  std::vector<int64_t> timestamps(n);
+  for (size_t i = 0; i < n; ++i) {
+    timestamps[i] = (1554121595035037 + static_cast<int64_t>(i));
+  }
+  const std::vector<uint8_t> valid(n, 1);
+
+  const auto fields = npz::Fields::get_fields();
+  std::vector<std::string> npys(fields.size());
+  npys[npz::Fields::POINTS_IDX] =
+      make_npy("<f8", "(" + std::to_string(n) + ", 3)", points);
+  npys[npz::Fields::AZIMUTH_IDX] = f8(0.0, 0.001);
+  npys[npz::Fields::BOUNDARY_IDX] = i8(0, 2);
+  npys[npz::Fields::COL_IDX] = f8(0.0, 1.5);
+  npys[npz::Fields::DEPTH_IDX] = f8(1.0, 0.05);
+  npys[npz::Fields::DISTANCE_IDX] = f8(1.0, 0.06);
+  npys[npz::Fields::ID_IDX] = i8(0, 5);
+  npys[npz::Fields::RECTIME_IDX] = make_npy("<i8", shape, timestamps);
+  npys[npz::Fields::REFLECTANCE_IDX] = i8(0, 256);
+  npys[npz::Fields::ROW_IDX] = f8(0.0, 1.1);
+  npys[npz::Fields::TIMESTAMP_IDX] = make_npy("<i8", shape, timestamps);
+  npys[npz::Fields::VALID_IDX] = make_npy("|b1", shape, valid);
+
+  std::vector<std::pair<std::string, std::string>> members;
+  for (size_t i = 0; i < fields.size(); ++i) {
+    members.emplace_back(fields[i] + ".npy", std::move(npys[i]));
+  }
+  return make_zip(members, deflate);
+}
+
+//------------------------------------------------------------------------------
+
+std::string make_camera_frame_json(uint64_t timestamp) {
+  return "{\n"
+         "  \"cam_tstamp\": " +
+         std::to_string(timestamp) +
+         ",\n"
+         "  \"cam_name\": \"front_center\",\n"
+         "  \"image_zoom\": 1.0,\n"
+         "  \"image_png\": "
+         "\"20190401145936_camera_frontcenter_000000080.png\",\n"
+         "  \"pcld_npz\": \"20190401145936_lidar_frontcenter_000000080.npz\",\n"
+         "  \"pcld_view\": {\n"
+         "    \"origin\": [1.711045726422736, -5.735179668849011e-09, "
+         "0.9431449279047172],\n"
+         "    \"x-axis\": [0.9995434309991505, -0.008282196165108387, "
+         "0.02908725486297257],\n"
+         "    \"y-axis\": [0.00827788599088859, 0.9999712680480445, "
+         "-0.0006130771280265999]\n"
+         "  },\n"
+         "  \"lidar_ids\": {\n"
+         "    \"0\": \"front_left\",\n"
+         "    \"1\": \"rear_right\",\n"
+         "    \"2\": \"front_center\",\n"
+         "    \"3\": \"front_right\",\n"
+         "    \"4\": \"rear_left\"\n"
+         "  }\n"
+         "}\n";
+}
+
+//------------------------------------------------------------------------------
+
+std::string make_bus_signal_json(size_t num_samples) {
+  // (name, unit, binary) for every signal the schema requires
+  const std::vector<std::tuple<std::string, std::string, bool>> signals = {
+      std::make_tuple("acceleration_x", "\"Unit_MeterPerSeconSquar\"", false),
+      std::make_tuple("acceleration_y", "\"Unit_MeterPerSeconSquar\"", false),
+      std::make_tuple("acceleration_z", "\"Unit_MeterPerSeconSquar\"", false),
+      std::make_tuple("angular_velocity_omega_x",
+                      "\"Unit_DegreOfArcPerSecon\"", false),
+      std::make_tuple("angular_velocity_omega_y",
+                      "\"Unit_DegreOfArcPerSecon\"", false),
+      std::make_tuple("angular_velocity_omega_z",
+                      "\"Unit_DegreOfArcPerSecon\"", false),
+      std::make_tuple("accelerator_pedal", "\"Unit_PerCent\"", false),
+      std::make_tuple("accelerator_pedal_gradient_sign", "null", true),
+      std::make_tuple("steering_angle_calculated_sign", "null", true),
+      std::make_tuple("brake_pressure", "\"Unit_Bar\"", false),
+      std::make_tuple("distance_pulse_front_left", "null", false),
+      std::make_tuple("distance_pulse_front_right", "null", false),
+      std::make_tuple("distance_pulse_rear_left", "null", false),
+      std::make_tuple("distance_pulse_rear_right", "null", false),
+      std::make_tuple("latitude_degree", "\"Unit_DegreOfArc\"", false),
+      std::make_tuple("longitude_degree", "\"Unit_DegreOfArc\"", false),
+      std::make_tuple("latitude_direction", "null", true),
+      std::make_tuple("longitude_direction", "null", true),
+      std::make_tuple("pitch_angle", "\"Unit_DegreOfArc\"", false),
+      std::make_tuple("roll_angle", "\"Unit_DegreOfArc\"", false),
+      std::make_tuple("steering_angle_calculated", "\"Unit_DegreOfArc\"",
+                      false),
+      std::make_tuple("vehicle_speed", "\"Unit_KiloMeterPerHour\"", false)};
+
+  constexpr uint64_t START_TIME = 1554121593909500;
+  std::string json("{\n");
+  for (size_t s = 0; s < signals.size(); ++s) {
+    const auto binary = std::get<2>(signals[s]);
+    json += ("  \"" + std::get<0>(signals[s]) + "\": {\n    \"unit\": " +
+             std::get<1>(signals[s]) + ",\n    \"values\": [");
+    for (size_t i = 0; i < num_samples; ++i) {
+      const auto time = (START_TIME + (10000 * i));
+      // every value is within the range of every signal
+      const auto value =
+          (binary ? std::to_string(i % 2) : ((i % 2) ? "0.25" : "0.5"));
+      json += ((i ? ", [" : "[") + std::to_string(time) + ", " + value + "]");
+    }
+    json += "]\n  }";
+    json += (((s + 1) < signals.size()) ? ",\n" : "\n");
+  }
+  json += "}\n";
+  return json;
+}
+
+//------------------------------------------------------------------------------
+
+std::string get_schema_path(const std::string& filename) {
+  return (std::string(A2D2_TO_ROS_SCHEMA_DIR) + "/" + filename);
+}
+
+//------------------------------------------------------------------------------
+
+TempFile::TempFile(const std::string& contents, const std::string& extension)
+    : path_((boost::filesystem::temp_directory_path() /
+             boost::filesystem::unique_path("a2d2_to_ros-bench-%%%%%%" +
+                                            extension))
+                .string()) {
+  std::ofstream ofs(path_, std::ios::binary);
+  ofs << contents;
+}
+
+//------------------------------------------------------------------------------
+
+TempFile::~TempFile() {
+  boost::system::error_code ec;
+  boost::filesystem::remove(path_, ec);
+}
+
+//------------------------------------------------------------------------------
+
+const std::string& TempFile::path() const { return path_; }
+
+//------------------------------------------------------------------------------
+
+}  // namespace bench
+}  // namespace a2d2_to_ros
@@ -0,0 +1,78 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef A2D2_TO_ROS__BENCH__SYNTHETIC_DATA_HPP_
+#define A2D2_TO_ROS__BENCH__SYNTHETIC_DATA_HPP_
+
+#include <cstdint>
+#include <string>
+
+namespace a2d2_to_ros {
+namespace bench {
+
+/**
+ * @brief Build an npz archive of a lidar frame with num_points points, laid
+ * out the way numpy.savez (or numpy.savez_compressed, if deflate) writes it.
+ * @note Every point is valid, and the timestamps increase by one microsecond
+ * per point from 1554121595035037.
+ */
+std::string make_lidar_npz(size_t num_points, bool deflate);
+
+/**
+ * @brief Build a camera frame info JSON document that passes the
+ * sensor_fusion_camera_frame schema.
+ */
+std::string make_camera_frame_json(uint64_t timestamp);
+
+/**
+ * @brief Build a bus signal JSON document that passes the
+ * sensor_fusion_bus_signal schema, with num_samples samples for every signal.
+ */
+std::string make_bus_signal_json(size_t num_samples);
+
+/** @brief Get the path of a schema shipped in this package's schemas/. */
+std::string get_schema_path(const std::string& filename);
+
+/**
+ * @brief A uniquely named file in the temp directory that is removed when this
+ * object is destroyed.
+ */
+class TempFile {
+ public:
+  /** @param extension Extension of the file name, including the dot. */
+  TempFile(const std::string& contents, const std::string& extension);
+  ~TempFile();
+
+  TempFile(const TempFile&) = delete;
+  TempFile& operator=(const TempFile&) = delete;
+
+  const std::string& path() const;
+
+ private:
+  std::string path_;
+};  // class TempFile
+
+}  // namespace bench
+}  // namespace a2d2_to_ros
+
+#endif  // A2D2_TO_ROS__BENCH__SYNTHETIC_DATA_HPP_
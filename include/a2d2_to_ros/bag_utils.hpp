@@ -0,0 +1,252 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef A2D2_TO_ROS__BAG_UTILS_HPP_
+#define A2D2_TO_ROS__BAG_UTILS_HPP_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <boost/make_shared.hpp>
+#include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <ros/message_traits.h>
+#include <ros/time.h>
+#include <rosbag/bag.h>
+
+#include "a2d2_to_ros/parallel.hpp"
+
+namespace a2d2_to_ros {
+
+/**
+ * @brief Get the index of the split window that a time offset falls into.
+ * @pre split_duration is finite and > 0.
+ * @return The window index, or zero if the offset is negative.
+ */
+size_t get_window_index(double time_offset, double split_duration);
+
+/**
+ * @brief Get the directory name for a split window.
+ * @note Names follow the 'timespan_<start>s_<end>s' convention used by
+ * scripts/convert.sh.
+ */
+std::string get_window_name(double window_start, double window_end);
+
+/**
+ * @brief Get the filename of a part of a bag, which is the bag filename for
+ * the first part and '<stem>_part<part>.<extension>' for the others, e.g.,
+ * 'lidar_part1.bag'.
+ */
+std::string get_bag_part_filename(const std::string& bag_filename,
+                                  size_t part);
+
+/**
+ * @brief Settings applied to every bag that is opened for writing.
+ */
+struct BagOptions {
+  /// rosbag's own default chunk threshold
+  static constexpr uint32_t DEFAULT_CHUNK_THRESHOLD = (768 * 1024);
+
+  rosbag::compression::CompressionType compression =
+      rosbag::compression::Uncompressed;
+  uint32_t chunk_threshold = DEFAULT_CHUNK_THRESHOLD;
+};  // struct BagOptions
+
+/**
+ * @brief Convert a compression name ('none', 'bz2', or 'lz4') to its type.
+ * @return The compression type, or a null reference if the name is unknown.
+ */
+boost::optional<rosbag::compression::CompressionType> get_compression_type(
+    const std::string& name);
+
+/**
+ * @brief A bag file and its size (bytes) as of a checkpoint.
+ */
+struct BagSegment {
+  std::string path;
+  uint64_t size = 0;
+};  // struct BagSegment
+
+/**
+ * @brief Writes messages to one bag per fixed-length time window.
+ * @note Bags are opened lazily on the first write into their window and are
+ * kept open until close() or checkpoint() is called, so messages do not need
+ * to arrive in time order. For unsplit output, the bag is always created,
+ * even if nothing is written to it.
+ * @note A bag is never reopened once it has been closed by a checkpoint.
+ * Writes into its window after the checkpoint go to the next part of the
+ * window's bag (see get_bag_part_filename) instead, so the bags of a
+ * checkpoint stay exactly as they were when it was made.
+ * @note If compression is enabled, messages are copied (or moved) into a
+ * queue and written, and so compressed, on a background thread. Writes keep
+ * their order. Exceptions from the background thread, e.g.,
+ * rosbag::BagException, are rethrown from a later call to write or close.
+ */
+class SplitBagWriter {
+ public:
+  /**
+   * @param output_path Directory to write bag files (or window directories) to.
+   * @param bag_filename Filename of each bag, including the extension.
+   * @param min_time_offset Offset (seconds) at which the first window starts.
+   * @param split_duration Length (seconds) of each window. Splitting is
+   * disabled if this is not finite and > 0, in which case a single bag is
+   * written to output_path/bag_filename.
+   * @param options Compression and chunk settings for each bag.
+   */
+  SplitBagWriter(std::string output_path, std::string bag_filename,
+                 double min_time_offset, double split_duration,
+                 BagOptions options = BagOptions());
+
+  /** @brief Closes all bags that are still open. */
+  ~SplitBagWriter();
+
+  SplitBagWriter(const SplitBagWriter&) = delete;
+  SplitBagWriter& operator=(const SplitBagWriter&) = delete;
+
+  /**
+   * @brief Write a message to the bag of the window containing the offset.
+   * @param time_since_begin Offset (seconds) of the message from the start of
+   * the data, i.e., the same offset that min-time-offset is compared against.
+   * @param latch If true, the message is recorded as latched, so that rosbag
+   * play republishes it to subscribers that connect later (as for
+   * /tf_static).
+   */
+  template <typename T>
+  void write(const std::string& topic, double time_since_begin,
+             const ros::Time& stamp, T&& msg, bool latch = false) {
+    typedef typename std::decay<T>::type Msg;
+    auto& bag = get_bag(time_since_begin);
+    const auto header = (latch ? get_latching_header<Msg>()
+                               : boost::shared_ptr<ros::M_string>());
+    if (!writer_) {
+      bag.write(topic, stamp, msg, header);
+      return;
+    }
+
+    const auto queued = std::make_shared<Msg>(std::forward<T>(msg));
+    writer_->push([&bag, topic, stamp, queued, header]() {
+      bag.write(topic, stamp, *queued, header);
+    });
+  }
+
+  /**
+   * @brief Get the index of the window (and so the bag) that messages with
+   * the offset are written to.
+   * @return The window index, which is always zero if output is not split.
+   */
+  size_t get_window(double time_since_begin) const;
+
+  /** @brief Finish any queued writes, then close all open bags. */
+  void close();
+
+  /**
+   * @brief Finish any queued writes and close all open bags, so that every
+   * bag written so far is complete and indexed.
+   * @note The next write into the window of a closed bag opens a new part.
+   * @return Every bag this writer has opened, with its size, which no longer
+   * changes.
+   */
+  std::vector<BagSegment> checkpoint();
+
+  /**
+   * @brief Continue the bags of an earlier checkpoint instead of starting
+   * them over.
+   * @note Each bag is checked to be the size it was at the checkpoint and to
+   * be readable. Parts that were started after the checkpoint, i.e., that
+   * an interrupted run left incomplete, are removed, and writes into a window
+   * continue with a new part after its last complete one. Segments of other
+   * writers, i.e., of bags with another filename, are ignored.
+   * @pre Nothing has been written yet.
+   * @return False if a bag is missing, has changed since the checkpoint, or
+   * cannot be read.
+   */
+  bool resume(const std::vector<BagSegment>& segments);
+
+  /** @brief Whether output is split into multiple windows. */
+  bool is_split() const;
+
+  /**
+   * @brief Get the total size (bytes) of every bag file this writer opened.
+   * @note This is only exact once close() has been called.
+   */
+  uint64_t get_bytes_written() const;
+
+ private:
+  // maximum number of messages waiting for the background writer
+  static constexpr size_t MAX_QUEUED_WRITES = 64;
+  // publisher recorded for latched messages, as rosbag record would
+  static constexpr auto LATCHING_CALLER_ID = "/a2d2_to_ros";
+
+  /**
+   * @brief Get the bag of the window containing the offset, opening it first
+   * if necessary.
+   */
+  rosbag::Bag& get_bag(double time_since_begin);
+
+  /** @brief Get the directory of a window's bag parts, creating it. */
+  std::string get_window_path(size_t window_idx) const;
+
+  /**
+   * @brief Connection header for messages of a type that are recorded as
+   * latched.
+   * @note rosbag writes a given connection header as is, so it has the type,
+   * MD5 sum, and definition of the message that rosbag would otherwise fill
+   * in; without them, the messages cannot be read back.
+   */
+  template <typename Msg>
+  static boost::shared_ptr<ros::M_string> get_latching_header() {
+    // shared by every latched message of the type; rosbag only reads it
+    static const auto header = [] {
+      auto h = boost::make_shared<ros::M_string>();
+      (*h)["type"] = ros::message_traits::datatype<Msg>();
+      (*h)["md5sum"] = ros::message_traits::md5sum<Msg>();
+      (*h)["message_definition"] = ros::message_traits::definition<Msg>();
+      (*h)["callerid"] = LATCHING_CALLER_ID;
+      (*h)["latching"] = "1";
+      return h;
+    }();
+    return header;
+  }
+
+  const std::string output_path_;
+  const std::string bag_filename_;
+  const double min_time_offset_;
+  const double split_duration_;
+  const BagOptions options_;
+  std::map<size_t, std::unique_ptr<rosbag::Bag>> bags_;
+  // every bag that has been opened, including ones that are closed
+  std::vector<std::string> bag_paths_;
+  // number of parts opened in each window directory
+  std::map<std::string, size_t> num_parts_;
+  std::unique_ptr<TaskQueue> writer_;
+};  // class SplitBagWriter
+
+}  // namespace a2d2_to_ros
+
+#endif  // A2D2_TO_ROS__BAG_UTILS_HPP_
@@ -0,0 +1,146 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef A2D2_TO_ROS__BUS_SIGNAL_READER_HPP_
+#define A2D2_TO_ROS__BUS_SIGNAL_READER_HPP_
+
+#include <cstdint>
+#include <functional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "rapidjson/reader.h"
+#include "rapidjson/schema.h"
+
+namespace a2d2_to_ros {
+
+/**
+ * @brief SAX handler for the bus signal JSON data set.
+ *
+ * The data set is an object that maps each signal name to an object containing
+ * the signal 'unit' and its 'values', an array of [timestamp, value] pairs.
+ * Pairs are passed to the sample callback in chunks of up to CHUNK_SIZE as
+ * they are parsed, so memory use does not depend on the size of the data set.
+ * The only exception is a signal whose unit appears after its values; its
+ * samples are buffered until the unit is known, and then passed in one chunk.
+ *
+ * @note A callback that returns false stops parsing.
+ */
+class BusSignalHandler
+    : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, BusSignalHandler> {
+ public:
+  /**
+   * @brief Called once per converted signal, before any of its samples.
+   */
+  typedef std::function<bool(const std::string& name)> SignalCallback;
+
+  /**
+   * @brief Called with consecutive [timestamp, value] pairs of a converted
+   * signal, split into parallel arrays of equal size. All of the samples in a
+   * chunk belong to the same signal and share the same unit, so the unit can
+   * be resolved once and the values converted in a single pass.
+   * @note A null unit is reported as "null".
+   */
+  typedef std::function<bool(const std::string& name, const std::string& unit,
+                             const std::vector<uint64_t>& times,
+                             const std::vector<double>& values)>
+      SampleCallback;
+
+  static constexpr size_t CHUNK_SIZE = 4096;
+
+  /**
+   * @param signals The names of the signals to convert; all others are
+   * skipped. If empty, every signal is converted.
+   */
+  BusSignalHandler(std::set<std::string> signals,
+                   SignalCallback signal_callback,
+                   SampleCallback sample_callback);
+
+  bool Default();
+  bool Null();
+  bool Int(int i);
+  bool Uint(unsigned u);
+  bool Int64(int64_t i);
+  bool Uint64(uint64_t u);
+  bool Double(double d);
+  bool String(const char* str, rapidjson::SizeType length, bool copy);
+  bool StartObject();
+  bool Key(const char* str, rapidjson::SizeType length, bool copy);
+  bool EndObject(rapidjson::SizeType member_count);
+  bool StartArray();
+  bool EndArray(rapidjson::SizeType element_count);
+
+  /**
+   * @brief Describes why parsing was stopped by this handler.
+   * @return The empty string if the handler has not stopped parsing.
+   */
+  const std::string& get_error_string() const;
+
+ private:
+  enum Depth : size_t {
+    DATA_SET = 1,
+    SIGNAL = 2,
+    VALUES = 3,
+    SAMPLE = 4,
+  };
+
+  bool is_converted_signal() const;
+  bool number(boost::optional<uint64_t> time, double value);
+  bool on_sample(uint64_t time, double value);
+  bool flush();
+  bool fail(const std::string& error_string);
+
+  const std::set<std::string> signals_;
+  const SignalCallback signal_callback_;
+  const SampleCallback sample_callback_;
+
+  size_t depth_ = 0;
+  std::string signal_;
+  std::string key_;
+  boost::optional<std::string> unit_;
+  std::vector<uint64_t> times_;
+  std::vector<double> values_;
+
+  size_t sample_idx_ = 0;
+  boost::optional<uint64_t> sample_time_;
+  boost::optional<double> sample_value_;
+
+  std::string error_string_;
+};  // class BusSignalHandler
+
+/**
+ * @brief Stream the bus signal JSON data set at path through handler, using a
+ * schema validator as a filter in front of it.
+ * @return True if the file was read, validated, and handled successfully. On
+ * failure, error_string describes the problem.
+ */
+bool read_bus_signals(const std::string& path,
+                      const rapidjson::SchemaDocument& schema,
+                      BusSignalHandler& handler, std::string& error_string);
+
+}  // namespace a2d2_to_ros
+
+#endif  // A2D2_TO_ROS__BUS_SIGNAL_READER_HPP_
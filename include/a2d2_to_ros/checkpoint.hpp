@@ -0,0 +1,125 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef A2D2_TO_ROS__CHECKPOINT_HPP_
+#define A2D2_TO_ROS__CHECKPOINT_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "a2d2_to_ros/message_sink.hpp"
+
+namespace a2d2_to_ros {
+
+/**
+ * @brief Progress of a conversion, saved as it runs so that an interrupted
+ * conversion can be continued instead of started over.
+ *
+ * The checkpoint is stored as a small text sidecar file next to the bag it is
+ * for. Every bag in it was closed, and so indexed, when it was saved.
+ */
+struct Checkpoint {
+  /// appended to the bag filename to get the checkpoint filename
+  static const std::string FILENAME_SUFFIX;
+
+  /// identifies the inputs and options of the conversion
+  uint64_t key = 0;
+  /// index of the first selected frame that has not been written
+  size_t next_frame = 0;
+  /// every bag written so far
+  std::vector<BagSegment> segments;
+};  // struct Checkpoint
+
+/**
+ * @brief Get the key of a conversion.
+ * @param settings Every option that the output depends on, in a fixed format.
+ * @param paths Every input file, in the order that they are converted.
+ */
+uint64_t get_checkpoint_key(const std::string& settings,
+                            const std::vector<std::string>& paths);
+
+/**
+ * @brief Write a checkpoint to path, replacing any existing checkpoint.
+ * @return True if the checkpoint was written successfully.
+ */
+bool save_checkpoint(const std::string& path, const Checkpoint& checkpoint);
+
+/**
+ * @return The checkpoint stored at path, or a null reference if the file does
+ * not exist or is malformed.
+ */
+boost::optional<Checkpoint> load_checkpoint(const std::string& path);
+
+/**
+ * @brief Get the checkpoint to continue a conversion from.
+ * @param num_frames Number of frames that the conversion selected.
+ * @return The checkpoint at path; an empty checkpoint, i.e., one that starts
+ * from the first frame, if there is none; or a null reference if it is for
+ * other inputs or options.
+ */
+boost::optional<Checkpoint> get_resume_checkpoint(const std::string& path,
+                                                  uint64_t key,
+                                                  size_t num_frames);
+
+/**
+ * @brief Saves a checkpoint of one or more bag writers every time a given
+ * span of data has been written.
+ */
+class CheckpointWriter {
+ public:
+  /**
+   * @param path Path of the checkpoint file.
+   * @param key Key of the conversion, from get_checkpoint_key.
+   * @param interval Seconds of data between checkpoints. Checkpoints are
+   * disabled if this is not finite and > 0.
+   */
+  CheckpointWriter(std::string path, uint64_t key, double interval);
+
+  /**
+   * @brief Save a checkpoint if a full interval of data has been written since
+   * the last one.
+   * @param time_since_begin Offset (seconds) of the frame that was just
+   * written.
+   * @param next_frame Index of the frame after it.
+   * @param bags Every sink that the frames are written to.
+   * @return True unless a checkpoint was due and could not be written.
+   */
+  bool update(double time_since_begin, size_t next_frame,
+              const std::vector<MessageSink*>& bags);
+
+  /** @brief Remove the checkpoint file, once the conversion is finished. */
+  void remove() const;
+
+ private:
+  const std::string path_;
+  const uint64_t key_;
+  const double interval_;
+  boost::optional<double> last_time_;
+};  // class CheckpointWriter
+
+}  // namespace a2d2_to_ros
+
+#endif  // A2D2_TO_ROS__CHECKPOINT_HPP_
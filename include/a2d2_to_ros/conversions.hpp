@@ -26,8 +26,11 @@
 
 #include <ros/time.h>
 
+#include <algorithm>
 #include <cstdint>
 #include <cstdlib>
+#include <limits>
+#include <string>
 
 namespace a2d2_to_ros {
 
@@ -91,13 +94,14 @@ Units get_unit_enum(const std::string& unit_name);
  * @note See: https://www.ros.org/reps/rep-0103.html
  * @note Unit_PerCent values [0, 100] are projected to [0, 1].
  * @note Unit_null and Unit_Bar are passed through unmodified.
+ * @note Resolve the unit with get_unit_enum once per signal and use this
+ * overload for each value to avoid repeated string comparisons.
  * @return val in ROS standard units, or NaN if there is no conversion. Return
  * value is undefined if pre-condition is not satisfied.
  */
 template <typename T>
-T to_ros_units(const std::string& unit_name, const T& val) {
-  const auto u = get_unit_enum(unit_name);
-  switch (u) {
+T to_ros_units(Units units, const T& val) {
+  switch (units) {
     case Units::Unit_DegreOfArc:
     case Units::Unit_DegreOfArcPerSecon:
       return (val * static_cast<T>(M_PI / 180.0));
@@ -119,6 +123,58 @@ T to_ros_units(const std::string& unit_name, const T& val) {
   }
 }
 
+/**
+ * @brief Convert data set units to ROS units.
+ * @note See to_ros_units(Units, const T&). This overload looks up the unit on
+ * every call.
+ */
+template <typename T>
+T to_ros_units(const std::string& unit_name, const T& val) {
+  return to_ros_units(get_unit_enum(unit_name), val);
+}
+
+/**
+ * @brief Convert n values of the same unit to ROS units in a single pass.
+ * @note Results are identical to calling to_ros_units(Units, const T&) on
+ * each value. The unit is dispatched once, outside of the loops, so that each
+ * loop is a simple element-wise operation the compiler can vectorize.
+ * @note in and out may point to the same array.
+ */
+template <typename T>
+void to_ros_units(Units units, const T* in, T* out, size_t n) {
+  switch (units) {
+    case Units::Unit_DegreOfArc:
+    case Units::Unit_DegreOfArcPerSecon: {
+      const auto scale = static_cast<T>(M_PI / 180.0);
+      for (size_t i = 0; i < n; ++i) {
+        out[i] = (in[i] * scale);
+      }
+    } break;
+    case Units::Unit_KiloMeterPerHour: {
+      const auto scale = static_cast<T>(1000.0 / (60.0 * 60.0));
+      for (size_t i = 0; i < n; ++i) {
+        out[i] = (in[i] * scale);
+      }
+    } break;
+    case Units::Unit_PerCent: {
+      const auto divisor = static_cast<T>(100.0);
+      for (size_t i = 0; i < n; ++i) {
+        out[i] = (in[i] / divisor);
+      }
+    } break;
+    case Units::null:
+    case Units::Unit_Bar:
+    case Units::Unit_MeterPerSeconSquar:
+      if (in != out) {
+        std::copy(in, in + n, out);
+      }
+      break;
+    default:
+      std::fill(out, out + n, std::numeric_limits<T>::quiet_NaN());
+      break;
+  }
+}
+
 }  // namespace a2d2_to_ros
 
 #endif  // A2D2_TO_ROS__CONVERSIONS_HPP_
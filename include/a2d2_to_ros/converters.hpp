@@ -0,0 +1,309 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef A2D2_TO_ROS__CONVERTERS_HPP_
+#define A2D2_TO_ROS__CONVERTERS_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <boost/optional.hpp>
+#include <ros/time.h>
+#include <rapidjson/document.h>
+#include <rapidjson/schema.h>
+#include <sensor_msgs/CameraInfo.h>
+#include <sensor_msgs/CompressedImage.h>
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <std_msgs/Header.h>
+
+#include "a2d2_to_ros/data_pair.hpp"
+#include "a2d2_to_ros/downsample.hpp"
+#include "a2d2_to_ros/merge.hpp"
+#include "a2d2_to_ros/msg_utils.hpp"
+#include "a2d2_to_ros/npz.hpp"
+#include "a2d2_to_ros/parallel.hpp"
+#include "a2d2_to_ros/run_stats.hpp"
+#include "a2d2_to_ros/transform_utils.hpp"
+
+namespace a2d2_to_ros {
+
+/**
+ * @brief Camera infos by camera name, e.g., as read from the vehicle/sensor
+ * config.
+ */
+typedef std::map<std::string, sensor_msgs::CameraInfo> CameraInfoMap;
+
+/** @brief Messages of a converted lidar frame. */
+struct LidarFrameMessages {
+  sensor_msgs::PointCloud2 cloud;
+  boost::optional<sensor_msgs::Image> depth_map;
+  /// what verifying the frame found, e.g., for logging frame statistics
+  npz::FrameSummary summary;
+  /// lidar (i.e., camera) name of the frame, which recycle needs
+  std::string sensor_name;
+};  // struct LidarFrameMessages
+
+/**
+ * @brief Converts lidar frames to PointCloud2 messages (and depth maps).
+ *
+ * The converter holds everything that does not change between frames: the
+ * point layout, the downsampling options, and the camera resolution and pool
+ * of depth map buffers of each camera. Clouds and the scratch buffers of
+ * downsampling are drawn from pools too, so once as many frames as are in
+ * flight have been recycled, a frame neither allocates nor zeroes its cloud,
+ * nor rebuilds its field descriptors. Everything is freed with the converter.
+ *
+ * @note convert and recycle are safe to call concurrently, e.g., from the
+ * workers of ordered_parallel_for.
+ */
+class LidarFrameConverter {
+ public:
+  struct Options {
+    PointLayout layout = get_full_point_layout();
+    DownsampleOptions downsample;
+    bool include_depth_map = false;
+  };  // struct Options
+
+  /**
+   * @param camera_infos Resolution of the depth maps of each camera. Only
+   * needed if depth maps are included.
+   * @param stats Where the verify and message build stages are timed; it
+   * must outlive the converter.
+   */
+  LidarFrameConverter(Options options, const CameraInfoMap& camera_infos,
+                      RunStats& stats);
+
+  LidarFrameConverter(const LidarFrameConverter&) = delete;
+  LidarFrameConverter& operator=(const LidarFrameConverter&) = delete;
+
+  /**
+   * @brief Verify a lidar frame and convert it to its messages.
+   * @param npz The frame, which only needs to stay open during the call.
+   * @param sensor_name Name of the lidar, e.g., "front_center".
+   * @param stamp Header stamp of the messages.
+   * @return The messages, or none if the frame is not valid, or there is no
+   * depth map camera for the sensor; the reason is logged.
+   */
+  boost::optional<LidarFrameMessages> convert(const npz::MappedNpz& npz,
+                                              const std::string& sensor_name,
+                                              ros::Time stamp) const;
+
+  /**
+   * @brief Return the buffers of messages that have been written, so that
+   * later frames can reuse them.
+   * @note The messages are left empty.
+   */
+  void recycle(LidarFrameMessages& messages) const;
+
+  const Options& get_options() const { return options_; }
+
+ private:
+  // each camera's buffers are only reached through its (thread-safe) pool
+  struct DepthCamera {
+    uint32_t width;
+    uint32_t height;
+    mutable ObjectPool<std::vector<uint8_t>> buffers;
+  };  // struct DepthCamera
+
+  // the points that downsampling selects, and their gathered copy
+  struct Selection {
+    std::vector<uint32_t> indices;
+    SelectedColumns columns;
+  };  // struct Selection
+
+  const Options options_;
+  const bool downsample_;
+  RunStats& stats_;
+  std::unordered_map<std::string, DepthCamera> depth_cameras_;
+  // clouds of the layout that have been written, and the largest cloud data
+  // so far, which every cloud is reserved to so that it only grows once
+  mutable ObjectPool<sensor_msgs::PointCloud2> clouds_;
+  mutable ObjectPool<Selection> selections_;
+  mutable std::atomic<size_t> max_cloud_bytes_{0};
+};  // class LidarFrameConverter
+
+/** @brief Messages of a converted camera frame. */
+struct CameraFrameMessages {
+  std_msgs::Header header;
+  /// set if the image is passed through as a PNG
+  boost::optional<sensor_msgs::CompressedImage> compressed_image;
+  /// set if the image is decoded to raw BGR8
+  sensor_msgs::ImagePtr image;
+};  // struct CameraFrameMessages
+
+/**
+ * @brief Converts camera frames (PNG files) to image messages.
+ * @note convert and get_camera_info are safe to call concurrently.
+ */
+class CameraFrameConverter {
+ public:
+  /**
+   * @param compressed If true, PNG files are passed through as
+   * CompressedImage messages; otherwise they are decoded to Image messages.
+   * @param stats Where decoding and message building are timed; it must
+   * outlive the converter.
+   */
+  CameraFrameConverter(bool compressed, CameraInfoMap camera_infos,
+                       RunStats& stats);
+
+  /**
+   * @brief Convert the bytes of a PNG file to an image message.
+   * @param png_bytes Moved into the message if images are compressed, and
+   * otherwise left as they are, so that the caller can reuse the buffer.
+   * @param sensor_name Name of the camera, e.g., "front_center".
+   * @param stamp Header stamp of the message.
+   * @return The messages, or none if the PNG fails to decode; the reason is
+   * logged.
+   */
+  boost::optional<CameraFrameMessages> convert(std::vector<uint8_t>& png_bytes,
+                                               const std::string& sensor_name,
+                                               ros::Time stamp) const;
+
+  /**
+   * @brief Get the camera info of a camera, with the frame of its images.
+   * @return none if the camera is not known.
+   */
+  boost::optional<sensor_msgs::CameraInfo> get_camera_info(
+      const std::string& sensor_name) const;
+
+  bool is_compressed() const { return compressed_; }
+
+ private:
+  const bool compressed_;
+  const CameraInfoMap camera_infos_;
+  RunStats& stats_;
+};  // class CameraFrameConverter
+
+/** @brief A sample of a bus signal. */
+struct BusSignalSample {
+  uint64_t time;
+  /// in the original units
+  double value;
+  /// in ROS units, if converted values are included
+  DataPair::value_type::_data_type ros_value;
+  /// offset (seconds) from the first sample of the signal, or the start time
+  double time_since_begin;
+};  // struct BusSignalSample
+
+/** @brief The samples of a bus signal that are converted, and their topics. */
+struct BusSignal {
+  std::string name;
+  std::string header_topic;
+  std::string original_value_topic;
+  std::string original_units_topic;
+  std::string value_topic;
+  /// unit of the first sample, which is written along with it
+  std::string unit;
+  size_t num_samples = 0;
+};  // struct BusSignal
+
+/**
+ * @brief The converted signals of a bus signal data set file.
+ *
+ * The samples are spilled to a temporary file as they are converted, in runs
+ * that are each sorted by time, so that memory does not grow with the length
+ * of the drive; merging the runs (e.g., with merge_sorted_runs) visits them in
+ * time order, with the samples of equal times in file order.
+ */
+struct BusSignalData {
+  /// in file order
+  std::vector<BusSignal> signals;
+  /// runs of samples, in file order; removed with the data
+  std::unique_ptr<RunFile<BusSignalSample>> samples;
+  /// index (into signals) of the signal of each run
+  std::vector<size_t> run_signals;
+  /// angles (radians) of the chassis, in file order
+  std::vector<AngleSample> roll_angles;
+  std::vector<AngleSample> pitch_angles;
+  /// time that TF messages are offset from, which is that of the roll angles
+  boost::optional<ros::Time> tf_first_time;
+};  // struct BusSignalData
+
+/**
+ * @brief Reads, validates, and converts bus signal data set files.
+ *
+ * The converter holds the JSON schema of the data set (and the names of the
+ * signals that it requires, which are the ones converted), so that it is only
+ * loaded once for any number of files.
+ *
+ * @note convert is safe to call concurrently; every call has its own validator
+ * and handler.
+ */
+class BusSignalConverter {
+ public:
+  struct Options {
+    /// topics of a signal are <topic_prefix>/<signal name>/...
+    std::string topic_prefix;
+    bool include_converted = true;
+    uint64_t start_time = 0;
+    double min_time_offset = 0.0;
+    double duration = std::numeric_limits<double>::max();
+    bool verbose = false;
+  };  // struct Options
+
+  /**
+   * @brief Load the JSON schema of the data set.
+   * @return A converter, or nullptr if the schema cannot be read; the reason
+   * is logged.
+   */
+  static std::unique_ptr<BusSignalConverter> load(
+      const std::string& schema_path, Options options);
+
+  BusSignalConverter(const BusSignalConverter&) = delete;
+  BusSignalConverter& operator=(const BusSignalConverter&) = delete;
+
+  /**
+   * @brief Stream a data set file through the schema validator, and keep the
+   * samples of each signal that fall in the requested timespan.
+   * @note The time spent converting samples is taken out of the time reported
+   * for validation.
+   * @return The signals, or none if the file is not valid; the reason is
+   * logged.
+   */
+  boost::optional<BusSignalData> convert(const std::string& json_path,
+                                         RunStats& stats) const;
+
+  const std::set<std::string>& get_signal_names() const {
+    return signal_names_;
+  }
+
+ private:
+  BusSignalConverter(Options options, rapidjson::Document schema_document);
+
+  const Options options_;
+  // the schema keeps pointers into the document that it was built from
+  const std::unique_ptr<rapidjson::Document> schema_document_;
+  const std::unique_ptr<rapidjson::SchemaDocument> schema_;
+  std::set<std::string> signal_names_;
+};  // class BusSignalConverter
+
+}  // namespace a2d2_to_ros
+
+#endif  // A2D2_TO_ROS__CONVERTERS_HPP_
@@ -53,6 +53,26 @@ struct DataPair {
   DataPair(std_msgs::Header header, value_type value);
 };  // struct DataPair
 
+/**
+ * @brief Reusable storage for timestamp/value pair.
+ * @note Unlike DataPair, the messages are updated in place, so converting a
+ * stream of samples with one instance does not allocate after construction.
+ */
+struct MutableDataPair {
+  typedef DataPair::value_type value_type;
+
+  value_type value;
+  std_msgs::Header header;
+
+  explicit MutableDataPair(std::string frame_id);
+
+  /**
+   * @brief Replace the value and timestamp; the frame is unchanged.
+   * @pre time is valid according to valid_ros_timestamp.
+   */
+  void set(double value, uint64_t time);
+};  // struct MutableDataPair
+
 /**
  * @brief Compare two DataPair objects by timestamp.
  * @note Operator returns true iff lhs < rhs.
@@ -0,0 +1,103 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef A2D2_TO_ROS__DOWNSAMPLE_HPP_
+#define A2D2_TO_ROS__DOWNSAMPLE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "a2d2_to_ros/npz.hpp"
+
+namespace a2d2_to_ros {
+
+/**
+ * @brief Which points of a lidar frame are written.
+ * @note The steps are applied in order: invalid points are dropped, then every
+ * stride-th remaining point is kept, and then one point is kept per voxel.
+ */
+struct DownsampleOptions {
+  /// if true, points whose valid flag is false are dropped
+  bool drop_invalid = false;
+  /// keep every stride-th point; 0 and 1 keep every point
+  size_t stride = 1;
+  /// edge length (meters) of the voxels of the hash grid; points are not
+  /// voxelized if this is not finite and > 0
+  double voxel_size = 0.0;
+
+  /** @brief Check whether any point can be dropped. */
+  bool enabled() const;
+};  // struct DownsampleOptions
+
+/**
+ * @brief Select the points of a frame to keep.
+ * @note Voxels are keyed by the cell of a hash grid over x/y/z, and the first
+ * point (in frame order) that falls into a voxel is its representative, so
+ * that all of its attributes are kept as they are. Points with non-finite
+ * coordinates are dropped when voxelizing.
+ * @param indices Filled with the indices of the kept points, in frame order.
+ */
+void select_points(const npz::Columns& columns,
+                   const DownsampleOptions& options,
+                   std::vector<uint32_t>& indices);
+
+/**
+ * @brief Owns the columns of a subset of the points of a frame, so that they
+ * can be filled into a message like the columns of a whole frame.
+ * @note Buffers are kept between calls to gather, so an object can be reused
+ * for every frame that a worker converts.
+ */
+class SelectedColumns {
+ public:
+  /**
+   * @brief Copy the selected points out of the columns of a frame.
+   * @pre Every index is < columns.num_points.
+   * @return A view of the selected points, which is valid until the next call
+   * to gather or until this object is destroyed.
+   */
+  const npz::Columns& gather(const npz::Columns& columns,
+                             const std::vector<uint32_t>& indices);
+
+ private:
+  std::vector<npz::ReadTypes::Point> points_;
+  std::vector<npz::ReadTypes::Azimuth> azimuth_;
+  std::vector<npz::ReadTypes::Boundary> boundary_;
+  std::vector<npz::ReadTypes::Col> col_;
+  std::vector<npz::ReadTypes::Depth> depth_;
+  std::vector<npz::ReadTypes::Distance> distance_;
+  std::vector<npz::ReadTypes::LidarId> lidar_id_;
+  std::vector<npz::ReadTypes::Rectime> rectime_;
+  std::vector<npz::ReadTypes::Reflectance> reflectance_;
+  std::vector<npz::ReadTypes::Row> row_;
+  std::vector<npz::ReadTypes::Timestamp> timestamp_;
+  // std::vector<bool> has no contiguous data to view
+  std::unique_ptr<npz::ReadTypes::Valid[]> valid_;
+  size_t valid_capacity_ = 0;
+  npz::Columns view_;
+};  // class SelectedColumns
+
+}  // namespace a2d2_to_ros
+
+#endif  // A2D2_TO_ROS__DOWNSAMPLE_HPP_
@@ -0,0 +1,185 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef A2D2_TO_ROS__DRY_RUN_HPP_
+#define A2D2_TO_ROS__DRY_RUN_HPP_
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <ros/serialization.h>
+
+namespace a2d2_to_ros {
+
+/**
+ * @brief Bytes that a bag adds for each message on top of its serialized
+ * size: the header of its message data record (op, conn, and time fields,
+ * plus the header and data lengths) and its entry in the chunk's index.
+ */
+static constexpr uint64_t BAG_RECORD_OVERHEAD = 58;
+
+/**
+ * @brief Get the bytes that a message takes up in an uncompressed bag.
+ */
+template <typename M>
+uint64_t get_bag_record_size(const M& msg) {
+  return (static_cast<uint64_t>(ros::serialization::serializationLength(msg)) +
+          BAG_RECORD_OVERHEAD);
+}
+
+/**
+ * @brief Pick the frames that a dry run converts.
+ * @return The indices of up to num_samples frames out of num_frames, evenly
+ * spaced and ascending, starting with the first frame. Every frame is picked
+ * if there are no more than num_samples.
+ */
+std::vector<size_t> get_sample_indices(size_t num_frames, size_t num_samples);
+
+/**
+ * @brief What a dry run projects for one bag.
+ */
+struct DryRunBag {
+  std::string name;
+  size_t num_frames = 0;   // frames that the bag would hold
+  size_t num_samples = 0;  // frames that were converted to measure it
+  double mean_frame_bytes = 0.0;
+  uint64_t max_frame_bytes = 0;
+  uint64_t bytes = 0;
+  // bytes of each split window (by directory name), in time order; empty if
+  // the bag is not split
+  std::vector<std::pair<std::string, uint64_t>> windows;
+};  // struct DryRunBag
+
+/**
+ * @brief What a dry run projects for a whole run.
+ * @note Sizes are those of uncompressed bags without a /clock topic, so a
+ * compressed bag is smaller. Times only cover loading and converting frames,
+ * since nothing is written, so they are a lower bound if storage is slow.
+ */
+struct DryRunReport {
+  std::vector<DryRunBag> bags;
+  size_t num_frames = 0;
+  size_t num_samples = 0;
+  double mean_frame_s = 0.0;
+  uint64_t bytes = 0;
+  double seconds = 0.0;  // with the frames split between jobs
+  double frames_per_s = 0.0;
+  double bytes_per_s = 0.0;
+  uint64_t peak_memory_bytes = 0;
+
+  /**
+   * @brief Get the report as a JSON object: the converter name, the totals,
+   * rates, and peak memory, and the projection of every bag.
+   */
+  std::string to_json(const std::string& converter) const;
+
+  /**
+   * @brief Write the report (see to_json) to a file.
+   * @return true iff the file was written.
+   */
+  bool write_json(const std::string& path, const std::string& converter) const;
+
+  /** @brief Log a summary of the report, one line per bag. */
+  void log() const;
+};  // struct DryRunReport
+
+/**
+ * @brief Projects the size of the bags that a run would write, and the time
+ * and memory it would take, from a sample of frames that are converted but
+ * not written.
+ *
+ * Frames are converted by lanes, e.g., one per camera directory, and the
+ * messages of each frame of a lane go to one or more bags, e.g., separate
+ * camera and lidar bags.
+ *
+ * @note All methods are safe to call concurrently, e.g., from the lanes of the
+ * camera converter.
+ */
+class DryRun {
+ public:
+  /**
+   * @param min_time_offset, split_duration As for SplitBagWriter.
+   */
+  DryRun(double min_time_offset, double split_duration);
+
+  DryRun(const DryRun&) = delete;
+  DryRun& operator=(const DryRun&) = delete;
+
+  /**
+   * @brief Add a lane to project.
+   * @param frame_offsets Time since begin of every frame of the lane.
+   * @param max_in_flight Frames whose messages may be held (converted but not
+   * yet written) at once, as for ordered_parallel_for.
+   * @param bag_names Bags that the messages of each frame go to.
+   * @return The index of the lane, for add_sample.
+   */
+  size_t add_lane(std::vector<double> frame_offsets, size_t max_in_flight,
+                  std::vector<std::string> bag_names);
+
+  /**
+   * @brief Record one converted frame of a lane.
+   * @param seconds Time to load and convert the frame.
+   * @param bag_bytes Bytes of the frame's messages in each bag of the lane, in
+   * the order of the bag names (see get_bag_record_size).
+   * @return false iff there is not one size per bag, in which case nothing is
+   * recorded.
+   */
+  bool add_sample(size_t lane, double seconds,
+                  const std::vector<uint64_t>& bag_bytes);
+
+  /**
+   * @brief Project the run from the samples so far.
+   * @param num_jobs Workers that the frames are split between.
+   * @param buffered_bytes Memory that the run holds regardless of the frames
+   * in flight, e.g., prefetched files and the chunks of open bags.
+   * @note A frame size that has not been sampled is projected as zero.
+   */
+  DryRunReport project(size_t num_jobs, uint64_t buffered_bytes) const;
+
+ private:
+  struct Bag {
+    std::string name;
+    uint64_t bytes;
+    uint64_t max_frame_bytes;
+  };  // struct Bag
+
+  struct Lane {
+    std::vector<double> frame_offsets;
+    size_t max_in_flight;
+    std::vector<Bag> bags;
+    size_t num_samples;
+    double seconds;
+  };  // struct Lane
+
+  const double min_time_offset_;
+  const double split_duration_;
+  mutable std::mutex mutex_;
+  std::vector<Lane> lanes_;
+};  // class DryRun
+
+}  // namespace a2d2_to_ros
+
+#endif  // A2D2_TO_ROS__DRY_RUN_HPP_
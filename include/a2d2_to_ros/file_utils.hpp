@@ -24,7 +24,9 @@
 #ifndef A2D2_TO_ROS__FILE_UTILS_HPP_
 #define A2D2_TO_ROS__FILE_UTILS_HPP_
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace a2d2_to_ros {
 
@@ -38,11 +40,42 @@ std::string frame_from_filename(const std::string& filename);
 /**
  * @brief Load an entire file into memory as a string.
  * @pre The file pointed to by path is non-empty.
- * @note This function has no test coverage.
  * @return The file text, or an empty string if loading the file failed.
  */
 std::string get_file_as_string(const std::string& path);
 
+/**
+ * @brief Load an entire file into memory as a string, reusing the storage of
+ * contents.
+ * @note The contents are replaced. The file is read with a single read call
+ * into a buffer sized from its length, so in a loop that passes the same
+ * string, nothing is allocated once the string has grown to the largest file.
+ * @return True if the file was opened and read completely; false otherwise,
+ * in which case contents is empty.
+ */
+bool get_file_as_string(const std::string& path, std::string& contents);
+
+/**
+ * @brief Load an entire file into memory as raw bytes.
+ * @note The contents of bytes are replaced. Reading directly into the caller's
+ * buffer allows, for example, filling a message's data field without a copy.
+ * @return True if the file was opened and read completely; false otherwise.
+ */
+bool get_file_as_bytes(const std::string& path, std::vector<uint8_t>& bytes);
+
+/**
+ * @brief Get the sensor data directories that a path refers to.
+ * @note The path is either a sensor data directory itself (e.g.,
+ * '<drive>/camera/cam_front_center') or the root of a drive (e.g.,
+ * 'camera_lidar/20190401_145936'). A drive root is a directory with a modality
+ * (e.g., 'camera') subdirectory, and each directory in that is a sensor data
+ * directory.
+ * @return The sensor data directories of a drive root in sorted order, or just
+ * path if it is not a drive root.
+ */
+std::vector<std::string> get_sensor_data_paths(const std::string& path,
+                                               const std::string& modality);
+
 }  // namespace a2d2_to_ros
 
 #endif  // A2D2_TO_ROS__FILE_UTILS_HPP_
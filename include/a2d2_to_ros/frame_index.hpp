@@ -0,0 +1,116 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef A2D2_TO_ROS__FRAME_INDEX_HPP_
+#define A2D2_TO_ROS__FRAME_INDEX_HPP_
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include <ros/time.h>
+
+namespace a2d2_to_ros {
+
+/**
+ * @brief Persistent map from frame file basenames to frame timestamps.
+ *
+ * The index is stored as a small text sidecar file in the directory of the
+ * frame info files, so that repeated conversions of the same data set do not
+ * need to open every frame info file again.
+ *
+ * @note Entries are never invalidated; the data set is assumed to be
+ * immutable. Delete the sidecar file to rebuild the index.
+ */
+class FrameIndex {
+ public:
+  static const std::string FILENAME;
+
+  /**
+   * @brief Load the index stored in directory.
+   * @return The index, or an empty index if the file does not exist or is
+   * malformed.
+   */
+  static FrameIndex load(const std::string& directory);
+
+  /**
+   * @brief Write the index to directory, replacing any existing index.
+   * @return True if the index was written successfully.
+   */
+  bool save(const std::string& directory) const;
+
+  /**
+   * @return The timestamp of the frame, or a null reference if the index
+   * does not contain it.
+   */
+  boost::optional<uint64_t> get_timestamp(const std::string& basename) const;
+
+  void set_timestamp(const std::string& basename, uint64_t timestamp);
+
+  /**
+   * @brief Check if entries were added or changed since the index was loaded.
+   */
+  bool is_modified() const;
+
+  size_t size() const;
+
+ private:
+  std::unordered_map<std::string, uint64_t> timestamps_;
+  bool modified_ = false;
+};  // class FrameIndex
+
+/**
+ * @brief The range [begin, end) of frames within a timespan.
+ */
+struct FrameWindow {
+  size_t begin = 0;
+  size_t end = 0;
+
+  /**
+   * @brief The time from which offsets are measured, or a null reference if
+   * no frame is on or after the start time.
+   */
+  boost::optional<ros::Time> first_time;
+};  // struct FrameWindow
+
+/**
+ * @brief Find the frames that fall within the timespan requested on the command
+ * line by binary search.
+ *
+ * Offsets are measured from start_time, or from the first frame timestamp if
+ * start_time is zero. A frame is selected if its timestamp is on or after
+ * start_time and its offset is in [min_time_offset, min_time_offset +
+ * duration].
+ *
+ * @pre timestamps is sorted in ascending order.
+ */
+FrameWindow get_frame_window(const std::vector<uint64_t>& timestamps,
+                             uint64_t start_time, double min_time_offset,
+                             double duration);
+
+}  // namespace a2d2_to_ros
+
+#endif  // A2D2_TO_ROS__FRAME_INDEX_HPP_
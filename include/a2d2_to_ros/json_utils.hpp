@@ -24,13 +24,18 @@
 #ifndef A2D2_TO_ROS__JSON_UTILS_HPP_
 #define A2D2_TO_ROS__JSON_UTILS_HPP_
 
+#include <cstdint>
+#include <sstream>
 #include <string>
 
 #include <Eigen/Core>
 #include <boost/optional.hpp>
 
+#include <sensor_msgs/CameraInfo.h>
+
 #include "rapidjson/document.h"
 #include "rapidjson/error/en.h"
+#include "rapidjson/reader.h"
 #include "rapidjson/schema.h"
 #include "rapidjson/stringbuffer.h"
 
@@ -39,9 +44,20 @@ namespace a2d2_to_ros {
 /**
  * @brief Get validator error in string format.
  * @pre There exists a validator error.
+ * @note Templated so that validators with any output handler are accepted.
  */
-std::string get_validator_error_string(
-    const rapidjson::SchemaValidator& validator);
+template <typename Validator>
+std::string get_validator_error_string(const Validator& validator) {
+  rapidjson::StringBuffer sb;
+  validator.GetInvalidSchemaPointer().StringifyUriFragment(sb);
+  std::stringstream ss;
+  ss << "\nInvalid schema: " << sb.GetString() << "\n";
+  ss << "Invalid keyword: " << validator.GetInvalidSchemaKeyword() << "\n";
+  sb.Clear();
+  validator.GetInvalidDocumentPointer().StringifyUriFragment(sb);
+  ss << "Invalid document: " << sb.GetString() << "\n";
+  return ss.str();
+}
 
 /**
  * @brief Load a given json file into a DOM object.
@@ -74,6 +90,123 @@ Eigen::Vector3d json_origin_to_eigen_vector(const rapidjson::Document& d,
                                             const std::string& sensor,
                                             const std::string& frame);
 
+/**
+ * @brief Utility to build the camera info (intrinsics and resolution) of a
+ * camera from a JSON doc.
+ * @pre The doc must validate according to the schema
+ * @note The header is left empty.
+ */
+sensor_msgs::CameraInfo json_camera_to_camera_info(
+    const rapidjson::Document& d, const std::string& sensor,
+    const std::string& camera_name);
+
+/**
+ * @brief How often the camera frame info files are validated against their
+ * schema.
+ *
+ * FULL validates every file, SAMPLE validates only the first num_samples files
+ * as a warm-up, and NONE never validates.
+ */
+struct ValidationPolicy {
+  enum class Mode { FULL, SAMPLE, NONE };
+
+  Mode mode = Mode::FULL;
+  size_t num_samples = 0;
+
+  /**
+   * @brief Check if the file with the given (zero-based) index is validated.
+   */
+  bool should_validate(size_t file_idx) const;
+};  // struct ValidationPolicy
+
+/**
+ * @brief Parse a validation policy of the form 'full', 'sample:N', or 'none'.
+ * @return A nullable object that either contains the policy or a null
+ * reference if the string is not a valid policy.
+ */
+boost::optional<ValidationPolicy> get_validation_policy(
+    const std::string& policy);
+
+/**
+ * @brief SAX handler that captures the top-level 'cam_tstamp' value of a
+ * camera frame info file.
+ *
+ * @note If stop_when_found is set, parsing is terminated as soon as the
+ * timestamp is read; this must not be set when the handler is the output of a
+ * schema validator, which needs to see the entire document.
+ */
+class FrameTimestampHandler
+    : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>,
+                                          FrameTimestampHandler> {
+ public:
+  bool Default();
+  bool StartObject();
+  bool EndObject(rapidjson::SizeType member_count);
+  bool StartArray();
+  bool EndArray(rapidjson::SizeType element_count);
+  bool Key(const char* str, rapidjson::SizeType length, bool copy);
+  bool Int(int i);
+  bool Uint(unsigned u);
+  bool Int64(int64_t i);
+  bool Uint64(uint64_t u);
+
+  /**
+   * @brief Prepare to handle a new document.
+   */
+  void reset(bool stop_when_found);
+
+  const boost::optional<uint64_t>& get_timestamp() const;
+
+ private:
+  boost::optional<uint64_t> timestamp_;
+  size_t depth_ = 0;
+  bool is_timestamp_key_ = false;
+  bool stop_when_found_ = false;
+};  // class FrameTimestampHandler
+
+/**
+ * @brief Reads the timestamp from camera frame info files without building a
+ * DOM, optionally validating each file against the schema in the same pass.
+ *
+ * A single schema validator is constructed up front and reset for every file.
+ */
+class FrameTimestampReader {
+ public:
+  /**
+   * @pre schema outlives this object.
+   */
+  explicit FrameTimestampReader(const rapidjson::SchemaDocument& schema);
+
+  /**
+   * @brief Get the 'cam_tstamp' value from the JSON text of a frame info file.
+   * @note Without validation, parsing stops as soon as the timestamp is found
+   * and the rest of the document is not checked for well-formedness.
+   * @return The timestamp, or a null reference on failure, in which case
+   * get_error_string describes the problem.
+   */
+  boost::optional<uint64_t> read(const std::string& json, bool validate);
+
+  /**
+   * @brief Get the 'cam_tstamp' value as read does, but parse the JSON text in
+   * place, which saves copying the keys and strings of the document.
+   * @pre json is null-terminated.
+   * @note The contents of json are modified.
+   */
+  boost::optional<uint64_t> read_insitu(char* json, bool validate);
+
+  const std::string& get_error_string() const;
+
+ private:
+  template <unsigned ParseFlags, typename Stream>
+  boost::optional<uint64_t> read_stream(Stream& stream, bool validate);
+
+  FrameTimestampHandler handler_;
+  rapidjson::GenericSchemaValidator<rapidjson::SchemaDocument,
+                                    FrameTimestampHandler>
+      validator_;
+  std::string error_string_;
+};  // class FrameTimestampReader
+
 }  // namespace a2d2_to_ros
 
 #endif  // A2D2_TO_ROS__JSON_UTILS_HPP_
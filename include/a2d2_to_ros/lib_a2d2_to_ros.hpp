@@ -24,15 +24,29 @@
 #ifndef A2D2_TO_ROS__LIB_A2D2_TO_ROS_HPP_
 #define A2D2_TO_ROS__LIB_A2D2_TO_ROS_HPP_
 
+#include "a2d2_to_ros/bag_utils.hpp"
+#include "a2d2_to_ros/checkpoint.hpp"
 #include "a2d2_to_ros/checks.hpp"
 #include "a2d2_to_ros/conversions.hpp"
+#include "a2d2_to_ros/converters.hpp"
 #include "a2d2_to_ros/data_pair.hpp"
+#include "a2d2_to_ros/downsample.hpp"
+#include "a2d2_to_ros/dry_run.hpp"
 #include "a2d2_to_ros/file_utils.hpp"
+#include "a2d2_to_ros/frame_index.hpp"
+#include "a2d2_to_ros/logger.hpp"
 #include "a2d2_to_ros/logging.hpp"
+#include "a2d2_to_ros/manifest.hpp"
+#include "a2d2_to_ros/merge.hpp"
+#include "a2d2_to_ros/message_sink.hpp"
 #include "a2d2_to_ros/msg_utils.hpp"
 #include "a2d2_to_ros/name_utils.hpp"
 #include "a2d2_to_ros/npz.hpp"
+#include "a2d2_to_ros/parallel.hpp"
 #include "a2d2_to_ros/point_cloud_iterators.hpp"
+#include "a2d2_to_ros/prefetch.hpp"
+#include "a2d2_to_ros/run_stats.hpp"
+#include "a2d2_to_ros/sensor_config.hpp"
 #include "a2d2_to_ros/sensors.hpp"
 #include "a2d2_to_ros/transform_utils.hpp"
 
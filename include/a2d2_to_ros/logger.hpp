@@ -0,0 +1,116 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef A2D2_TO_ROS__LOGGER_HPP_
+#define A2D2_TO_ROS__LOGGER_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+#include <boost/optional.hpp>
+
+namespace a2d2_to_ros {
+namespace logging {
+
+/**
+ * @brief Severity of a log message, from least to most severe.
+ */
+enum class Level { DEBUG, INFO, WARN, ERROR, FATAL };  // enum class Level
+
+/**
+ * @brief Convert a level name ('debug', 'info', 'warn', 'error', or 'fatal')
+ * to its level.
+ * @return The level, or a null reference if the name is unknown.
+ */
+boost::optional<Level> get_level(const std::string& name);
+
+/**
+ * @brief Set the least severe level that is logged. The default is INFO.
+ * @note This is thread-safe.
+ */
+void set_level(Level level);
+
+/** @brief Check whether messages of the level are logged. */
+bool is_enabled(Level level);
+
+/**
+ * @brief Queue a line to be written by the background writer, to stdout for
+ * DEBUG to WARN, and to stderr for ERROR and FATAL.
+ * @note Each batch of queued lines is flushed once, instead of once per line.
+ * ERROR and FATAL lines are written (along with everything before them) before
+ * this returns, and the queue is flushed when the program exits. After that,
+ * lines are written right away.
+ */
+void write(Level level, std::string line);
+
+/** @brief Block until every line queued so far has been written. */
+void flush();
+
+/**
+ * @brief Logs a progress line, with the rate, every so many items.
+ * @note This is not thread-safe; each thread that counts items should have its
+ * own.
+ */
+class ProgressLogger {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  /**
+   * @param label Prefix of each line, e.g., the directory being converted.
+   * @param unit What is counted, e.g., "frames".
+   * @param total Number of items that are expected, or 0 if it is unknown.
+   * @param interval Number of items between lines. Nothing is logged if this
+   * is 0.
+   */
+  ProgressLogger(std::string label, std::string unit, size_t total,
+                 size_t interval);
+
+  /**
+   * @brief Count items as done, and log a line if the count reached the next
+   * multiple of the interval, or the total.
+   * @return True if a line was logged (or would have been, if logging is
+   * compiled out).
+   */
+  bool add(size_t count = 1);
+
+  /**
+   * @brief Get the line for a count of items done at a time.
+   * @return The line, e.g., "cam_front_center: 500/12000 frames (4.2%), 35.1
+   * frames/s". The rate is left out if no time has passed.
+   */
+  std::string get_line(size_t done, Clock::time_point now) const;
+
+ private:
+  const std::string label_;
+  const std::string unit_;
+  const size_t total_;
+  const size_t interval_;
+  const Clock::time_point start_;
+  size_t done_ = 0;
+};  // class ProgressLogger
+
+}  // namespace logging
+}  // namespace a2d2_to_ros
+
+#endif  // A2D2_TO_ROS__LOGGER_HPP_
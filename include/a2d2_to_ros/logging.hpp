@@ -24,19 +24,53 @@
 #ifndef A2D2_TO_ROS__LOGGING_HPP_
 #define A2D2_TO_ROS__LOGGING_HPP_
 
+/**
+ * Logging macros, which are compiled in for one of two backends, or out:
+ * - ENABLE_A2D2_ROS_LOGGING logs through rosconsole.
+ * - ENABLE_A2D2_STREAM_LOGGING formats each message on the calling thread and
+ *   queues it for a background writer, which flushes once per batch of lines
+ *   (see logger.hpp).
+ * - Otherwise, the macros expand to nothing and their arguments are never
+ *   evaluated.
+ * Either backend skips messages below the level given to logging::set_level.
+ */
+#if defined(ENABLE_A2D2_ROS_LOGGING) || defined(ENABLE_A2D2_STREAM_LOGGING)
+#include "a2d2_to_ros/logger.hpp"
+#define X_LOG_ENABLED_(level) \
+  ::a2d2_to_ros::logging::is_enabled(::a2d2_to_ros::logging::Level::level)
+#endif
+
 #ifdef ENABLE_A2D2_ROS_LOGGING
 #include <ros/console.h>
-#define X_INFO(s) ROS_INFO_STREAM(s)
-#define X_WARN(s) ROS_WARN_STREAM(s)
-#define X_ERROR(s) ROS_ERROR_STREAM(s)
-#define X_FATAL(s) ROS_FATAL_STREAM(s)
+#define X_LOG_(level, ros_macro, s) \
+  do {                              \
+    if (X_LOG_ENABLED_(level)) {    \
+      ros_macro(s);                 \
+    }                               \
+  } while (false)
+#define X_DEBUG(s) X_LOG_(DEBUG, ROS_DEBUG_STREAM, s)
+#define X_INFO(s) X_LOG_(INFO, ROS_INFO_STREAM, s)
+#define X_WARN(s) X_LOG_(WARN, ROS_WARN_STREAM, s)
+#define X_ERROR(s) X_LOG_(ERROR, ROS_ERROR_STREAM, s)
+#define X_FATAL(s) X_LOG_(FATAL, ROS_FATAL_STREAM, s)
 #elif defined(ENABLE_A2D2_STREAM_LOGGING)
-#include <iostream>
-#define X_INFO(s) std::cout << s << std::endl;
-#define X_WARN(s) std::cout << s << std::endl;
-#define X_ERROR(s) std::cerr << s << std::endl;
-#define X_FATAL(s) std::cerr << s << std::endl;
+#include <sstream>
+#define X_LOG_(level, s)                                          \
+  do {                                                            \
+    if (X_LOG_ENABLED_(level)) {                                  \
+      std::ostringstream x_log_ss_;                               \
+      x_log_ss_ << s;                                             \
+      ::a2d2_to_ros::logging::write(                              \
+          ::a2d2_to_ros::logging::Level::level, x_log_ss_.str()); \
+    }                                                             \
+  } while (false)
+#define X_DEBUG(s) X_LOG_(DEBUG, s)
+#define X_INFO(s) X_LOG_(INFO, s)
+#define X_WARN(s) X_LOG_(WARN, s)
+#define X_ERROR(s) X_LOG_(ERROR, s)
+#define X_FATAL(s) X_LOG_(FATAL, s)
 #else
+#define X_DEBUG(s)
 #define X_INFO(s)
 #define X_WARN(s)
 #define X_ERROR(s)
@@ -0,0 +1,97 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef A2D2_TO_ROS__MANIFEST_HPP_
+#define A2D2_TO_ROS__MANIFEST_HPP_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+namespace a2d2_to_ros {
+
+/**
+ * @brief The parts of a sensor fusion file basename, e.g.,
+ * '20190401145936_lidar_frontcenter_000000080'.
+ */
+struct FrameName {
+  /// recording time, e.g., '20190401145936'
+  std::string recording;
+  /// 'camera' or 'lidar'
+  std::string modality;
+  /// sensor frame, e.g., 'frontcenter'
+  std::string frame;
+  uint64_t sequence = 0;
+};  // struct FrameName
+
+/**
+ * @brief Split a basename into its parts at its underscores.
+ * @pre The input must be a basename (no directory and no extension)
+ * @return The parts, or a null reference if the basename does not have four
+ * parts, a known sensor frame, and a numeric sequence number.
+ */
+boost::optional<FrameName> parse_frame_name(const std::string& basename);
+
+/**
+ * @brief Everything about a frame that the converters get from file names.
+ */
+struct ManifestEntry {
+  uint64_t sequence = 0;
+  /// data file of the frame, e.g., its .npz or .png file
+  std::string data_path;
+  /// frame info (.json) file of the frame
+  std::string info_path;
+  /// basename of the frame info file, which is also its frame index key
+  std::string info_basename;
+  /// sensor name, e.g., 'front_center'
+  std::string sensor_name;
+};  // struct ManifestEntry
+
+/**
+ * @brief List a directory once, and group the paths of its files by
+ * extension.
+ * @return Paths by extension (e.g., '.npz'), each sorted, or a null reference
+ * if the directory cannot be opened.
+ */
+boost::optional<std::map<std::string, std::vector<std::string>>>
+list_directory(const std::string& directory);
+
+/**
+ * @brief Pair each data file with the frame info file of the same sequence
+ * number.
+ * @param data_paths Data files of a single sensor, e.g., the .npz files of a
+ * lidar data directory.
+ * @param info_paths Frame info files of the same sensor.
+ * @return The entries sorted by sequence number, or a null reference if a data
+ * file name cannot be parsed or has no frame info file of the same sensor.
+ */
+boost::optional<std::vector<ManifestEntry>> build_manifest(
+    const std::vector<std::string>& data_paths,
+    const std::vector<std::string>& info_paths);
+
+}  // namespace a2d2_to_ros
+
+#endif  // A2D2_TO_ROS__MANIFEST_HPP_
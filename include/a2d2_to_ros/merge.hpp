@@ -0,0 +1,226 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef A2D2_TO_ROS__MERGE_HPP_
+#define A2D2_TO_ROS__MERGE_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+namespace a2d2_to_ros {
+
+/**
+ * @brief Visit the elements of several sorted runs in merged order.
+ *
+ * Calls visit(r, i) for the i-th element of runs[r], for every element of
+ * every run, in the order a stable sort of all of the runs concatenated would
+ * put them in; elements that compare equal are visited in run order. The heads
+ * of the runs are kept in a binary heap, so merging n elements of k runs takes
+ * O(n log k) comparisons and O(k) memory.
+ *
+ * @pre Each run is sorted according to less. A Run is anything with size() and
+ * operator[], e.g., a std::vector.
+ * @return False as soon as visit returns false; true otherwise.
+ */
+template <typename Run, typename Less, typename Visit>
+bool merge_sorted_runs(const std::vector<Run>& runs, Less less, Visit visit) {
+  struct Head {
+    size_t run;
+    size_t idx;
+  };  // struct Head
+
+  // std::*_heap keep the greatest element at the front, so this is reversed
+  const auto after = [&runs, &less](const Head& lhs, const Head& rhs) {
+    const auto& l = runs[lhs.run][lhs.idx];
+    const auto& r = runs[rhs.run][rhs.idx];
+    if (less(r, l)) {
+      return true;
+    }
+    return (!less(l, r) && (rhs.run < lhs.run));
+  };
+
+  std::vector<Head> heads;
+  heads.reserve(runs.size());
+  for (size_t r = 0; r < runs.size(); ++r) {
+    if (runs[r].size() > 0) {
+      heads.push_back({r, 0});
+    }
+  }
+  std::make_heap(std::begin(heads), std::end(heads), after);
+
+  while (!heads.empty()) {
+    std::pop_heap(std::begin(heads), std::end(heads), after);
+    auto& head = heads.back();
+    if (!visit(head.run, head.idx)) {
+      return false;
+    }
+    if (++head.idx < runs[head.run].size()) {
+      std::push_heap(std::begin(heads), std::end(heads), after);
+    } else {
+      heads.pop_back();
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Sorted runs that are spilled to a temporary file while they are
+ * built, to be merged with merge_sorted_runs.
+ *
+ * Elements are appended to the last run through a write buffer, and each run
+ * reads its elements back through a buffer of its own, so the runs take
+ * O(k * chunk_size) memory however many elements they hold. The file is made
+ * in the temporary directory (TMPDIR, or /tmp), and removed with the RunFile.
+ *
+ * @pre T is trivially copyable.
+ * @note Runs are read efficiently in index order. A failed read yields
+ * value-initialized elements; check good() once the runs have been merged.
+ */
+template <typename T>
+class RunFile {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "RunFile elements are written as bytes");
+
+ public:
+  /** @brief A run of the file, which reads its elements as they are needed. */
+  class Run {
+   public:
+    size_t size() const { return size_; }
+
+    const T& operator[](size_t idx) const {
+      if ((idx < begin_) || (idx >= (begin_ + buffer_.size()))) {
+        begin_ = idx;
+        buffer_.resize(std::min(file_->chunk_size_, (size_ - idx)));
+        file_->read(offset_ + idx, buffer_);
+      }
+      return buffer_[idx - begin_];
+    }
+
+   private:
+    friend class RunFile;
+    Run(const RunFile* file, size_t offset) : file_(file), offset_(offset) {}
+
+    const RunFile* file_;
+    /// of the first element of the run, in elements from the start of the file
+    size_t offset_;
+    size_t size_ = 0;
+    /// index of the first buffered element
+    mutable size_t begin_ = 0;
+    mutable std::vector<T> buffer_;
+  };  // class Run
+
+  explicit RunFile(size_t chunk_size = 4096)
+      : chunk_size_(std::max(chunk_size, size_t(1))),
+        path_((boost::filesystem::temp_directory_path() /
+               boost::filesystem::unique_path("a2d2_to_ros-%%%%-%%%%.run"))
+                  .string()) {
+    file_.open(path_, (std::ios::in | std::ios::out | std::ios::binary |
+                       std::ios::trunc));
+    good_ = file_.is_open();
+    write_buffer_.reserve(chunk_size_);
+  }
+
+  ~RunFile() {
+    file_.close();
+    boost::system::error_code ec;
+    boost::filesystem::remove(path_, ec);
+  }
+
+  RunFile(const RunFile&) = delete;
+  RunFile& operator=(const RunFile&) = delete;
+
+  /** @return False if the file could not be made, written, or read. */
+  bool good() const { return good_; }
+
+  const std::string& get_path() const { return path_; }
+
+  /** @brief Start a new run, which elements are appended to from now on. */
+  void begin_run() { runs_.push_back(Run(this, size_)); }
+
+  /**
+   * @pre begin_run has been called.
+   * @return False if a full write buffer could not be written to the file.
+   */
+  bool push_back(const T& value) {
+    write_buffer_.push_back(value);
+    ++runs_.back().size_;
+    ++size_;
+    return ((write_buffer_.size() < chunk_size_) || flush());
+  }
+
+  /**
+   * @brief Write the buffered elements to the file, which must be done before
+   * the runs are read.
+   */
+  bool flush() {
+    if (!good_) {
+      return false;
+    }
+    if (!write_buffer_.empty()) {
+      file_.seekp(0, std::ios::end);
+      file_.write(reinterpret_cast<const char*>(write_buffer_.data()),
+                  (write_buffer_.size() * sizeof(T)));
+      write_buffer_.clear();
+    }
+    file_.flush();
+    good_ = !file_.fail();
+    return good_;
+  }
+
+  const std::vector<Run>& get_runs() const { return runs_; }
+
+  /** @return The number of elements of all runs. */
+  size_t size() const { return size_; }
+
+ private:
+  void read(size_t offset, std::vector<T>& elements) const {
+    if (good_) {
+      file_.seekg(static_cast<std::streamoff>(offset * sizeof(T)));
+      file_.read(reinterpret_cast<char*>(elements.data()),
+                 (elements.size() * sizeof(T)));
+      good_ = !file_.fail();
+    }
+    if (!good_) {
+      std::fill(std::begin(elements), std::end(elements), T());
+      file_.clear();
+    }
+  }
+
+  const size_t chunk_size_;
+  const std::string path_;
+  mutable std::fstream file_;
+  mutable bool good_ = false;
+  std::vector<T> write_buffer_;
+  std::vector<Run> runs_;
+  size_t size_ = 0;
+};  // class RunFile
+
+}  // namespace a2d2_to_ros
+
+#endif  // A2D2_TO_ROS__MERGE_HPP_
@@ -0,0 +1,264 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef A2D2_TO_ROS__MESSAGE_SINK_HPP_
+#define A2D2_TO_ROS__MESSAGE_SINK_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include <ros/ros.h>
+
+#include "a2d2_to_ros/bag_utils.hpp"
+
+namespace a2d2_to_ros {
+
+/**
+ * @brief Where converted messages go.
+ */
+enum class SinkType {
+  /// bag files, written by SplitBagWriter
+  BAG,
+  /// topics of a live ROS graph, published by TopicPublisher
+  TOPICS
+};  // enum class SinkType
+
+/**
+ * @brief Convert a sink name ('bag' or 'topics') to its type.
+ * @return The sink type, or a null reference if the name is unknown.
+ */
+boost::optional<SinkType> get_sink_type(const std::string& name);
+
+/**
+ * @brief Paces a stream of messages against their stamps, so that they are
+ * published at the rate at which they were recorded, or a multiple of it.
+ * @note The first stamp is due right away, and every later one is due when
+ * the wall time since the first has caught up with its (scaled) offset from
+ * the first stamp. wait is thread-safe.
+ */
+class Pacer {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  /**
+   * @param speed Factor of real time to publish at, e.g., 2.0 for twice as
+   * fast as recorded. Every stamp is due right away if this is not finite and
+   * > 0.
+   */
+  explicit Pacer(double speed);
+
+  /** @brief Block until the stamp is due. */
+  void wait(const ros::Time& stamp);
+
+  /**
+   * @brief Get how long after now the stamp is due.
+   * @return The wait, which is zero or negative if the stamp is already due.
+   */
+  Clock::duration get_wait(const ros::Time& stamp, Clock::time_point now);
+
+ private:
+  const double speed_;
+  std::mutex mutex_;
+  // wall time and stamp of the first message
+  boost::optional<std::pair<Clock::time_point, ros::Time>> origin_;
+};  // class Pacer
+
+/**
+ * @brief Publishes messages to topics, paced against their stamps.
+ * @note Each topic is advertised on its first message. write is thread-safe,
+ * so several sinks (e.g., camera lanes) can share a publisher.
+ */
+class TopicPublisher {
+ public:
+  /// messages each publisher queues for a subscriber that falls behind
+  static constexpr uint32_t QUEUE_SIZE = 100;
+
+  /**
+   * @param speed Factor of real time to publish at, as for Pacer.
+   * @pre ros::init has been called.
+   */
+  explicit TopicPublisher(double speed);
+
+  TopicPublisher(const TopicPublisher&) = delete;
+  TopicPublisher& operator=(const TopicPublisher&) = delete;
+
+  /**
+   * @brief Wait until the stamp is due, then publish the message.
+   * @param latch If true, the topic is advertised as latched, so that
+   * subscribers that connect later receive its last message (as for
+   * /tf_static).
+   */
+  template <typename T>
+  void write(const std::string& topic, const ros::Time& stamp, const T& msg,
+             bool latch = false) {
+    pacer_.wait(stamp);
+    get_publisher<T>(topic, latch).publish(msg);
+  }
+
+ private:
+  template <typename T>
+  const ros::Publisher& get_publisher(const std::string& topic, bool latch) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = publishers_.find(topic);
+    if (it == std::end(publishers_)) {
+      it = publishers_
+               .emplace(topic, node_.advertise<T>(topic, QUEUE_SIZE, latch))
+               .first;
+    }
+    return it->second;
+  }
+
+  ros::NodeHandle node_;
+  Pacer pacer_;
+  std::mutex mutex_;
+  std::map<std::string, ros::Publisher> publishers_;
+};  // class TopicPublisher
+
+/**
+ * @brief What a converter writes its messages to: either bag files, through a
+ * SplitBagWriter that it owns, or live topics, through a shared
+ * TopicPublisher.
+ * @note Messages have many types, so the interface is a template, and the
+ * sink dispatches each write to the implementation that it was made with.
+ * Calls that only apply to bags are no-ops for topics.
+ */
+class MessageSink {
+ public:
+  explicit MessageSink(std::unique_ptr<SplitBagWriter> bag);
+
+  /** @pre The publisher outlives this object. */
+  explicit MessageSink(TopicPublisher& publisher);
+
+  /** @brief Write a message, as for SplitBagWriter::write. */
+  template <typename T>
+  void write(const std::string& topic, double time_since_begin,
+             const ros::Time& stamp, T&& msg, bool latch = false) {
+    if (bag_) {
+      bag_->write(topic, time_since_begin, stamp, std::forward<T>(msg), latch);
+    } else {
+      publisher_->write(topic, stamp, msg, latch);
+    }
+  }
+
+  /**
+   * @brief Get the split window that messages with the offset are written to.
+   * @return The window index, which is always zero for topics.
+   */
+  size_t get_window(double time_since_begin) const;
+
+  /** @brief Finish writing bags. */
+  void close();
+
+  /**
+   * @brief Get the total size (bytes) of the bags written, which is zero for
+   * topics.
+   */
+  uint64_t get_bytes_written() const;
+
+  /**
+   * @brief Close bags so that they are complete, as for
+   * SplitBagWriter::checkpoint.
+   * @return The bags written so far, which is none for topics.
+   */
+  std::vector<BagSegment> checkpoint();
+
+  /**
+   * @brief Continue the bags of a checkpoint, as for SplitBagWriter::resume.
+   * @return False if the bags cannot be continued, or if there are segments
+   * to continue but this sink publishes to topics.
+   */
+  bool resume(const std::vector<BagSegment>& segments);
+
+ private:
+  std::unique_ptr<SplitBagWriter> bag_;
+  TopicPublisher* publisher_ = nullptr;
+};  // class MessageSink
+
+/**
+ * @brief Get a sink that publishes with publisher if it is not null, or that
+ * writes to bags otherwise.
+ * @note The other arguments are those of SplitBagWriter, and are only used
+ * for bags.
+ */
+MessageSink make_message_sink(TopicPublisher* publisher,
+                              std::string output_path,
+                              std::string bag_filename, double min_time_offset,
+                              double split_duration,
+                              BagOptions options = BagOptions());
+
+/**
+ * @brief Writes clock messages inline, as the messages they are for are
+ * written in time order.
+ * @note Stamps at or before the last stamp that was seen are dropped, so the
+ * stream of written messages is deduplicated without being collected first.
+ * @note If a rate is set, a clock message is only written once at least one
+ * period has passed since the last one, or once the stamp falls into a new
+ * split window, so that every window starts with a clock message.
+ */
+class ClockWriter {
+ public:
+  /**
+   * @param sink Sink to write clock messages to. It must outlive this object.
+   * @param topic Topic of the clock messages, e.g., /clock.
+   * @param rate Maximum rate (Hz) of clock messages. A message is written for
+   * every new stamp if this is not finite and > 0.
+   */
+  ClockWriter(MessageSink& sink, std::string topic, double rate = 0.0);
+
+  /**
+   * @brief Write a clock message for the stamp if it is new and due.
+   * @param time_since_begin Offset (seconds) of the stamp from the start of the
+   * data, as for SplitBagWriter::write.
+   * @return True if a clock message was written.
+   */
+  bool write(double time_since_begin, const ros::Time& stamp);
+
+  /** @brief Get the number of distinct stamps seen, written or not. */
+  size_t get_num_stamps() const;
+
+  /** @brief Get the number of clock messages written. */
+  size_t get_num_written() const;
+
+ private:
+  MessageSink& sink_;
+  const std::string topic_;
+  // zero if every new stamp is written
+  const double period_;
+  boost::optional<ros::Time> last_stamp_;
+  boost::optional<ros::Time> last_written_;
+  size_t last_window_ = 0;
+  size_t num_stamps_ = 0;
+  size_t num_written_ = 0;
+};  // class ClockWriter
+
+}  // namespace a2d2_to_ros
+
+#endif  // A2D2_TO_ROS__MESSAGE_SINK_HPP_
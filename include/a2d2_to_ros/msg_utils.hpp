@@ -24,12 +24,19 @@
 #ifndef A2D2_TO_ROS__MSG_UTILS_HPP_
 #define A2D2_TO_ROS__MSG_UTILS_HPP_
 
+#include <cstdint>
 #include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
 
 #include <ros/time.h>
+#include <sensor_msgs/Image.h>
 #include <sensor_msgs/PointCloud2.h>
 #include <shape_msgs/SolidPrimitive.h>
 
+#include "a2d2_to_ros/npz.hpp"
+
 namespace a2d2_to_ros {
 
 /**
@@ -51,6 +58,163 @@ sensor_msgs::PointCloud2 build_pc2_msg(std::string frame, ros::Time timestamp,
                                        bool is_dense,
                                        const uint32_t num_points);
 
+/**
+ * @brief Fill a PointCloud2 message from the columns of a lidar frame.
+ * @pre msg was built by build_pc2_msg with columns.num_points points.
+ * @note Each column pointer and each field offset is resolved once, and the
+ * points are then written in a single pass over the message buffer.
+ * @return false iff msg does not have the fields or size of a message built by
+ * build_pc2_msg; the message contents are unspecified in that case.
+ */
+bool fill_pc2_msg(const npz::Columns& columns, sensor_msgs::PointCloud2& msg);
+
+/**
+ * @brief Build a 32FC1 depth image for a camera image grid.
+ * @param data Storage for the pixels, e.g., the data of an image that has
+ * already been written; it is reused if it is large enough.
+ * @return An image with every pixel set to NaN, i.e., no depth.
+ */
+sensor_msgs::Image build_depth_image_msg(
+    std::string frame, ros::Time timestamp, uint32_t width, uint32_t height,
+    std::vector<uint8_t> data = std::vector<uint8_t>());
+
+/**
+ * @brief Fill a PointCloud2 message and, in the same pass, scatter the depth
+ * (in meters) of every valid point into its row/col pixel of a depth image.
+ * @pre depth_image was built by build_depth_image_msg.
+ * @note Points outside of the image are skipped. If several points fall on the
+ * same pixel, the nearest one is kept.
+ * @return false iff fill_pc2_msg would fail or depth_image is not a 32FC1
+ * image of consistent size; the message contents are unspecified in that case.
+ */
+bool fill_pc2_msg(const npz::Columns& columns, sensor_msgs::PointCloud2& msg,
+                  sensor_msgs::Image& depth_image);
+
+/**
+ * @brief Selection and packing of the lidar fields in a PointCloud2 message.
+ */
+struct PointLayout {
+  /** @brief Lidar column that a message field is filled from. */
+  enum Source {
+    X,
+    Y,
+    Z,
+    AZIMUTH,
+    BOUNDARY,
+    COL,
+    DEPTH,
+    DISTANCE,
+    LIDAR_ID,
+    RECTIME,
+    REFLECTANCE,
+    ROW,
+    TIMESTAMP,
+    VALID
+  };
+
+  struct Field {
+    Source source;
+    std::string name;
+    uint8_t datatype;  // a sensor_msgs::PointField type
+    uint32_t offset;
+  };  // struct Field
+
+  /// true iff this is the layout of build_pc2_msg, with every field
+  bool full = false;
+  std::vector<Field> fields;
+  uint32_t point_step = 0;
+};  // struct PointLayout
+
+/**
+ * @brief Get the layout of messages built by build_pc2_msg: all 14 fields,
+ * packed without padding.
+ */
+PointLayout get_full_point_layout();
+
+/**
+ * @brief Get a point layout from a comma separated list of fields.
+ *
+ * Each item is one of:
+ * - 'all': every field, exactly as build_pc2_msg stores them (only valid as
+ *   the only item)
+ * - 'xyz': the x, y, and z coordinates
+ * - 'xyzi': the coordinates and 'intensity'
+ * - 'x', 'y', 'z', or 'intensity' (the reflectance as FLOAT32, which is how
+ *   PCL and rviz expect intensity)
+ * - an A2D2 attribute without its 'pcloud_attr.' prefix, e.g., 'reflectance'
+ *
+ * Attributes keep their full A2D2 names in the message. Floating point values
+ * are stored as FLOAT32, integers and bools as UINT8, rectime as a FLOAT64
+ * holding its value (microseconds), and timestamp as an INT32
+ * 'timestamp_offset': the point time in microseconds relative to the header
+ * stamp.
+ *
+ * @note Unlike compact layouts, the full layout of build_pc2_msg labels
+ * rectime FLOAT64 but stores the bits of its uint64 value, as it always has.
+ *
+ * @note Fields are stored in the order given, each at an offset aligned to its
+ * size, and point_step is padded to the largest alignment.
+ * @return The layout, or boost::none if an item is unknown or repeated.
+ */
+boost::optional<PointLayout> get_point_layout(const std::string& spec);
+
+/**
+ * @brief Build a PointCloud2 message with the fields of a layout.
+ * @return A properly configured and sized, but uninitialized, message.
+ */
+sensor_msgs::PointCloud2 build_pc2_msg(const PointLayout& layout,
+                                       std::string frame, ros::Time timestamp,
+                                       bool is_dense,
+                                       const uint32_t num_points);
+
+/**
+ * @brief Turn a message into what build_pc2_msg would build, reusing its
+ * storage.
+ * @param msg A message that was built for the same layout, e.g., one that has
+ * already been written, or a default constructed message.
+ * @note The fields are only rebuilt if they do not match the layout. The data
+ * is reused if it is large enough, and only bytes past its old size are
+ * zeroed, so the bytes that filling does not write (the padding of a compact
+ * layout) stay zero as long as the message is only used with one layout.
+ */
+void rebuild_pc2_msg(const PointLayout& layout, std::string frame,
+                     ros::Time timestamp, bool is_dense,
+                     const uint32_t num_points, sensor_msgs::PointCloud2& msg);
+
+/**
+ * @brief Fill a PointCloud2 message built for a layout.
+ * @note The full layout uses the single pass kernel of fill_pc2_msg. Other
+ * layouts write their (few) fields one column at a time.
+ * @return false iff msg does not match the layout or the number of points, or
+ * a timestamp offset does not fit in an INT32.
+ */
+bool fill_pc2_msg(const PointLayout& layout, const npz::Columns& columns,
+                  sensor_msgs::PointCloud2& msg);
+
+/**
+ * @brief Fill a PointCloud2 message built for a layout, and scatter the point
+ * depths into a depth image like the depth image overload of fill_pc2_msg.
+ */
+bool fill_pc2_msg(const PointLayout& layout, const npz::Columns& columns,
+                  sensor_msgs::PointCloud2& msg,
+                  sensor_msgs::Image& depth_image);
+
+/**
+ * @brief Scatter the depths of the valid points into a depth image, without
+ * filling a PointCloud2 message.
+ * @note Used when the cloud is filled from a subset of the points of a frame,
+ * while the depth image is still filled from all of them.
+ * @return false iff depth_image is not a 32FC1 image of consistent size.
+ */
+bool fill_depth_image(const npz::Columns& columns,
+                      sensor_msgs::Image& depth_image);
+
+/**
+ * @brief Convenience overload of fill_pc2_msg for a loaded npz file.
+ * @pre verify_structure returns true for the npz.
+ */
+bool fill_pc2_from_npz(const cnpy::npz_t& npz, sensor_msgs::PointCloud2& msg);
+
 }  // namespace a2d2_to_ros
 
 #endif  // A2D2_TO_ROS__MSG_UTILS_HPP_
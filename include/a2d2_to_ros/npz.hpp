@@ -25,8 +25,13 @@
 #define A2D2_TO_ROS__NPZ_HPP_
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "ros_cnpy/cnpy.h"
 
@@ -119,6 +124,122 @@ struct WriteTypes {
   typedef BOOL Valid;
 };  // struct ReadTypes
 
+/**
+ * @brief Non-owning view of the columns of a single lidar frame.
+ * @note The points column is stored row-major with three values (x, y, z) per
+ * point. All other columns store one value per point.
+ */
+struct Columns {
+  const ReadTypes::Point* points;
+  const ReadTypes::Azimuth* azimuth;
+  const ReadTypes::Boundary* boundary;
+  const ReadTypes::Col* col;
+  const ReadTypes::Depth* depth;
+  const ReadTypes::Distance* distance;
+  const ReadTypes::LidarId* lidar_id;
+  const ReadTypes::Rectime* rectime;
+  const ReadTypes::Reflectance* reflectance;
+  const ReadTypes::Row* row;
+  const ReadTypes::Timestamp* timestamp;
+  const ReadTypes::Valid* valid;
+  size_t num_points;
+};  // struct Columns
+
+/**
+ * @brief Read-only access to the arrays of an npz file without loading it.
+ * @note The file is memory-mapped and only its zip central directory and the
+ * .npy headers are parsed when it is opened. Arrays that are stored without
+ * compression are viewed in place; arrays that are deflated (or whose data is
+ * not aligned for its type) are inflated/copied into buffers owned by this
+ * object.
+ */
+class MappedNpz {
+ public:
+  /** @brief View of a single array in the archive. */
+  struct Array {
+    std::vector<size_t> shape;
+    char kind;  // numpy type kind, e.g., 'b', 'i', 'u', or 'f'
+    size_t word_size;
+    bool fortran_order;
+    size_t num_vals;
+    const uint8_t* bytes;
+
+    /** @pre template parameter T must match the underlying data type. */
+    template <typename T>
+    const T* data() const {
+      return reinterpret_cast<const T*>(bytes);
+    }
+  };  // struct Array
+
+  MappedNpz() = default;
+  ~MappedNpz();
+  MappedNpz(const MappedNpz&) = delete;
+  MappedNpz& operator=(const MappedNpz&) = delete;
+
+  /**
+   * @brief Map an npz file and index its arrays. Anything previously opened
+   * is closed first.
+   * @return true iff the file is a readable npz archive.
+   */
+  bool open(const std::string& path);
+
+  /**
+   * @brief Index the arrays of an npz file that has already been read into
+   * memory, e.g., by FilePrefetcher. Anything previously opened is closed
+   * first.
+   * @param name Name of the file, which is only used in error messages.
+   * @return true iff the bytes are a readable npz archive.
+   */
+  bool open(std::vector<uint8_t>&& bytes, const std::string& name);
+
+  /** @brief Unmap the file and release all array data. */
+  void close();
+
+  /**
+   * @brief Look up an array by its name in the archive, without the '.npy'
+   * suffix (the same keys cnpy::npz_load uses).
+   * @return The array, or nullptr if there is no array with that name.
+   */
+  const Array* get(const std::string& name) const;
+
+  /** @brief Get the size (bytes) of the mapped file, or zero if none is. */
+  size_t get_size() const { return map_size_; }
+
+  /** @brief Get all arrays in the archive, keyed by name. */
+  const std::map<std::string, Array>& get_arrays() const { return arrays_; }
+
+ private:
+  /** @brief Index every member listed in the zip central directory. */
+  bool read_central_directory(const std::string& path);
+
+  /** @brief Locate (and inflate if necessary) one member and its header. */
+  bool read_member(const std::string& path, const std::string& member_name,
+                   uint16_t method, uint64_t compressed_size,
+                   uint64_t uncompressed_size, uint64_t local_header_offset);
+
+  const uint8_t* map_ = nullptr;
+  size_t map_size_ = 0;
+  // contents of a file opened from memory, which map_ then points to
+  std::vector<uint8_t> file_bytes_;
+  std::map<std::string, Array> arrays_;
+  // data of arrays that could not be viewed in place
+  std::vector<std::unique_ptr<uint8_t[]>> buffers_;
+};  // class MappedNpz
+
+/**
+ * @brief Resolve the data pointers of every lidar field in an npz.
+ * @pre verify_structure returns true for the npz.
+ * @note The returned view is only valid as long as the npz object is.
+ */
+Columns get_columns(const std::map<std::string, cnpy::NpyArray>& npz);
+
+/**
+ * @brief Resolve the data pointers of every lidar field in a mapped npz.
+ * @pre verify_structure returns true for the npz.
+ * @note The returned view is only valid as long as the npz object is open.
+ */
+Columns get_columns(const MappedNpz& npz);
+
 /**
  * @brief Check that lidar npz data has expected structure.
  * @note This function has no test coverage.
@@ -128,59 +249,145 @@ struct WriteTypes {
  */
 bool verify_structure(const std::map<std::string, cnpy::NpyArray>& npz);
 
+/**
+ * @brief Check that mapped lidar npz data has expected structure.
+ * @return true iff the npz satisfies the same checks as the cnpy overload of
+ * verify_structure and, because its arrays are used in place, every array is
+ * stored in C order with the element type given by ReadTypes.
+ */
+bool verify_structure(const MappedNpz& npz);
+
+/**
+ * @brief Result of verifying a lidar frame.
+ * @note The remaining members are only meaningful if valid is true.
+ */
+struct FrameSummary {
+  /// true iff the frame passed every check of verify_structure
+  bool valid = false;
+  /// true iff no points are flagged invalid (PointCloud2::is_dense)
+  bool is_dense = false;
+  size_t num_invalid_points = 0;
+  /// range of point timestamps; both are 0 if the frame has no points
+  ReadTypes::Timestamp min_timestamp = 0;
+  ReadTypes::Timestamp max_timestamp = 0;
+};  // struct FrameSummary
+
+/**
+ * @brief Verify a lidar npz exactly as verify_structure does, and summarize
+ * it.
+ * @note Shapes are checked once per field index. Every constrained column is
+ * then swept exactly once, with the sign checks, the timestamp range check,
+ * and the valid point count computed from per-column reductions.
+ */
+FrameSummary verify_frame(const std::map<std::string, cnpy::NpyArray>& npz);
+
+/** @brief Overload of verify_frame for mapped npz data. */
+FrameSummary verify_frame(const MappedNpz& npz);
+
+/**
+ * @brief Check the values of a lidar frame for the sign and range
+ * constraints used by verify_structure, and summarize them.
+ */
+FrameSummary verify_columns(const Columns& columns);
+
+/**
+ * @brief Statistics of the values of a single column.
+ * @note NaN values are only counted as invalid: they are excluded from the
+ * minimum and maximum, and they are not non-negative.
+ */
+template <typename T>
+struct ColumnStats {
+  /// smallest value, or std::numeric_limits<T>::max() if there is none
+  T min = std::numeric_limits<T>::max();
+  /// largest value, or std::numeric_limits<T>::lowest() if there is none
+  T max = std::numeric_limits<T>::lowest();
+  /// number of values that are NaN, which is always 0 for integer types
+  size_t num_invalid = 0;
+  /// true iff every value is >= 0 (which is true if there are none)
+  bool all_non_negative = true;
+};  // struct ColumnStats
+
+/**
+ * @brief Compute the statistics of the first n values in one pass.
+ * @note The loop is branch-free, with each statistic kept in its own
+ * accumulator, so that the compiler can vectorize the reductions where the
+ * optimization level allows it. Floating point columns are reduced with SSE2
+ * instead (see the specialization below).
+ */
+template <typename T>
+ColumnStats<T> get_column_stats(const T* vals, size_t n) {
+  ColumnStats<T> stats;
+  auto lo = stats.min;
+  auto hi = stats.max;
+  size_t num_nan = 0;
+  size_t num_not_non_negative = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const auto v = vals[i];
+    lo = (v < lo) ? v : lo;
+    hi = (v > hi) ? v : hi;
+    // only NaN compares unequal to itself
+    num_nan += static_cast<size_t>(v != v);
+    num_not_non_negative += static_cast<size_t>(!(v >= static_cast<T>(0)));
+  }
+  stats.min = lo;
+  stats.max = hi;
+  stats.num_invalid = num_nan;
+  stats.all_non_negative = (num_not_non_negative == 0);
+  return stats;
+}
+
+/**
+ * @brief Specialization for the floating point columns, which reduces two
+ * values at a time with SSE2 where it is available.
+ */
+template <>
+ColumnStats<double> get_column_stats(const double* vals, size_t n);
+
+/**
+ * @brief Compute the statistics of every value of an array, as for the
+ * pointer overload.
+ * @pre template parameter T must match the underlying data type.
+ */
+template <typename T>
+ColumnStats<T> get_column_stats(const cnpy::NpyArray& field) {
+  return get_column_stats(field.data<T>(), field.num_vals);
+}
+
 /**
  * @brief Check whether the valid array has any false values.
- * @note This function has no test coverage.
+ * @note This stops at the first false value.
  * @pre The underlying type is bool.
  */
 bool any_points_invalid(const cnpy::NpyArray& valid);
 
 /**
- * @brief Test whether int64_t data is all non-negative.
- * @note This function has no test coverage.
+ * @brief Test whether data is all non-negative.
  * @pre template parameter T must match the underlying data type.
  */
 template <typename T>
 bool all_non_negative(const cnpy::NpyArray& field) {
-  auto good = true;
-  const auto vals = field.data<T>();
-  for (auto i = 0; i < field.shape[npz::Fields::ROW_SHAPE_IDX]; ++i) {
-    const auto is_non_negative = (vals[i] >= static_cast<T>(0));
-    good = (good && is_non_negative);
-  }
-  return good;
+  return get_column_stats<T>(field).all_non_negative;
 }
 
 /**
  * @brief Get the minimum value of a given field
- * @note This function has no test coverage.
  * @pre template parameter T must match the underlying data type.
  * @return The minimum value or std::numeric_limits<T>::max() if field is empty.
  */
 template <typename T>
 T get_min_value(const cnpy::NpyArray& field) {
-  auto t = std::numeric_limits<T>::max();
-  const auto vals = field.data<T>();
-  for (auto i = 0; i < field.shape[npz::Fields::ROW_SHAPE_IDX]; ++i) {
-    t = std::min(t, vals[i]);
-  }
-  return t;
+  return get_column_stats<T>(field).min;
 }
 
 /**
  * @brief Get the maximum value of a given field
- * @note This function has no test coverage.
  * @pre template parameter T must match the underlying data type.
- * @return The maximum value or std::numeric_limits<T>::min() if field is empty.
+ * @return The maximum value or std::numeric_limits<T>::lowest() if field is
+ * empty.
  */
 template <typename T>
 T get_max_value(const cnpy::NpyArray& field) {
-  auto t = std::numeric_limits<T>::min();
-  const auto vals = field.data<T>();
-  for (auto i = 0; i < field.shape[npz::Fields::ROW_SHAPE_IDX]; ++i) {
-    t = std::max(t, vals[i]);
-  }
-  return t;
+  return get_column_stats<T>(field).max;
 }
 
 }  // namespace npz
@@ -0,0 +1,245 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef A2D2_TO_ROS__PARALLEL_HPP_
+#define A2D2_TO_ROS__PARALLEL_HPP_
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+namespace a2d2_to_ros {
+
+/**
+ * @brief Runs tasks in the order they are pushed on a single background thread.
+ *
+ * At most max_queued tasks wait to be run; push blocks while the queue is
+ * full, which bounds the memory held by pending tasks.
+ *
+ * @note If a task throws, the remaining tasks are discarded and the exception
+ * is rethrown (once) from the next call to push or wait.
+ */
+class TaskQueue {
+ public:
+  explicit TaskQueue(size_t max_queued);
+
+  /** @brief Runs the remaining tasks and stops the thread. Does not throw. */
+  ~TaskQueue();
+
+  TaskQueue(const TaskQueue&) = delete;
+  TaskQueue& operator=(const TaskQueue&) = delete;
+
+  void push(std::function<void()> task);
+
+  /** @brief Block until every task that has been pushed has run. */
+  void wait();
+
+ private:
+  void run();
+  void rethrow_error(std::unique_lock<std::mutex>& lock);
+
+  const size_t max_queued_;
+  std::mutex mutex_;
+  std::condition_variable task_ready_;
+  std::condition_variable task_done_;
+  std::deque<std::function<void()>> tasks_;
+  bool busy_ = false;
+  bool stop_ = false;
+  std::exception_ptr error_;
+  std::thread thread_;
+};  // class TaskQueue
+
+/**
+ * @brief Thread-safe free list of objects that are expensive to allocate, e.g.,
+ * message buffers that are refilled for every frame.
+ */
+template <typename T>
+class ObjectPool {
+ public:
+  /**
+   * @brief Take an object out of the pool.
+   * @return A previously returned object in an unspecified state, or a default
+   * constructed object if the pool is empty.
+   */
+  T take() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (objects_.empty()) {
+      return T();
+    }
+    auto t = std::move(objects_.back());
+    objects_.pop_back();
+    return t;
+  }
+
+  /** @brief Return an object to the pool so that a later take can reuse it. */
+  void give(T&& t) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    objects_.push_back(std::move(t));
+  }
+
+  /** @brief Number of objects waiting to be reused. */
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return objects_.size();
+  }
+
+ private:
+  mutable std::mutex mutex_;
+  std::vector<T> objects_;
+};  // class ObjectPool
+
+/**
+ * @brief Get the number of worker threads to use for a requested job count.
+ * @return The requested count, or the number of hardware threads if the
+ * requested count is zero. The return value is always at least one.
+ */
+size_t get_num_jobs(size_t requested);
+
+/**
+ * @brief Produce items on a pool of worker threads and consume them in order.
+ *
+ * Calls produce(i) for every i in [0, n) on up to num_jobs worker threads, and
+ * calls consume(i, item) on the calling thread strictly in index order. At most
+ * max_in_flight items are claimed but not yet consumed at any time, which
+ * bounds the memory held by finished items waiting for their turn.
+ *
+ * @note produce must be safe to call concurrently; consume is never called
+ * concurrently with itself. If num_jobs <= 1, everything runs sequentially on
+ * the calling thread.
+ * @note consume may take the item by non-const reference, e.g., to move its
+ * buffers back into an ObjectPool once they have been written.
+ * @note Processing stops as soon as produce returns boost::none (or throws) or
+ * consume returns false. Items already in progress are finished and discarded.
+ * @return true iff every item was produced and consumed successfully.
+ */
+template <typename T, typename Produce, typename Consume>
+bool ordered_parallel_for(size_t n, size_t num_jobs, size_t max_in_flight,
+                          Produce produce, Consume consume) {
+  // an exception thrown by produce is treated like a failure to produce
+  const auto try_produce = [&produce](size_t i) -> boost::optional<T> {
+    try {
+      return produce(i);
+    } catch (...) {
+      return boost::none;
+    }
+  };
+
+  if (num_jobs <= 1) {
+    for (size_t i = 0; i < n; ++i) {
+      auto item = try_produce(i);
+      if (!item || !consume(i, *item)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  max_in_flight = std::max(max_in_flight, static_cast<size_t>(1));
+
+  std::mutex mutex;
+  std::condition_variable item_ready;
+  std::condition_variable slot_ready;
+  std::map<size_t, boost::optional<T>> finished;
+  size_t next_claim = 0;
+  size_t next_consume = 0;
+  auto stop = false;
+
+  const auto work = [&]() {
+    while (true) {
+      size_t i = 0;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        slot_ready.wait(lock, [&]() {
+          return (stop || (next_claim >= n) ||
+                  ((next_claim - next_consume) < max_in_flight));
+        });
+        if (stop || (next_claim >= n)) {
+          return;
+        }
+        i = next_claim++;
+      }
+
+      auto item = try_produce(i);
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.emplace(i, std::move(item));
+      }
+      item_ready.notify_all();
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (size_t j = 0; j < std::min(num_jobs, n); ++j) {
+    workers.emplace_back(work);
+  }
+
+  auto success = true;
+  while (next_consume < n) {
+    boost::optional<T> item;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      item_ready.wait(lock, [&]() {
+        return (finished.find(next_consume) != std::end(finished));
+      });
+      auto it = finished.find(next_consume);
+      item = std::move(it->second);
+      finished.erase(it);
+    }
+
+    if (!item || !consume(next_consume, *item)) {
+      success = false;
+      break;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      ++next_consume;
+    }
+    slot_ready.notify_all();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop = true;
+  }
+  slot_ready.notify_all();
+  for (auto& w : workers) {
+    w.join();
+  }
+
+  return success;
+}
+
+}  // namespace a2d2_to_ros
+
+#endif  // A2D2_TO_ROS__PARALLEL_HPP_
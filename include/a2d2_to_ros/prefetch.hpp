@@ -0,0 +1,125 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef A2D2_TO_ROS__PREFETCH_HPP_
+#define A2D2_TO_ROS__PREFETCH_HPP_
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace a2d2_to_ros {
+
+/**
+ * @brief Settings for reading files ahead of the code that converts them.
+ */
+struct PrefetchOptions {
+  /// files that may be read ahead; zero disables prefetching
+  static constexpr size_t DEFAULT_DEPTH = 8;
+  /// bytes of files that may be held after they are read ahead
+  static constexpr size_t DEFAULT_MAX_BYTES = (512 * 1024 * 1024);
+
+  size_t depth = DEFAULT_DEPTH;
+  size_t max_bytes = DEFAULT_MAX_BYTES;
+};  // struct PrefetchOptions
+
+/**
+ * @brief Reads a list of files into memory, in order, on a background thread,
+ * so that whoever converts them does not wait on storage latency.
+ *
+ * At most depth files that have been read but not taken are held at any time,
+ * and no file is started while the held files add up to max_bytes or more, so
+ * the memory held is bounded by max_bytes plus the size of one file.
+ *
+ * The buffer passed to take is kept for reading a later file (it counts
+ * against max_bytes while it waits), so a loop that takes every file into the
+ * same buffer does not allocate once the buffers have grown to the largest
+ * file.
+ *
+ * @note If depth is zero, no thread is started and each file is read by take
+ * on the calling thread, i.e., files are read just as they would be without a
+ * prefetcher.
+ */
+class FilePrefetcher {
+ public:
+  /**
+   * @param paths Files to read, in the order they will be taken. An empty path
+   * is a placeholder that gives empty contents, e.g., for a frame without an
+   * image.
+   */
+  FilePrefetcher(std::vector<std::string> paths, PrefetchOptions options);
+
+  /** @brief Stops reading ahead and discards files that were not taken. */
+  ~FilePrefetcher();
+
+  FilePrefetcher(const FilePrefetcher&) = delete;
+  FilePrefetcher& operator=(const FilePrefetcher&) = delete;
+
+  /**
+   * @brief Take the contents of a file, waiting for it to be read if it has
+   * not been read yet.
+   * @pre Each index is taken at most once. Files are read in index order, so
+   * indices should be taken in (roughly) ascending order, e.g., as workers of
+   * ordered_parallel_for claim them. Every index below one that is waited on
+   * must be taken eventually, or the wait may not end.
+   * @note This is safe to call concurrently for different indices.
+   * @return true iff the file was read completely (or its path was empty), in
+   * which case bytes holds its contents. The previous contents of bytes are
+   * discarded.
+   */
+  bool take(size_t idx, std::vector<uint8_t>& bytes);
+
+  size_t size() const { return paths_.size(); }
+
+ private:
+  struct File {
+    bool read;
+    std::vector<uint8_t> bytes;
+  };  // struct File
+
+  void run();
+
+  static bool read_file(const std::string& path, std::vector<uint8_t>& bytes);
+
+  const std::vector<std::string> paths_;
+  const PrefetchOptions options_;
+  std::mutex mutex_;
+  std::condition_variable file_ready_;
+  std::condition_variable slot_ready_;
+  std::map<size_t, File> files_;
+  // buffers given back by take, which are refilled before new ones are made
+  std::vector<std::vector<uint8_t>> spares_;
+  size_t next_read_ = 0;
+  size_t bytes_held_ = 0;
+  size_t spare_bytes_ = 0;
+  bool stop_ = false;
+  std::thread thread_;
+};  // class FilePrefetcher
+
+}  // namespace a2d2_to_ros
+
+#endif  // A2D2_TO_ROS__PREFETCH_HPP_
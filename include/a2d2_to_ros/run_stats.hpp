@@ -0,0 +1,174 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef A2D2_TO_ROS__RUN_STATS_HPP_
+#define A2D2_TO_ROS__RUN_STATS_HPP_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace a2d2_to_ros {
+
+/**
+ * @brief Stages of a conversion that are timed separately.
+ */
+struct Stage {
+  enum Id {
+    SCAN = 0,       // listing the input directory
+    JSON_READ,      // reading JSON files from disk
+    JSON_PARSE,     // parsing JSON without schema validation
+    JSON_VALIDATE,  // parsing JSON with schema validation (same pass)
+    NPZ_LOAD,       // opening (and inflating) npz archives
+    VERIFY,         // checking the structure and values of lidar frames
+    IMAGE_LOAD,     // reading PNG files
+    IMAGE_DECODE,   // decoding PNG files to raw images
+    MSG_BUILD,      // building and filling messages
+    BAG_WRITE,      // writing (or queueing) messages to bags
+    BAG_CLOSE,      // finishing queued writes and closing bags
+    CLOCK_WRITE,    // writing the /clock topic
+    NUM_STAGES
+  };
+
+  /** @brief Get the name of a stage as written to the run report. */
+  static const char* get_name(Id id);
+};  // struct Stage
+
+/**
+ * @brief Summary of the latencies recorded for one stage.
+ * @note Percentiles use the nearest-rank method. All values are zero if
+ * nothing was recorded.
+ */
+struct LatencySummary {
+  size_t count = 0;
+  double total = 0.0;  // seconds
+  double p50 = 0.0;    // seconds
+  double p99 = 0.0;    // seconds
+  double max = 0.0;    // seconds
+};  // struct LatencySummary
+
+/**
+ * @brief Get the summary of a set of latencies (seconds).
+ */
+LatencySummary summarize_latencies(std::vector<double> latencies);
+
+/**
+ * @brief Collects per-stage latencies and throughput counters for one run of
+ * a converter, and writes them as a machine-readable report.
+ *
+ * @note All methods are safe to call concurrently, e.g., from the workers of
+ * ordered_parallel_for. If the stats are disabled, nothing is recorded and
+ * ScopedStageTimer does not read the clock, so instrumentation can stay in
+ * place at (almost) no cost.
+ */
+class RunStats {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  explicit RunStats(bool enabled);
+
+  RunStats(const RunStats&) = delete;
+  RunStats& operator=(const RunStats&) = delete;
+
+  bool is_enabled() const { return enabled_; }
+
+  /** @brief Record one latency (seconds) for a stage. */
+  void add_latency(Stage::Id stage, double seconds);
+
+  void add_frames(uint64_t n);
+  void add_points(uint64_t n);
+  void add_bytes_in(uint64_t n);
+  void add_bytes_out(uint64_t n);
+
+  uint64_t get_frames() const { return frames_; }
+  uint64_t get_points() const { return points_; }
+  uint64_t get_bytes_in() const { return bytes_in_; }
+  uint64_t get_bytes_out() const { return bytes_out_; }
+
+  LatencySummary get_summary(Stage::Id stage) const;
+
+  /**
+   * @brief Get the report as a JSON object: the converter name, wall time
+   * since construction, totals and rates of the counters, and the count,
+   * total, p50, p99, and max latency of every stage that was recorded.
+   */
+  std::string to_json(const std::string& converter) const;
+
+  /**
+   * @brief Write the report (see to_json) to a file.
+   * @return true iff the file was written.
+   */
+  bool write_json(const std::string& path, const std::string& converter) const;
+
+ private:
+  const bool enabled_;
+  const Clock::time_point start_;
+  mutable std::mutex mutex_;
+  std::array<std::vector<double>, Stage::NUM_STAGES> latencies_;
+  std::atomic<uint64_t> frames_{0};
+  std::atomic<uint64_t> points_{0};
+  std::atomic<uint64_t> bytes_in_{0};
+  std::atomic<uint64_t> bytes_out_{0};
+};  // class RunStats
+
+/**
+ * @brief Records the time between its construction and destruction (or
+ * stop) as one latency of a stage.
+ * @note Time while the timer is paused is left out, so one latency can cover
+ * a stage whose work is split up, e.g., reading a file early and decoding it
+ * later.
+ */
+class ScopedStageTimer {
+ public:
+  ScopedStageTimer(RunStats& stats, Stage::Id stage);
+
+  /** @brief Stops the timer if it is still running. */
+  ~ScopedStageTimer();
+
+  ScopedStageTimer(const ScopedStageTimer&) = delete;
+  ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+  /** @brief Record the latency now instead of on destruction. */
+  void stop();
+
+  /** @brief Stop counting time until resume is called. */
+  void pause();
+
+  void resume();
+
+ private:
+  RunStats& stats_;
+  const Stage::Id stage_;
+  RunStats::Clock::time_point start_;
+  RunStats::Clock::duration elapsed_;
+  bool running_;
+  bool paused_;
+};  // class ScopedStageTimer
+
+}  // namespace a2d2_to_ros
+
+#endif  // A2D2_TO_ROS__RUN_STATS_HPP_
@@ -0,0 +1,132 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef A2D2_TO_ROS__SENSOR_CONFIG_HPP_
+#define A2D2_TO_ROS__SENSOR_CONFIG_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include <geometry_msgs/TransformStamped.h>
+#include <sensor_msgs/CameraInfo.h>
+
+#include "rapidjson/document.h"
+
+namespace a2d2_to_ros {
+
+/**
+ * @brief Everything the converters use from the vehicle/sensor config
+ * (cams_lidars.json), built once from the validated JSON.
+ *
+ * The config can be cached in a binary sidecar file next to the JSON, so that
+ * later runs do not need to parse and validate the JSON again. The cache is
+ * keyed by a hash of both the JSON and its schema, so it is rebuilt whenever
+ * either of them changes.
+ */
+struct SensorConfig {
+  static const std::string CACHE_FILENAME;
+
+  /** @brief Tolerance used to build the orthonormal basis of each sensor. */
+  static constexpr double BASIS_EPSILON = 1e-8;
+
+  struct EgoBBox {
+    double x_min = 0.0;
+    double x_max = 0.0;
+    double y_min = 0.0;
+    double y_max = 0.0;
+    double z_min = 0.0;
+    double z_max = 0.0;
+  };  // struct EgoBBox
+
+  /**
+   * @brief Camera info of each camera by name (e.g., 'front_center'). The
+   * headers are left empty.
+   */
+  std::map<std::string, sensor_msgs::CameraInfo> camera_infos;
+
+  /**
+   * @brief Pose of every sensor frame, relative to 'chassis', and of every
+   * motion compensated camera frame, relative to 'wheels'. The header stamps
+   * are left empty.
+   */
+  std::vector<geometry_msgs::TransformStamped> transforms;
+
+  EgoBBox ego_bbox;
+};  // struct SensorConfig
+
+/**
+ * @brief 64-bit FNV-1a hash of data. Pass the result of a previous call as
+ * hash to continue hashing across several buffers.
+ */
+uint64_t fnv1a_hash(const uint8_t* data, size_t size,
+                    uint64_t hash = 0xcbf29ce484222325ull);
+
+/**
+ * @brief Build the sensor config from a JSON doc.
+ * @pre The doc must validate according to the schema
+ * @return False if the pose of a sensor or the ego bbox is not valid, in which
+ * case the reason is logged.
+ */
+bool build_sensor_config(const rapidjson::Document& d, SensorConfig& config);
+
+/**
+ * @brief Write the sensor config to a binary cache file, replacing any
+ * existing file.
+ * @note The file is in host byte order; it is only meant to be read back on
+ * the machine that wrote it.
+ * @return True if the file was written successfully.
+ */
+bool save_sensor_config(const std::string& path, uint64_t key,
+                        const SensorConfig& config);
+
+/**
+ * @brief Read a sensor config from a binary cache file.
+ * @return The config, or a null reference if the file does not exist, is
+ * malformed, or was written for a different key.
+ */
+boost::optional<SensorConfig> load_sensor_config(const std::string& path,
+                                                 uint64_t key);
+
+/**
+ * @brief Get the sensor config, from the cache in the directory of the JSON
+ * if it is up to date, or else by parsing the JSON and validating it against
+ * the schema.
+ * @note If use_cache is set and the cache was missing or out of date, the
+ * cache is written after the JSON is validated. Failing to write it is not an
+ * error.
+ * @return The config, or a null reference if either file cannot be read, the
+ * JSON is not valid, or the config cannot be built from it. The reason is
+ * logged.
+ */
+boost::optional<SensorConfig> get_sensor_config(
+    const std::string& config_path, const std::string& schema_path,
+    bool use_cache);
+
+}  // namespace a2d2_to_ros
+
+#endif  // A2D2_TO_ROS__SENSOR_CONFIG_HPP_
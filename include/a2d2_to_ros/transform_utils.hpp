@@ -24,7 +24,10 @@
 #ifndef A2D2_TO_ROS__TRANSFORM_UTILS_HPP_
 #define A2D2_TO_ROS__TRANSFORM_UTILS_HPP_
 
+#include <cstdint>
+#include <vector>
 #include <Eigen/Geometry>
+#include <boost/optional.hpp>
 
 namespace a2d2_to_ros {
 
@@ -45,6 +48,53 @@ Eigen::Matrix3d get_orthonormal_basis(const Eigen::Vector3d& X,
 Eigen::Affine3d Tx_global_sensor(const Eigen::Matrix3d& basis,
                                  const Eigen::Vector3d& origin);
 
+/** @brief An angle (radians) of the chassis at an A2D2 timestamp. */
+struct AngleSample {
+  uint64_t time;
+  double angle;
+};  // struct AngleSample
+
+/** @brief Roll and pitch (radians) of the chassis at an A2D2 timestamp. */
+struct ChassisAngles {
+  uint64_t time;
+  double roll;
+  double pitch;
+};  // struct ChassisAngles
+
+/**
+ * @brief Sort angle samples by time.
+ * @note Samples are normally read in time order already, in which case they
+ * are only checked.
+ * @return The first timestamp that appears more than once, or none if every
+ * timestamp is unique.
+ */
+boost::optional<uint64_t> sort_angle_samples(std::vector<AngleSample>& samples);
+
+/**
+ * @brief Pair roll and pitch samples that have the same timestamps, in a
+ * single merge pass over both.
+ * @pre Both inputs are sorted by sort_angle_samples, with unique timestamps.
+ * @return The first timestamp that appears in only one of the inputs, or none
+ * if every sample was paired.
+ */
+boost::optional<uint64_t> join_chassis_angles(
+    const std::vector<AngleSample>& roll, const std::vector<AngleSample>& pitch,
+    std::vector<ChassisAngles>& angles);
+
+/**
+ * @brief Resample roll and pitch at a fixed rate, interpolating each linearly
+ * between its samples.
+ * @pre Both inputs are sorted by sort_angle_samples, with unique timestamps,
+ * and rate is finite and > 0.
+ * @note The first resampled time is the first time that both signals have a
+ * sample at or before, and times advance by the period until the last time
+ * that both signals have a sample at or after. Roll and pitch do not need to
+ * share timestamps.
+ */
+void resample_chassis_angles(const std::vector<AngleSample>& roll,
+                             const std::vector<AngleSample>& pitch,
+                             double rate, std::vector<ChassisAngles>& angles);
+
 }  // namespace a2d2_to_ros
 
 #endif  // A2D2_TO_ROS__TRANSFORM_UTILS_HPP_
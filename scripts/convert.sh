@@ -40,55 +40,20 @@ bus_data_subdir=/bus
 data_source="$data_root/$sensor_data"
 sensor_locations=(cam_front_center cam_front_left cam_front_right cam_rear_center cam_side_left cam_side_right)
 
-# Convert bus signal data
-start_time=0
-while [ $start_time -lt $data_set_duration ]
-do
-  end_time=$(( $start_time + $split_duration ))
-  sub_dir="timespan_${start_time}s_${end_time}s"
-  if [ ! -d "$sub_dir" ]; then
-    mkdir $sub_dir
-  fi
+# Round the data set duration up to a whole number of split windows
+record_duration=$(( ( ($data_set_duration + $split_duration - 1) / $split_duration ) * $split_duration ))
 
-  rosrun a2d2_to_ros sensor_fusion_bus_signals --sensor-config-json-path $data_root --sensor-config-schema-path $package_source/schemas/sensor_config.schema --bus-signal-json-path $data_source$bus_data_subdir --bus-signal-schema-path $package_source/schemas/sensor_fusion_bus_signal.schema --min-time-offset $start_time --duration $split_duration --output-path $sub_dir --include-clock-topic true --start-time $record_start_time || exit 1
+# Convert bus signal data
+rosrun a2d2_to_ros sensor_fusion_bus_signals --sensor-config-json-path $data_root --sensor-config-schema-path $package_source/schemas/sensor_config.schema --bus-signal-json-path $data_source$bus_data_subdir --bus-signal-schema-path $package_source/schemas/sensor_fusion_bus_signal.schema --duration $record_duration --split-duration $split_duration --include-clock-topic true --start-time $record_start_time || exit 1
 
-  start_time=$end_time
-done
 
+# Convert camera data (every camera of the drive, in parallel)
+rosrun a2d2_to_ros sensor_fusion_camera --camera-data-path $data_source --frame-info-schema-path $package_source/schemas/sensor_fusion_camera_frame.schema --sensor-config-path $data_root --sensor-config-schema-path $package_source/schemas/sensor_config.schema --duration $record_duration --split-duration $split_duration --include-clock-topic false --start-time $record_start_time --jobs 0 || exit 1
 
-# Convert sensor data
+# Convert lidar data
 for location in "${sensor_locations[@]}"
 do
-  start_time=0
   camera_data="$data_source/camera/$location"
-  while [ $start_time -lt $data_set_duration ]
-  do
-    end_time=$(( $start_time + $split_duration ))
-    sub_dir="timespan_${start_time}s_${end_time}s"
-    if [ ! -d "$sub_dir" ]; then
-      mkdir $sub_dir
-    fi
-
-    rosrun a2d2_to_ros sensor_fusion_camera --camera-data-path $camera_data --frame-info-schema-path $package_source/schemas/sensor_fusion_camera_frame.schema --sensor-config-path $data_root --sensor-config-schema-path $package_source/schemas/sensor_config.schema --min-time-offset $start_time --duration $split_duration --output-path $sub_dir --include-clock-topic false  --start-time $record_start_time || exit 1
-
-    start_time=$end_time
-  done
-
-
   lidar_data="$data_source/lidar/$location"
-  start_time=0
-  camera_data="$data_source/camera/$location"
-  while [ $start_time -lt $data_set_duration ]
-  do
-    end_time=$(( $start_time + $split_duration ))
-    sub_dir="timespan_${start_time}s_${end_time}s"
-    if [ ! -d "$sub_dir" ]; then
-      mkdir $sub_dir
-    fi
-
-    rosrun a2d2_to_ros sensor_fusion_lidar --lidar-data-path $lidar_data --camera-data-path $camera_data --frame-info-schema-path $package_source/schemas/sensor_fusion_camera_frame.schema --min-time-offset $start_time --duration $split_duration --output-path $sub_dir --include-clock-topic false  --start-time $record_start_time || exit 1
-
-    start_time=$end_time
-  done
-
+  rosrun a2d2_to_ros sensor_fusion_lidar --lidar-data-path $lidar_data --camera-data-path $camera_data --frame-info-schema-path $package_source/schemas/sensor_fusion_camera_frame.schema --duration $record_duration --split-duration $split_duration --include-clock-topic false --start-time $record_start_time || exit 1
 done
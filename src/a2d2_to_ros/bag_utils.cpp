@@ -0,0 +1,285 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "a2d2_to_ros/bag_utils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+#include <boost/filesystem.hpp>
+
+#include "a2d2_to_ros/checks.hpp"
+#include "a2d2_to_ros/logging.hpp"
+
+namespace a2d2_to_ros {
+
+//------------------------------------------------------------------------------
+
+size_t get_window_index(double time_offset, double split_duration) {
+  if (!strictly_positive(time_offset)) {
+    return 0;
+  }
+  return static_cast<size_t>(std::floor(time_offset / split_duration));
+}
+
+//------------------------------------------------------------------------------
+
+std::string get_window_name(double window_start, double window_end) {
+  std::stringstream ss;
+  ss << "timespan_" << window_start << "s_" << window_end << "s";
+  return ss.str();
+}
+
+//------------------------------------------------------------------------------
+
+std::string get_bag_part_filename(const std::string& bag_filename,
+                                  size_t part) {
+  if (part == 0) {
+    return bag_filename;
+  }
+  const boost::filesystem::path path(bag_filename);
+  std::stringstream ss;
+  ss << path.stem().string() << "_part" << part << path.extension().string();
+  return ss.str();
+}
+
+//------------------------------------------------------------------------------
+
+constexpr uint32_t BagOptions::DEFAULT_CHUNK_THRESHOLD;
+
+//------------------------------------------------------------------------------
+
+boost::optional<rosbag::compression::CompressionType> get_compression_type(
+    const std::string& name) {
+  if (name == "none") {
+    return rosbag::compression::Uncompressed;
+  }
+  if (name == "bz2") {
+    return rosbag::compression::BZ2;
+  }
+  if (name == "lz4") {
+    return rosbag::compression::LZ4;
+  }
+  return boost::none;
+}
+
+//------------------------------------------------------------------------------
+
+constexpr size_t SplitBagWriter::MAX_QUEUED_WRITES;
+constexpr const char* SplitBagWriter::LATCHING_CALLER_ID;
+
+//------------------------------------------------------------------------------
+
+SplitBagWriter::SplitBagWriter(std::string output_path,
+                               std::string bag_filename,
+                               double min_time_offset, double split_duration,
+                               BagOptions options)
+    : output_path_(std::move(output_path)),
+      bag_filename_(std::move(bag_filename)),
+      min_time_offset_(min_time_offset),
+      split_duration_(split_duration),
+      options_(options) {
+  // compressing is the expensive part of writing, so move it off this thread
+  if (options_.compression != rosbag::compression::Uncompressed) {
+    writer_.reset(new TaskQueue(MAX_QUEUED_WRITES));
+  }
+}
+
+//------------------------------------------------------------------------------
+
+SplitBagWriter::~SplitBagWriter() {
+  try {
+    close();
+  } catch (const std::exception& e) {
+    X_ERROR("Failed to finish writing bag files: " << e.what());
+  }
+}
+
+//------------------------------------------------------------------------------
+
+bool SplitBagWriter::is_split() const {
+  return (std::isfinite(split_duration_) && strictly_positive(split_duration_));
+}
+
+//------------------------------------------------------------------------------
+
+std::string SplitBagWriter::get_window_path(size_t window_idx) const {
+  if (!is_split()) {
+    return output_path_;
+  }
+
+  const auto start = (min_time_offset_ + (window_idx * split_duration_));
+  const auto end = (start + split_duration_);
+  const auto window_path = (output_path_ + "/" + get_window_name(start, end));
+  boost::filesystem::create_directories(window_path);
+  return window_path;
+}
+
+//------------------------------------------------------------------------------
+
+size_t SplitBagWriter::get_window(double time_since_begin) const {
+  return (is_split() ? get_window_index(time_since_begin - min_time_offset_,
+                                        split_duration_)
+                     : static_cast<size_t>(0));
+}
+
+//------------------------------------------------------------------------------
+
+rosbag::Bag& SplitBagWriter::get_bag(double time_since_begin) {
+  const auto window_idx = get_window(time_since_begin);
+
+  auto it = bags_.find(window_idx);
+  if (it == std::end(bags_)) {
+    // a window whose bag was closed by a checkpoint continues in a new part
+    const auto window_path = get_window_path(window_idx);
+    auto& num_parts = num_parts_[window_path];
+    const auto bag_path =
+        (window_path + "/" + get_bag_part_filename(bag_filename_, num_parts));
+    X_INFO("Creating bag file at: " << bag_path);
+    std::unique_ptr<rosbag::Bag> bag(new rosbag::Bag());
+    bag->open(bag_path, rosbag::bagmode::Write);
+    bag_paths_.push_back(bag_path);
+    ++num_parts;
+    bag->setCompression(options_.compression);
+    bag->setChunkThreshold(options_.chunk_threshold);
+    it = bags_.emplace(window_idx, std::move(bag)).first;
+  }
+  return *(it->second);
+}
+
+//------------------------------------------------------------------------------
+
+uint64_t SplitBagWriter::get_bytes_written() const {
+  uint64_t bytes = 0;
+  for (const auto& path : bag_paths_) {
+    boost::system::error_code ec;
+    const auto size = boost::filesystem::file_size(path, ec);
+    if (!ec) {
+      bytes += size;
+    }
+  }
+  return bytes;
+}
+
+//------------------------------------------------------------------------------
+
+void SplitBagWriter::close() {
+  if (writer_) {
+    writer_->wait();
+  }
+  // preserve the behavior of always creating the bag for unsplit output
+  if (!is_split() && bag_paths_.empty()) {
+    get_bag(min_time_offset_);
+  }
+  for (auto& p : bags_) {
+    p.second->close();
+  }
+  bags_.clear();
+}
+
+//------------------------------------------------------------------------------
+
+std::vector<BagSegment> SplitBagWriter::checkpoint() {
+  if (writer_) {
+    writer_->wait();
+  }
+  for (auto& p : bags_) {
+    p.second->close();
+  }
+  bags_.clear();
+
+  std::vector<BagSegment> segments;
+  for (const auto& path : bag_paths_) {
+    segments.push_back({path, boost::filesystem::file_size(path)});
+  }
+  return segments;
+}
+
+//------------------------------------------------------------------------------
+
+bool SplitBagWriter::resume(const std::vector<BagSegment>& segments) {
+  for (const auto& segment : segments) {
+    // find the part of this writer's bag that the segment is, if any; there
+    // are no more parts of a window than there are segments
+    const auto filename =
+        boost::filesystem::path(segment.path).filename().string();
+    boost::optional<size_t> part;
+    for (size_t p = 0; p <= segments.size(); ++p) {
+      if (filename == get_bag_part_filename(bag_filename_, p)) {
+        part = p;
+        break;
+      }
+    }
+    if (!part) {
+      continue;
+    }
+
+    // bags are never written to after the checkpoint that closed them
+    boost::system::error_code ec;
+    const auto size = boost::filesystem::file_size(segment.path, ec);
+    if (ec || (size != segment.size)) {
+      X_ERROR("Bag file '" << segment.path
+                           << "' is missing or has changed since the "
+                              "checkpoint.");
+      return false;
+    }
+
+    try {
+      rosbag::Bag bag;
+      bag.open(segment.path, rosbag::bagmode::Read);
+      bag.close();
+    } catch (const rosbag::BagException& e) {
+      X_ERROR("Failed to read bag file '" << segment.path
+                                          << "': " << e.what());
+      return false;
+    }
+
+    X_INFO("Resuming bag file at: " << segment.path);
+    bag_paths_.push_back(segment.path);
+    const auto window_path =
+        segment.path.substr(0, (segment.path.size() - filename.size() - 1));
+    auto& num_parts = num_parts_[window_path];
+    num_parts = std::max(num_parts, (*part + 1));
+  }
+
+  // parts after the last complete one of a window were left incomplete by the
+  // interrupted run, and are removed instead of being left for the next write
+  // into the window to replace, since there may not be one
+  for (const auto& p : num_parts_) {
+    for (auto part = p.second;; ++part) {
+      const auto path =
+          (p.first + "/" + get_bag_part_filename(bag_filename_, part));
+      boost::system::error_code ec;
+      if (!boost::filesystem::remove(path, ec) || ec) {
+        break;
+      }
+      X_INFO("Removed incomplete bag file at: " << path);
+    }
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
@@ -0,0 +1,293 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "a2d2_to_ros/bus_signal_reader.hpp"
+
+#include <cstdio>
+#include <sstream>
+
+#include "rapidjson/filereadstream.h"
+
+#include "a2d2_to_ros/json_utils.hpp"
+
+namespace a2d2_to_ros {
+
+//------------------------------------------------------------------------------
+
+constexpr size_t BusSignalHandler::CHUNK_SIZE;
+
+//------------------------------------------------------------------------------
+
+BusSignalHandler::BusSignalHandler(std::set<std::string> signals,
+                                   SignalCallback signal_callback,
+                                   SampleCallback sample_callback)
+    : signals_(std::move(signals)),
+      signal_callback_(std::move(signal_callback)),
+      sample_callback_(std::move(sample_callback)) {
+  times_.reserve(CHUNK_SIZE);
+  values_.reserve(CHUNK_SIZE);
+}
+
+//------------------------------------------------------------------------------
+
+bool BusSignalHandler::Default() { return true; }
+
+//------------------------------------------------------------------------------
+
+bool BusSignalHandler::Null() {
+  if ((depth_ == SIGNAL) && (key_ == "unit") && is_converted_signal()) {
+    unit_ = "null";
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool BusSignalHandler::Int(int i) {
+  return Int64(static_cast<int64_t>(i));
+}
+
+//------------------------------------------------------------------------------
+
+bool BusSignalHandler::Uint(unsigned u) {
+  return Uint64(static_cast<uint64_t>(u));
+}
+
+//------------------------------------------------------------------------------
+
+bool BusSignalHandler::Int64(int64_t i) {
+  const auto time = ((i < 0) ? boost::optional<uint64_t>()
+                             : boost::optional<uint64_t>(i));
+  return number(time, static_cast<double>(i));
+}
+
+//------------------------------------------------------------------------------
+
+bool BusSignalHandler::Uint64(uint64_t u) {
+  return number(u, static_cast<double>(u));
+}
+
+//------------------------------------------------------------------------------
+
+bool BusSignalHandler::Double(double d) { return number(boost::none, d); }
+
+//------------------------------------------------------------------------------
+
+bool BusSignalHandler::String(const char* str, rapidjson::SizeType length,
+                              bool) {
+  if ((depth_ == SIGNAL) && (key_ == "unit") && is_converted_signal()) {
+    unit_ = std::string(str, length);
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool BusSignalHandler::StartObject() {
+  ++depth_;
+  if ((depth_ == SIGNAL) && is_converted_signal()) {
+    key_.clear();
+    unit_ = boost::none;
+    times_.clear();
+    values_.clear();
+    if (!signal_callback_(signal_)) {
+      return fail("Stopped before converting signal '" + signal_ + "'.");
+    }
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool BusSignalHandler::Key(const char* str, rapidjson::SizeType length, bool) {
+  if (depth_ == DATA_SET) {
+    signal_.assign(str, length);
+  } else if (depth_ == SIGNAL) {
+    key_.assign(str, length);
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool BusSignalHandler::EndObject(rapidjson::SizeType) {
+  if ((depth_ == SIGNAL) && is_converted_signal()) {
+    if (!unit_) {
+      return fail("Signal '" + signal_ + "' does not have a unit.");
+    }
+    // samples that did not fill a whole chunk
+    if (!flush()) {
+      return false;
+    }
+  }
+  --depth_;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool BusSignalHandler::StartArray() {
+  ++depth_;
+  if (depth_ == SAMPLE) {
+    sample_idx_ = 0;
+    sample_time_ = boost::none;
+    sample_value_ = boost::none;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool BusSignalHandler::EndArray(rapidjson::SizeType) {
+  const auto is_sample =
+      ((depth_ == SAMPLE) && (key_ == "values") && is_converted_signal());
+  --depth_;
+  if (!is_sample) {
+    return true;
+  }
+
+  if ((sample_idx_ != 2) || !sample_time_ || !sample_value_) {
+    return fail("Signal '" + signal_ +
+                "' has a sample that is not a [timestamp, value] pair.");
+  }
+  return on_sample(*sample_time_, *sample_value_);
+}
+
+//------------------------------------------------------------------------------
+
+const std::string& BusSignalHandler::get_error_string() const {
+  return error_string_;
+}
+
+//------------------------------------------------------------------------------
+
+bool BusSignalHandler::is_converted_signal() const {
+  return ((depth_ >= SIGNAL) &&
+          (signals_.empty() || (signals_.find(signal_) != std::end(signals_))));
+}
+
+//------------------------------------------------------------------------------
+
+bool BusSignalHandler::number(boost::optional<uint64_t> time, double value) {
+  const auto is_sample =
+      ((depth_ == SAMPLE) && (key_ == "values") && is_converted_signal());
+  if (!is_sample) {
+    return true;
+  }
+
+  constexpr auto TIMESTAMP_IDX = 0u;
+  constexpr auto VALUE_IDX = 1u;
+  if (sample_idx_ == TIMESTAMP_IDX) {
+    if (!time) {
+      return fail("Signal '" + signal_ +
+                  "' has a timestamp that is not an unsigned integer.");
+    }
+    sample_time_ = time;
+  } else if (sample_idx_ == VALUE_IDX) {
+    sample_value_ = value;
+  }
+  ++sample_idx_;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool BusSignalHandler::on_sample(uint64_t time, double value) {
+  times_.push_back(time);
+  values_.push_back(value);
+
+  // until the unit is known, samples are kept regardless of the chunk size
+  if (unit_ && (times_.size() >= CHUNK_SIZE)) {
+    return flush();
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool BusSignalHandler::flush() {
+  if (times_.empty()) {
+    return true;
+  }
+
+  const auto ok = sample_callback_(signal_, *unit_, times_, values_);
+  times_.clear();
+  values_.clear();
+  if (!ok) {
+    return fail("Stopped while converting signal '" + signal_ + "'.");
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool BusSignalHandler::fail(const std::string& error_string) {
+  error_string_ = error_string;
+  return false;
+}
+
+//------------------------------------------------------------------------------
+
+bool read_bus_signals(const std::string& path,
+                      const rapidjson::SchemaDocument& schema,
+                      BusSignalHandler& handler, std::string& error_string) {
+  error_string.clear();
+
+  auto* fp = std::fopen(path.c_str(), "rb");
+  if (!fp) {
+    error_string = "'" + path + "' failed to open.";
+    return false;
+  }
+
+  // the file is read in chunks of this size, regardless of its total size
+  constexpr size_t BUFFER_SIZE = (64 * 1024);
+  std::vector<char> buffer(BUFFER_SIZE);
+  rapidjson::FileReadStream stream(fp, buffer.data(), buffer.size());
+
+  rapidjson::GenericSchemaValidator<rapidjson::SchemaDocument,
+                                    BusSignalHandler>
+      validator(schema, handler);
+  rapidjson::Reader reader;
+  const auto result = reader.Parse(stream, validator);
+  std::fclose(fp);
+
+  if (result) {
+    return true;
+  }
+
+  if (!handler.get_error_string().empty()) {
+    error_string = handler.get_error_string();
+  } else if (!validator.IsValid()) {
+    error_string = get_validator_error_string(validator);
+  } else {
+    std::stringstream ss;
+    ss << "Error(offset " << static_cast<unsigned>(result.Offset())
+       << "): " << rapidjson::GetParseError_En(result.Code());
+    error_string = ss.str();
+  }
+  return false;
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
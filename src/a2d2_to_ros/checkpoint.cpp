@@ -0,0 +1,196 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "a2d2_to_ros/checkpoint.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+#include "a2d2_to_ros/checks.hpp"
+#include "a2d2_to_ros/logging.hpp"
+#include "a2d2_to_ros/sensor_config.hpp"
+
+namespace a2d2_to_ros {
+
+namespace {
+// first line of the checkpoint file; bump the version if the format changes
+static constexpr auto CHECKPOINT_HEADER = "a2d2_checkpoint 1";
+}  // namespace
+
+//------------------------------------------------------------------------------
+
+const std::string Checkpoint::FILENAME_SUFFIX = ".checkpoint";
+
+//------------------------------------------------------------------------------
+
+uint64_t get_checkpoint_key(const std::string& settings,
+                            const std::vector<std::string>& paths) {
+  // the terminating null separates each string from the next
+  auto key = fnv1a_hash(reinterpret_cast<const uint8_t*>(settings.c_str()),
+                        settings.size() + 1);
+  for (const auto& path : paths) {
+    key = fnv1a_hash(reinterpret_cast<const uint8_t*>(path.c_str()),
+                     path.size() + 1, key);
+  }
+  return key;
+}
+
+//------------------------------------------------------------------------------
+
+bool save_checkpoint(const std::string& path, const Checkpoint& checkpoint) {
+  const auto tmp_path = (path + ".tmp");
+
+  {
+    std::ofstream ofs(tmp_path, std::ios::trunc);
+    if (!ofs.good()) {
+      return false;
+    }
+
+    ofs << CHECKPOINT_HEADER << "\n";
+    ofs << checkpoint.key << " " << checkpoint.next_frame << "\n";
+    for (const auto& segment : checkpoint.segments) {
+      ofs << segment.size << " " << segment.path << "\n";
+    }
+
+    ofs.close();
+    if (ofs.fail()) {
+      std::remove(tmp_path.c_str());
+      return false;
+    }
+  }
+
+  // replace the old checkpoint in one step, so that a crash while saving
+  // leaves the last one intact
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    std::remove(tmp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+boost::optional<Checkpoint> load_checkpoint(const std::string& path) {
+  std::ifstream ifs(path);
+  if (!ifs.good()) {
+    return boost::none;
+  }
+
+  std::string header;
+  if (!std::getline(ifs, header) || (header != CHECKPOINT_HEADER)) {
+    return boost::none;
+  }
+
+  Checkpoint checkpoint;
+  if (!(ifs >> checkpoint.key >> checkpoint.next_frame)) {
+    return boost::none;
+  }
+
+  // each following line is '<size> <path>', where the path may have spaces
+  BagSegment segment;
+  while (ifs >> segment.size) {
+    ifs.ignore(1);
+    if (!std::getline(ifs, segment.path) || segment.path.empty()) {
+      return boost::none;
+    }
+    checkpoint.segments.push_back(segment);
+  }
+
+  if (!ifs.eof()) {
+    // a line failed to parse; don't trust any of it
+    return boost::none;
+  }
+
+  return checkpoint;
+}
+
+//------------------------------------------------------------------------------
+
+boost::optional<Checkpoint> get_resume_checkpoint(const std::string& path,
+                                                  uint64_t key,
+                                                  size_t num_frames) {
+  const auto checkpoint_opt = load_checkpoint(path);
+  if (!checkpoint_opt) {
+    X_INFO("No checkpoint at '" << path
+                                << "'. Starting from the first frame.");
+    Checkpoint checkpoint;
+    checkpoint.key = key;
+    return checkpoint;
+  }
+
+  if ((checkpoint_opt->key != key) ||
+      (checkpoint_opt->next_frame > num_frames)) {
+    X_ERROR("Checkpoint at '" << path
+                              << "' is for other inputs or options.");
+    return boost::none;
+  }
+
+  X_INFO("Resuming from frame " << checkpoint_opt->next_frame << " of "
+                                << num_frames << ".");
+  return checkpoint_opt;
+}
+
+//------------------------------------------------------------------------------
+
+CheckpointWriter::CheckpointWriter(std::string path, uint64_t key,
+                                   double interval)
+    : path_(std::move(path)),
+      key_(key),
+      interval_(strictly_positive(interval) && std::isfinite(interval)
+                    ? interval
+                    : 0.0) {}
+
+//------------------------------------------------------------------------------
+
+bool CheckpointWriter::update(double time_since_begin, size_t next_frame,
+                              const std::vector<MessageSink*>& bags) {
+  if (!strictly_positive(interval_)) {
+    return true;
+  }
+  if (!last_time_) {
+    last_time_ = time_since_begin;
+  }
+  if ((time_since_begin - *last_time_) < interval_) {
+    return true;
+  }
+  last_time_ = time_since_begin;
+
+  Checkpoint checkpoint;
+  checkpoint.key = key_;
+  checkpoint.next_frame = next_frame;
+  for (auto* bag : bags) {
+    const auto segments = bag->checkpoint();
+    checkpoint.segments.insert(std::end(checkpoint.segments),
+                               std::begin(segments), std::end(segments));
+  }
+  return save_checkpoint(path_, checkpoint);
+}
+
+//------------------------------------------------------------------------------
+
+void CheckpointWriter::remove() const { std::remove(path_.c_str()); }
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
@@ -0,0 +1,429 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "a2d2_to_ros/converters.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+#include <boost/filesystem.hpp>
+#include <cv_bridge/cv_bridge.h>
+#include <opencv2/opencv.hpp>
+
+#include "a2d2_to_ros/bus_signal_reader.hpp"
+#include "a2d2_to_ros/checks.hpp"
+#include "a2d2_to_ros/conversions.hpp"
+#include "a2d2_to_ros/json_utils.hpp"
+#include "a2d2_to_ros/logging.hpp"
+#include "a2d2_to_ros/name_utils.hpp"
+#include "a2d2_to_ros/sensors.hpp"
+
+namespace a2d2_to_ros {
+
+//------------------------------------------------------------------------------
+
+LidarFrameConverter::LidarFrameConverter(Options options,
+                                         const CameraInfoMap& camera_infos,
+                                         RunStats& stats)
+    : options_(std::move(options)),
+      downsample_(options_.downsample.enabled()),
+      stats_(stats) {
+  if (!options_.include_depth_map) {
+    return;
+  }
+  for (const auto& p : camera_infos) {
+    auto& camera = depth_cameras_[p.first];
+    camera.width = p.second.width;
+    camera.height = p.second.height;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+boost::optional<LidarFrameMessages> LidarFrameConverter::convert(
+    const npz::MappedNpz& npz, const std::string& sensor_name,
+    ros::Time stamp) const {
+  LidarFrameMessages messages;
+  messages.sensor_name = sensor_name;
+
+  // one pass over the data both validates it and summarizes it
+  ScopedStageTimer verify_timer(stats_, Stage::VERIFY);
+  messages.summary = npz::verify_frame(npz);
+  verify_timer.stop();
+  const auto& summary = messages.summary;
+  if (!summary.valid) {
+    X_ERROR("Encountered unexpected structure in the data of lidar: "
+            << sensor_name);
+    return boost::none;
+  }
+
+  // the columns are views into the mapped file, so npz must outlive them
+  ScopedStageTimer build_timer(stats_, Stage::MSG_BUILD);
+  const auto columns = npz::get_columns(npz);
+
+  const auto frame = tf_motion_compensated_sensor_frame_name(
+      sensors::Names::CAMERAS, sensor_name);
+  if (frame.empty()) {
+    X_ERROR("Could not find frame name for lidar: " << sensor_name);
+    return boost::none;
+  }
+
+  // looked up before anything is taken from a pool, so that nothing taken
+  // can be lost on this error
+  const DepthCamera* camera = nullptr;
+  if (options_.include_depth_map) {
+    const auto it_camera = depth_cameras_.find(sensor_name);
+    if (it_camera == std::end(depth_cameras_)) {
+      X_ERROR("Did not find camera info for: " << sensor_name);
+      return boost::none;
+    }
+    camera = &it_camera->second;
+  }
+
+  // downsampled clouds are filled from a gathered copy of their points, so
+  // every layout is filled by the same kernels as a whole frame; the copy is
+  // only needed until the cloud is filled
+  Selection selection;
+  if (downsample_) {
+    selection = selections_.take();
+    select_points(columns, options_.downsample, selection.indices);
+  }
+  const auto& cloud_columns =
+      (downsample_ ? selection.columns.gather(columns, selection.indices)
+                   : columns);
+  const auto is_dense = (summary.is_dense || options_.downsample.drop_invalid);
+
+  const auto& layout = options_.layout;
+  const auto num_points = static_cast<uint32_t>(cloud_columns.num_points);
+  const auto cloud_bytes =
+      (static_cast<size_t>(num_points) * layout.point_step);
+  auto max_cloud_bytes = max_cloud_bytes_.load();
+  while ((cloud_bytes > max_cloud_bytes) &&
+         !max_cloud_bytes_.compare_exchange_weak(max_cloud_bytes,
+                                                 cloud_bytes)) {
+  }
+  messages.cloud = clouds_.take();
+  auto& msg = messages.cloud;
+  msg.data.reserve(std::max(cloud_bytes, max_cloud_bytes));
+  rebuild_pc2_msg(layout, frame, stamp, is_dense, num_points, msg);
+
+  if (camera) {
+    messages.depth_map = build_depth_image_msg(
+        tf_frame_name(sensors::Names::CAMERAS, sensor_name), stamp,
+        camera->width, camera->height, camera->buffers.take());
+  }
+
+  // the cloud and depth map are filled in a single pass, except that the
+  // depth map of a downsampled cloud is filled from all points after it
+  auto filled = false;
+  if (!messages.depth_map) {
+    filled = fill_pc2_msg(layout, cloud_columns, msg);
+  } else if (!downsample_) {
+    filled = fill_pc2_msg(layout, columns, msg, *messages.depth_map);
+  } else {
+    filled = (fill_pc2_msg(layout, cloud_columns, msg) &&
+              fill_depth_image(columns, *messages.depth_map));
+  }
+  if (downsample_) {
+    selections_.give(std::move(selection));
+  }
+  if (!filled) {
+    X_ERROR("Failed to fill point cloud message for lidar: " << sensor_name);
+    recycle(messages);
+    return boost::none;
+  }
+  return messages;
+}
+
+//------------------------------------------------------------------------------
+
+void LidarFrameConverter::recycle(LidarFrameMessages& messages) const {
+  clouds_.give(std::move(messages.cloud));
+  messages.cloud = sensor_msgs::PointCloud2();
+  if (!messages.depth_map) {
+    return;
+  }
+  const auto it_camera = depth_cameras_.find(messages.sensor_name);
+  if (it_camera != std::end(depth_cameras_)) {
+    it_camera->second.buffers.give(std::move(messages.depth_map->data));
+  }
+  messages.depth_map = boost::none;
+}
+
+//------------------------------------------------------------------------------
+
+CameraFrameConverter::CameraFrameConverter(bool compressed,
+                                           CameraInfoMap camera_infos,
+                                           RunStats& stats)
+    : compressed_(compressed),
+      camera_infos_(std::move(camera_infos)),
+      stats_(stats) {}
+
+//------------------------------------------------------------------------------
+
+boost::optional<CameraFrameMessages> CameraFrameConverter::convert(
+    std::vector<uint8_t>& png_bytes, const std::string& sensor_name,
+    ros::Time stamp) const {
+  CameraFrameMessages messages;
+  messages.header.frame_id =
+      tf_frame_name(sensors::Names::CAMERAS, sensor_name);
+  messages.header.stamp = stamp;
+
+  // the PNG is either passed through as-is or decoded to a raw image
+  if (compressed_) {
+    messages.compressed_image = sensor_msgs::CompressedImage();
+    messages.compressed_image->header = messages.header;
+    messages.compressed_image->format = "png";
+    messages.compressed_image->data = std::move(png_bytes);
+    return messages;
+  }
+
+  // decodes the same way cv::imread would
+  ScopedStageTimer decode_timer(stats_, Stage::IMAGE_DECODE);
+  const auto img = cv::imdecode(png_bytes, cv::IMREAD_COLOR);
+  decode_timer.stop();
+  if (img.empty()) {
+    X_ERROR("Failed to decode image of camera: " << sensor_name);
+    return boost::none;
+  }
+
+  ScopedStageTimer build_timer(stats_, Stage::MSG_BUILD);
+  messages.image =
+      cv_bridge::CvImage(messages.header, "bgr8", img).toImageMsg();
+  return messages;
+}
+
+//------------------------------------------------------------------------------
+
+boost::optional<sensor_msgs::CameraInfo> CameraFrameConverter::get_camera_info(
+    const std::string& sensor_name) const {
+  const auto it = camera_infos_.find(sensor_name);
+  if (it == std::end(camera_infos_)) {
+    return boost::none;
+  }
+  auto info = it->second;
+  info.header.frame_id = tf_frame_name(sensors::Names::CAMERAS, sensor_name);
+  return info;
+}
+
+//------------------------------------------------------------------------------
+
+std::unique_ptr<BusSignalConverter> BusSignalConverter::load(
+    const std::string& schema_path, Options options) {
+  auto d_schema_opt = get_rapidjson_dom(schema_path);
+  if (!d_schema_opt) {
+    X_ERROR("Could not open '" << schema_path);
+    return nullptr;
+  }
+  return std::unique_ptr<BusSignalConverter>(
+      new BusSignalConverter(std::move(options), std::move(*d_schema_opt)));
+}
+
+//------------------------------------------------------------------------------
+
+BusSignalConverter::BusSignalConverter(Options options,
+                                       rapidjson::Document schema_document)
+    : options_(std::move(options)),
+      schema_document_(new rapidjson::Document(std::move(schema_document))),
+      schema_(new rapidjson::SchemaDocument(*schema_document_)) {
+  // the signals to convert are the ones the schema requires
+  const rapidjson::Value& r = (*schema_document_)["required"];
+  for (rapidjson::SizeType idx = 0; idx < r.Size(); ++idx) {
+    signal_names_.insert(std::string(r[idx].GetString()));
+  }
+}
+
+//------------------------------------------------------------------------------
+
+boost::optional<BusSignalData> BusSignalConverter::convert(
+    const std::string& json_path, RunStats& stats) const {
+  BusSignalData data;
+  data.samples.reset(new RunFile<BusSignalSample>());
+  if (!data.samples->good()) {
+    X_ERROR("Failed to create temporary file for bus signal samples: "
+            << data.samples->get_path());
+    return boost::none;
+  }
+
+  // state of the signal currently being converted
+  boost::optional<ros::Time> first_time;
+  auto signal_done = false;
+  uint64_t last_time = 0;
+  const auto begin_signal = [&](const std::string& name) {
+    if (options_.verbose) {
+      X_INFO("Converting " << name << "...");
+    }
+    first_time = boost::none;
+    signal_done = false;
+    last_time = 0;
+
+    const auto signal_prefix = (options_.topic_prefix + "/" + name + "/");
+    BusSignal signal;
+    signal.name = name;
+    signal.header_topic = (signal_prefix + "header");
+    signal.original_value_topic = (signal_prefix + "original_value");
+    signal.original_units_topic = (signal_prefix + "original_units");
+    signal.value_topic = (signal_prefix + "value");
+    data.signals.push_back(std::move(signal));
+    return true;
+  };
+
+  // converted values are reused for every chunk
+  std::vector<DataPair::value_type::_data_type> ros_values;
+  const auto convert_samples = [&](const std::string& name,
+                                   const std::string& unit,
+                                   const std::vector<uint64_t>& times,
+                                   const std::vector<double>& values) {
+    // the rest of a signal is skipped once it exceeds the duration
+    if (signal_done) {
+      return true;
+    }
+
+    // resolve the unit once, and convert the whole chunk in one pass
+    ScopedStageTimer build_timer(stats, Stage::MSG_BUILD);
+    const auto units = get_unit_enum(unit);
+    if (options_.include_converted) {
+      ros_values.assign(std::begin(values), std::end(values));
+      const auto is_lat_lon =
+          ((name == "longitude_degree") || (name == "latitude_degree"));
+      if (!is_lat_lon) {
+        to_ros_units(units, ros_values.data(), ros_values.data(),
+                     ros_values.size());
+      }
+    }
+
+    auto& signal = data.signals.back();
+    for (size_t i = 0; i < times.size(); ++i) {
+      const auto time = times[i];
+      const auto value = values[i];
+
+      if (!valid_ros_timestamp(time)) {
+        X_ERROR("Timestamp "
+                << time
+                << " has unsupported magnitude: ROS does not support "
+                   "timestamps on or after 4294967296000000 "
+                   "(Sunday, February 7, 2106 6:28:16 AM GMT)\nCall "
+                   "Zager and Evans for details.");
+        return false;
+      }
+
+      if (time < options_.start_time) {
+        continue;
+      }
+
+      const auto stamp = a2d2_timestamp_to_ros_time(time);
+      if (!first_time) {
+        if (options_.start_time != 0) {
+          first_time = a2d2_timestamp_to_ros_time(options_.start_time);
+        } else {
+          first_time = stamp;
+        }
+      }
+
+      const auto time_since_begin = (stamp - *first_time).toSec();
+      if (time_since_begin < options_.min_time_offset) {
+        continue;
+      }
+
+      const auto recorded_duration =
+          (time_since_begin - options_.min_time_offset);
+      if (recorded_duration > options_.duration) {
+        signal_done = true;
+        break;
+      }
+
+      if (name == "roll_angle") {
+        data.roll_angles.push_back({time, to_ros_units(units, value)});
+        if (!data.tf_first_time) {
+          data.tf_first_time = first_time;
+        }
+      }
+
+      if (name == "pitch_angle") {
+        data.pitch_angles.push_back({time, to_ros_units(units, value)});
+      }
+
+      // the samples of a signal are in file order, which should be time
+      // order; a sample that is not starts a new run, so every run is sorted
+      if ((signal.num_samples == 0) || (time < last_time)) {
+        data.samples->begin_run();
+        data.run_signals.push_back(data.signals.size() - 1);
+      }
+      if (signal.num_samples == 0) {
+        signal.unit = unit;
+      }
+      last_time = time;
+      ++signal.num_samples;
+      if (!data.samples->push_back(
+              {time, value,
+               (options_.include_converted
+                    ? ros_values[i]
+                    : DataPair::value_type::_data_type()),
+               time_since_begin})) {
+        X_ERROR("Failed to write bus signal samples to: "
+                << data.samples->get_path());
+        return false;
+      }
+    }
+    return true;
+  };
+
+  // samples are converted while the file is parsed, so the time spent in
+  // convert_samples is taken out of the time reported for parsing
+  auto convert_time = 0.0;
+  const auto timed_convert_samples = [&](const std::string& name,
+                                         const std::string& unit,
+                                         const std::vector<uint64_t>& times,
+                                         const std::vector<double>& values) {
+    const auto start = RunStats::Clock::now();
+    const auto converted = convert_samples(name, unit, times, values);
+    convert_time +=
+        std::chrono::duration<double>(RunStats::Clock::now() - start).count();
+    return converted;
+  };
+
+  BusSignalHandler handler(signal_names_, begin_signal, timed_convert_samples);
+  std::string err_string;
+  const auto start = RunStats::Clock::now();
+  if (!read_bus_signals(json_path, *schema_, handler, err_string)) {
+    X_ERROR(err_string);
+    return boost::none;
+  }
+  const auto read_time =
+      std::chrono::duration<double>(RunStats::Clock::now() - start).count();
+  stats.add_latency(Stage::JSON_VALIDATE, (read_time - convert_time));
+  if (stats.is_enabled()) {
+    stats.add_bytes_in(boost::filesystem::file_size(json_path));
+  }
+
+  if (!data.samples->flush()) {
+    X_ERROR("Failed to write bus signal samples to: "
+            << data.samples->get_path());
+    return boost::none;
+  }
+  return data;
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
@@ -55,4 +55,18 @@ DataPair DataPair::build(double value, uint64_t time, std::string frame_id) {
 
 //------------------------------------------------------------------------------
 
+MutableDataPair::MutableDataPair(std::string frame_id) {
+  header.seq = 0;
+  header.frame_id = std::move(frame_id);
+}
+
+//------------------------------------------------------------------------------
+
+void MutableDataPair::set(double value, uint64_t time) {
+  header.stamp = a2d2_timestamp_to_ros_time(time);
+  this->value.data = value;
+}
+
+//------------------------------------------------------------------------------
+
 }  // namespace a2d2_to_ros
@@ -0,0 +1,146 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "a2d2_to_ros/downsample.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+
+#include "a2d2_to_ros/checks.hpp"
+
+namespace a2d2_to_ros {
+
+namespace {
+
+/// bits of each voxel coordinate in a key; coordinates wrap around beyond
+/// +/- 2^20 voxels, which is over 100 km for 0.1 m voxels
+constexpr uint64_t VOXEL_COORD_BITS = 21;
+constexpr uint64_t VOXEL_COORD_MASK = ((uint64_t(1) << VOXEL_COORD_BITS) - 1);
+
+/** @brief Pack the voxel coordinates of a point into a single key. */
+uint64_t get_voxel_key(const double* xyz, double inverse_size) {
+  uint64_t key = 0;
+  for (size_t i = 0; i < 3; ++i) {
+    const auto coord = static_cast<int64_t>(std::floor(xyz[i] * inverse_size));
+    key = ((key << VOXEL_COORD_BITS) |
+           (static_cast<uint64_t>(coord) & VOXEL_COORD_MASK));
+  }
+  return key;
+}
+
+/** @brief Copy the values at the indices of a column into a buffer. */
+template <typename T>
+const T* gather_column(const T* src, const std::vector<uint32_t>& indices,
+                       std::vector<T>& dst) {
+  dst.resize(indices.size());
+  for (size_t i = 0; i < indices.size(); ++i) {
+    dst[i] = src[indices[i]];
+  }
+  return dst.data();
+}
+
+}  // namespace
+
+//------------------------------------------------------------------------------
+
+bool DownsampleOptions::enabled() const {
+  return (drop_invalid || (stride > 1) ||
+          (strictly_positive(voxel_size) && std::isfinite(voxel_size)));
+}
+
+//------------------------------------------------------------------------------
+
+void select_points(const npz::Columns& columns,
+                   const DownsampleOptions& options,
+                   std::vector<uint32_t>& indices) {
+  indices.clear();
+  const auto n = columns.num_points;
+  const auto stride = std::max(options.stride, static_cast<size_t>(1));
+  size_t num_candidates = 0;
+  for (size_t i = 0; i < n; ++i) {
+    if (options.drop_invalid && !columns.valid[i]) {
+      continue;
+    }
+    if ((num_candidates++ % stride) == 0) {
+      indices.push_back(static_cast<uint32_t>(i));
+    }
+  }
+
+  const auto voxel_size = options.voxel_size;
+  if (!strictly_positive(voxel_size) || !std::isfinite(voxel_size)) {
+    return;
+  }
+  const auto inverse_size = (1.0 / voxel_size);
+  std::unordered_set<uint64_t> occupied;
+  occupied.reserve(indices.size());
+  size_t num_kept = 0;
+  for (const auto i : indices) {
+    const auto* const xyz = (columns.points + (3 * static_cast<size_t>(i)));
+    const auto finite = (std::isfinite(xyz[0]) && std::isfinite(xyz[1]) &&
+                         std::isfinite(xyz[2]));
+    if (finite && occupied.insert(get_voxel_key(xyz, inverse_size)).second) {
+      indices[num_kept++] = i;
+    }
+  }
+  indices.resize(num_kept);
+}
+
+//------------------------------------------------------------------------------
+
+const npz::Columns& SelectedColumns::gather(
+    const npz::Columns& columns, const std::vector<uint32_t>& indices) {
+  const auto n = indices.size();
+  points_.resize(3 * n);
+  for (size_t i = 0; i < n; ++i) {
+    const auto j = static_cast<size_t>(indices[i]);
+    const auto* const src = (columns.points + (3 * j));
+    std::copy(src, (src + 3), (points_.data() + (3 * i)));
+  }
+  if (valid_capacity_ < n) {
+    valid_.reset(new npz::ReadTypes::Valid[n]);
+    valid_capacity_ = n;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    valid_[i] = columns.valid[indices[i]];
+  }
+
+  view_.points = points_.data();
+  view_.azimuth = gather_column(columns.azimuth, indices, azimuth_);
+  view_.boundary = gather_column(columns.boundary, indices, boundary_);
+  view_.col = gather_column(columns.col, indices, col_);
+  view_.depth = gather_column(columns.depth, indices, depth_);
+  view_.distance = gather_column(columns.distance, indices, distance_);
+  view_.lidar_id = gather_column(columns.lidar_id, indices, lidar_id_);
+  view_.rectime = gather_column(columns.rectime, indices, rectime_);
+  view_.reflectance = gather_column(columns.reflectance, indices, reflectance_);
+  view_.row = gather_column(columns.row, indices, row_);
+  view_.timestamp = gather_column(columns.timestamp, indices, timestamp_);
+  view_.valid = valid_.get();
+  view_.num_points = n;
+  return view_;
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
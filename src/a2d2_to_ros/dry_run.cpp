@@ -0,0 +1,274 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "a2d2_to_ros/dry_run.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#include "a2d2_to_ros/bag_utils.hpp"
+#include "a2d2_to_ros/checks.hpp"
+#include "a2d2_to_ros/logging.hpp"
+
+namespace a2d2_to_ros {
+
+namespace {
+/** @brief Get a count per second, or zero if no time would pass. */
+double get_rate(double count, double seconds) {
+  return ((seconds > 0.0) ? (count / seconds) : 0.0);
+}
+
+/** @brief Get the bytes of a number of frames of a mean size. */
+uint64_t get_bytes(size_t num_frames, double mean_frame_bytes) {
+  return static_cast<uint64_t>(
+      std::llround(static_cast<double>(num_frames) * mean_frame_bytes));
+}
+
+/** @brief Get a number of bytes in mebibytes, for logging. */
+double to_mib(uint64_t bytes) {
+  return (static_cast<double>(bytes) / (1024.0 * 1024.0));
+}
+}  // namespace
+
+//------------------------------------------------------------------------------
+
+std::vector<size_t> get_sample_indices(size_t num_frames, size_t num_samples) {
+  std::vector<size_t> indices;
+  if (num_frames <= num_samples) {
+    for (size_t i = 0; i < num_frames; ++i) {
+      indices.push_back(i);
+    }
+    return indices;
+  }
+  if (num_samples == 1) {
+    indices.push_back(0);
+    return indices;
+  }
+
+  // the first and last frames are always picked, so the whole drive is covered
+  for (size_t i = 0; i < num_samples; ++i) {
+    indices.push_back((i * (num_frames - 1)) / (num_samples - 1));
+  }
+  return indices;
+}
+
+//------------------------------------------------------------------------------
+
+std::string DryRunReport::to_json(const std::string& converter) const {
+  std::stringstream ss;
+  ss.precision(9);
+  ss << "{\n"
+     << "  \"converter\": \"" << converter << "\",\n"
+     << "  \"dry_run\": true,\n"
+     << "  \"totals\": {\n"
+     << "    \"frames\": " << num_frames << ",\n"
+     << "    \"samples\": " << num_samples << ",\n"
+     << "    \"bytes\": " << bytes << ",\n"
+     << "    \"seconds\": " << seconds << ",\n"
+     << "    \"peak_memory_bytes\": " << peak_memory_bytes << "\n"
+     << "  },\n"
+     << "  \"rates\": {\n"
+     << "    \"mean_frame_s\": " << mean_frame_s << ",\n"
+     << "    \"frames_per_s\": " << frames_per_s << ",\n"
+     << "    \"bytes_per_s\": " << bytes_per_s << "\n"
+     << "  },\n"
+     << "  \"bags\": [";
+
+  for (size_t i = 0; i < bags.size(); ++i) {
+    const auto& bag = bags[i];
+    ss << ((i == 0) ? "\n" : ",\n") << "    {\"name\": \"" << bag.name
+       << "\", \"frames\": " << bag.num_frames
+       << ", \"samples\": " << bag.num_samples
+       << ", \"mean_frame_bytes\": " << bag.mean_frame_bytes
+       << ", \"max_frame_bytes\": " << bag.max_frame_bytes
+       << ", \"bytes\": " << bag.bytes << ", \"windows\": [";
+    for (size_t j = 0; j < bag.windows.size(); ++j) {
+      ss << ((j == 0) ? "" : ", ") << "{\"name\": \"" << bag.windows[j].first
+         << "\", \"bytes\": " << bag.windows[j].second << "}";
+    }
+    ss << "]}";
+  }
+  ss << (bags.empty() ? "]\n" : "\n  ]\n") << "}\n";
+  return ss.str();
+}
+
+//------------------------------------------------------------------------------
+
+bool DryRunReport::write_json(const std::string& path,
+                              const std::string& converter) const {
+  std::ofstream f(path);
+  if (!f) {
+    X_ERROR("Failed to open '" << path << "' for writing.");
+    return false;
+  }
+  f << to_json(converter);
+  f.close();
+  if (!f) {
+    X_ERROR("Failed to write '" << path << "'.");
+    return false;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+void DryRunReport::log() const {
+  for (const auto& bag : bags) {
+    X_INFO("Dry run: " << bag.name << ": " << bag.num_frames << " frames, "
+                       << to_mib(bag.bytes) << " MiB (" << bag.windows.size()
+                       << " window(s)), from " << bag.num_samples
+                       << " sampled frame(s) of up to "
+                       << to_mib(bag.max_frame_bytes) << " MiB");
+    for (const auto& window : bag.windows) {
+      X_INFO("Dry run: " << bag.name << ": " << window.first << ": "
+                         << to_mib(window.second) << " MiB");
+    }
+  }
+  X_INFO("Dry run: " << num_frames << " frames, " << to_mib(bytes)
+                     << " MiB in about " << seconds << " s ("
+                     << frames_per_s << " frames/s, "
+                     << to_mib(static_cast<uint64_t>(bytes_per_s))
+                     << " MiB/s), peak memory of about "
+                     << to_mib(peak_memory_bytes) << " MiB");
+}
+
+//------------------------------------------------------------------------------
+
+DryRun::DryRun(double min_time_offset, double split_duration)
+    : min_time_offset_(min_time_offset), split_duration_(split_duration) {}
+
+//------------------------------------------------------------------------------
+
+size_t DryRun::add_lane(std::vector<double> frame_offsets,
+                        size_t max_in_flight,
+                        std::vector<std::string> bag_names) {
+  Lane lane;
+  lane.frame_offsets = std::move(frame_offsets);
+  lane.max_in_flight = max_in_flight;
+  for (auto& name : bag_names) {
+    lane.bags.push_back({std::move(name), 0, 0});
+  }
+  lane.num_samples = 0;
+  lane.seconds = 0.0;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  lanes_.push_back(std::move(lane));
+  return (lanes_.size() - 1);
+}
+
+//------------------------------------------------------------------------------
+
+bool DryRun::add_sample(size_t lane, double seconds,
+                        const std::vector<uint64_t>& bag_bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& l = lanes_[lane];
+  if (bag_bytes.size() != l.bags.size()) {
+    X_ERROR("Expected the sizes of " << l.bags.size() << " bag(s), but got "
+                                     << bag_bytes.size() << ".");
+    return false;
+  }
+  ++l.num_samples;
+  l.seconds += seconds;
+  for (size_t i = 0; i < bag_bytes.size(); ++i) {
+    l.bags[i].bytes += bag_bytes[i];
+    l.bags[i].max_frame_bytes =
+        std::max(l.bags[i].max_frame_bytes, bag_bytes[i]);
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+DryRunReport DryRun::project(size_t num_jobs, uint64_t buffered_bytes) const {
+  const auto split =
+      (std::isfinite(split_duration_) && strictly_positive(split_duration_));
+  const auto jobs =
+      static_cast<double>(std::max(num_jobs, static_cast<size_t>(1)));
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  DryRunReport report;
+  report.peak_memory_bytes = buffered_bytes;
+  double sampled_seconds = 0.0;
+  for (const auto& lane : lanes_) {
+    const auto num_frames = lane.frame_offsets.size();
+    const auto samples = static_cast<double>(lane.num_samples);
+    report.num_frames += num_frames;
+    report.num_samples += lane.num_samples;
+    sampled_seconds += lane.seconds;
+    if (lane.num_samples > 0) {
+      report.seconds +=
+          ((lane.seconds / samples) * static_cast<double>(num_frames) / jobs);
+    }
+
+    // the frames of a window are those that SplitBagWriter would write to it
+    std::map<size_t, size_t> window_frames;
+    if (split) {
+      for (const auto t : lane.frame_offsets) {
+        ++window_frames[get_window_index(t - min_time_offset_,
+                                         split_duration_)];
+      }
+    }
+
+    uint64_t in_flight_frame_bytes = 0;
+    for (const auto& b : lane.bags) {
+      DryRunBag bag;
+      bag.name = b.name;
+      bag.num_frames = num_frames;
+      bag.num_samples = lane.num_samples;
+      bag.mean_frame_bytes =
+          ((lane.num_samples > 0) ? (static_cast<double>(b.bytes) / samples)
+                                  : 0.0);
+      bag.max_frame_bytes = b.max_frame_bytes;
+      if (split) {
+        for (const auto& w : window_frames) {
+          const auto start = (min_time_offset_ + (w.first * split_duration_));
+          const auto bytes = get_bytes(w.second, bag.mean_frame_bytes);
+          bag.windows.emplace_back(
+              get_window_name(start, (start + split_duration_)), bytes);
+          bag.bytes += bytes;
+        }
+      } else {
+        bag.bytes = get_bytes(num_frames, bag.mean_frame_bytes);
+      }
+      report.bytes += bag.bytes;
+      in_flight_frame_bytes += bag.max_frame_bytes;
+      report.bags.push_back(std::move(bag));
+    }
+    report.peak_memory_bytes += (lane.max_in_flight * in_flight_frame_bytes);
+  }
+
+  if (report.num_samples > 0) {
+    report.mean_frame_s =
+        (sampled_seconds / static_cast<double>(report.num_samples));
+  }
+  report.frames_per_s =
+      get_rate(static_cast<double>(report.num_frames), report.seconds);
+  report.bytes_per_s =
+      get_rate(static_cast<double>(report.bytes), report.seconds);
+  return report;
+}
+
+}  // namespace a2d2_to_ros
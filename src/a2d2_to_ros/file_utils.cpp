@@ -26,6 +26,8 @@
 #include <algorithm>
 #include <fstream>
 
+#include <boost/filesystem.hpp>
+
 #include "a2d2_to_ros/sensors.hpp"
 
 namespace a2d2_to_ros {
@@ -55,18 +57,91 @@ std::string frame_from_filename(const std::string& filename) {
 //------------------------------------------------------------------------------
 
 std::string get_file_as_string(const std::string& path) {
-  std::ifstream ifs(path);
+  std::string content;
+  get_file_as_string(path, content);
+  return content;
+}
+
+//------------------------------------------------------------------------------
+
+bool get_file_as_string(const std::string& path, std::string& contents) {
+  contents.clear();
+
+  std::ifstream ifs(path, std::ios::binary | std::ios::ate);
   if (!ifs.good()) {
-    return std::string("");
+    return false;
+  }
+
+  const auto size = ifs.tellg();
+  if (size < 0) {
+    return false;
   }
+  ifs.seekg(0, std::ios::beg);
 
   try {
-    std::string content((std::istreambuf_iterator<char>(ifs)),
-                        (std::istreambuf_iterator<char>()));
-    return content;
+    contents.resize(static_cast<size_t>(size));
   } catch (...) {
-    return std::string("");
+    return false;
+  }
+
+  if (!contents.empty()) {
+    ifs.read(&contents[0], size);
+  }
+  if (ifs.gcount() != static_cast<std::streamsize>(size)) {
+    contents.clear();
+    return false;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool get_file_as_bytes(const std::string& path, std::vector<uint8_t>& bytes) {
+  bytes.clear();
+
+  std::ifstream ifs(path, std::ios::binary | std::ios::ate);
+  if (!ifs.good()) {
+    return false;
+  }
+
+  const auto size = ifs.tellg();
+  if (size < 0) {
+    return false;
+  }
+  ifs.seekg(0, std::ios::beg);
+
+  try {
+    bytes.resize(static_cast<size_t>(size));
+  } catch (...) {
+    return false;
+  }
+
+  if (!bytes.empty()) {
+    ifs.read(reinterpret_cast<char*>(bytes.data()), size);
+  }
+  return (ifs.gcount() == static_cast<std::streamsize>(size));
+}
+
+//------------------------------------------------------------------------------
+
+std::vector<std::string> get_sensor_data_paths(const std::string& path,
+                                               const std::string& modality) {
+  const auto modality_path = (boost::filesystem::path(path) / modality);
+  boost::system::error_code ec;
+  if (!boost::filesystem::is_directory(modality_path, ec)) {
+    return {path};
+  }
+
+  std::vector<std::string> paths;
+  boost::filesystem::directory_iterator it(modality_path, ec);
+  for (; !ec && it != boost::filesystem::directory_iterator{};
+       it.increment(ec)) {
+    if (boost::filesystem::is_directory(it->status())) {
+      paths.push_back(it->path().string());
+    }
   }
+  std::sort(std::begin(paths), std::end(paths));
+  return paths;
 }
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,179 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "a2d2_to_ros/frame_index.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+
+#include "a2d2_to_ros/conversions.hpp"
+
+namespace a2d2_to_ros {
+
+namespace {
+// first line of the index file; bump the version if the format changes
+static constexpr auto INDEX_HEADER = "a2d2_index 1";
+}  // namespace
+
+//------------------------------------------------------------------------------
+
+const std::string FrameIndex::FILENAME = ".a2d2_index";
+
+//------------------------------------------------------------------------------
+
+FrameIndex FrameIndex::load(const std::string& directory) {
+  FrameIndex index;
+
+  std::ifstream ifs(directory + "/" + FILENAME);
+  if (!ifs.good()) {
+    return index;
+  }
+
+  std::string header;
+  if (!std::getline(ifs, header) || (header != INDEX_HEADER)) {
+    return index;
+  }
+
+  // each line is '<timestamp> <basename>'
+  uint64_t timestamp = 0;
+  std::string basename;
+  while (ifs >> timestamp >> basename) {
+    index.timestamps_[basename] = timestamp;
+  }
+
+  if (!ifs.eof()) {
+    // a line failed to parse; don't trust any of it
+    return FrameIndex();
+  }
+
+  return index;
+}
+
+//------------------------------------------------------------------------------
+
+bool FrameIndex::save(const std::string& directory) const {
+  const auto path = (directory + "/" + FILENAME);
+  const auto tmp_path = (path + ".tmp");
+
+  {
+    std::ofstream ofs(tmp_path, std::ios::trunc);
+    if (!ofs.good()) {
+      return false;
+    }
+
+    // sorted, so that the file is stable and easy to inspect
+    const std::map<std::string, uint64_t> sorted(std::begin(timestamps_),
+                                                 std::end(timestamps_));
+    ofs << INDEX_HEADER << "\n";
+    for (const auto& p : sorted) {
+      ofs << p.second << " " << p.first << "\n";
+    }
+
+    ofs.close();
+    if (ofs.fail()) {
+      std::remove(tmp_path.c_str());
+      return false;
+    }
+  }
+
+  // replace the old index in one step so that readers never see a partial file
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    std::remove(tmp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+boost::optional<uint64_t> FrameIndex::get_timestamp(
+    const std::string& basename) const {
+  const auto it = timestamps_.find(basename);
+  if (it == std::end(timestamps_)) {
+    return boost::none;
+  }
+  return it->second;
+}
+
+//------------------------------------------------------------------------------
+
+void FrameIndex::set_timestamp(const std::string& basename,
+                               uint64_t timestamp) {
+  const auto it = timestamps_.find(basename);
+  if ((it != std::end(timestamps_)) && (it->second == timestamp)) {
+    return;
+  }
+  timestamps_[basename] = timestamp;
+  modified_ = true;
+}
+
+//------------------------------------------------------------------------------
+
+bool FrameIndex::is_modified() const { return modified_; }
+
+//------------------------------------------------------------------------------
+
+size_t FrameIndex::size() const { return timestamps_.size(); }
+
+//------------------------------------------------------------------------------
+
+FrameWindow get_frame_window(const std::vector<uint64_t>& timestamps,
+                             uint64_t start_time, double min_time_offset,
+                             double duration) {
+  FrameWindow window;
+  window.begin = timestamps.size();
+  window.end = timestamps.size();
+
+  const auto first = std::lower_bound(std::begin(timestamps),
+                                      std::end(timestamps), start_time);
+  if (first == std::end(timestamps)) {
+    return window;
+  }
+
+  const auto first_time =
+      a2d2_timestamp_to_ros_time((start_time != 0) ? start_time : *first);
+  window.first_time = first_time;
+
+  // offsets are monotonic in the timestamps, so both bounds are partitions
+  const auto time_since_begin = [&first_time](uint64_t timestamp) {
+    return (a2d2_timestamp_to_ros_time(timestamp) - first_time).toSec();
+  };
+  const auto begin = std::partition_point(
+      first, std::end(timestamps), [&](uint64_t timestamp) {
+        return (time_since_begin(timestamp) < min_time_offset);
+      });
+  const auto end = std::partition_point(
+      begin, std::end(timestamps), [&](uint64_t timestamp) {
+        return ((time_since_begin(timestamp) - min_time_offset) <= duration);
+      });
+
+  window.begin = static_cast<size_t>(begin - std::begin(timestamps));
+  window.end = static_cast<size_t>(end - std::begin(timestamps));
+  return window;
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
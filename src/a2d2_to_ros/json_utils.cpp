@@ -23,6 +23,8 @@
  */
 #include "a2d2_to_ros/json_utils.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <sstream>
 
 #include "a2d2_to_ros/file_utils.hpp"
@@ -32,21 +34,6 @@ namespace a2d2_to_ros {
 
 //------------------------------------------------------------------------------
 
-std::string get_validator_error_string(
-    const rapidjson::SchemaValidator& validator) {
-  rapidjson::StringBuffer sb;
-  validator.GetInvalidSchemaPointer().StringifyUriFragment(sb);
-  std::stringstream ss;
-  ss << "\nInvalid schema: " << sb.GetString() << "\n";
-  ss << "Invalid keyword: " << validator.GetInvalidSchemaKeyword() << "\n";
-  sb.Clear();
-  validator.GetInvalidDocumentPointer().StringifyUriFragment(sb);
-  ss << "Invalid document: " << sb.GetString() << "\n";
-  return ss.str();
-}
-
-//------------------------------------------------------------------------------
-
 boost::optional<rapidjson::Document> get_rapidjson_dom(
     const std::string& path) {
   rapidjson::Document d;
@@ -105,4 +92,279 @@ Eigen::Vector3d json_origin_to_eigen_vector(const rapidjson::Document& d,
 
 //------------------------------------------------------------------------------
 
+sensor_msgs::CameraInfo json_camera_to_camera_info(
+    const rapidjson::Document& d, const std::string& sensor,
+    const std::string& camera_name) {
+  sensor_msgs::CameraInfo msg;
+
+  const rapidjson::Value& camera = d[sensor.c_str()][camera_name.c_str()];
+
+  const std::string camera_type = camera["Lens"].GetString();
+  const auto is_fisheye = (camera_type == "Fisheye");
+
+  // TODO(jeff): verify that this is right
+  msg.D.resize(5, 0.0);
+  const auto ROW_IDX = static_cast<rapidjson::SizeType>(0);
+  const auto D_size = static_cast<rapidjson::SizeType>(is_fisheye ? 4 : 5);
+  for (auto i = 0; i < D_size; ++i) {
+    const auto IDX = static_cast<rapidjson::SizeType>(i);
+    msg.D[i] = camera["Distortion"][ROW_IDX][IDX].GetDouble();
+  }
+
+  {
+    const rapidjson::Value& camera_matrix_raw = camera["CamMatrixOriginal"];
+    for (auto i = 0; i < camera_matrix_raw.Size(); ++i) {
+      const auto row_idx = static_cast<rapidjson::SizeType>(i);
+      for (auto j = 0; j < camera_matrix_raw[row_idx].Size(); ++j) {
+        const auto col_idx = static_cast<rapidjson::SizeType>(j);
+        const auto msg_idx = ((row_idx * 3) + col_idx);
+        msg.K[msg_idx] = camera_matrix_raw[row_idx][col_idx].GetDouble();
+      }
+    }
+  }
+
+  {
+    msg.P.fill(0.0);
+    const rapidjson::Value& camera_matrix = camera["CamMatrix"];
+    for (auto i = 0; i < camera_matrix.Size(); ++i) {
+      const auto row_idx = static_cast<rapidjson::SizeType>(i);
+      for (auto j = 0; j < camera_matrix[row_idx].Size(); ++j) {
+        const auto col_idx = static_cast<rapidjson::SizeType>(j);
+        const auto msg_idx = ((row_idx * 4) + col_idx);
+        msg.P[msg_idx] = camera_matrix[row_idx][col_idx].GetDouble();
+      }
+    }
+  }
+
+  constexpr auto WIDTH_IDX = static_cast<rapidjson::SizeType>(0);
+  constexpr auto HEIGHT_IDX = static_cast<rapidjson::SizeType>(1);
+  msg.width = camera["Resolution"][WIDTH_IDX].GetInt64();
+  msg.height = camera["Resolution"][HEIGHT_IDX].GetInt64();
+
+  msg.binning_x = 0;
+  msg.binning_y = 0;
+
+  msg.roi.x_offset = 0;
+  msg.roi.y_offset = 0;
+  msg.roi.height = 0;
+  msg.roi.width = 0;
+  msg.roi.do_rectify = false;
+
+  return msg;
+}
+
+//------------------------------------------------------------------------------
+
+bool ValidationPolicy::should_validate(size_t file_idx) const {
+  switch (mode) {
+    case Mode::FULL:
+      return true;
+    case Mode::SAMPLE:
+      return (file_idx < num_samples);
+    case Mode::NONE:
+      return false;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+boost::optional<ValidationPolicy> get_validation_policy(
+    const std::string& policy) {
+  ValidationPolicy p;
+  if (policy == "full") {
+    p.mode = ValidationPolicy::Mode::FULL;
+    return p;
+  }
+  if (policy == "none") {
+    p.mode = ValidationPolicy::Mode::NONE;
+    return p;
+  }
+
+  const std::string SAMPLE_PREFIX = "sample:";
+  const auto has_prefix = (policy.compare(0, SAMPLE_PREFIX.size(),
+                                          SAMPLE_PREFIX) == 0);
+  const auto count = policy.substr(std::min(SAMPLE_PREFIX.size(),
+                                            policy.size()));
+  const auto all_digits =
+      (!count.empty() &&
+       std::all_of(std::begin(count), std::end(count),
+                   [](char c) { return ((c >= '0') && (c <= '9')); }));
+  if (!has_prefix || !all_digits) {
+    return boost::none;
+  }
+
+  try {
+    p.num_samples = static_cast<size_t>(std::stoull(count));
+  } catch (...) {
+    return boost::none;
+  }
+  p.mode = ValidationPolicy::Mode::SAMPLE;
+  return p;
+}
+
+//------------------------------------------------------------------------------
+
+bool FrameTimestampHandler::Default() {
+  is_timestamp_key_ = false;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool FrameTimestampHandler::StartObject() {
+  ++depth_;
+  return Default();
+}
+
+//------------------------------------------------------------------------------
+
+bool FrameTimestampHandler::EndObject(rapidjson::SizeType) {
+  --depth_;
+  return Default();
+}
+
+//------------------------------------------------------------------------------
+
+bool FrameTimestampHandler::StartArray() {
+  ++depth_;
+  return Default();
+}
+
+//------------------------------------------------------------------------------
+
+bool FrameTimestampHandler::EndArray(rapidjson::SizeType) {
+  --depth_;
+  return Default();
+}
+
+//------------------------------------------------------------------------------
+
+bool FrameTimestampHandler::Key(const char* str, rapidjson::SizeType length,
+                                bool) {
+  static constexpr auto TIMESTAMP_KEY = "cam_tstamp";
+  is_timestamp_key_ =
+      ((depth_ == 1) && (length == std::strlen(TIMESTAMP_KEY)) &&
+       (std::strncmp(str, TIMESTAMP_KEY, length) == 0));
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool FrameTimestampHandler::Int(int i) {
+  return Int64(static_cast<int64_t>(i));
+}
+
+//------------------------------------------------------------------------------
+
+bool FrameTimestampHandler::Uint(unsigned u) {
+  return Uint64(static_cast<uint64_t>(u));
+}
+
+//------------------------------------------------------------------------------
+
+bool FrameTimestampHandler::Int64(int64_t i) {
+  if (i < 0) {
+    // not a valid timestamp; leave it to the schema (if any) to complain
+    return Default();
+  }
+  return Uint64(static_cast<uint64_t>(i));
+}
+
+//------------------------------------------------------------------------------
+
+bool FrameTimestampHandler::Uint64(uint64_t u) {
+  const auto found = is_timestamp_key_;
+  Default();
+  if (found) {
+    timestamp_ = u;
+    return !stop_when_found_;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+void FrameTimestampHandler::reset(bool stop_when_found) {
+  timestamp_ = boost::none;
+  depth_ = 0;
+  is_timestamp_key_ = false;
+  stop_when_found_ = stop_when_found;
+}
+
+//------------------------------------------------------------------------------
+
+const boost::optional<uint64_t>& FrameTimestampHandler::get_timestamp() const {
+  return timestamp_;
+}
+
+//------------------------------------------------------------------------------
+
+FrameTimestampReader::FrameTimestampReader(
+    const rapidjson::SchemaDocument& schema)
+    : validator_(schema, handler_) {}
+
+//------------------------------------------------------------------------------
+
+boost::optional<uint64_t> FrameTimestampReader::read(const std::string& json,
+                                                     bool validate) {
+  rapidjson::StringStream ss(json.c_str());
+  return read_stream<rapidjson::kParseDefaultFlags>(ss, validate);
+}
+
+//------------------------------------------------------------------------------
+
+boost::optional<uint64_t> FrameTimestampReader::read_insitu(char* json,
+                                                            bool validate) {
+  rapidjson::InsituStringStream ss(json);
+  return read_stream<rapidjson::kParseInsituFlag>(ss, validate);
+}
+
+//------------------------------------------------------------------------------
+
+template <unsigned ParseFlags, typename Stream>
+boost::optional<uint64_t> FrameTimestampReader::read_stream(Stream& ss,
+                                                            bool validate) {
+  error_string_.clear();
+  handler_.reset(!validate);
+
+  rapidjson::Reader reader;
+  rapidjson::ParseResult result;
+  if (validate) {
+    validator_.Reset();
+    result = reader.Parse<ParseFlags>(ss, validator_);
+    if (!result && !validator_.IsValid()) {
+      error_string_ = get_validator_error_string(validator_);
+      return boost::none;
+    }
+  } else {
+    result = reader.Parse<ParseFlags>(ss, handler_);
+  }
+
+  const auto& timestamp = handler_.get_timestamp();
+  const auto stopped_early =
+      (!validate && timestamp &&
+       (result.Code() == rapidjson::kParseErrorTermination));
+  if (!result && !stopped_early) {
+    std::stringstream err;
+    err << "Error(offset " << static_cast<unsigned>(result.Offset())
+        << "): " << rapidjson::GetParseError_En(result.Code());
+    error_string_ = err.str();
+    return boost::none;
+  }
+
+  if (!timestamp) {
+    error_string_ = "Did not find an unsigned integer 'cam_tstamp' value.";
+  }
+  return timestamp;
+}
+
+//------------------------------------------------------------------------------
+
+const std::string& FrameTimestampReader::get_error_string() const {
+  return error_string_;
+}
+
+//------------------------------------------------------------------------------
+
 }  // namespace a2d2_to_ros
@@ -0,0 +1,268 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "a2d2_to_ros/logger.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "a2d2_to_ros/logging.hpp"
+
+namespace a2d2_to_ros {
+namespace logging {
+
+namespace {
+
+std::atomic<int> least_level(static_cast<int>(Level::INFO));
+
+/**
+ * @brief Writes queued lines on a background thread.
+ * @note The writer is never destroyed, so that it can be used by anything
+ * that logs while the program exits; instead, it is stopped by an exit
+ * handler once the queue is flushed.
+ */
+class AsyncWriter {
+ public:
+  /// lines that can be queued before write blocks until some are written
+  static constexpr size_t MAX_QUEUED_LINES = 4096;
+
+  static AsyncWriter& get() {
+    static auto* writer = new AsyncWriter();
+    return *writer;
+  }
+
+  void write(Level level, std::string line) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (stopped_) {
+        write_line(level, line);
+        get_stream(level).flush();
+        return;
+      }
+      space_.wait(lock,
+                  [this]() { return (queue_.size() < MAX_QUEUED_LINES); });
+      queue_.push_back({level, std::move(line)});
+    }
+    ready_.notify_one();
+    if (level >= Level::ERROR) {
+      flush();
+    }
+  }
+
+  void flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    drained_.wait(lock, [this]() { return (queue_.empty() && !writing_); });
+  }
+
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_requested_ = true;
+    }
+    ready_.notify_one();
+    thread_.join();
+
+    // anything queued after the thread stopped is written here instead
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& line : queue_) {
+      write_line(line.level, line.text);
+    }
+    queue_.clear();
+    std::cout.flush();
+    std::cerr.flush();
+    stopped_ = true;
+    drained_.notify_all();
+    space_.notify_all();
+  }
+
+ private:
+  struct Line {
+    Level level;
+    std::string text;
+  };  // struct Line
+
+  AsyncWriter() : thread_([this]() { run(); }) {
+    std::atexit([]() { AsyncWriter::get().stop(); });
+  }
+
+  static std::ostream& get_stream(Level level) {
+    return ((level >= Level::ERROR) ? std::cerr : std::cout);
+  }
+
+  static void write_line(Level level, const std::string& text) {
+    get_stream(level) << text << '\n';
+  }
+
+  void run() {
+    std::vector<Line> batch;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      ready_.wait(lock,
+                  [this]() { return (!queue_.empty() || stop_requested_); });
+      if (queue_.empty()) {
+        return;
+      }
+      batch.swap(queue_);
+      writing_ = true;
+      lock.unlock();
+      space_.notify_all();
+
+      // lines go to two streams, so one is flushed before switching to the
+      // other to keep them in order
+      std::ostream* stream = nullptr;
+      for (const auto& line : batch) {
+        auto& line_stream = get_stream(line.level);
+        if (stream && (stream != &line_stream)) {
+          stream->flush();
+        }
+        stream = &line_stream;
+        write_line(line.level, line.text);
+      }
+      if (stream) {
+        stream->flush();
+      }
+      batch.clear();
+
+      lock.lock();
+      writing_ = false;
+      drained_.notify_all();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  std::condition_variable space_;
+  std::condition_variable drained_;
+  std::vector<Line> queue_;
+  bool writing_ = false;
+  bool stop_requested_ = false;
+  bool stopped_ = false;
+  std::thread thread_;
+};  // class AsyncWriter
+
+constexpr size_t AsyncWriter::MAX_QUEUED_LINES;
+
+}  // namespace
+
+//------------------------------------------------------------------------------
+
+boost::optional<Level> get_level(const std::string& name) {
+  if (name == "debug") {
+    return Level::DEBUG;
+  }
+  if (name == "info") {
+    return Level::INFO;
+  }
+  if (name == "warn") {
+    return Level::WARN;
+  }
+  if (name == "error") {
+    return Level::ERROR;
+  }
+  if (name == "fatal") {
+    return Level::FATAL;
+  }
+  return boost::none;
+}
+
+//------------------------------------------------------------------------------
+
+void set_level(Level level) { least_level = static_cast<int>(level); }
+
+//------------------------------------------------------------------------------
+
+bool is_enabled(Level level) {
+  return (static_cast<int>(level) >= least_level.load());
+}
+
+//------------------------------------------------------------------------------
+
+void write(Level level, std::string line) {
+  AsyncWriter::get().write(level, std::move(line));
+}
+
+//------------------------------------------------------------------------------
+
+void flush() { AsyncWriter::get().flush(); }
+
+//------------------------------------------------------------------------------
+
+ProgressLogger::ProgressLogger(std::string label, std::string unit,
+                               size_t total, size_t interval)
+    : label_(std::move(label)),
+      unit_(std::move(unit)),
+      total_(total),
+      interval_(interval),
+      start_(Clock::now()) {}
+
+//------------------------------------------------------------------------------
+
+bool ProgressLogger::add(size_t count) {
+  const auto last = done_;
+  done_ += count;
+  if (interval_ == 0 || count == 0) {
+    return false;
+  }
+  const auto crossed_interval = ((done_ / interval_) != (last / interval_));
+  const auto reached_total =
+      ((total_ > 0) && (last < total_) && (done_ >= total_));
+  if (!crossed_interval && !reached_total) {
+    return false;
+  }
+  X_INFO(get_line(done_, Clock::now()));
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+std::string ProgressLogger::get_line(size_t done,
+                                     Clock::time_point now) const {
+  std::stringstream ss;
+  ss << std::fixed << std::setprecision(1) << label_ << ": " << done;
+  if (total_ > 0) {
+    ss << "/" << total_ << " " << unit_ << " ("
+       << (100.0 * static_cast<double>(done) / static_cast<double>(total_))
+       << "%)";
+  } else {
+    ss << " " << unit_;
+  }
+  const auto elapsed = std::chrono::duration<double>(now - start_).count();
+  if (elapsed > 0.0) {
+    ss << ", " << (static_cast<double>(done) / elapsed) << " " << unit_
+       << "/s";
+  }
+  return ss.str();
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace logging
+}  // namespace a2d2_to_ros
@@ -0,0 +1,151 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "a2d2_to_ros/manifest.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+
+#include <boost/filesystem.hpp>
+
+#include "a2d2_to_ros/logging.hpp"
+#include "a2d2_to_ros/name_utils.hpp"
+
+namespace a2d2_to_ros {
+
+//------------------------------------------------------------------------------
+
+boost::optional<FrameName> parse_frame_name(const std::string& basename) {
+  std::vector<std::string> parts;
+  size_t begin = 0;
+  while (true) {
+    const auto end = basename.find('_', begin);
+    parts.push_back(basename.substr(begin, end - begin));
+    if (end == std::string::npos) {
+      break;
+    }
+    begin = (end + 1);
+  }
+  if (parts.size() != 4) {
+    return boost::none;
+  }
+
+  const auto& sequence = parts[3];
+  const auto is_digit = [](char c) { return ((c >= '0') && (c <= '9')); };
+  // at most as many digits as always fit in a uint64_t
+  if (sequence.empty() ||
+      (sequence.size() > std::numeric_limits<uint64_t>::digits10) ||
+      !std::all_of(std::begin(sequence), std::end(sequence), is_digit)) {
+    return boost::none;
+  }
+  if (get_camera_name_from_frame_name(parts[2]).empty()) {
+    return boost::none;
+  }
+
+  FrameName name;
+  name.recording = parts[0];
+  name.modality = parts[1];
+  name.frame = parts[2];
+  name.sequence = std::stoull(sequence);
+  return name;
+}
+
+//------------------------------------------------------------------------------
+
+boost::optional<std::map<std::string, std::vector<std::string>>>
+list_directory(const std::string& directory) {
+  boost::system::error_code ec;
+  boost::filesystem::directory_iterator it{directory, ec};
+  if (ec) {
+    return boost::none;
+  }
+
+  std::map<std::string, std::vector<std::string>> paths;
+  for (; it != boost::filesystem::directory_iterator{}; it.increment(ec)) {
+    if (ec) {
+      return boost::none;
+    }
+    const auto& p = it->path();
+    paths[p.extension().string()].push_back(p.string());
+  }
+  for (auto& p : paths) {
+    std::sort(std::begin(p.second), std::end(p.second));
+  }
+  return paths;
+}
+
+//------------------------------------------------------------------------------
+
+boost::optional<std::vector<ManifestEntry>> build_manifest(
+    const std::vector<std::string>& data_paths,
+    const std::vector<std::string>& info_paths) {
+  // frame info files by sequence number, with their parsed names
+  std::unordered_map<uint64_t, std::pair<const std::string*, FrameName>> infos;
+  infos.reserve(info_paths.size());
+  for (const auto& path : info_paths) {
+    auto name_opt =
+        parse_frame_name(boost::filesystem::path(path).stem().string());
+    if (name_opt) {
+      const auto sequence = name_opt->sequence;
+      infos.emplace(sequence, std::make_pair(&path, std::move(*name_opt)));
+    }
+  }
+
+  std::vector<ManifestEntry> entries;
+  entries.reserve(data_paths.size());
+  for (const auto& path : data_paths) {
+    const auto name_opt =
+        parse_frame_name(boost::filesystem::path(path).stem().string());
+    if (!name_opt) {
+      X_ERROR("Could not parse the frame name of: " << path);
+      return boost::none;
+    }
+
+    const auto it = infos.find(name_opt->sequence);
+    if ((it == std::end(infos)) ||
+        (it->second.second.frame != name_opt->frame)) {
+      X_ERROR("Could not find the frame info file of: " << path);
+      return boost::none;
+    }
+
+    ManifestEntry entry;
+    entry.sequence = name_opt->sequence;
+    entry.data_path = path;
+    entry.info_path = *(it->second.first);
+    entry.info_basename =
+        boost::filesystem::path(entry.info_path).stem().string();
+    entry.sensor_name = get_camera_name_from_frame_name(name_opt->frame);
+    entries.push_back(std::move(entry));
+  }
+
+  std::sort(std::begin(entries), std::end(entries),
+            [](const ManifestEntry& lhs, const ManifestEntry& rhs) {
+              return (lhs.sequence < rhs.sequence);
+            });
+  return entries;
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
@@ -0,0 +1,195 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "a2d2_to_ros/message_sink.hpp"
+
+#include <cmath>
+#include <thread>
+
+#include <rosgraph_msgs/Clock.h>
+
+#include "a2d2_to_ros/checks.hpp"
+#include "a2d2_to_ros/logging.hpp"
+
+namespace a2d2_to_ros {
+
+//------------------------------------------------------------------------------
+
+boost::optional<SinkType> get_sink_type(const std::string& name) {
+  if (name == "bag") {
+    return SinkType::BAG;
+  }
+  if (name == "topics") {
+    return SinkType::TOPICS;
+  }
+  return boost::none;
+}
+
+//------------------------------------------------------------------------------
+
+Pacer::Pacer(double speed)
+    : speed_(strictly_positive(speed) && std::isfinite(speed) ? speed : 0.0) {}
+
+//------------------------------------------------------------------------------
+
+void Pacer::wait(const ros::Time& stamp) {
+  const auto wait = get_wait(stamp, Clock::now());
+  if (wait > Clock::duration::zero()) {
+    std::this_thread::sleep_for(wait);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+Pacer::Clock::duration Pacer::get_wait(const ros::Time& stamp,
+                                       Clock::time_point now) {
+  if (speed_ == 0.0) {
+    return Clock::duration::zero();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!origin_) {
+    origin_ = std::make_pair(now, stamp);
+    return Clock::duration::zero();
+  }
+
+  const auto offset = (stamp - origin_->second).toSec() / speed_;
+  const auto due =
+      origin_->first + std::chrono::duration_cast<Clock::duration>(
+                           std::chrono::duration<double>(offset));
+  return due - now;
+}
+
+//------------------------------------------------------------------------------
+
+constexpr uint32_t TopicPublisher::QUEUE_SIZE;
+
+//------------------------------------------------------------------------------
+
+TopicPublisher::TopicPublisher(double speed) : pacer_(speed) {}
+
+//------------------------------------------------------------------------------
+
+MessageSink::MessageSink(std::unique_ptr<SplitBagWriter> bag)
+    : bag_(std::move(bag)) {}
+
+//------------------------------------------------------------------------------
+
+MessageSink::MessageSink(TopicPublisher& publisher) : publisher_(&publisher) {}
+
+//------------------------------------------------------------------------------
+
+size_t MessageSink::get_window(double time_since_begin) const {
+  return bag_ ? bag_->get_window(time_since_begin) : 0;
+}
+
+//------------------------------------------------------------------------------
+
+void MessageSink::close() {
+  if (bag_) {
+    bag_->close();
+  }
+}
+
+//------------------------------------------------------------------------------
+
+uint64_t MessageSink::get_bytes_written() const {
+  return bag_ ? bag_->get_bytes_written() : 0;
+}
+
+//------------------------------------------------------------------------------
+
+std::vector<BagSegment> MessageSink::checkpoint() {
+  return bag_ ? bag_->checkpoint() : std::vector<BagSegment>();
+}
+
+//------------------------------------------------------------------------------
+
+bool MessageSink::resume(const std::vector<BagSegment>& segments) {
+  if (bag_) {
+    return bag_->resume(segments);
+  }
+  if (!segments.empty()) {
+    X_ERROR("Cannot resume bag files when publishing to topics");
+    return false;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+MessageSink make_message_sink(TopicPublisher* publisher,
+                              std::string output_path,
+                              std::string bag_filename, double min_time_offset,
+                              double split_duration, BagOptions options) {
+  if (publisher) {
+    return MessageSink(*publisher);
+  }
+  return MessageSink(std::unique_ptr<SplitBagWriter>(new SplitBagWriter(
+      std::move(output_path), std::move(bag_filename), min_time_offset,
+      split_duration, options)));
+}
+
+//------------------------------------------------------------------------------
+
+ClockWriter::ClockWriter(MessageSink& sink, std::string topic, double rate)
+    : sink_(sink),
+      topic_(std::move(topic)),
+      period_(strictly_positive(rate) && std::isfinite(rate) ? (1.0 / rate)
+                                                             : 0.0) {}
+
+//------------------------------------------------------------------------------
+
+bool ClockWriter::write(double time_since_begin, const ros::Time& stamp) {
+  if (last_stamp_ && stamp <= *last_stamp_) {
+    return false;
+  }
+  last_stamp_ = stamp;
+  ++num_stamps_;
+
+  const auto window = sink_.get_window(time_since_begin);
+  if (last_written_ && window == last_window_ &&
+      (stamp - *last_written_).toSec() < period_) {
+    return false;
+  }
+
+  rosgraph_msgs::Clock clock_msg;
+  clock_msg.clock = stamp;
+  sink_.write(topic_, time_since_begin, stamp, clock_msg);
+  last_written_ = stamp;
+  last_window_ = window;
+  ++num_written_;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+size_t ClockWriter::get_num_stamps() const { return num_stamps_; }
+
+//------------------------------------------------------------------------------
+
+size_t ClockWriter::get_num_written() const { return num_written_; }
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
@@ -23,10 +23,448 @@
  */
 #include "a2d2_to_ros/msg_utils.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <set>
+
+#include <boost/optional.hpp>
+#include <sensor_msgs/image_encodings.h>
 #include <sensor_msgs/point_cloud2_iterator.h>
 
 #include "a2d2_to_ros/npz.hpp"
 
+namespace {
+
+/** @brief Byte offsets of the lidar fields within a single point. */
+struct PointOffsets {
+  uint32_t x;
+  uint32_t y;
+  uint32_t z;
+  uint32_t azimuth;
+  uint32_t boundary;
+  uint32_t col;
+  uint32_t depth;
+  uint32_t distance;
+  uint32_t lidar_id;
+  uint32_t rectime;
+  uint32_t reflectance;
+  uint32_t row;
+  uint32_t timestamp;
+  uint32_t valid;
+};  // struct PointOffsets
+
+/**
+ * @brief Look up the offset of a scalar field with the given name and type.
+ * @return The byte offset, or boost::none if no such field exists.
+ */
+boost::optional<uint32_t> get_field_offset(const sensor_msgs::PointCloud2& msg,
+                                           const std::string& name,
+                                           uint8_t datatype) {
+  for (const auto& field : msg.fields) {
+    if (field.name == name) {
+      if ((field.datatype != datatype) || (field.count != 1)) {
+        return boost::none;
+      }
+      return field.offset;
+    }
+  }
+  return boost::none;
+}
+
+/**
+ * @brief Resolve the offsets of all fields written by build_pc2_msg.
+ * @return The offsets, or boost::none if any field is missing.
+ */
+boost::optional<PointOffsets> get_point_offsets(
+    const sensor_msgs::PointCloud2& msg) {
+  namespace npz = a2d2_to_ros::npz;
+  typedef npz::WriteTypes W;
+  const auto fields = npz::Fields::get_fields();
+
+  std::array<boost::optional<uint32_t>, 14> o = {
+      get_field_offset(msg, "x", W::MSG_FLOAT),
+      get_field_offset(msg, "y", W::MSG_FLOAT),
+      get_field_offset(msg, "z", W::MSG_FLOAT),
+      get_field_offset(msg, fields[npz::Fields::AZIMUTH_IDX], W::MSG_FLOAT),
+      get_field_offset(msg, fields[npz::Fields::BOUNDARY_IDX], W::MSG_UINT8),
+      get_field_offset(msg, fields[npz::Fields::COL_IDX], W::MSG_FLOAT),
+      get_field_offset(msg, fields[npz::Fields::DEPTH_IDX], W::MSG_FLOAT),
+      get_field_offset(msg, fields[npz::Fields::DISTANCE_IDX], W::MSG_FLOAT),
+      get_field_offset(msg, fields[npz::Fields::ID_IDX], W::MSG_UINT8),
+      get_field_offset(msg, fields[npz::Fields::RECTIME_IDX], W::MSG_UINT64),
+      get_field_offset(msg, fields[npz::Fields::REFLECTANCE_IDX], W::MSG_UINT8),
+      get_field_offset(msg, fields[npz::Fields::ROW_IDX], W::MSG_FLOAT),
+      get_field_offset(msg, fields[npz::Fields::TIMESTAMP_IDX], W::MSG_UINT64),
+      get_field_offset(msg, fields[npz::Fields::VALID_IDX], W::MSG_UINT8)};
+
+  const auto missing = std::any_of(
+      std::begin(o), std::end(o),
+      [](const boost::optional<uint32_t>& offset) { return !offset; });
+  if (missing) {
+    return boost::none;
+  }
+
+  PointOffsets offsets;
+  offsets.x = *o[0];
+  offsets.y = *o[1];
+  offsets.z = *o[2];
+  offsets.azimuth = *o[3];
+  offsets.boundary = *o[4];
+  offsets.col = *o[5];
+  offsets.depth = *o[6];
+  offsets.distance = *o[7];
+  offsets.lidar_id = *o[8];
+  offsets.rectime = *o[9];
+  offsets.reflectance = *o[10];
+  offsets.row = *o[11];
+  offsets.timestamp = *o[12];
+  offsets.valid = *o[13];
+  return offsets;
+}
+
+/**
+ * @brief Narrow a value to the write type and store it at a possibly
+ * unaligned location.
+ */
+template <typename Out, typename In>
+inline void store_as(uint8_t* dst, const In& val) {
+  const auto out = static_cast<Out>(val);
+  std::memcpy(dst, &out, sizeof(Out));
+}
+
+/** @brief Pixels of a 32FC1 depth image that points are scattered into. */
+struct DepthGrid {
+  uint8_t* data;
+  double width;
+  double height;
+  size_t step;  // pixels per row
+};  // struct DepthGrid
+
+/**
+ * @brief Write a point's depth to the pixel at (row, col), keeping the nearest
+ * depth if the pixel already has one.
+ * @note Coordinates are rounded the same way the A2D2 tutorial does, and
+ * points outside of the image (or with non-finite coordinates) are skipped.
+ */
+inline void scatter_depth(const DepthGrid& grid, double row, double col,
+                          double depth) {
+  const auto r = std::floor(row + 0.5);
+  const auto c = std::floor(col + 0.5);
+  const auto inside =
+      ((r >= 0.0) && (r < grid.height) && (c >= 0.0) && (c < grid.width));
+  if (!inside) {
+    return;
+  }
+
+  auto* const pixel =
+      (grid.data + (sizeof(float) * ((static_cast<size_t>(r) * grid.step) +
+                                     static_cast<size_t>(c))));
+  float current;
+  std::memcpy(&current, pixel, sizeof(float));
+  const auto d = static_cast<float>(depth);
+  // empty pixels are NaN, which never compares <= d
+  if (!(current <= d)) {
+    std::memcpy(pixel, &d, sizeof(float));
+  }
+}
+
+/**
+ * @brief Single pass that writes every point to the PointCloud2 and, if
+ * WITH_DEPTH, scatters the depth of every valid point into the grid.
+ */
+template <bool WITH_DEPTH>
+bool fill_points(const a2d2_to_ros::npz::Columns& columns,
+                 sensor_msgs::PointCloud2& msg, const DepthGrid& grid) {
+  typedef a2d2_to_ros::npz::WriteTypes W;
+
+  const auto offsets_opt = get_point_offsets(msg);
+  if (!offsets_opt) {
+    return false;
+  }
+  const auto o = *offsets_opt;
+
+  const auto n = columns.num_points;
+  const auto step = static_cast<size_t>(msg.point_step);
+  const auto num_msg_points =
+      (static_cast<size_t>(msg.width) * static_cast<size_t>(msg.height));
+  if ((num_msg_points != n) || (msg.data.size() != (n * step))) {
+    return false;
+  }
+
+  // hoist everything out of the loop so the body is straight-line code
+  const auto* const points = columns.points;
+  const auto* const azimuth = columns.azimuth;
+  const auto* const boundary = columns.boundary;
+  const auto* const col = columns.col;
+  const auto* const depth = columns.depth;
+  const auto* const distance = columns.distance;
+  const auto* const lidar_id = columns.lidar_id;
+  const auto* const rectime = columns.rectime;
+  const auto* const reflectance = columns.reflectance;
+  const auto* const row = columns.row;
+  const auto* const timestamp = columns.timestamp;
+  const auto* const valid = columns.valid;
+  auto* const data = msg.data.data();
+
+  for (size_t i = 0; i < n; ++i) {
+    auto* const p = (data + (i * step));
+    const auto* const xyz = (points + (3 * i));
+    store_as<W::Point>(p + o.x, xyz[0]);
+    store_as<W::Point>(p + o.y, xyz[1]);
+    store_as<W::Point>(p + o.z, xyz[2]);
+    store_as<W::Azimuth>(p + o.azimuth, azimuth[i]);
+    store_as<W::Boundary>(p + o.boundary, boundary[i]);
+    store_as<W::Col>(p + o.col, col[i]);
+    store_as<W::Depth>(p + o.depth, depth[i]);
+    store_as<W::Distance>(p + o.distance, distance[i]);
+    store_as<W::LidarId>(p + o.lidar_id, lidar_id[i]);
+    store_as<W::Rectime>(p + o.rectime, rectime[i]);
+    store_as<W::Reflectance>(p + o.reflectance, reflectance[i]);
+    store_as<W::Row>(p + o.row, row[i]);
+    store_as<W::Timestamp>(p + o.timestamp, timestamp[i]);
+    store_as<W::Valid>(p + o.valid, valid[i]);
+    if (WITH_DEPTH && valid[i]) {
+      scatter_depth(grid, row[i], col[i], depth[i]);
+    }
+  }
+
+  return true;
+}
+
+/** @brief Size in bytes of a scalar sensor_msgs::PointField type. */
+uint32_t get_datatype_size(uint8_t datatype) {
+  typedef sensor_msgs::PointField PF;
+  switch (datatype) {
+    case PF::INT8:
+    case PF::UINT8:
+      return 1;
+    case PF::INT16:
+    case PF::UINT16:
+      return 2;
+    case PF::INT32:
+    case PF::UINT32:
+    case PF::FLOAT32:
+      return 4;
+    case PF::FLOAT64:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+/**
+ * @brief Look up a single field of a compact layout by its --fields item.
+ * @return The field with offset 0, or boost::none for an unknown item.
+ */
+boost::optional<a2d2_to_ros::PointLayout::Field> get_compact_field(
+    const std::string& item) {
+  namespace npz = a2d2_to_ros::npz;
+  typedef a2d2_to_ros::PointLayout L;
+  typedef sensor_msgs::PointField PF;
+  const auto fields = npz::Fields::get_fields();
+  const auto attr = [&fields](size_t idx) { return fields[idx]; };
+
+  const std::vector<std::pair<std::string, L::Field>> table = {
+      {"x", {L::X, "x", PF::FLOAT32, 0}},
+      {"y", {L::Y, "y", PF::FLOAT32, 0}},
+      {"z", {L::Z, "z", PF::FLOAT32, 0}},
+      {"intensity", {L::REFLECTANCE, "intensity", PF::FLOAT32, 0}},
+      {"azimuth",
+       {L::AZIMUTH, attr(npz::Fields::AZIMUTH_IDX), PF::FLOAT32, 0}},
+      {"boundary",
+       {L::BOUNDARY, attr(npz::Fields::BOUNDARY_IDX), PF::UINT8, 0}},
+      {"col", {L::COL, attr(npz::Fields::COL_IDX), PF::FLOAT32, 0}},
+      {"depth", {L::DEPTH, attr(npz::Fields::DEPTH_IDX), PF::FLOAT32, 0}},
+      {"distance",
+       {L::DISTANCE, attr(npz::Fields::DISTANCE_IDX), PF::FLOAT32, 0}},
+      {"lidar_id", {L::LIDAR_ID, attr(npz::Fields::ID_IDX), PF::UINT8, 0}},
+      // a real double, unlike the uint64 bits that the full layout stores
+      {"rectime",
+       {L::RECTIME, attr(npz::Fields::RECTIME_IDX), PF::FLOAT64, 0}},
+      {"reflectance",
+       {L::REFLECTANCE, attr(npz::Fields::REFLECTANCE_IDX), PF::UINT8, 0}},
+      {"row", {L::ROW, attr(npz::Fields::ROW_IDX), PF::FLOAT32, 0}},
+      {"timestamp", {L::TIMESTAMP, "timestamp_offset", PF::INT32, 0}},
+      {"valid", {L::VALID, attr(npz::Fields::VALID_IDX), PF::UINT8, 0}}};
+
+  for (const auto& entry : table) {
+    if (entry.first == item) {
+      return entry.second;
+    }
+  }
+  return boost::none;
+}
+
+/**
+ * @brief Check that a message was built for the layout and sized for the
+ * number of points.
+ */
+bool matches_layout(const a2d2_to_ros::PointLayout& layout,
+                    const sensor_msgs::PointCloud2& msg, size_t num_points) {
+  if ((msg.point_step != layout.point_step) ||
+      (msg.fields.size() != layout.fields.size())) {
+    return false;
+  }
+  for (size_t i = 0; i < layout.fields.size(); ++i) {
+    const auto& expected = layout.fields[i];
+    const auto& field = msg.fields[i];
+    if ((field.name != expected.name) ||
+        (field.datatype != expected.datatype) ||
+        (field.offset != expected.offset) || (field.count != 1)) {
+      return false;
+    }
+  }
+  const auto num_msg_points =
+      (static_cast<size_t>(msg.width) * static_cast<size_t>(msg.height));
+  return ((num_msg_points == num_points) &&
+          (msg.data.size() == (num_points * layout.point_step)));
+}
+
+/**
+ * @brief Store every in_stride'th value of a column to one field of every
+ * point.
+ */
+template <typename Out, typename In>
+void store_column(uint8_t* dst, size_t step, const In* src, size_t in_stride,
+                  size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    store_as<Out>(dst + (i * step), src[i * in_stride]);
+  }
+}
+
+/**
+ * @brief Store point timestamps as INT32 microsecond offsets from base.
+ * @return false iff an offset does not fit in an INT32.
+ */
+bool store_timestamp_offsets(uint8_t* dst, size_t step, const int64_t* src,
+                             size_t n, int64_t base) {
+  constexpr auto lowest = static_cast<int64_t>(
+      std::numeric_limits<int32_t>::lowest());
+  constexpr auto highest =
+      static_cast<int64_t>(std::numeric_limits<int32_t>::max());
+  auto in_range = true;
+  for (size_t i = 0; i < n; ++i) {
+    const auto offset = (src[i] - base);
+    in_range &= ((offset >= lowest) && (offset <= highest));
+    store_as<int32_t>(dst + (i * step), offset);
+  }
+  return in_range;
+}
+
+/**
+ * @brief Fill the fields of a layout one column at a time.
+ * @pre matches_layout returns true for the layout and message.
+ */
+bool fill_columns(const a2d2_to_ros::PointLayout& layout,
+                  const a2d2_to_ros::npz::Columns& c,
+                  sensor_msgs::PointCloud2& msg) {
+  typedef a2d2_to_ros::PointLayout L;
+  typedef a2d2_to_ros::npz::WriteTypes W;
+  typedef sensor_msgs::PointField PF;
+
+  const auto n = c.num_points;
+  const auto step = static_cast<size_t>(layout.point_step);
+  const auto base = ((static_cast<int64_t>(msg.header.stamp.sec) * 1000000) +
+                     static_cast<int64_t>(msg.header.stamp.nsec / 1000));
+  auto* const data = msg.data.data();
+
+  // compact layouts use FLOAT32, the full layout uses WriteTypes::FLOAT
+  const auto store_float = [&](uint8_t* dst, uint8_t datatype,
+                               const a2d2_to_ros::npz::ReadTypes::FLOAT* src,
+                               size_t in_stride) {
+    if (datatype == PF::FLOAT32) {
+      store_column<float>(dst, step, src, in_stride, n);
+    } else {
+      store_column<double>(dst, step, src, in_stride, n);
+    }
+  };
+
+  auto ok = true;
+  for (const auto& field : layout.fields) {
+    auto* const dst = (data + field.offset);
+    switch (field.source) {
+      case L::X:
+        store_float(dst, field.datatype, c.points, 3);
+        break;
+      case L::Y:
+        store_float(dst, field.datatype, c.points + 1, 3);
+        break;
+      case L::Z:
+        store_float(dst, field.datatype, c.points + 2, 3);
+        break;
+      case L::AZIMUTH:
+        store_float(dst, field.datatype, c.azimuth, 1);
+        break;
+      case L::BOUNDARY:
+        store_column<W::Boundary>(dst, step, c.boundary, 1, n);
+        break;
+      case L::COL:
+        store_float(dst, field.datatype, c.col, 1);
+        break;
+      case L::DEPTH:
+        store_float(dst, field.datatype, c.depth, 1);
+        break;
+      case L::DISTANCE:
+        store_float(dst, field.datatype, c.distance, 1);
+        break;
+      case L::LIDAR_ID:
+        store_column<W::LidarId>(dst, step, c.lidar_id, 1, n);
+        break;
+      case L::RECTIME:
+        // microseconds since the epoch are exact in a double until 2255
+        store_column<double>(dst, step, c.rectime, 1, n);
+        break;
+      case L::REFLECTANCE:
+        if (field.datatype == PF::FLOAT32) {
+          store_column<float>(dst, step, c.reflectance, 1, n);
+        } else {
+          store_column<W::Reflectance>(dst, step, c.reflectance, 1, n);
+        }
+        break;
+      case L::ROW:
+        store_float(dst, field.datatype, c.row, 1);
+        break;
+      case L::TIMESTAMP:
+        if (field.datatype == PF::INT32) {
+          ok &= store_timestamp_offsets(dst, step, c.timestamp, n, base);
+        } else {
+          store_column<W::Timestamp>(dst, step, c.timestamp, 1, n);
+        }
+        break;
+      case L::VALID:
+        store_column<W::Valid>(dst, step, c.valid, 1, n);
+        break;
+    }
+  }
+  return ok;
+}
+
+/**
+ * @brief View a 32FC1 depth image as a DepthGrid.
+ * @return false iff the image is not a dense 32FC1 image.
+ */
+bool get_depth_grid(sensor_msgs::Image& depth_image, DepthGrid& grid) {
+  const auto step = static_cast<size_t>(depth_image.width) * sizeof(float);
+  const auto valid_image =
+      ((depth_image.encoding == sensor_msgs::image_encodings::TYPE_32FC1) &&
+       (depth_image.step == step) &&
+       (depth_image.data.size() == (step * depth_image.height)));
+  if (!valid_image) {
+    return false;
+  }
+
+  grid.data = depth_image.data.data();
+  grid.width = static_cast<double>(depth_image.width);
+  grid.height = static_cast<double>(depth_image.height);
+  grid.step = static_cast<size_t>(depth_image.width);
+  return true;
+}
+
+}  // namespace
+
 namespace a2d2_to_ros {
 
 //------------------------------------------------------------------------------
@@ -50,7 +488,170 @@ shape_msgs::SolidPrimitive build_ego_shape_msg(double x_min, double x_max,
 sensor_msgs::PointCloud2 build_pc2_msg(std::string frame, ros::Time timestamp,
                                        bool is_dense,
                                        const uint32_t num_points) {
+  return build_pc2_msg(get_full_point_layout(), std::move(frame), timestamp,
+                       is_dense, num_points);
+}
+
+//------------------------------------------------------------------------------
+
+bool fill_pc2_msg(const npz::Columns& columns, sensor_msgs::PointCloud2& msg) {
+  return fill_points<false>(columns, msg, DepthGrid());
+}
+
+//------------------------------------------------------------------------------
+
+sensor_msgs::Image build_depth_image_msg(std::string frame,
+                                         ros::Time timestamp, uint32_t width,
+                                         uint32_t height,
+                                         std::vector<uint8_t> data) {
+  sensor_msgs::Image msg;
+  msg.header.seq = static_cast<uint32_t>(0);
+  msg.header.stamp = timestamp;
+  msg.header.frame_id = std::move(frame);
+  msg.height = height;
+  msg.width = width;
+  msg.encoding = sensor_msgs::image_encodings::TYPE_32FC1;
+  msg.is_bigendian = false;
+  msg.step = static_cast<uint32_t>(width * sizeof(float));
+
+  // reuses the storage if it is large enough
+  msg.data = std::move(data);
+  const auto num_pixels =
+      (static_cast<size_t>(width) * static_cast<size_t>(height));
+  msg.data.resize(num_pixels * sizeof(float));
+  const auto nan = std::numeric_limits<float>::quiet_NaN();
+  auto* const pixels = msg.data.data();
+  for (size_t i = 0; i < num_pixels; ++i) {
+    std::memcpy(pixels + (i * sizeof(float)), &nan, sizeof(float));
+  }
+
+  return msg;
+}
+
+//------------------------------------------------------------------------------
+
+bool fill_pc2_msg(const npz::Columns& columns, sensor_msgs::PointCloud2& msg,
+                  sensor_msgs::Image& depth_image) {
+  DepthGrid grid;
+  if (!get_depth_grid(depth_image, grid)) {
+    return false;
+  }
+  return fill_points<true>(columns, msg, grid);
+}
+
+//------------------------------------------------------------------------------
+
+PointLayout get_full_point_layout() {
+  typedef npz::WriteTypes W;
+  const auto fields = npz::Fields::get_fields();
+
+  // use uint8_t for bool; PointField does not define a bool type
+  PointLayout layout;
+  layout.full = true;
+  layout.fields = {
+      {PointLayout::X, "x", W::MSG_FLOAT, 0},
+      {PointLayout::Y, "y", W::MSG_FLOAT, 0},
+      {PointLayout::Z, "z", W::MSG_FLOAT, 0},
+      {PointLayout::AZIMUTH, fields[npz::Fields::AZIMUTH_IDX], W::MSG_FLOAT, 0},
+      {PointLayout::BOUNDARY, fields[npz::Fields::BOUNDARY_IDX], W::MSG_UINT8,
+       0},
+      {PointLayout::COL, fields[npz::Fields::COL_IDX], W::MSG_FLOAT, 0},
+      {PointLayout::DEPTH, fields[npz::Fields::DEPTH_IDX], W::MSG_FLOAT, 0},
+      {PointLayout::DISTANCE, fields[npz::Fields::DISTANCE_IDX], W::MSG_FLOAT,
+       0},
+      {PointLayout::LIDAR_ID, fields[npz::Fields::ID_IDX], W::MSG_UINT8, 0},
+      {PointLayout::RECTIME, fields[npz::Fields::RECTIME_IDX], W::MSG_UINT64,
+       0},
+      {PointLayout::ROW, fields[npz::Fields::ROW_IDX], W::MSG_FLOAT, 0},
+      {PointLayout::REFLECTANCE, fields[npz::Fields::REFLECTANCE_IDX],
+       W::MSG_UINT8, 0},
+      {PointLayout::TIMESTAMP, fields[npz::Fields::TIMESTAMP_IDX],
+       W::MSG_UINT64, 0},
+      {PointLayout::VALID, fields[npz::Fields::VALID_IDX], W::MSG_UINT8, 0}};
+
+  // packed, as PointCloud2Modifier::setPointCloud2Fields does
+  uint32_t offset = 0;
+  for (auto& field : layout.fields) {
+    field.offset = offset;
+    offset += get_datatype_size(field.datatype);
+  }
+  layout.point_step = offset;
+  return layout;
+}
+
+//------------------------------------------------------------------------------
+
+boost::optional<PointLayout> get_point_layout(const std::string& spec) {
+  // keep empty items (e.g., a trailing comma) so that they are rejected
+  std::vector<std::string> items;
+  size_t begin = 0;
+  for (auto end = spec.find(','); end != std::string::npos;
+       end = spec.find(',', begin)) {
+    items.push_back(spec.substr(begin, end - begin));
+    begin = (end + 1);
+  }
+  items.push_back(spec.substr(begin));
+
+  if ((items.size() == 1) && (items[0] == "all")) {
+    return get_full_point_layout();
+  }
+
+  PointLayout layout;
+  std::set<std::string> names;
+  uint32_t offset = 0;
+  uint32_t alignment = 1;
+  const auto add = [&](const std::string& name) {
+    auto field_opt = get_compact_field(name);
+    if (!field_opt || !names.insert(field_opt->name).second) {
+      return false;
+    }
+    const auto size = get_datatype_size(field_opt->datatype);
+    offset = (((offset + size - 1) / size) * size);
+    field_opt->offset = offset;
+    offset += size;
+    alignment = std::max(alignment, size);
+    layout.fields.push_back(std::move(*field_opt));
+    return true;
+  };
+
+  for (const auto& i : items) {
+    auto ok = true;
+    if (i == "xyz") {
+      ok = (add("x") && add("y") && add("z"));
+    } else if (i == "xyzi") {
+      ok = (add("x") && add("y") && add("z") && add("intensity"));
+    } else {
+      ok = add(i);
+    }
+    if (!ok) {
+      return boost::none;
+    }
+  }
+
+  if (layout.fields.empty()) {
+    return boost::none;
+  }
+  layout.point_step = (((offset + alignment - 1) / alignment) * alignment);
+  return layout;
+}
+
+//------------------------------------------------------------------------------
+
+sensor_msgs::PointCloud2 build_pc2_msg(const PointLayout& layout,
+                                       std::string frame, ros::Time timestamp,
+                                       bool is_dense,
+                                       const uint32_t num_points) {
   sensor_msgs::PointCloud2 msg;
+  rebuild_pc2_msg(layout, std::move(frame), timestamp, is_dense, num_points,
+                  msg);
+  return msg;
+}
+
+//------------------------------------------------------------------------------
+
+void rebuild_pc2_msg(const PointLayout& layout, std::string frame,
+                     ros::Time timestamp, bool is_dense,
+                     const uint32_t num_points, sensor_msgs::PointCloud2& msg) {
   msg.header.seq = static_cast<uint32_t>(0);
   msg.header.stamp = timestamp;
   msg.header.frame_id = std::move(frame);
@@ -59,37 +660,89 @@ sensor_msgs::PointCloud2 build_pc2_msg(std::string frame, ros::Time timestamp,
 
   // cnpy uses little endian format
   msg.is_bigendian = false;
+  msg.is_dense = is_dense;
 
-  // use uint8_t for bool; PointField does not define a bool type
-  const auto float_width = (6 * sizeof(npz::WriteTypes::FLOAT));
-  const auto int_width = (2 * sizeof(npz::WriteTypes::UINT64));
-  const auto bool_width = (4 * sizeof(npz::WriteTypes::UINT8));
-  msg.point_step = (float_width + int_width + bool_width);
+  // a message of the same layout keeps its fields (and their names)
+  auto same_fields = ((msg.point_step == layout.point_step) &&
+                      (msg.fields.size() == layout.fields.size()));
+  for (size_t i = 0; same_fields && (i < layout.fields.size()); ++i) {
+    const auto& field = msg.fields[i];
+    const auto& f = layout.fields[i];
+    same_fields = ((field.name == f.name) && (field.offset == f.offset) &&
+                   (field.datatype == f.datatype) && (field.count == 1));
+  }
+  if (!same_fields) {
+    msg.fields.clear();
+    msg.fields.reserve(layout.fields.size());
+    for (const auto& f : layout.fields) {
+      sensor_msgs::PointField field;
+      field.name = f.name;
+      field.offset = f.offset;
+      field.datatype = f.datatype;
+      field.count = 1;
+      msg.fields.push_back(std::move(field));
+    }
+    // the padding of the old layout is not the padding of this one
+    msg.data.clear();
+  }
 
-  msg.row_step = (3 * msg.point_step);
-  msg.is_dense = is_dense;
+  msg.point_step = layout.point_step;
+  msg.row_step = (msg.width * msg.point_step);
+  msg.data.resize(static_cast<size_t>(msg.row_step) * msg.height);
+}
 
-  const auto fields = npz::Fields::get_fields();
-  sensor_msgs::PointCloud2Modifier modifier(msg);
-  modifier.setPointCloud2Fields(
-      14, "x", 1, npz::WriteTypes::MSG_FLOAT, "y", 1,
-      npz::WriteTypes::MSG_FLOAT, "z", 1, npz::WriteTypes::MSG_FLOAT,
-      fields[npz::Fields::AZIMUTH_IDX].c_str(), 1, npz::WriteTypes::MSG_FLOAT,
-      fields[npz::Fields::BOUNDARY_IDX].c_str(), 1, npz::WriteTypes::MSG_UINT8,
-      fields[npz::Fields::COL_IDX].c_str(), 1, npz::WriteTypes::MSG_FLOAT,
-      fields[npz::Fields::DEPTH_IDX].c_str(), 1, npz::WriteTypes::MSG_FLOAT,
-      fields[npz::Fields::DISTANCE_IDX].c_str(), 1, npz::WriteTypes::MSG_FLOAT,
-      fields[npz::Fields::ID_IDX].c_str(), 1, npz::WriteTypes::MSG_UINT8,
-      fields[npz::Fields::RECTIME_IDX].c_str(), 1, npz::WriteTypes::MSG_UINT64,
-      fields[npz::Fields::ROW_IDX].c_str(), 1, npz::WriteTypes::MSG_FLOAT,
-      fields[npz::Fields::REFLECTANCE_IDX].c_str(), 1,
-      npz::WriteTypes::MSG_UINT8, fields[npz::Fields::TIMESTAMP_IDX].c_str(), 1,
-      npz::WriteTypes::MSG_UINT64, fields[npz::Fields::VALID_IDX].c_str(), 1,
-      npz::WriteTypes::MSG_UINT8);
-
-  modifier.resize(msg.width);
+//------------------------------------------------------------------------------
 
-  return msg;
+bool fill_pc2_msg(const PointLayout& layout, const npz::Columns& columns,
+                  sensor_msgs::PointCloud2& msg) {
+  if (layout.full) {
+    return fill_points<false>(columns, msg, DepthGrid());
+  }
+  if (!matches_layout(layout, msg, columns.num_points)) {
+    return false;
+  }
+  return fill_columns(layout, columns, msg);
+}
+
+//------------------------------------------------------------------------------
+
+bool fill_pc2_msg(const PointLayout& layout, const npz::Columns& columns,
+                  sensor_msgs::PointCloud2& msg,
+                  sensor_msgs::Image& depth_image) {
+  DepthGrid grid;
+  if (!get_depth_grid(depth_image, grid)) {
+    return false;
+  }
+  if (layout.full) {
+    return fill_points<true>(columns, msg, grid);
+  }
+  if (!matches_layout(layout, msg, columns.num_points) ||
+      !fill_columns(layout, columns, msg)) {
+    return false;
+  }
+  return fill_depth_image(columns, depth_image);
+}
+
+//------------------------------------------------------------------------------
+
+bool fill_depth_image(const npz::Columns& columns,
+                      sensor_msgs::Image& depth_image) {
+  DepthGrid grid;
+  if (!get_depth_grid(depth_image, grid)) {
+    return false;
+  }
+  for (size_t i = 0; i < columns.num_points; ++i) {
+    if (columns.valid[i]) {
+      scatter_depth(grid, columns.row[i], columns.col[i], columns.depth[i]);
+    }
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool fill_pc2_from_npz(const cnpy::npz_t& npz, sensor_msgs::PointCloud2& msg) {
+  return fill_pc2_msg(npz::get_columns(npz), msg);
 }
 
 //------------------------------------------------------------------------------
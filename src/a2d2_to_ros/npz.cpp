@@ -23,52 +23,201 @@
  */
 #include "a2d2_to_ros/npz.hpp"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <utility>
+
 #include "a2d2_to_ros/checks.hpp"
 #include "a2d2_to_ros/logging.hpp"
 
 namespace a2d2_to_ros {
 namespace npz {
 
-//------------------------------------------------------------------------------
+namespace {
 
-std::array<std::string, 12> Fields::get_fields() {
-  return {"pcloud_points",           "pcloud_attr.azimuth",
-          "pcloud_attr.boundary",    "pcloud_attr.col",
-          "pcloud_attr.depth",       "pcloud_attr.distance",
-          "pcloud_attr.lidar_id",    "pcloud_attr.rectime",
-          "pcloud_attr.reflectance", "pcloud_attr.row",
-          "pcloud_attr.timestamp",   "pcloud_attr.valid"};
+// zip record signatures and fixed sizes, see PKWARE's APPNOTE.TXT
+constexpr uint32_t LOCAL_HEADER_SIGNATURE = 0x04034b50;
+constexpr uint32_t CENTRAL_HEADER_SIGNATURE = 0x02014b50;
+constexpr uint32_t END_SIGNATURE = 0x06054b50;
+constexpr uint32_t ZIP64_END_SIGNATURE = 0x06064b50;
+constexpr uint32_t ZIP64_LOCATOR_SIGNATURE = 0x07064b50;
+constexpr size_t LOCAL_HEADER_SIZE = 30;
+constexpr size_t CENTRAL_HEADER_SIZE = 46;
+constexpr size_t END_SIZE = 22;
+constexpr size_t ZIP64_END_SIZE = 56;
+constexpr size_t ZIP64_LOCATOR_SIZE = 20;
+constexpr size_t MAX_COMMENT_SIZE = 0xFFFF;
+constexpr uint16_t ZIP64_EXTRA_ID = 0x0001;
+constexpr uint32_t ZIP64_MARKER = 0xFFFFFFFF;
+
+constexpr uint16_t METHOD_STORED = 0;
+constexpr uint16_t METHOD_DEFLATED = 8;
+
+// zip fields are little endian regardless of the host
+uint16_t read_u16(const uint8_t* p) {
+  return static_cast<uint16_t>(p[0] | (p[1] << 8));
 }
 
-//------------------------------------------------------------------------------
+uint32_t read_u32(const uint8_t* p) {
+  return (static_cast<uint32_t>(read_u16(p)) |
+          (static_cast<uint32_t>(read_u16(p + 2)) << 16));
+}
 
-bool verify_structure(const std::map<std::string, cnpy::NpyArray>& npz) {
-  ///
-  /// Make sure all required fields are there
-  ///
+uint64_t read_u64(const uint8_t* p) {
+  return (static_cast<uint64_t>(read_u32(p)) |
+          (static_cast<uint64_t>(read_u32(p + 4)) << 32));
+}
 
-  const auto fields = Fields::get_fields();
-  if (npz.size() != fields.size()) {
-    X_ERROR("Expected npz to have " << fields.size() << " fields, but it has "
-                                    << npz.size());
+/**
+ * @brief Get the value of a key in the dictionary of a .npy header, e.g.,
+ * "'<f8'" for 'descr' in "{'descr': '<f8', 'fortran_order': False, ...}".
+ * @return The raw value, or an empty string if the key is missing.
+ */
+std::string get_npy_header_value(const std::string& header,
+                                 const std::string& key) {
+  const auto key_pos = header.find("'" + key + "'");
+  if (key_pos == std::string::npos) {
+    return std::string();
+  }
+  auto begin = header.find(':', key_pos);
+  if (begin == std::string::npos) {
+    return std::string();
+  }
+  begin = header.find_first_not_of(' ', begin + 1);
+  if (begin == std::string::npos) {
+    return std::string();
+  }
+  // the shape tuple contains commas, so it ends at its closing parenthesis
+  const auto end = (header[begin] == '(') ? header.find(')', begin) + 1
+                                          : header.find(',', begin);
+  if (end == std::string::npos || end == 0) {
+    return std::string();
+  }
+  return header.substr(begin, end - begin);
+}
+
+/**
+ * @brief Parse the header of a .npy array.
+ * @param[out] array Receives the shape and type; its data is not set.
+ * @param[out] header_size Receives the offset of the data from the start.
+ */
+bool parse_npy_header(const uint8_t* npy, size_t size, MappedNpz::Array& array,
+                      size_t& header_size) {
+  static const char MAGIC[] = "\x93NUMPY";
+  constexpr size_t MAGIC_SIZE = (sizeof(MAGIC) - 1);
+  if (size < (MAGIC_SIZE + 4) || std::memcmp(npy, MAGIC, MAGIC_SIZE) != 0) {
+    X_ERROR("Array does not start with a .npy header.");
     return false;
   }
 
-  for (const auto& f : fields) {
-    if (npz.find(f) == std::end(npz)) {
-      X_ERROR("Expected npz to have field '" << f << "', but it does not.");
+  // version 1.0 stores the header length in 2 bytes, later versions in 4
+  const auto major_version = npy[MAGIC_SIZE];
+  size_t prefix_size = 0;
+  size_t header_length = 0;
+  if (major_version == 1) {
+    prefix_size = (MAGIC_SIZE + 4);
+    header_length = read_u16(npy + MAGIC_SIZE + 2);
+  } else if (major_version == 2 || major_version == 3) {
+    prefix_size = (MAGIC_SIZE + 6);
+    if (size < prefix_size) {
+      X_ERROR("Array header is truncated.");
       return false;
     }
+    header_length = read_u32(npy + MAGIC_SIZE + 2);
+  } else {
+    X_ERROR("Unsupported .npy format version "
+            << static_cast<int>(major_version));
+    return false;
+  }
+  header_size = (prefix_size + header_length);
+  if (header_size > size) {
+    X_ERROR("Array header is truncated.");
+    return false;
   }
+  const std::string header(reinterpret_cast<const char*>(npy + prefix_size),
+                           header_length);
 
   ///
-  /// Make sure all fields have expected shape
+  /// Type, e.g., '<f8': byte order, kind, and size in bytes
   ///
 
-  const auto points_field_name = fields[Fields::POINTS_IDX];
+  const auto descr = get_npy_header_value(header, "descr");
+  if (descr.size() < 5 || descr.front() != '\'' || descr.back() != '\'') {
+    X_ERROR("Array header has no valid 'descr': " << header);
+    return false;
+  }
+  const auto byte_order = descr[1];
+  array.kind = descr[2];
+  array.word_size = std::strtoul(descr.c_str() + 3, nullptr, 10);
+  if (array.word_size == 0) {
+    X_ERROR("Array header has no valid 'descr': " << header);
+    return false;
+  }
+  // A2D2 is written on little endian machines, as are the ones reading it
+  const auto big_endian = (byte_order == '>');
+  if (big_endian && array.word_size > 1) {
+    X_ERROR("Big endian arrays are not supported: " << header);
+    return false;
+  }
+
+  ///
+  /// Memory order and shape
+  ///
+
+  const auto fortran_order = get_npy_header_value(header, "fortran_order");
+  if (fortran_order != "True" && fortran_order != "False") {
+    X_ERROR("Array header has no valid 'fortran_order': " << header);
+    return false;
+  }
+  array.fortran_order = (fortran_order == "True");
+
+  const auto shape = get_npy_header_value(header, "shape");
+  if (shape.size() < 2 || shape.front() != '(' || shape.back() != ')') {
+    X_ERROR("Array header has no valid 'shape': " << header);
+    return false;
+  }
+  array.shape.clear();
+  array.num_vals = 1;
+  const char* p = (shape.c_str() + 1);
+  while (true) {
+    char* end = nullptr;
+    const auto dim = std::strtoull(p, &end, 10);
+    if (end == p) {
+      break;
+    }
+    array.shape.push_back(static_cast<size_t>(dim));
+    array.num_vals *= static_cast<size_t>(dim);
+    p = end;
+    while (*p == ',' || *p == ' ') {
+      ++p;
+    }
+  }
+  return true;
+}
 
-  // this cannot throw if the fields check passes
-  const auto& points_shape = npz.at(points_field_name).shape;
+/** @brief Shapes of the lidar fields, in the order of Fields::get_fields. */
+typedef std::array<const std::vector<size_t>*, 12> FieldShapes;
+
+/**
+ * @brief Check that the points field is M x 3 in size and all other fields
+ * are M x 1 in size, where 'M' is the row count of the points field.
+ */
+bool verify_shapes(const FieldShapes& shapes) {
+  const auto fields = Fields::get_fields();
+  const auto& points_shape = *shapes[Fields::POINTS_IDX];
 
   if (points_shape.size() != 2) {
     X_ERROR("Points array must have exactly two dimensions. Instead it has "
@@ -84,15 +233,14 @@ bool verify_structure(const std::map<std::string, cnpy::NpyArray>& npz) {
     return false;
   }
 
-  for (const auto& p : npz) {
-    const auto& field_name = p.first;
-    const auto& field_values = p.second;
+  for (size_t i = 0; i < shapes.size(); ++i) {
     // this one is already checked
-    if (field_name == points_field_name) {
+    if (i == Fields::POINTS_IDX) {
       continue;
     }
 
-    const auto& shape = field_values.shape;
+    const auto& field_name = fields[i];
+    const auto& shape = *shapes[i];
 
     if (shape.size() != 1) {
       X_ERROR(
@@ -108,60 +256,523 @@ bool verify_structure(const std::map<std::string, cnpy::NpyArray>& npz) {
                           << shape[Fields::ROW_SHAPE_IDX]);
       return false;
     }
+  }
+
+  return true;
+}
+
+/** @brief Count the first n values that are false. */
+size_t count_false(const bool* vals, size_t n) {
+  size_t count = 0;
+  for (size_t i = 0; i < n; ++i) {
+    count += static_cast<size_t>(!vals[i]);
+  }
+  return count;
+}
+
+}  // namespace
+
+//------------------------------------------------------------------------------
+
+std::array<std::string, 12> Fields::get_fields() {
+  return {"pcloud_points",           "pcloud_attr.azimuth",
+          "pcloud_attr.boundary",    "pcloud_attr.col",
+          "pcloud_attr.depth",       "pcloud_attr.distance",
+          "pcloud_attr.lidar_id",    "pcloud_attr.rectime",
+          "pcloud_attr.reflectance", "pcloud_attr.row",
+          "pcloud_attr.timestamp",   "pcloud_attr.valid"};
+}
+
+//------------------------------------------------------------------------------
+
+FrameSummary verify_frame(const std::map<std::string, cnpy::NpyArray>& npz) {
+  ///
+  /// Make sure all required fields are there
+  ///
+
+  const auto fields = Fields::get_fields();
+  if (npz.size() != fields.size()) {
+    X_ERROR("Expected npz to have " << fields.size() << " fields, but it has "
+                                    << npz.size());
+    return FrameSummary();
+  }
+
+  FieldShapes shapes;
+  for (size_t i = 0; i < fields.size(); ++i) {
+    const auto it = npz.find(fields[i]);
+    if (it == std::end(npz)) {
+      X_ERROR("Expected npz to have field '" << fields[i]
+                                             << "', but it does not.");
+      return FrameSummary();
+    }
+    shapes[i] = &it->second.shape;
+  }
 
-    ///
-    /// Make sure fields have expected sign
-    ///
+  ///
+  /// Make sure all fields have expected shape and values
+  ///
 
-    auto sign_error = false;
+  if (!verify_shapes(shapes)) {
+    return FrameSummary();
+  }
+  return verify_columns(get_columns(npz));
+}
 
-    const auto is_timestamp = (field_name == fields[Fields::TIMESTAMP_IDX]);
-    const auto is_rectime = (field_name == fields[Fields::RECTIME_IDX]);
-    const auto is_lidar_id = (field_name == fields[Fields::ID_IDX]);
-    if (is_timestamp || is_rectime || is_lidar_id) {
-      const auto non_negative = all_non_negative<int64_t>(field_values);
-      sign_error = (sign_error || !non_negative);
+//------------------------------------------------------------------------------
+
+FrameSummary verify_frame(const MappedNpz& npz) {
+  ///
+  /// Make sure all required fields are there
+  ///
+
+  const auto& arrays = npz.get_arrays();
+  const auto fields = Fields::get_fields();
+  if (arrays.size() != fields.size()) {
+    X_ERROR("Expected npz to have " << fields.size() << " fields, but it has "
+                                    << arrays.size());
+    return FrameSummary();
+  }
+
+  std::array<const MappedNpz::Array*, 12> field_arrays;
+  FieldShapes shapes;
+  for (size_t i = 0; i < fields.size(); ++i) {
+    field_arrays[i] = npz.get(fields[i]);
+    if (field_arrays[i] == nullptr) {
+      X_ERROR("Expected npz to have field '" << fields[i]
+                                             << "', but it does not.");
+      return FrameSummary();
     }
+    shapes[i] = &field_arrays[i]->shape;
+  }
+
+  ///
+  /// Make sure all fields have expected shape, type, and values
+  ///
+
+  if (!verify_shapes(shapes)) {
+    return FrameSummary();
+  }
+
+  for (size_t i = 0; i < fields.size(); ++i) {
+    const auto& field_name = fields[i];
+    const auto& array = *field_arrays[i];
 
-    const auto is_row = (field_name == fields[Fields::ROW_IDX]);
-    const auto is_col = (field_name == fields[Fields::COL_IDX]);
-    const auto is_depth = (field_name == fields[Fields::DEPTH_IDX]);
-    const auto is_distance = (field_name == fields[Fields::DISTANCE_IDX]);
-    // TODO(jeff): figure out whether row/col can be negative
-    if (/* is_row || is_col ||*/ is_depth || is_distance) {
-      const auto non_negative =
-          all_non_negative<ReadTypes::Point>(field_values);
-      sign_error = (sign_error || !non_negative);
+    // the data is used in place, so it must have exactly the read type
+    const auto is_points = (i == Fields::POINTS_IDX);
+    const auto is_valid = (i == Fields::VALID_IDX);
+    const auto is_int = (i == Fields::BOUNDARY_IDX || i == Fields::ID_IDX ||
+                         i == Fields::RECTIME_IDX ||
+                         i == Fields::REFLECTANCE_IDX ||
+                         i == Fields::TIMESTAMP_IDX);
+    const auto expected_kind = is_valid ? 'b' : (is_int ? 'i' : 'f');
+    const auto expected_size =
+        is_valid ? sizeof(ReadTypes::BOOL)
+                 : (is_int ? sizeof(ReadTypes::INT64)
+                           : sizeof(ReadTypes::FLOAT));
+    if (array.kind != expected_kind || array.word_size != expected_size ||
+        (is_points && array.fortran_order)) {
+      X_ERROR("Expected " << field_name << " to be a C ordered array of '"
+                          << expected_kind << expected_size
+                          << "'. Instead it is a "
+                          << (array.fortran_order ? "Fortran" : "C")
+                          << " ordered array of '" << array.kind
+                          << array.word_size << "'");
+      return FrameSummary();
     }
+  }
+
+  return verify_columns(get_columns(npz));
+}
+
+//------------------------------------------------------------------------------
+
+FrameSummary verify_columns(const Columns& columns) {
+  const auto fields = Fields::get_fields();
+  const auto n = columns.num_points;
+  FrameSummary summary;
+
+  ///
+  /// Sweep each column that has constraints exactly once
+  ///
 
-    if (sign_error) {
-      X_ERROR("Expected " << field_name
+  const auto timestamps = get_column_stats(columns.timestamp, n);
+  const auto rectimes = get_column_stats(columns.rectime, n);
+  const auto lidar_ids = get_column_stats(columns.lidar_id, n);
+  const auto depths = get_column_stats(columns.depth, n);
+  const auto distances = get_column_stats(columns.distance, n);
+  summary.num_invalid_points = count_false(columns.valid, n);
+  summary.is_dense = (summary.num_invalid_points == 0);
+  if (n > 0) {
+    summary.min_timestamp = timestamps.min;
+    summary.max_timestamp = timestamps.max;
+  }
+
+  ///
+  /// Make sure fields have expected sign
+  ///
+
+  const auto check_sign = [&fields](bool non_negative, size_t field_idx) {
+    if (!non_negative) {
+      X_ERROR("Expected " << fields[field_idx]
                           << " to be strictly non-negative. Instead, it has "
                              "negative values.");
+    }
+    return non_negative;
+  };
+
+  // TODO(jeff): figure out whether row/col can be negative
+  const auto signs_valid =
+      (check_sign(timestamps.all_non_negative, Fields::TIMESTAMP_IDX) &&
+       check_sign(rectimes.all_non_negative, Fields::RECTIME_IDX) &&
+       check_sign(lidar_ids.all_non_negative, Fields::ID_IDX) &&
+       check_sign(depths.all_non_negative, Fields::DEPTH_IDX) &&
+       check_sign(distances.all_non_negative, Fields::DISTANCE_IDX));
+  if (!signs_valid) {
+    return summary;
+  }
+
+  ///
+  /// Make sure times are compatible with ROS
+  /// TODO(jeff): Add rectime here once it's verified that that's a timestamp
+  ///
+
+  // preceding checks guarantee data is non-negative
+  const auto t = static_cast<uint64_t>(summary.max_timestamp);
+  if (!valid_ros_timestamp(t)) {
+    X_ERROR("Timestamp "
+            << t
+            << " has unsupported magnitude: ROS does not support "
+               "timestamps on or after 4294967296000000 "
+               "(Sunday, February 7, 2106 6:28:16 AM GMT)\nCall "
+               "Zager and Evans for details.");
+    return summary;
+  }
+
+  summary.valid = true;
+  return summary;
+}
+
+//------------------------------------------------------------------------------
+
+bool verify_structure(const std::map<std::string, cnpy::NpyArray>& npz) {
+  return verify_frame(npz).valid;
+}
+
+//------------------------------------------------------------------------------
+
+bool verify_structure(const MappedNpz& npz) {
+  return verify_frame(npz).valid;
+}
+
+//------------------------------------------------------------------------------
+
+Columns get_columns(const std::map<std::string, cnpy::NpyArray>& npz) {
+  const auto fields = Fields::get_fields();
+  const auto& points = npz.at(fields[Fields::POINTS_IDX]);
+
+  Columns c;
+  c.points = points.data<ReadTypes::Point>();
+  c.azimuth = npz.at(fields[Fields::AZIMUTH_IDX]).data<ReadTypes::Azimuth>();
+  c.boundary =
+      npz.at(fields[Fields::BOUNDARY_IDX]).data<ReadTypes::Boundary>();
+  c.col = npz.at(fields[Fields::COL_IDX]).data<ReadTypes::Col>();
+  c.depth = npz.at(fields[Fields::DEPTH_IDX]).data<ReadTypes::Depth>();
+  c.distance =
+      npz.at(fields[Fields::DISTANCE_IDX]).data<ReadTypes::Distance>();
+  c.lidar_id = npz.at(fields[Fields::ID_IDX]).data<ReadTypes::LidarId>();
+  c.rectime = npz.at(fields[Fields::RECTIME_IDX]).data<ReadTypes::Rectime>();
+  c.reflectance =
+      npz.at(fields[Fields::REFLECTANCE_IDX]).data<ReadTypes::Reflectance>();
+  c.row = npz.at(fields[Fields::ROW_IDX]).data<ReadTypes::Row>();
+  c.timestamp =
+      npz.at(fields[Fields::TIMESTAMP_IDX]).data<ReadTypes::Timestamp>();
+  c.valid = npz.at(fields[Fields::VALID_IDX]).data<ReadTypes::Valid>();
+  c.num_points = points.shape[Fields::ROW_SHAPE_IDX];
+  return c;
+}
+
+//------------------------------------------------------------------------------
+
+Columns get_columns(const MappedNpz& npz) {
+  const auto fields = Fields::get_fields();
+  const auto get = [&npz, &fields](size_t field_idx) {
+    return npz.get(fields[field_idx]);
+  };
+  const auto points = get(Fields::POINTS_IDX);
+
+  Columns c;
+  c.points = points->data<ReadTypes::Point>();
+  c.azimuth = get(Fields::AZIMUTH_IDX)->data<ReadTypes::Azimuth>();
+  c.boundary = get(Fields::BOUNDARY_IDX)->data<ReadTypes::Boundary>();
+  c.col = get(Fields::COL_IDX)->data<ReadTypes::Col>();
+  c.depth = get(Fields::DEPTH_IDX)->data<ReadTypes::Depth>();
+  c.distance = get(Fields::DISTANCE_IDX)->data<ReadTypes::Distance>();
+  c.lidar_id = get(Fields::ID_IDX)->data<ReadTypes::LidarId>();
+  c.rectime = get(Fields::RECTIME_IDX)->data<ReadTypes::Rectime>();
+  c.reflectance = get(Fields::REFLECTANCE_IDX)->data<ReadTypes::Reflectance>();
+  c.row = get(Fields::ROW_IDX)->data<ReadTypes::Row>();
+  c.timestamp = get(Fields::TIMESTAMP_IDX)->data<ReadTypes::Timestamp>();
+  c.valid = get(Fields::VALID_IDX)->data<ReadTypes::Valid>();
+  c.num_points = points->shape[Fields::ROW_SHAPE_IDX];
+  return c;
+}
+
+//------------------------------------------------------------------------------
+
+template <>
+ColumnStats<double> get_column_stats(const double* vals, size_t n) {
+  ColumnStats<double> stats;
+  auto lo = stats.min;
+  auto hi = stats.max;
+  size_t num_nan = 0;
+  size_t num_not_non_negative = 0;
+  size_t i = 0;
+#ifdef __SSE2__
+  // min/max return their second operand if either is NaN, so NaN values are
+  // skipped exactly as by the scalar comparisons
+  auto lo2 = _mm_set1_pd(lo);
+  auto hi2 = _mm_set1_pd(hi);
+  const auto zero = _mm_setzero_pd();
+  for (; (i + 2) <= n; i += 2) {
+    const auto v = _mm_loadu_pd(vals + i);
+    lo2 = _mm_min_pd(v, lo2);
+    hi2 = _mm_max_pd(v, hi2);
+    const auto nan_mask = _mm_movemask_pd(_mm_cmpunord_pd(v, v));
+    const auto negative_mask = _mm_movemask_pd(_mm_cmpnge_pd(v, zero));
+    num_nan += static_cast<size_t>((nan_mask & 1) + (nan_mask >> 1));
+    num_not_non_negative +=
+        static_cast<size_t>((negative_mask & 1) + (negative_mask >> 1));
+  }
+  double lanes[2];
+  _mm_storeu_pd(lanes, lo2);
+  lo = std::min(lanes[0], lanes[1]);
+  _mm_storeu_pd(lanes, hi2);
+  hi = std::max(lanes[0], lanes[1]);
+#endif
+  // the remainder, or everything without SSE2
+  for (; i < n; ++i) {
+    const auto v = vals[i];
+    lo = (v < lo) ? v : lo;
+    hi = (v > hi) ? v : hi;
+    num_nan += static_cast<size_t>(v != v);
+    num_not_non_negative += static_cast<size_t>(!(v >= 0.0));
+  }
+  stats.min = lo;
+  stats.max = hi;
+  stats.num_invalid = num_nan;
+  stats.all_non_negative = (num_not_non_negative == 0);
+  return stats;
+}
+
+//------------------------------------------------------------------------------
+
+bool any_points_invalid(const cnpy::NpyArray& valid) {
+  const auto v = valid.data<bool>();
+  return (std::find(v, v + valid.num_vals, false) != (v + valid.num_vals));
+}
+
+//------------------------------------------------------------------------------
+
+MappedNpz::~MappedNpz() { close(); }
+
+//------------------------------------------------------------------------------
+
+bool MappedNpz::open(const std::string& path) {
+  close();
+
+  const auto fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    X_ERROR("Could not open " << path << ": " << std::strerror(errno));
+    return false;
+  }
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    X_ERROR("Could not stat " << path << ": " << std::strerror(errno));
+    ::close(fd);
+    return false;
+  }
+
+  map_size_ = static_cast<size_t>(st.st_size);
+  if (map_size_ > 0) {
+    const auto map = ::mmap(nullptr, map_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+      X_ERROR("Could not map " << path << ": " << std::strerror(errno));
+      map_size_ = 0;
+      ::close(fd);
+      return false;
+    }
+    map_ = static_cast<const uint8_t*>(map);
+  }
+  // the mapping keeps its own reference to the file
+  ::close(fd);
+
+  if (!read_central_directory(path)) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool MappedNpz::open(std::vector<uint8_t>&& bytes, const std::string& name) {
+  close();
+
+  file_bytes_ = std::move(bytes);
+  map_size_ = file_bytes_.size();
+  if (map_size_ > 0) {
+    map_ = file_bytes_.data();
+  }
+
+  if (!read_central_directory(name)) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+void MappedNpz::close() {
+  if ((map_ != nullptr) && file_bytes_.empty()) {
+    ::munmap(const_cast<uint8_t*>(map_), map_size_);
+  }
+  map_ = nullptr;
+  map_size_ = 0;
+  file_bytes_.clear();
+  arrays_.clear();
+  buffers_.clear();
+}
+
+//------------------------------------------------------------------------------
+
+const MappedNpz::Array* MappedNpz::get(const std::string& name) const {
+  const auto it = arrays_.find(name);
+  return (it == std::end(arrays_)) ? nullptr : &it->second;
+}
+
+//------------------------------------------------------------------------------
+
+bool MappedNpz::read_central_directory(const std::string& path) {
+  ///
+  /// Find the end of central directory record; only a comment can follow it
+  ///
+
+  if (map_size_ < END_SIZE) {
+    X_ERROR(path << " is too small to be an npz file.");
+    return false;
+  }
+  const auto search_end =
+      (map_size_ > (END_SIZE + MAX_COMMENT_SIZE))
+          ? (map_size_ - END_SIZE - MAX_COMMENT_SIZE)
+          : static_cast<size_t>(0);
+  auto end_pos = (map_size_ - END_SIZE);
+  while (read_u32(map_ + end_pos) != END_SIGNATURE) {
+    if (end_pos == search_end) {
+      X_ERROR(path << " is not a zip archive.");
       return false;
     }
+    --end_pos;
+  }
+  const auto end = (map_ + end_pos);
+
+  uint64_t num_entries = read_u16(end + 10);
+  uint64_t directory_size = read_u32(end + 12);
+  uint64_t directory_offset = read_u32(end + 16);
+
+  const auto is_zip64 = (num_entries == 0xFFFF ||
+                         directory_size == ZIP64_MARKER ||
+                         directory_offset == ZIP64_MARKER);
+  if (is_zip64) {
+    const auto has_locator =
+        (end_pos >= ZIP64_LOCATOR_SIZE &&
+         read_u32(end - ZIP64_LOCATOR_SIZE) == ZIP64_LOCATOR_SIGNATURE);
+    const auto zip64_end_offset =
+        has_locator ? read_u64(end - ZIP64_LOCATOR_SIZE + 8) : map_size_;
+    if (!has_locator || zip64_end_offset + ZIP64_END_SIZE > map_size_ ||
+        read_u32(map_ + zip64_end_offset) != ZIP64_END_SIGNATURE) {
+      X_ERROR(path << " has a malformed zip64 end of central directory.");
+      return false;
+    }
+    const auto zip64_end = (map_ + zip64_end_offset);
+    num_entries = read_u64(zip64_end + 32);
+    directory_size = read_u64(zip64_end + 40);
+    directory_offset = read_u64(zip64_end + 48);
+  }
 
-    ///
-    /// Make sure times are compatible with ROS
-    /// TODO(jeff): Add rectime here once it's verified that that's a timestamp
-    ///
-    if (is_timestamp) {
-      const auto length = field_values.shape[Fields::ROW_SHAPE_IDX];
-      const auto& data = field_values.data<ReadTypes::Timestamp>();
-      for (auto i = 0; i < length; ++i) {
-        // preceding checks guarantee data is non-negative
-        const auto t = static_cast<uint64_t>(data[i]);
-        if (!valid_ros_timestamp(t)) {
-          X_ERROR("Timestamp "
-                  << t
-                  << " has unsupported magnitude: ROS does not support "
-                     "timestamps on or after 4294967296000000 "
-                     "(Sunday, February 7, 2106 6:28:16 AM GMT)\nCall "
-                     "Zager and Evans for details.");
-          return false;
+  if (directory_offset + directory_size > map_size_) {
+    X_ERROR(path << " has a truncated central directory.");
+    return false;
+  }
+
+  ///
+  /// Index every member
+  ///
+
+  auto pos = directory_offset;
+  const auto directory_end = (directory_offset + directory_size);
+  for (uint64_t i = 0; i < num_entries; ++i) {
+    if (pos + CENTRAL_HEADER_SIZE > directory_end ||
+        read_u32(map_ + pos) != CENTRAL_HEADER_SIGNATURE) {
+      X_ERROR(path << " has a malformed central directory.");
+      return false;
+    }
+    const auto header = (map_ + pos);
+    const auto method = read_u16(header + 10);
+    uint64_t compressed_size = read_u32(header + 20);
+    uint64_t uncompressed_size = read_u32(header + 24);
+    const auto name_length = read_u16(header + 28);
+    const auto extra_length = read_u16(header + 30);
+    const auto comment_length = read_u16(header + 32);
+    uint64_t local_header_offset = read_u32(header + 42);
+
+    const auto next_pos = (pos + CENTRAL_HEADER_SIZE + name_length +
+                           extra_length + comment_length);
+    if (next_pos > directory_end) {
+      X_ERROR(path << " has a malformed central directory.");
+      return false;
+    }
+
+    // 64 bit values are in the extra field, but only for the saturated ones
+    auto extra = (header + CENTRAL_HEADER_SIZE + name_length);
+    const auto extra_end = (extra + extra_length);
+    while (extra + 4 <= extra_end) {
+      const auto id = read_u16(extra);
+      const auto size = read_u16(extra + 2);
+      auto value = (extra + 4);
+      const auto value_end = (value + size);
+      if (value_end > extra_end) {
+        break;
+      }
+      if (id == ZIP64_EXTRA_ID) {
+        for (auto field : {&uncompressed_size, &compressed_size,
+                           &local_header_offset}) {
+          if (*field == ZIP64_MARKER && value + 8 <= value_end) {
+            *field = read_u64(value);
+            value += 8;
+          }
         }
       }
+      extra = value_end;
     }
+
+    auto name = std::string(
+        reinterpret_cast<const char*>(header + CENTRAL_HEADER_SIZE),
+        name_length);
+    // cnpy::npz_load uses the same keys
+    const std::string NPY_SUFFIX = ".npy";
+    if (name.size() > NPY_SUFFIX.size() &&
+        name.compare(name.size() - NPY_SUFFIX.size(), NPY_SUFFIX.size(),
+                     NPY_SUFFIX) == 0) {
+      name.erase(name.size() - NPY_SUFFIX.size());
+    }
+
+    if (!read_member(path, name, method, compressed_size, uncompressed_size,
+                     local_header_offset)) {
+      return false;
+    }
+    pos = next_pos;
   }
 
   return true;
@@ -169,13 +780,106 @@ bool verify_structure(const std::map<std::string, cnpy::NpyArray>& npz) {
 
 //------------------------------------------------------------------------------
 
-bool any_points_invalid(const cnpy::NpyArray& valid) {
-  auto all_valid = true;
-  const auto v = valid.data<bool>();
-  for (auto i = 0; i < valid.shape[Fields::ROW_SHAPE_IDX]; ++i) {
-    all_valid = (all_valid && v[i]);
+bool MappedNpz::read_member(const std::string& path,
+                            const std::string& member_name, uint16_t method,
+                            uint64_t compressed_size,
+                            uint64_t uncompressed_size,
+                            uint64_t local_header_offset) {
+  // the local header repeats the name, but its extra field can differ
+  if (local_header_offset + LOCAL_HEADER_SIZE > map_size_ ||
+      read_u32(map_ + local_header_offset) != LOCAL_HEADER_SIGNATURE) {
+    X_ERROR(path << ": member '" << member_name
+                 << "' has a malformed local header.");
+    return false;
+  }
+  const auto local_header = (map_ + local_header_offset);
+  const auto data_offset = (local_header_offset + LOCAL_HEADER_SIZE +
+                            read_u16(local_header + 26) +
+                            read_u16(local_header + 28));
+  if (data_offset + compressed_size > map_size_) {
+    X_ERROR(path << ": member '" << member_name << "' is truncated.");
+    return false;
+  }
+
+  ///
+  /// View stored members in place, inflate deflated ones
+  ///
+
+  const uint8_t* npy = (map_ + data_offset);
+  std::unique_ptr<uint8_t[]> buffer;
+  if (method == METHOD_DEFLATED) {
+    const auto max_size = std::numeric_limits<uInt>::max();
+    if (compressed_size > max_size || uncompressed_size > max_size) {
+      X_ERROR(path << ": member '" << member_name
+                   << "' is too large to inflate.");
+      return false;
+    }
+    buffer.reset(new uint8_t[uncompressed_size]);
+
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    // zip members are raw deflate streams without a zlib header
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+      X_ERROR("Could not initialize zlib.");
+      return false;
+    }
+    stream.next_in = const_cast<Bytef*>(npy);
+    stream.avail_in = static_cast<uInt>(compressed_size);
+    stream.next_out = buffer.get();
+    stream.avail_out = static_cast<uInt>(uncompressed_size);
+    const auto result = inflate(&stream, Z_FINISH);
+    const auto num_inflated = stream.total_out;
+    inflateEnd(&stream);
+    if (result != Z_STREAM_END || num_inflated != uncompressed_size) {
+      X_ERROR(path << ": member '" << member_name
+                   << "' could not be inflated.");
+      return false;
+    }
+    npy = buffer.get();
+  } else if (method == METHOD_STORED) {
+    if (compressed_size != uncompressed_size) {
+      X_ERROR(path << ": member '" << member_name
+                   << "' has inconsistent sizes.");
+      return false;
+    }
+  } else {
+    X_ERROR(path << ": member '" << member_name
+                 << "' uses unsupported compression method " << method);
+    return false;
   }
-  return !all_valid;
+
+  ///
+  /// Parse the array header
+  ///
+
+  Array array;
+  size_t header_size = 0;
+  if (!parse_npy_header(npy, uncompressed_size, array, header_size)) {
+    X_ERROR(path << ": member '" << member_name << "' is not a .npy array.");
+    return false;
+  }
+  const auto num_bytes = (array.num_vals * array.word_size);
+  if (header_size + num_bytes > uncompressed_size) {
+    X_ERROR(path << ": member '" << member_name << "' is truncated.");
+    return false;
+  }
+  array.bytes = (npy + header_size);
+
+  // numpy pads its headers, but the zip local headers are not padded
+  const auto misaligned =
+      ((reinterpret_cast<uintptr_t>(array.bytes) % array.word_size) != 0);
+  if (misaligned) {
+    std::unique_ptr<uint8_t[]> aligned(new uint8_t[num_bytes]);
+    std::memcpy(aligned.get(), array.bytes, num_bytes);
+    array.bytes = aligned.get();
+    buffer = std::move(aligned);
+  }
+  if (buffer) {
+    buffers_.push_back(std::move(buffer));
+  }
+
+  arrays_[member_name] = std::move(array);
+  return true;
 }
 
 //------------------------------------------------------------------------------
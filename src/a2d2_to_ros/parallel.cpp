@@ -0,0 +1,127 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "a2d2_to_ros/parallel.hpp"
+
+namespace a2d2_to_ros {
+
+//------------------------------------------------------------------------------
+
+size_t get_num_jobs(size_t requested) {
+  if (requested > 0) {
+    return requested;
+  }
+  const auto hardware_threads =
+      static_cast<size_t>(std::thread::hardware_concurrency());
+  return std::max(hardware_threads, static_cast<size_t>(1));
+}
+
+//------------------------------------------------------------------------------
+
+TaskQueue::TaskQueue(size_t max_queued)
+    : max_queued_(std::max(max_queued, static_cast<size_t>(1))),
+      thread_(&TaskQueue::run, this) {}
+
+//------------------------------------------------------------------------------
+
+TaskQueue::~TaskQueue() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  task_ready_.notify_all();
+  thread_.join();
+}
+
+//------------------------------------------------------------------------------
+
+void TaskQueue::push(std::function<void()> task) {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    task_done_.wait(lock, [this]() {
+      return (error_ || (tasks_.size() < max_queued_));
+    });
+    rethrow_error(lock);
+    tasks_.push_back(std::move(task));
+  }
+  task_ready_.notify_one();
+}
+
+//------------------------------------------------------------------------------
+
+void TaskQueue::wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  task_done_.wait(lock, [this]() { return (tasks_.empty() && !busy_); });
+  rethrow_error(lock);
+}
+
+//------------------------------------------------------------------------------
+
+void TaskQueue::run() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      task_ready_.wait(lock, [this]() { return (stop_ || !tasks_.empty()); });
+      if (tasks_.empty()) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+      busy_ = true;
+    }
+
+    std::exception_ptr error;
+    try {
+      task();
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (error) {
+        error_ = error;
+        tasks_.clear();
+      }
+      busy_ = false;
+    }
+    task_done_.notify_all();
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void TaskQueue::rethrow_error(std::unique_lock<std::mutex>& lock) {
+  if (!error_) {
+    return;
+  }
+  auto error = error_;
+  error_ = nullptr;
+  lock.unlock();
+  std::rethrow_exception(error);
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
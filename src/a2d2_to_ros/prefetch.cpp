@@ -0,0 +1,150 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "a2d2_to_ros/prefetch.hpp"
+
+#include <utility>
+
+#include "a2d2_to_ros/file_utils.hpp"
+
+namespace a2d2_to_ros {
+
+//------------------------------------------------------------------------------
+
+constexpr size_t PrefetchOptions::DEFAULT_DEPTH;
+constexpr size_t PrefetchOptions::DEFAULT_MAX_BYTES;
+
+//------------------------------------------------------------------------------
+
+FilePrefetcher::FilePrefetcher(std::vector<std::string> paths,
+                               PrefetchOptions options)
+    : paths_(std::move(paths)), options_(options) {
+  if ((options_.depth > 0) && !paths_.empty()) {
+    thread_ = std::thread(&FilePrefetcher::run, this);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+FilePrefetcher::~FilePrefetcher() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  slot_ready_.notify_all();
+  file_ready_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+//------------------------------------------------------------------------------
+
+bool FilePrefetcher::take(size_t idx, std::vector<uint8_t>& bytes) {
+  if (idx >= paths_.size()) {
+    return false;
+  }
+  if (!thread_.joinable()) {
+    return read_file(paths_[idx], bytes);
+  }
+
+  File file;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    file_ready_.wait(lock, [this, idx]() {
+      return (stop_ || (idx < next_read_));
+    });
+    const auto it = files_.find(idx);
+    if (it == std::end(files_)) {
+      // stopped, or already taken
+      return false;
+    }
+    file = std::move(it->second);
+    files_.erase(it);
+    bytes_held_ -= file.bytes.size();
+
+    std::swap(bytes, file.bytes);
+    if ((file.bytes.capacity() > 0) && (spares_.size() < options_.depth)) {
+      spare_bytes_ += file.bytes.capacity();
+      spares_.push_back(std::move(file.bytes));
+    }
+  }
+  slot_ready_.notify_one();
+
+  return file.read;
+}
+
+//------------------------------------------------------------------------------
+
+void FilePrefetcher::run() {
+  while (true) {
+    size_t idx = 0;
+    File file;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      slot_ready_.wait(lock, [this]() {
+        // a file is always read if none are held, even if it exceeds the cap
+        const auto has_room =
+            (files_.empty() ||
+             ((files_.size() < options_.depth) &&
+              ((bytes_held_ + spare_bytes_) < options_.max_bytes)));
+        return (stop_ || (next_read_ >= paths_.size()) || has_room);
+      });
+      if (stop_ || (next_read_ >= paths_.size())) {
+        return;
+      }
+      idx = next_read_;
+
+      if (!spares_.empty()) {
+        file.bytes = std::move(spares_.back());
+        spares_.pop_back();
+        spare_bytes_ -= file.bytes.capacity();
+      }
+    }
+
+    file.read = read_file(paths_[idx], file.bytes);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      bytes_held_ += file.bytes.size();
+      files_.emplace(idx, std::move(file));
+      ++next_read_;
+    }
+    file_ready_.notify_all();
+  }
+}
+
+//------------------------------------------------------------------------------
+
+bool FilePrefetcher::read_file(const std::string& path,
+                               std::vector<uint8_t>& bytes) {
+  if (path.empty()) {
+    bytes.clear();
+    return true;
+  }
+  return get_file_as_bytes(path, bytes);
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
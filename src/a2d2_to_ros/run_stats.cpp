@@ -0,0 +1,271 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "a2d2_to_ros/run_stats.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+#include "a2d2_to_ros/logging.hpp"
+
+namespace a2d2_to_ros {
+
+namespace {
+/** @brief Get the nearest-rank percentile of sorted, non-empty values. */
+double get_percentile(const std::vector<double>& sorted, double percent) {
+  const auto rank = static_cast<size_t>(
+      std::ceil((percent / 100.0) * static_cast<double>(sorted.size())));
+  return sorted[std::max(rank, static_cast<size_t>(1)) - 1];
+}
+
+/** @brief Get a count per second, or zero if no time has passed. */
+double get_rate(uint64_t count, double seconds) {
+  return ((seconds > 0.0) ? (static_cast<double>(count) / seconds) : 0.0);
+}
+}  // namespace
+
+//------------------------------------------------------------------------------
+
+const char* Stage::get_name(Id id) {
+  switch (id) {
+    case SCAN:
+      return "scan";
+    case JSON_READ:
+      return "json_read";
+    case JSON_PARSE:
+      return "json_parse";
+    case JSON_VALIDATE:
+      return "json_validate";
+    case NPZ_LOAD:
+      return "npz_load";
+    case VERIFY:
+      return "verify";
+    case IMAGE_LOAD:
+      return "image_load";
+    case IMAGE_DECODE:
+      return "image_decode";
+    case MSG_BUILD:
+      return "msg_build";
+    case BAG_WRITE:
+      return "bag_write";
+    case BAG_CLOSE:
+      return "bag_close";
+    case CLOCK_WRITE:
+      return "clock_write";
+    case NUM_STAGES:
+      break;
+  }
+  return "unknown";
+}
+
+//------------------------------------------------------------------------------
+
+LatencySummary summarize_latencies(std::vector<double> latencies) {
+  LatencySummary summary;
+  if (latencies.empty()) {
+    return summary;
+  }
+
+  std::sort(std::begin(latencies), std::end(latencies));
+  summary.count = latencies.size();
+  for (const auto l : latencies) {
+    summary.total += l;
+  }
+  summary.p50 = get_percentile(latencies, 50.0);
+  summary.p99 = get_percentile(latencies, 99.0);
+  summary.max = latencies.back();
+  return summary;
+}
+
+//------------------------------------------------------------------------------
+
+RunStats::RunStats(bool enabled) : enabled_(enabled), start_(Clock::now()) {}
+
+//------------------------------------------------------------------------------
+
+void RunStats::add_latency(Stage::Id stage, double seconds) {
+  if (!enabled_) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  latencies_[stage].push_back(seconds);
+}
+
+//------------------------------------------------------------------------------
+
+void RunStats::add_frames(uint64_t n) {
+  if (enabled_) {
+    frames_ += n;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void RunStats::add_points(uint64_t n) {
+  if (enabled_) {
+    points_ += n;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void RunStats::add_bytes_in(uint64_t n) {
+  if (enabled_) {
+    bytes_in_ += n;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void RunStats::add_bytes_out(uint64_t n) {
+  if (enabled_) {
+    bytes_out_ += n;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+LatencySummary RunStats::get_summary(Stage::Id stage) const {
+  std::vector<double> latencies;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    latencies = latencies_[stage];
+  }
+  return summarize_latencies(std::move(latencies));
+}
+
+//------------------------------------------------------------------------------
+
+std::string RunStats::to_json(const std::string& converter) const {
+  const auto wall_time =
+      std::chrono::duration<double>(Clock::now() - start_).count();
+
+  std::stringstream ss;
+  ss.precision(9);
+  ss << "{\n"
+     << "  \"converter\": \"" << converter << "\",\n"
+     << "  \"wall_time_s\": " << wall_time << ",\n"
+     << "  \"totals\": {\n"
+     << "    \"frames\": " << frames_ << ",\n"
+     << "    \"points\": " << points_ << ",\n"
+     << "    \"bytes_in\": " << bytes_in_ << ",\n"
+     << "    \"bytes_out\": " << bytes_out_ << "\n"
+     << "  },\n"
+     << "  \"rates\": {\n"
+     << "    \"frames_per_s\": " << get_rate(frames_, wall_time) << ",\n"
+     << "    \"points_per_s\": " << get_rate(points_, wall_time) << ",\n"
+     << "    \"bytes_in_per_s\": " << get_rate(bytes_in_, wall_time) << ",\n"
+     << "    \"bytes_out_per_s\": " << get_rate(bytes_out_, wall_time) << "\n"
+     << "  },\n"
+     << "  \"stages\": {";
+
+  // only stages that ran are reported, in pipeline order
+  auto first = true;
+  for (auto i = 0; i < Stage::NUM_STAGES; ++i) {
+    const auto stage = static_cast<Stage::Id>(i);
+    const auto summary = get_summary(stage);
+    if (summary.count == 0) {
+      continue;
+    }
+    ss << (first ? "\n" : ",\n") << "    \"" << Stage::get_name(stage)
+       << "\": {\"count\": " << summary.count
+       << ", \"total_s\": " << summary.total
+       << ", \"p50_s\": " << summary.p50 << ", \"p99_s\": " << summary.p99
+       << ", \"max_s\": " << summary.max << "}";
+    first = false;
+  }
+  ss << (first ? "}\n" : "\n  }\n") << "}\n";
+  return ss.str();
+}
+
+//------------------------------------------------------------------------------
+
+bool RunStats::write_json(const std::string& path,
+                          const std::string& converter) const {
+  std::ofstream f(path);
+  if (!f) {
+    X_ERROR("Failed to open '" << path << "' for writing.");
+    return false;
+  }
+  f << to_json(converter);
+  f.close();
+  if (!f) {
+    X_ERROR("Failed to write '" << path << "'.");
+    return false;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+ScopedStageTimer::ScopedStageTimer(RunStats& stats, Stage::Id stage)
+    : stats_(stats),
+      stage_(stage),
+      elapsed_(RunStats::Clock::duration::zero()),
+      running_(stats.is_enabled()),
+      paused_(false) {
+  if (running_) {
+    start_ = RunStats::Clock::now();
+  }
+}
+
+//------------------------------------------------------------------------------
+
+ScopedStageTimer::~ScopedStageTimer() { stop(); }
+
+//------------------------------------------------------------------------------
+
+void ScopedStageTimer::stop() {
+  if (!running_) {
+    return;
+  }
+  pause();
+  running_ = false;
+  stats_.add_latency(stage_, std::chrono::duration<double>(elapsed_).count());
+}
+
+//------------------------------------------------------------------------------
+
+void ScopedStageTimer::pause() {
+  if (!running_ || paused_) {
+    return;
+  }
+  paused_ = true;
+  elapsed_ += (RunStats::Clock::now() - start_);
+}
+
+//------------------------------------------------------------------------------
+
+void ScopedStageTimer::resume() {
+  if (!running_ || !paused_) {
+    return;
+  }
+  paused_ = false;
+  start_ = RunStats::Clock::now();
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
@@ -0,0 +1,506 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "a2d2_to_ros/sensor_config.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+#include <boost/filesystem.hpp>
+#include <eigen_conversions/eigen_msg.h>
+
+#include "a2d2_to_ros/checks.hpp"
+#include "a2d2_to_ros/file_utils.hpp"
+#include "a2d2_to_ros/json_utils.hpp"
+#include "a2d2_to_ros/logging.hpp"
+#include "a2d2_to_ros/name_utils.hpp"
+#include "a2d2_to_ros/sensors.hpp"
+#include "a2d2_to_ros/transform_utils.hpp"
+
+namespace a2d2_to_ros {
+
+namespace {
+// first bytes of the cache file; bump the version if the format changes
+static constexpr char CACHE_MAGIC[] = "a2d2_sensor_config 1\n";
+static constexpr auto CACHE_MAGIC_SIZE = (sizeof(CACHE_MAGIC) - 1);
+
+/**
+ * @brief Appends values to a byte buffer in host byte order.
+ */
+class BinaryWriter {
+ public:
+  template <typename T>
+  void write(const T& value) {
+    static_assert(std::is_arithmetic<T>::value, "Only numbers are written.");
+    const auto p = reinterpret_cast<const char*>(&value);
+    buffer_.append(p, sizeof(T));
+  }
+
+  void write_string(const std::string& s) {
+    write(static_cast<uint32_t>(s.size()));
+    buffer_.append(s);
+  }
+
+  template <typename Array>
+  void write_doubles(const Array& values) {
+    for (const auto value : values) {
+      write(static_cast<double>(value));
+    }
+  }
+
+  const std::string& get_buffer() const { return buffer_; }
+
+ private:
+  std::string buffer_;
+};  // class BinaryWriter
+
+/**
+ * @brief Reads values written by BinaryWriter. Once a read runs past the end
+ * of the data, every later read fails too.
+ */
+class BinaryReader {
+ public:
+  explicit BinaryReader(const std::vector<uint8_t>& bytes) : bytes_(bytes) {}
+
+  template <typename T>
+  bool read(T& value) {
+    static_assert(std::is_arithmetic<T>::value, "Only numbers are read.");
+    if (!ok_ || ((bytes_.size() - offset_) < sizeof(T))) {
+      ok_ = false;
+      return false;
+    }
+    std::memcpy(&value, bytes_.data() + offset_, sizeof(T));
+    offset_ += sizeof(T);
+    return true;
+  }
+
+  bool read_string(std::string& s) {
+    uint32_t size = 0;
+    if (!read(size) || ((bytes_.size() - offset_) < size)) {
+      ok_ = false;
+      return false;
+    }
+    s.assign(reinterpret_cast<const char*>(bytes_.data() + offset_), size);
+    offset_ += size;
+    return true;
+  }
+
+  template <typename Array>
+  bool read_doubles(Array& values) {
+    for (auto& value : values) {
+      if (!read(value)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool skip(size_t size) {
+    if (!ok_ || ((bytes_.size() - offset_) < size)) {
+      ok_ = false;
+      return false;
+    }
+    offset_ += size;
+    return true;
+  }
+
+  bool ok() const { return ok_; }
+
+  size_t remaining() const { return (bytes_.size() - offset_); }
+
+ private:
+  const std::vector<uint8_t>& bytes_;
+  size_t offset_ = 0;
+  bool ok_ = true;
+};  // class BinaryReader
+
+//------------------------------------------------------------------------------
+
+void write_camera_info(BinaryWriter& writer,
+                       const sensor_msgs::CameraInfo& info) {
+  writer.write(static_cast<uint32_t>(info.height));
+  writer.write(static_cast<uint32_t>(info.width));
+  writer.write_string(info.distortion_model);
+  writer.write(static_cast<uint32_t>(info.D.size()));
+  writer.write_doubles(info.D);
+  writer.write_doubles(info.K);
+  writer.write_doubles(info.R);
+  writer.write_doubles(info.P);
+}
+
+//------------------------------------------------------------------------------
+
+bool read_camera_info(BinaryReader& reader, sensor_msgs::CameraInfo& info) {
+  uint32_t num_coefficients = 0;
+  if (!reader.read(info.height) || !reader.read(info.width) ||
+      !reader.read_string(info.distortion_model) ||
+      !reader.read(num_coefficients)) {
+    return false;
+  }
+  // a count past the end of the file is caught before anything is allocated
+  if (num_coefficients > (reader.remaining() / sizeof(double))) {
+    return false;
+  }
+  info.D.resize(num_coefficients);
+  return (reader.read_doubles(info.D) && reader.read_doubles(info.K) &&
+          reader.read_doubles(info.R) && reader.read_doubles(info.P));
+}
+
+//------------------------------------------------------------------------------
+
+void write_transform(BinaryWriter& writer,
+                     const geometry_msgs::TransformStamped& tx) {
+  writer.write_string(tx.header.frame_id);
+  writer.write_string(tx.child_frame_id);
+  const auto& t = tx.transform.translation;
+  const auto& q = tx.transform.rotation;
+  for (const auto value : {t.x, t.y, t.z, q.x, q.y, q.z, q.w}) {
+    writer.write(value);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+bool read_transform(BinaryReader& reader, geometry_msgs::TransformStamped& tx) {
+  auto& t = tx.transform.translation;
+  auto& q = tx.transform.rotation;
+  return (reader.read_string(tx.header.frame_id) &&
+          reader.read_string(tx.child_frame_id) && reader.read(t.x) &&
+          reader.read(t.y) && reader.read(t.z) && reader.read(q.x) &&
+          reader.read(q.y) && reader.read(q.z) && reader.read(q.w));
+}
+
+//------------------------------------------------------------------------------
+
+geometry_msgs::TransformStamped build_transform_msg(
+    const Eigen::Affine3d& Tx, const std::string& parent_frame,
+    const std::string& child_frame) {
+  geometry_msgs::TransformStamped msg;
+  tf::transformEigenToMsg(Tx, msg.transform);
+  msg.header.frame_id = parent_frame;
+  msg.child_frame_id = child_frame;
+  return msg;
+}
+}  // namespace
+
+//------------------------------------------------------------------------------
+
+const std::string SensorConfig::CACHE_FILENAME = ".a2d2_sensor_config";
+constexpr double SensorConfig::BASIS_EPSILON;
+
+//------------------------------------------------------------------------------
+
+uint64_t fnv1a_hash(const uint8_t* data, size_t size, uint64_t hash) {
+  constexpr auto PRIME = 0x100000001b3ull;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= data[i];
+    hash *= PRIME;
+  }
+  return hash;
+}
+
+//------------------------------------------------------------------------------
+
+bool build_sensor_config(const rapidjson::Document& d, SensorConfig& config) {
+  config = SensorConfig();
+
+  ///
+  /// Ego vehicle bounding box
+  ///
+
+  {
+    const rapidjson::Value& ego_dims = d["vehicle"]["ego-dimensions"];
+    const rapidjson::Value& x_dims = ego_dims["x-range"];
+    const rapidjson::Value& y_dims = ego_dims["y-range"];
+    const rapidjson::Value& z_dims = ego_dims["z-range"];
+
+    constexpr auto MIN_IDX = static_cast<rapidjson::SizeType>(0);
+    constexpr auto MAX_IDX = static_cast<rapidjson::SizeType>(1);
+    auto& bbox = config.ego_bbox;
+    bbox.x_min = x_dims[MIN_IDX].GetDouble();
+    bbox.x_max = x_dims[MAX_IDX].GetDouble();
+    bbox.y_min = y_dims[MIN_IDX].GetDouble();
+    bbox.y_max = y_dims[MAX_IDX].GetDouble();
+    bbox.z_min = z_dims[MIN_IDX].GetDouble();
+    bbox.z_max = z_dims[MAX_IDX].GetDouble();
+
+    if (!verify_ego_bbox_params(bbox.x_min, bbox.x_max, bbox.y_min, bbox.y_max,
+                                bbox.z_min, bbox.z_max)) {
+      X_ERROR(
+          "Ego bounding box parameters are invalid. They must be finite, "
+          "real-valued, and ordered: x: ["
+          << bbox.x_min << ", " << bbox.x_max << "], y: [" << bbox.y_min
+          << ", " << bbox.y_max << "], z: [" << bbox.z_min << ", "
+          << bbox.z_max << "]");
+      return false;
+    }
+  }
+
+  ///
+  /// Camera info and pose of every sensor
+  ///
+
+  const auto sensors = sensors::Frames::get_sensors();
+  for (const auto& name : {sensors::Names::CAMERAS, sensors::Names::LIDARS}) {
+    const auto is_camera = (name == sensors::Names::CAMERAS);
+    const auto is_lidar = (name == sensors::Names::LIDARS);
+
+    for (size_t i = 0; i < sensors.size(); ++i) {
+      const auto& frame = sensors[i];
+
+      // No lidars at these positions
+      const auto is_side_left = (sensors::Frames::SIDE_LEFT_IDX == i);
+      const auto is_side_right = (sensors::Frames::SIDE_RIGHT_IDX == i);
+      const auto is_rear_center = (sensors::Frames::REAR_CENTER_IDX == i);
+      if (is_lidar && (is_side_left || is_side_right || is_rear_center)) {
+        continue;
+      }
+
+      // No cameras at these positions
+      const auto is_rear_left = (sensors::Frames::REAR_LEFT_IDX == i);
+      const auto is_rear_right = (sensors::Frames::REAR_RIGHT_IDX == i);
+      if (is_camera && (is_rear_left || is_rear_right)) {
+        continue;
+      }
+
+      if (is_camera) {
+        config.camera_infos[frame] =
+            json_camera_to_camera_info(d, name, frame);
+      }
+
+      // compute transform between sensor and vehicle
+      const Eigen::Matrix3d basis = json_axes_to_eigen_basis(
+          d, name, frame, SensorConfig::BASIS_EPSILON);
+      const Eigen::Vector3d origin =
+          json_origin_to_eigen_vector(d, name, frame);
+      if (!vector_is_valid(origin)) {
+        X_ERROR("Origin for " << name << "::" << frame
+                              << " is not valid. Origin must be finite and "
+                                 "real valued.");
+        return false;
+      }
+      if (basis.isZero(0.0)) {
+        X_ERROR("Basis for " << name << "::" << frame
+                             << " cannot be constructed. Check that the X/Y "
+                                "axes are valid.");
+        return false;
+      }
+
+      const Eigen::Affine3d Tx = Tx_global_sensor(basis, origin);
+      config.transforms.push_back(
+          build_transform_msg(Tx, "chassis", tf_frame_name(name, frame)));
+
+      // Lidar data lives in camera frames, but it is motion corrected, so it
+      // lives in 'wheels' not 'chassis'
+      if (is_camera) {
+        config.transforms.push_back(build_transform_msg(
+            Tx, "wheels",
+            tf_motion_compensated_sensor_frame_name(name, frame)));
+      }
+    }
+  }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool save_sensor_config(const std::string& path, uint64_t key,
+                        const SensorConfig& config) {
+  BinaryWriter writer;
+  writer.write(key);
+
+  const auto& bbox = config.ego_bbox;
+  for (const auto value : {bbox.x_min, bbox.x_max, bbox.y_min, bbox.y_max,
+                           bbox.z_min, bbox.z_max}) {
+    writer.write(value);
+  }
+
+  writer.write(static_cast<uint32_t>(config.camera_infos.size()));
+  for (const auto& p : config.camera_infos) {
+    writer.write_string(p.first);
+    write_camera_info(writer, p.second);
+  }
+
+  writer.write(static_cast<uint32_t>(config.transforms.size()));
+  for (const auto& tx : config.transforms) {
+    write_transform(writer, tx);
+  }
+
+  const auto tmp_path = (path + ".tmp");
+  {
+    std::ofstream ofs(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!ofs.good()) {
+      return false;
+    }
+    ofs.write(CACHE_MAGIC, CACHE_MAGIC_SIZE);
+    const auto& buffer = writer.get_buffer();
+    ofs.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+
+    ofs.close();
+    if (ofs.fail()) {
+      std::remove(tmp_path.c_str());
+      return false;
+    }
+  }
+
+  // replace the old cache in one step so that readers never see a partial file
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    std::remove(tmp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+boost::optional<SensorConfig> load_sensor_config(const std::string& path,
+                                                 uint64_t key) {
+  std::vector<uint8_t> bytes;
+  if (!get_file_as_bytes(path, bytes) || (bytes.size() < CACHE_MAGIC_SIZE) ||
+      (std::memcmp(bytes.data(), CACHE_MAGIC, CACHE_MAGIC_SIZE) != 0)) {
+    return boost::none;
+  }
+
+  BinaryReader reader(bytes);
+  reader.skip(CACHE_MAGIC_SIZE);
+
+  uint64_t cached_key = 0;
+  if (!reader.read(cached_key) || (cached_key != key)) {
+    return boost::none;
+  }
+
+  SensorConfig config;
+  auto& bbox = config.ego_bbox;
+  reader.read(bbox.x_min);
+  reader.read(bbox.x_max);
+  reader.read(bbox.y_min);
+  reader.read(bbox.y_max);
+  reader.read(bbox.z_min);
+  reader.read(bbox.z_max);
+
+  uint32_t num_cameras = 0;
+  reader.read(num_cameras);
+  for (uint32_t i = 0; reader.ok() && (i < num_cameras); ++i) {
+    std::string name;
+    sensor_msgs::CameraInfo info;
+    if (reader.read_string(name) && read_camera_info(reader, info)) {
+      config.camera_infos[name] = info;
+    }
+  }
+
+  uint32_t num_transforms = 0;
+  reader.read(num_transforms);
+  for (uint32_t i = 0; reader.ok() && (i < num_transforms); ++i) {
+    geometry_msgs::TransformStamped tx;
+    if (read_transform(reader, tx)) {
+      config.transforms.push_back(tx);
+    }
+  }
+
+  // a short or overlong file is not trusted at all
+  if (!reader.ok() || (reader.remaining() != 0)) {
+    return boost::none;
+  }
+  return config;
+}
+
+//------------------------------------------------------------------------------
+
+boost::optional<SensorConfig> get_sensor_config(
+    const std::string& config_path, const std::string& schema_path,
+    bool use_cache) {
+  std::vector<uint8_t> config_bytes;
+  if (!get_file_as_bytes(config_path, config_bytes) || config_bytes.empty()) {
+    X_ERROR("Could not open '" << config_path << "'");
+    return boost::none;
+  }
+  std::vector<uint8_t> schema_bytes;
+  if (!get_file_as_bytes(schema_path, schema_bytes) || schema_bytes.empty()) {
+    X_ERROR("Could not open '" << schema_path << "'");
+    return boost::none;
+  }
+
+  // the cache is only valid for the JSON and the schema it was validated with
+  const auto key = fnv1a_hash(
+      schema_bytes.data(), schema_bytes.size(),
+      fnv1a_hash(config_bytes.data(), config_bytes.size()));
+  const auto cache_path =
+      (boost::filesystem::path(config_path).parent_path() /
+       SensorConfig::CACHE_FILENAME)
+          .string();
+  if (use_cache) {
+    auto config_opt = load_sensor_config(cache_path, key);
+    if (config_opt) {
+      X_INFO("Loaded sensor config from cache: " << cache_path);
+      return config_opt;
+    }
+  }
+
+  rapidjson::Document config_d;
+  if (config_d
+          .Parse(reinterpret_cast<const char*>(config_bytes.data()),
+                 config_bytes.size())
+          .HasParseError()) {
+    X_ERROR("Could not parse '" << config_path << "'");
+    return boost::none;
+  }
+  rapidjson::Document schema_d;
+  if (schema_d
+          .Parse(reinterpret_cast<const char*>(schema_bytes.data()),
+                 schema_bytes.size())
+          .HasParseError()) {
+    X_ERROR("Could not parse '" << schema_path << "'");
+    return boost::none;
+  }
+
+  {
+    rapidjson::SchemaDocument schema(schema_d);
+    rapidjson::SchemaValidator validator(schema);
+    if (!config_d.Accept(validator)) {
+      X_ERROR(get_validator_error_string(validator));
+      return boost::none;
+    }
+    X_INFO("Validated: " << config_path);
+  }
+
+  SensorConfig config;
+  if (!build_sensor_config(config_d, config)) {
+    return boost::none;
+  }
+
+  if (use_cache) {
+    if (save_sensor_config(cache_path, key, config)) {
+      X_INFO("Updated sensor config cache: " << cache_path);
+    } else {
+      X_WARN("Failed to write sensor config cache: " << cache_path);
+    }
+  }
+  return config;
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
@@ -23,8 +23,42 @@
  */
 #include "a2d2_to_ros/transform_utils.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 #include "a2d2_to_ros/checks.hpp"
 
+namespace {
+
+/** @brief Order angle samples by time. */
+bool sample_less(const a2d2_to_ros::AngleSample& lhs,
+                 const a2d2_to_ros::AngleSample& rhs) {
+  return (lhs.time < rhs.time);
+}
+
+/**
+ * @brief Interpolate a sorted signal linearly at a time.
+ * @pre samples[0].time <= time <= samples.back().time, and idx is the index of
+ * a sample at or before the time; it is advanced as far as it can be, so that a
+ * signal can be interpolated at increasing times in a single pass.
+ */
+double interpolate(const std::vector<a2d2_to_ros::AngleSample>& samples,
+                   size_t& idx, uint64_t time) {
+  while (((idx + 1) < samples.size()) && (samples[idx + 1].time <= time)) {
+    ++idx;
+  }
+  const auto& lhs = samples[idx];
+  if ((lhs.time == time) || ((idx + 1) == samples.size())) {
+    return lhs.angle;
+  }
+  const auto& rhs = samples[idx + 1];
+  const auto t = (static_cast<double>(time - lhs.time) /
+                  static_cast<double>(rhs.time - lhs.time));
+  return (lhs.angle + (t * (rhs.angle - lhs.angle)));
+}
+
+}  // namespace
+
 namespace a2d2_to_ros {
 
 //------------------------------------------------------------------------------
@@ -59,4 +93,81 @@ Eigen::Affine3d Tx_global_sensor(const Eigen::Matrix3d& basis,
 
 //------------------------------------------------------------------------------
 
+boost::optional<uint64_t> sort_angle_samples(
+    std::vector<AngleSample>& samples) {
+  if (!std::is_sorted(std::begin(samples), std::end(samples), sample_less)) {
+    std::stable_sort(std::begin(samples), std::end(samples), sample_less);
+  }
+  const auto it = std::adjacent_find(
+      std::begin(samples), std::end(samples),
+      [](const AngleSample& lhs, const AngleSample& rhs) {
+        return (lhs.time == rhs.time);
+      });
+  if (it != std::end(samples)) {
+    return it->time;
+  }
+  return boost::none;
+}
+
+//------------------------------------------------------------------------------
+
+boost::optional<uint64_t> join_chassis_angles(
+    const std::vector<AngleSample>& roll, const std::vector<AngleSample>& pitch,
+    std::vector<ChassisAngles>& angles) {
+  angles.clear();
+  angles.reserve(std::min(roll.size(), pitch.size()));
+  size_t i = 0;
+  size_t j = 0;
+  while ((i < roll.size()) && (j < pitch.size())) {
+    if (roll[i].time != pitch[j].time) {
+      return std::min(roll[i].time, pitch[j].time);
+    }
+    angles.push_back({roll[i].time, roll[i].angle, pitch[j].angle});
+    ++i;
+    ++j;
+  }
+  if (i < roll.size()) {
+    return roll[i].time;
+  }
+  if (j < pitch.size()) {
+    return pitch[j].time;
+  }
+  return boost::none;
+}
+
+//------------------------------------------------------------------------------
+
+void resample_chassis_angles(const std::vector<AngleSample>& roll,
+                             const std::vector<AngleSample>& pitch,
+                             double rate, std::vector<ChassisAngles>& angles) {
+  angles.clear();
+  if (roll.empty() || pitch.empty()) {
+    return;
+  }
+  const auto begin = std::max(roll.front().time, pitch.front().time);
+  const auto end = std::min(roll.back().time, pitch.back().time);
+  if (begin > end) {
+    return;
+  }
+
+  // A2D2 timestamps are in microseconds; offsets are rounded from the index so
+  // that the period does not drift
+  const auto period = (1e6 / rate);
+  angles.reserve(
+      static_cast<size_t>(static_cast<double>(end - begin) / period) + 1);
+  size_t roll_idx = 0;
+  size_t pitch_idx = 0;
+  for (size_t k = 0;; ++k) {
+    const auto offset = std::llround(static_cast<double>(k) * period);
+    const auto time = (begin + static_cast<uint64_t>(offset));
+    if (time > end) {
+      break;
+    }
+    angles.push_back({time, interpolate(roll, roll_idx, time),
+                      interpolate(pitch, pitch_idx, time)});
+  }
+}
+
+//------------------------------------------------------------------------------
+
 }  // namespace a2d2_to_ros
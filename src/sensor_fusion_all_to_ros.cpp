@@ -0,0 +1,1012 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/filesystem/convenience.hpp>  // TODO(jeff): use std::filesystem in C++17
+#include <boost/optional.hpp>
+#include <boost/program_options.hpp>
+
+#include <ros/ros.h>
+#include <rosbag/bag.h>
+#include <sensor_msgs/CameraInfo.h>
+#include <sensor_msgs/CompressedImage.h>
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/PointCloud2.h>
+
+#include "a2d2_to_ros/bag_utils.hpp"
+#include "a2d2_to_ros/checkpoint.hpp"
+#include "a2d2_to_ros/converters.hpp"
+#include "a2d2_to_ros/dry_run.hpp"
+#include "a2d2_to_ros/frame_index.hpp"
+#include "a2d2_to_ros/json_utils.hpp"
+#include "a2d2_to_ros/lib_a2d2_to_ros.hpp"
+#include "a2d2_to_ros/log_build_options.hpp"
+#include "a2d2_to_ros/logger.hpp"
+#include "a2d2_to_ros/logging.hpp"
+#include "a2d2_to_ros/manifest.hpp"
+#include "a2d2_to_ros/message_sink.hpp"
+#include "a2d2_to_ros/parallel.hpp"
+#include "a2d2_to_ros/prefetch.hpp"
+#include "a2d2_to_ros/run_stats.hpp"
+#include "a2d2_to_ros/sensor_config.hpp"
+
+namespace {
+namespace a2d2 = a2d2_to_ros;
+namespace po = boost::program_options;
+}  // namespace
+
+///
+/// Program constants and defaults.
+///
+
+static constexpr auto _PROGRAM_OPTIONS_LINE_LENGTH = 120u;
+static constexpr auto _CLOCK_TOPIC = "/clock";
+static constexpr auto _OUTPUT_PATH = ".";
+static constexpr auto _NODE_NAME = "a2d2_converter";
+static constexpr auto _DATASET_NAMESPACE = "/a2d2";
+static constexpr auto _CAMERA_SUFFIX = "camera";
+static constexpr auto _LIDAR_SUFFIX = "lidar";
+static constexpr auto _MERGED_SUFFIX = "camera_lidar";
+static constexpr auto _DEPTH_MAP_SUFFIX = "depth_map";
+static constexpr auto _SENSOR_CONFIG_FILENAME = "cams_lidars.json";
+static constexpr auto _SENSOR_CONFIG_CACHE = true;
+static constexpr auto _BAG_LAYOUT = "merged";
+static constexpr auto _INCLUDE_CLOCK_TOPIC = false;
+static constexpr auto _CLOCK_RATE = 0.0;
+static constexpr auto _INCLUDE_DEPTH_MAP = false;
+static constexpr auto _COMPRESSED = false;
+static constexpr auto _FIELDS = "all";
+static constexpr auto _VERBOSE = false;
+static constexpr auto _LOG_LEVEL = "info";
+static constexpr auto _PROGRESS = 0u;
+static constexpr auto _START_TIME = static_cast<uint64_t>(0);
+static constexpr auto _MIN_TIME_OFFSET = 0.0;
+static constexpr auto _DURATION = std::numeric_limits<double>::max();
+static constexpr auto _SPLIT_DURATION = 0.0;
+static constexpr auto _CHECKPOINT_INTERVAL = 0.0;
+static constexpr auto _RESUME = false;
+static constexpr auto _COMPRESSION = "none";
+static constexpr auto _CHUNK_THRESHOLD =
+    a2d2_to_ros::BagOptions::DEFAULT_CHUNK_THRESHOLD;
+static constexpr auto _SINK = "bag";
+static constexpr auto _PUBLISH_SPEED = 1.0;
+static constexpr auto _VALIDATION = "full";
+static constexpr auto _FRAME_INDEX = true;
+static constexpr auto _JOBS = 1u;
+static constexpr auto _PREFETCH =
+    static_cast<unsigned>(a2d2_to_ros::PrefetchOptions::DEFAULT_DEPTH);
+static constexpr auto _PREFETCH_MEMORY = static_cast<unsigned>(
+    a2d2_to_ros::PrefetchOptions::DEFAULT_MAX_BYTES / (1024 * 1024));
+static constexpr auto _DRY_RUN = false;
+static constexpr auto _DRY_RUN_SAMPLES = 16u;
+
+int main(int argc, char* argv[]) {
+  X_INFO("<Camera + Lidar Converter>");
+  BUILD_INFO;  // just write to log what build options were specified
+
+  ///
+  /// Set up command line arguments
+  ///
+
+  boost::optional<std::string> camera_path_opt;
+  boost::optional<std::string> lidar_path_opt;
+  boost::optional<std::string> camera_frame_schema_path_opt;
+  boost::optional<std::string> sensor_config_path_opt;
+  boost::optional<std::string> sensor_config_schema_path_opt;
+  boost::optional<std::string> stats_json_path_opt;
+  po::options_description desc(
+      "Convert the camera and lidar data of one sensor (e.g., "
+      "cam_front_center) to rosbag for the A2D2 Sensor Fusion data set in a "
+      "single pass. The sensor config and the frame info files are read only "
+      "once for both. See README.md for details.\nAvailable options are "
+      "listed below. Arguments without default values are required",
+      _PROGRAM_OPTIONS_LINE_LENGTH);
+  desc.add_options()("help,h", "Print help and exit.")(
+      "camera-data-path,c", po::value(&camera_path_opt)->required(),
+      "Path to the camera data files.")(
+      "lidar-data-path,l", po::value(&lidar_path_opt)->required(),
+      "Path to the lidar data files of the same sensor.")(
+      "frame-info-schema-path,f",
+      po::value(&camera_frame_schema_path_opt)->required(),
+      "Path to the JSON schema for camera frame info files.")(
+      "sensor-config-path,p", po::value(&sensor_config_path_opt)->required(),
+      "Path to the JSON for vehicle/sensor config.")(
+      "sensor-config-schema-path,s",
+      po::value(&sensor_config_schema_path_opt)->required(),
+      "Path to the JSON schema for the vehicle/sensor config.")(
+      "bag-layout", po::value<std::string>()->default_value(_BAG_LAYOUT),
+      "Optional: Either 'merged' (write camera and lidar messages to a single "
+      "'<basename>_camera_lidar.bag') or 'modality' (write the same bags as "
+      "the camera and lidar converters).")(
+      "include-clock-topic,t",
+      po::value<bool>()->default_value(_INCLUDE_CLOCK_TOPIC),
+      "Optional: Use timestamps from the data to write a /clock topic.")(
+      "clock-rate", po::value<double>()->default_value(_CLOCK_RATE),
+      "Optional: Maximum rate (Hz) of /clock messages. A message is written "
+      "for every unique timestamp if this is 0.")(
+      "start-time,a", po::value<uint64_t>()->default_value(_START_TIME),
+      "Optional: Start on or after this time.")(
+      "min-time-offset,m", po::value<double>()->default_value(_MIN_TIME_OFFSET),
+      "Optional: Seconds to skip ahead in the data before starting the bag.")(
+      "duration,d", po::value<double>()->default_value(_DURATION),
+      "Optional: Seconds after min-time-offset to include in bag file.")(
+      "split-duration", po::value<double>()->default_value(_SPLIT_DURATION),
+      "Optional: Seconds of data to write to each bag file before starting a "
+      "new one in a 'timespan_<start>s_<end>s' subdirectory of the output "
+      "path. Splitting is disabled if this is 0.")(
+      "checkpoint-interval",
+      po::value<double>()->default_value(_CHECKPOINT_INTERVAL),
+      "Optional: Seconds of data to write between checkpoints, which are "
+      "saved to a '<bag filename>.checkpoint' file in the output path, so "
+      "that an interrupted run can be continued with --resume. Checkpoints "
+      "are disabled if this is 0.")(
+      "resume", po::value<bool>()->default_value(_RESUME),
+      "Optional: Continue from the checkpoint of an interrupted run with the "
+      "same inputs and options, instead of starting over. Starts from the "
+      "first frame if there is no checkpoint.")(
+      "compression", po::value<std::string>()->default_value(_COMPRESSION),
+      "Optional: Compression of the bag file chunks. One of 'none', 'bz2', or "
+      "'lz4'. Compressed chunks are written on a background thread.")(
+      "chunk-threshold",
+      po::value<uint32_t>()->default_value(_CHUNK_THRESHOLD),
+      "Optional: Bytes of messages to buffer before a chunk is written (and "
+      "compressed).")(
+      "output-path,o", po::value<std::string>()->default_value(_OUTPUT_PATH),
+      "Optional: Path for the output bag file(s).")(
+      "sink", po::value<std::string>()->default_value(_SINK),
+      "Optional: Where to write the messages. One of 'bag' (bag files in the "
+      "output path) or 'topics' (publish them to a running ROS master, paced "
+      "by their stamps).")(
+      "publish-speed", po::value<double>()->default_value(_PUBLISH_SPEED),
+      "Optional: Factor of real time to publish at with '--sink topics', e.g., "
+      "2 for twice as fast as recorded. Messages are published as fast as "
+      "possible if this is 0.")(
+      "validation", po::value<std::string>()->default_value(_VALIDATION),
+      "Optional: Schema validation of the camera frame info files. One of "
+      "'full' (validate every file), 'sample:N' (validate only the first N "
+      "files), or 'none'.")(
+      "frame-index", po::value<bool>()->default_value(_FRAME_INDEX),
+      "Optional: Cache frame timestamps in a '.a2d2_index' file in the camera "
+      "data directory, so that later runs do not need to read the frame info "
+      "files again.")(
+      "jobs", po::value<unsigned>()->default_value(_JOBS),
+      "Optional: Number of frames to convert in parallel. Use 0 to convert "
+      "one frame per hardware thread.")(
+      "prefetch", po::value<unsigned>()->default_value(_PREFETCH),
+      "Optional: Number of frames (PNG and npz files, and frame info files "
+      "that are not in the frame index) to read into memory ahead of their "
+      "conversion on background threads. Use 0 to read each file when it is "
+      "converted.")(
+      "prefetch-memory",
+      po::value<unsigned>()->default_value(_PREFETCH_MEMORY),
+      "Optional: Megabytes of files that may be held in memory after they are "
+      "prefetched.")(
+      "sensor-config-cache",
+      po::value<bool>()->default_value(_SENSOR_CONFIG_CACHE),
+      "Optional: Cache what is built from the vehicle/sensor config in a "
+      "'.a2d2_sensor_config' file next to it, so that later runs do not need "
+      "to parse and validate it again. The cache is rebuilt when the config "
+      "or its schema changes.")(
+      "compressed", po::value<bool>()->default_value(_COMPRESSED),
+      "Optional: Write the original PNG data as CompressedImage messages on "
+      "'<topic>/compressed' instead of decoding it to raw Image messages.")(
+      "fields", po::value<std::string>()->default_value(_FIELDS),
+      "Optional: Comma separated point cloud fields to write, as for the "
+      "lidar converter.")(
+      "include-depth-map,i",
+      po::value<bool>()->default_value(_INCLUDE_DEPTH_MAP),
+      "Optional: Publish a depth map version of the lidar data, as for the "
+      "lidar converter.")(
+      "dry-run", po::value<bool>()->default_value(_DRY_RUN),
+      "Optional: Convert only a sample of the frames, without writing "
+      "anything, and log the projected size of each bag (and of each split "
+      "window), the time the run would take, and the memory it would need. "
+      "With --stats-json, the projection is written there instead of the run "
+      "report.")(
+      "dry-run-samples",
+      po::value<unsigned>()->default_value(_DRY_RUN_SAMPLES),
+      "Optional: Number of frames to convert in a dry run, evenly spaced over "
+      "the selected frames.")(
+      "stats-json", po::value(&stats_json_path_opt),
+      "Optional: Write a JSON report of this run to this path, as for the "
+      "lidar converter.")(
+      "log-level", po::value<std::string>()->default_value(_LOG_LEVEL),
+      "Optional: Least severe messages to log. One of 'debug', 'info', "
+      "'warn', 'error', or 'fatal'.")(
+      "progress", po::value<unsigned>()->default_value(_PROGRESS),
+      "Optional: Log a progress line, with the rate, every this many frames. "
+      "Progress is not logged if this is 0.")(
+      "verbose,v", po::value<bool>()->default_value(_VERBOSE),
+      "Optional: Show name of each file after it is processed.");
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+
+  const auto help_requested = vm.count("help");
+  if (help_requested) {
+    std::cout << desc << "\n";
+    return EXIT_SUCCESS;
+  }
+
+  try {
+    po::notify(vm);
+  } catch (boost::program_options::required_option& e) {
+    std::cerr << "Ensure that all required options are specified: " << e.what()
+              << "\n\n";
+    std::cerr << desc << "\n";
+    return EXIT_FAILURE;
+  }
+
+  const auto log_level_opt =
+      a2d2::logging::get_level(vm["log-level"].as<std::string>());
+  if (!log_level_opt) {
+    X_FATAL("Log level '" << vm["log-level"].as<std::string>()
+                          << "' is not valid. It must be one of 'debug', "
+                             "'info', 'warn', 'error', or 'fatal'.");
+    return EXIT_FAILURE;
+  }
+  a2d2::logging::set_level(*log_level_opt);
+
+  ///
+  /// Get commandline parameters
+  ///
+
+  const auto camera_path = *camera_path_opt;
+  const auto lidar_path = *lidar_path_opt;
+  const auto camera_frame_schema_path = *camera_frame_schema_path_opt;
+  const auto sensor_config_path =
+      *sensor_config_path_opt + "/" + _SENSOR_CONFIG_FILENAME;
+  const auto sensor_config_schema_path = *sensor_config_schema_path_opt;
+  const auto output_path = vm["output-path"].as<std::string>();
+  const auto verbose = vm["verbose"].as<bool>();
+  const auto progress_interval = vm["progress"].as<unsigned>();
+  const auto include_clock_topic = vm["include-clock-topic"].as<bool>();
+  const auto clock_rate = vm["clock-rate"].as<double>();
+  const auto include_depth_map = vm["include-depth-map"].as<bool>();
+  const auto compressed = vm["compressed"].as<bool>();
+  const auto start_time = vm["start-time"].as<uint64_t>();
+  const auto min_time_offset = vm["min-time-offset"].as<double>();
+  const auto duration = vm["duration"].as<double>();
+  const auto split_duration = vm["split-duration"].as<double>();
+  const auto checkpoint_interval = vm["checkpoint-interval"].as<double>();
+  const auto resume = vm["resume"].as<bool>();
+  const auto publish_speed = vm["publish-speed"].as<double>();
+  const auto use_frame_index = vm["frame-index"].as<bool>();
+  const auto use_sensor_config_cache = vm["sensor-config-cache"].as<bool>();
+  const auto num_jobs = a2d2::get_num_jobs(vm["jobs"].as<unsigned>());
+  const auto dry_run = vm["dry-run"].as<bool>();
+  const auto dry_run_samples = vm["dry-run-samples"].as<unsigned>();
+  a2d2::PrefetchOptions prefetch_options;
+  prefetch_options.depth = vm["prefetch"].as<unsigned>();
+  prefetch_options.max_bytes =
+      (static_cast<size_t>(vm["prefetch-memory"].as<unsigned>()) * 1024 * 1024);
+
+  // stages are only timed if a report was requested
+  a2d2::RunStats stats(static_cast<bool>(stats_json_path_opt));
+
+  const auto bag_layout = vm["bag-layout"].as<std::string>();
+  if ((bag_layout != "merged") && (bag_layout != "modality")) {
+    X_FATAL("Bag layout '" << bag_layout
+                           << "' is not valid. It must be 'merged' or "
+                              "'modality'.");
+    return EXIT_FAILURE;
+  }
+  const auto merged = (bag_layout == "merged");
+
+  const auto valid_min_offset = (std::isfinite(min_time_offset) &&
+                                 a2d2::strictly_non_negative(min_time_offset));
+  const auto valid_duration =
+      (std::isfinite(duration) && a2d2::strictly_non_negative(duration));
+  const auto valid_split_duration =
+      (std::isfinite(split_duration) &&
+       a2d2::strictly_non_negative(split_duration));
+  if (!valid_min_offset || !valid_duration || !valid_split_duration) {
+    X_FATAL(
+        "Time constraints {min-time-offset: "
+        << min_time_offset << ", duration: " << duration
+        << ", split-duration: " << split_duration
+        << "} are not valid. They must be finite, real valued, and >= 0.0.");
+    return EXIT_FAILURE;
+  }
+  if (!std::isfinite(clock_rate) || !a2d2::strictly_non_negative(clock_rate)) {
+    X_FATAL("Clock rate " << clock_rate
+                          << " is not valid. It must be finite and >= 0.0.");
+    return EXIT_FAILURE;
+  }
+  if (!std::isfinite(checkpoint_interval) ||
+      !a2d2::strictly_non_negative(checkpoint_interval)) {
+    X_FATAL("Checkpoint interval "
+            << checkpoint_interval
+            << " is not valid. It must be finite and >= 0.0.");
+    return EXIT_FAILURE;
+  }
+
+  const auto compression_opt =
+      a2d2::get_compression_type(vm["compression"].as<std::string>());
+  if (!compression_opt) {
+    X_FATAL("Compression '" << vm["compression"].as<std::string>()
+                            << "' is not valid. It must be one of 'none', "
+                               "'bz2', or 'lz4'.");
+    return EXIT_FAILURE;
+  }
+  const auto chunk_threshold = vm["chunk-threshold"].as<uint32_t>();
+  if (chunk_threshold == 0) {
+    X_FATAL("Chunk threshold must be > 0.");
+    return EXIT_FAILURE;
+  }
+  a2d2::BagOptions bag_options;
+  bag_options.compression = *compression_opt;
+  bag_options.chunk_threshold = chunk_threshold;
+
+  const auto sink_opt = a2d2::get_sink_type(vm["sink"].as<std::string>());
+  if (!sink_opt) {
+    X_FATAL("Sink '" << vm["sink"].as<std::string>()
+                     << "' is not valid. It must be one of 'bag' or 'topics'.");
+    return EXIT_FAILURE;
+  }
+  if (!std::isfinite(publish_speed) ||
+      !a2d2::strictly_non_negative(publish_speed)) {
+    X_FATAL("Publish speed " << publish_speed
+                             << " is not valid. It must be finite and >= 0.0.");
+    return EXIT_FAILURE;
+  }
+  const auto publish = (*sink_opt == a2d2::SinkType::TOPICS);
+  if (publish && (resume || a2d2::strictly_positive(checkpoint_interval))) {
+    X_FATAL("Checkpoints and resuming only apply to bag files, not topics.");
+    return EXIT_FAILURE;
+  }
+  if (dry_run && (publish || resume)) {
+    X_FATAL("Dry runs only apply to new bag files, not topics or resuming.");
+    return EXIT_FAILURE;
+  }
+  if (dry_run_samples == 0) {
+    X_FATAL("Dry run samples must be > 0.");
+    return EXIT_FAILURE;
+  }
+
+  const auto point_layout_opt =
+      a2d2::get_point_layout(vm["fields"].as<std::string>());
+  if (!point_layout_opt) {
+    X_FATAL("Fields '" << vm["fields"].as<std::string>()
+                       << "' are not valid. Each field must be known and "
+                          "appear only once, and 'all' must appear alone.");
+    return EXIT_FAILURE;
+  }
+  const auto point_layout = *point_layout_opt;
+
+  const auto validation_policy_opt =
+      a2d2::get_validation_policy(vm["validation"].as<std::string>());
+  if (!validation_policy_opt) {
+    X_FATAL("Validation policy '"
+            << vm["validation"].as<std::string>()
+            << "' is not valid. It must be 'full', 'sample:N', or 'none'.");
+    return EXIT_FAILURE;
+  }
+  const auto& validation_policy = *validation_policy_opt;
+
+  ///
+  /// Get the vehicle/sensor config, once for both the camera info messages and
+  /// the depth maps
+  ///
+
+  const auto sensor_config_opt = a2d2::get_sensor_config(
+      sensor_config_path, sensor_config_schema_path, use_sensor_config_cache);
+  if (!sensor_config_opt) {
+    X_FATAL("Could not get the vehicle/sensor config from: "
+            << sensor_config_path);
+    return EXIT_FAILURE;
+  }
+
+  // the lidar converter keeps the buffers of written depth maps for reuse
+  const a2d2::CameraFrameConverter camera_converter(
+      compressed, sensor_config_opt->camera_infos, stats);
+  a2d2::LidarFrameConverter::Options lidar_options;
+  lidar_options.layout = point_layout;
+  lidar_options.include_depth_map = include_depth_map;
+  const a2d2::LidarFrameConverter lidar_converter(
+      lidar_options, sensor_config_opt->camera_infos, stats);
+
+  boost::filesystem::path d(camera_path);
+  const auto timestamp = d.parent_path().parent_path().filename().string();
+
+  const auto file_basename =
+      (timestamp + "_" + boost::filesystem::basename(camera_path));
+
+  ///
+  /// Pair up the .png and .npz files by the name of their camera frame
+  ///
+
+  struct Frame {
+    std::string camera_basename;
+    std::string info_path;
+    std::string sensor_name;
+    std::string png_path;
+    std::string npz_path;
+    uint64_t timestamp;
+    ros::Time stamp;
+    double time_since_begin;
+  };  // struct Frame
+
+  a2d2::ScopedStageTimer scan_timer(stats, a2d2::Stage::SCAN);
+  // each directory is listed once, and files are paired by sequence number
+  std::map<std::string, Frame> frames_by_name;
+  {
+    auto camera_files_opt = a2d2::list_directory(camera_path);
+    auto lidar_files_opt = a2d2::list_directory(lidar_path);
+    if (!camera_files_opt || !lidar_files_opt) {
+      X_FATAL("Could not open the camera or lidar data directory.");
+      return EXIT_FAILURE;
+    }
+    const auto& json_paths = (*camera_files_opt)[".json"];
+    const auto png_manifest_opt =
+        a2d2::build_manifest((*camera_files_opt)[".png"], json_paths);
+    const auto npz_manifest_opt =
+        a2d2::build_manifest((*lidar_files_opt)[".npz"], json_paths);
+    if (!png_manifest_opt || !npz_manifest_opt) {
+      X_FATAL("Failed to match camera and lidar files to frame info files. "
+              "Cannot continue.");
+      return EXIT_FAILURE;
+    }
+
+    const auto add_entry =
+        [&frames_by_name](const a2d2::ManifestEntry& entry) -> Frame& {
+      auto& frame = frames_by_name[entry.info_basename];
+      frame.info_path = entry.info_path;
+      frame.sensor_name = entry.sensor_name;
+      return frame;
+    };
+    for (const auto& entry : *png_manifest_opt) {
+      add_entry(entry).png_path = entry.data_path;
+    }
+    for (const auto& entry : *npz_manifest_opt) {
+      add_entry(entry).npz_path = entry.data_path;
+    }
+  }
+  scan_timer.stop();
+
+  ///
+  /// Get the JSON schema for the camera frame info files
+  ///
+
+  auto d_camera_frame_schema_opt =
+      a2d2::get_rapidjson_dom(camera_frame_schema_path);
+  if (!d_camera_frame_schema_opt) {
+    X_FATAL("Could not open '" << camera_frame_schema_path);
+    return EXIT_FAILURE;
+  }
+  auto& camera_frame_d = *d_camera_frame_schema_opt;
+  rapidjson::SchemaDocument camera_frame_schema(camera_frame_d);
+
+  ///
+  /// Get the timestamp of each frame, either from the frame index or from its
+  /// frame info file. Camera and lidar data share the same frame info file, so
+  /// each one is read at most once.
+  ///
+
+  auto frame_index = (use_frame_index ? a2d2::FrameIndex::load(camera_path)
+                                      : a2d2::FrameIndex());
+
+  // the frame info files that are not in the index are read ahead, in order
+  std::vector<std::string> camera_data_files;
+  for (const auto& p : frames_by_name) {
+    if (!frame_index.get_timestamp(p.first)) {
+      camera_data_files.push_back(p.second.info_path);
+    }
+  }
+  a2d2::FilePrefetcher json_prefetcher(camera_data_files, prefetch_options);
+
+  a2d2::FrameTimestampReader timestamp_reader(camera_frame_schema);
+  size_t file_idx = 0;
+  std::vector<uint8_t> json_bytes;
+  std::vector<Frame> frames;
+  frames.reserve(frames_by_name.size());
+  for (auto& p : frames_by_name) {
+    const auto& b = p.first;
+    auto frame_timestamp_opt = frame_index.get_timestamp(b);
+    if (!frame_timestamp_opt) {
+      const auto& camera_data_file = camera_data_files[file_idx];
+      a2d2::ScopedStageTimer read_timer(stats, a2d2::Stage::JSON_READ);
+      const auto read = json_prefetcher.take(file_idx, json_bytes);
+      read_timer.stop();
+      if (!read || json_bytes.empty()) {
+        X_FATAL("'" << camera_data_file << "' failed to open or is empty.");
+        return EXIT_FAILURE;
+      }
+      stats.add_bytes_in(json_bytes.size());
+      // the text is parsed in place, which needs it to be null-terminated
+      json_bytes.push_back('\0');
+
+      const auto validate = validation_policy.should_validate(file_idx++);
+      a2d2::ScopedStageTimer parse_timer(
+          stats,
+          (validate ? a2d2::Stage::JSON_VALIDATE : a2d2::Stage::JSON_PARSE));
+      frame_timestamp_opt = timestamp_reader.read_insitu(
+          reinterpret_cast<char*>(json_bytes.data()), validate);
+      parse_timer.stop();
+      if (!frame_timestamp_opt) {
+        X_FATAL("'" << camera_data_file << "': "
+                    << timestamp_reader.get_error_string());
+        return EXIT_FAILURE;
+      }
+      if (verbose && validate) {
+        X_INFO("Validated: " << camera_data_file);
+      }
+      frame_index.set_timestamp(b, *frame_timestamp_opt);
+    }
+
+    auto& frame = p.second;
+    frame.camera_basename = b;
+    frame.timestamp = *frame_timestamp_opt;
+    frames.push_back(std::move(frame));
+  }
+  frames_by_name.clear();
+
+  if (use_frame_index && frame_index.is_modified()) {
+    if (frame_index.save(camera_path)) {
+      X_INFO("Updated frame index in: " << camera_path);
+    } else {
+      X_WARN("Failed to write frame index to: " << camera_path);
+    }
+  }
+
+  ///
+  /// Select the frames that fall in the requested timespan
+  ///
+
+  // the bag writer consumes frames in order, so make that order chronological
+  std::stable_sort(std::begin(frames), std::end(frames),
+                   [](const Frame& lhs, const Frame& rhs) {
+                     return (lhs.timestamp < rhs.timestamp);
+                   });
+
+  boost::optional<ros::Time> first_time;
+  {
+    std::vector<uint64_t> timestamps;
+    timestamps.reserve(frames.size());
+    for (const auto& frame : frames) {
+      timestamps.push_back(frame.timestamp);
+    }
+
+    const auto window = a2d2::get_frame_window(timestamps, start_time,
+                                               min_time_offset, duration);
+    frames.erase(std::begin(frames) + window.end, std::end(frames));
+    frames.erase(std::begin(frames), std::begin(frames) + window.begin);
+    first_time = window.first_time;
+  }
+
+  for (auto& frame : frames) {
+    frame.stamp = a2d2::a2d2_timestamp_to_ros_time(frame.timestamp);
+    frame.time_since_begin = (frame.stamp - *first_time).toSec();
+  }
+
+  ///
+  /// Skip the frames that an interrupted run already wrote, if resuming
+  ///
+
+  const auto get_bag_name = [&file_basename](const char* suffix) {
+    return (file_basename + "_" + std::string(suffix) + ".bag");
+  };
+
+  // one checkpoint covers the bag(s) of either layout
+  const auto checkpoint_path = (output_path + "/" +
+                                get_bag_name(_MERGED_SUFFIX) +
+                                a2d2::Checkpoint::FILENAME_SUFFIX);
+
+  // every option that the bags depend on, along with the selected frames
+  std::stringstream settings;
+  settings.precision(std::numeric_limits<double>::max_digits10);
+  settings << start_time << " " << min_time_offset << " " << duration << " "
+           << split_duration << " " << vm["compression"].as<std::string>()
+           << " " << chunk_threshold << " " << include_clock_topic << " "
+           << clock_rate << " " << vm["fields"].as<std::string>() << " "
+           << include_depth_map << " " << compressed << " " << bag_layout;
+  std::vector<std::string> frame_paths;
+  for (const auto& frame : frames) {
+    frame_paths.push_back(frame.png_path);
+    frame_paths.push_back(frame.npz_path);
+  }
+  const auto checkpoint_key =
+      a2d2::get_checkpoint_key(settings.str(), frame_paths);
+
+  ///
+  /// In a dry run, keep the offsets of all frames to project the bag(s) from,
+  /// but only convert a sample of them
+  ///
+
+  a2d2::DryRun estimator(min_time_offset, split_duration);
+  size_t dry_run_lane = 0;
+  if (dry_run) {
+    std::vector<double> frame_offsets;
+    for (const auto& frame : frames) {
+      frame_offsets.push_back(frame.time_since_begin);
+    }
+    std::vector<std::string> bag_names;
+    if (merged) {
+      bag_names.push_back(get_bag_name(_MERGED_SUFFIX));
+    } else {
+      bag_names.push_back(get_bag_name(_CAMERA_SUFFIX));
+      bag_names.push_back(get_bag_name(_LIDAR_SUFFIX));
+    }
+    dry_run_lane = estimator.add_lane(std::move(frame_offsets),
+                                      (2 * num_jobs), std::move(bag_names));
+
+    std::vector<Frame> samples;
+    for (const auto idx :
+         a2d2::get_sample_indices(frames.size(), dry_run_samples)) {
+      samples.push_back(frames[idx]);
+    }
+    frames = std::move(samples);
+  }
+
+  size_t resumed_frames = 0;
+  boost::optional<a2d2::Checkpoint> checkpoint_opt;
+  if (resume) {
+    checkpoint_opt = a2d2::get_resume_checkpoint(
+        checkpoint_path, checkpoint_key, frames.size());
+    if (!checkpoint_opt) {
+      X_FATAL("Cannot resume. Remove '" << checkpoint_path
+                                        << "' to start over.");
+      return EXIT_FAILURE;
+    }
+    resumed_frames = checkpoint_opt->next_frame;
+    frames.erase(std::begin(frames), std::begin(frames) + resumed_frames);
+  }
+
+  ///
+  /// Convert each frame to its camera and lidar messages
+  ///
+
+  struct FrameMessages {
+    boost::optional<a2d2::CameraFrameMessages> camera;
+    boost::optional<a2d2::LidarFrameMessages> lidar;
+    // stamped like the image
+    sensor_msgs::CameraInfo camera_info;
+  };  // struct FrameMessages
+
+  // each frame's files are read ahead (PNG and npz on their own threads), and
+  // the memory cap is shared between them; without prefetching, each npz file
+  // is mapped rather than read
+  auto frame_prefetch_options = prefetch_options;
+  frame_prefetch_options.max_bytes /= 2;
+  std::vector<std::string> png_paths;
+  std::vector<std::string> npz_paths;
+  for (const auto& frame : frames) {
+    png_paths.push_back(frame.png_path);
+    if (prefetch_options.depth > 0) {
+      npz_paths.push_back(frame.npz_path);
+    }
+  }
+  a2d2::FilePrefetcher png_prefetcher(png_paths, frame_prefetch_options);
+  a2d2::FilePrefetcher npz_prefetcher(npz_paths, frame_prefetch_options);
+
+  // the converters are thread-safe, so workers can share them
+  const auto convert_frame =
+      [&](size_t idx) -> boost::optional<FrameMessages> {
+    const auto& selected = frames[idx];
+
+    // both files are taken before anything can fail, since the prefetchers
+    // only read ahead of the frames that have been taken
+    std::vector<uint8_t> png_bytes;
+    std::vector<uint8_t> npz_bytes;
+    a2d2::ScopedStageTimer image_timer(stats, a2d2::Stage::IMAGE_LOAD);
+    const auto png_read = png_prefetcher.take(idx, png_bytes);
+    image_timer.stop();
+    a2d2::ScopedStageTimer npz_timer(stats, a2d2::Stage::NPZ_LOAD);
+    const auto npz_read = ((prefetch_options.depth > 0) &&
+                           npz_prefetcher.take(idx, npz_bytes));
+    npz_timer.pause();
+
+    const auto& camera_name = selected.sensor_name;
+    const auto info_opt = camera_converter.get_camera_info(camera_name);
+    if (!info_opt) {
+      X_FATAL("Did not find camera info for: " << camera_name
+                                               << ". Cannot continue.");
+      return boost::none;
+    }
+
+    FrameMessages messages;
+    messages.camera_info = *info_opt;
+    messages.camera_info.header.stamp = selected.stamp;
+
+    ///
+    /// Build image message
+    ///
+
+    if (!selected.png_path.empty()) {
+      if (!png_read) {
+        X_FATAL("'" << selected.png_path
+                    << "' failed to open. Cannot continue.");
+        return boost::none;
+      }
+      stats.add_bytes_in(png_bytes.size());
+      messages.camera =
+          camera_converter.convert(png_bytes, camera_name, selected.stamp);
+      if (!messages.camera) {
+        X_FATAL("'" << selected.png_path
+                    << "' failed to convert. Cannot continue.");
+        return boost::none;
+      }
+    }
+
+    ///
+    /// Build and fill in the point cloud message (and depth map)
+    ///
+
+    if (selected.npz_path.empty()) {
+      return messages;
+    }
+    const auto& f = selected.npz_path;
+
+    a2d2::npz::MappedNpz npz;
+    npz_timer.resume();
+    const auto opened =
+        ((prefetch_options.depth > 0) ? (npz_read &&
+                                         npz.open(std::move(npz_bytes), f))
+                                      : npz.open(f));
+    if (!opened) {
+      X_FATAL("Failed to read npz file: " << f << ". Cannot continue.");
+      return boost::none;
+    }
+    npz_timer.stop();
+    stats.add_bytes_in(npz.get_size());
+
+    messages.lidar = lidar_converter.convert(npz, camera_name, selected.stamp);
+    if (!messages.lidar) {
+      X_FATAL("Failed to convert npz file: " << f << ". Cannot continue.");
+      return boost::none;
+    }
+    return messages;
+  };
+
+  ///
+  /// In a dry run, convert the sampled frames one at a time to measure them,
+  /// and report the projection instead of writing anything
+  ///
+
+  if (dry_run) {
+    X_INFO("Dry run: converting " << frames.size() << " sampled frame(s).");
+    for (size_t idx = 0; idx < frames.size(); ++idx) {
+      const auto start = a2d2::RunStats::Clock::now();
+      auto messages = convert_frame(idx);
+      if (!messages) {
+        return EXIT_FAILURE;
+      }
+      const auto seconds = std::chrono::duration<double>(
+                               a2d2::RunStats::Clock::now() - start)
+                               .count();
+
+      uint64_t camera_bytes = 0;
+      if (messages->camera) {
+        const auto& camera = *messages->camera;
+        camera_bytes =
+            ((camera.compressed_image
+                  ? a2d2::get_bag_record_size(*camera.compressed_image)
+                  : a2d2::get_bag_record_size(*camera.image)) +
+             a2d2::get_bag_record_size(messages->camera_info));
+      }
+      uint64_t lidar_bytes = 0;
+      if (messages->lidar) {
+        lidar_bytes = a2d2::get_bag_record_size(messages->lidar->cloud);
+        if (messages->lidar->depth_map) {
+          lidar_bytes += a2d2::get_bag_record_size(*messages->lidar->depth_map);
+        }
+        lidar_converter.recycle(*messages->lidar);
+      }
+      if (merged) {
+        estimator.add_sample(dry_run_lane, seconds,
+                             {(camera_bytes + lidar_bytes)});
+      } else {
+        estimator.add_sample(dry_run_lane, seconds,
+                             {camera_bytes, lidar_bytes});
+      }
+    }
+
+    // prefetched files and the chunk of every open bag are held throughout
+    const auto prefetch_bytes =
+        ((prefetch_options.depth > 0) ? prefetch_options.max_bytes : 0);
+    const auto num_bags = (merged ? 1 : 2);
+    const auto report = estimator.project(
+        num_jobs, (prefetch_bytes + (num_bags * chunk_threshold)));
+    report.log();
+    if (stats_json_path_opt) {
+      if (!report.write_json(*stats_json_path_opt, "camera_lidar")) {
+        X_FATAL("Failed to write dry run report to: " << *stats_json_path_opt);
+        return EXIT_FAILURE;
+      }
+      X_INFO("Wrote dry run report to: " << *stats_json_path_opt);
+    }
+
+    X_INFO("Done.");
+    return EXIT_SUCCESS;
+  }
+
+  ///
+  /// Write messages to bag file(s), or publish them, in time order
+  ///
+
+  std::unique_ptr<a2d2::TopicPublisher> publisher;
+  if (publish) {
+    ros::init(argc, argv, _NODE_NAME,
+              (ros::init_options::NoSigintHandler |
+               ros::init_options::AnonymousName));
+    if (!ros::master::check()) {
+      X_FATAL("Cannot publish messages. The ROS master is not running.");
+      return EXIT_FAILURE;
+    }
+    publisher.reset(new a2d2::TopicPublisher(publish_speed));
+  }
+  const auto make_sink = [&](const char* suffix) {
+    return std::unique_ptr<a2d2::MessageSink>(
+        new a2d2::MessageSink(a2d2::make_message_sink(
+            publisher.get(), output_path, get_bag_name(suffix),
+            min_time_offset, split_duration, bag_options)));
+  };
+  std::unique_ptr<a2d2::MessageSink> merged_sink;
+  std::unique_ptr<a2d2::MessageSink> camera_sink;
+  std::unique_ptr<a2d2::MessageSink> lidar_sink;
+  if (merged) {
+    merged_sink = make_sink(_MERGED_SUFFIX);
+  } else {
+    camera_sink = make_sink(_CAMERA_SUFFIX);
+    lidar_sink = make_sink(_LIDAR_SUFFIX);
+  }
+  auto& camera_out = (merged ? *merged_sink : *camera_sink);
+  auto& lidar_out = (merged ? *merged_sink : *lidar_sink);
+
+  std::vector<a2d2::MessageSink*> sinks;
+  for (auto* sink : {merged_sink.get(), camera_sink.get(), lidar_sink.get()}) {
+    if (sink) {
+      sinks.push_back(sink);
+    }
+  }
+  const auto close_sinks = [&]() {
+    for (auto* sink : sinks) {
+      sink->close();
+    }
+  };
+  if (checkpoint_opt) {
+    for (auto* sink : sinks) {
+      if (!sink->resume(checkpoint_opt->segments)) {
+        X_FATAL("Failed to resume the bag file(s) of: " << checkpoint_path);
+        return EXIT_FAILURE;
+      }
+    }
+  }
+  a2d2::CheckpointWriter checkpoints(checkpoint_path, checkpoint_key,
+                                     checkpoint_interval);
+
+  // topics are the same as those of the camera and lidar converters
+  const auto topic_prefix =
+      (std::string(_DATASET_NAMESPACE) + "/" + file_basename + "/");
+  const auto image_topic = (topic_prefix + std::string(_CAMERA_SUFFIX));
+  const auto info_topic = (topic_prefix + "camera_info");
+  const auto cloud_topic = (topic_prefix + std::string(_LIDAR_SUFFIX));
+  const auto depth_map_topic =
+      (cloud_topic + "/" + std::string(_DEPTH_MAP_SUFFIX));
+
+  // frames are written in time order, so the clock is written along with them,
+  // to each bag so that every bag can be played on its own; sinks that publish
+  // share the topic, so only the first of them writes it
+  std::vector<a2d2::ClockWriter> clocks;
+  if (include_clock_topic) {
+    for (auto* sink : sinks) {
+      clocks.emplace_back(*sink, _CLOCK_TOPIC, clock_rate);
+      if (publish) {
+        break;
+      }
+    }
+  }
+
+  a2d2::logging::ProgressLogger progress(
+      camera_path, "frames", frames.size(), progress_interval);
+  const auto write_frame = [&](size_t idx, FrameMessages& messages) {
+    const auto& selected = frames[idx];
+    const auto t = selected.time_since_begin;
+    const auto& stamp = selected.stamp;
+
+    a2d2::ScopedStageTimer write_timer(stats, a2d2::Stage::BAG_WRITE);
+    if (messages.camera) {
+      const auto& camera = *messages.camera;
+      if (camera.compressed_image) {
+        camera_out.write(image_topic + "/compressed", t, stamp,
+                         *camera.compressed_image);
+      } else {
+        camera_out.write(image_topic, t, stamp, *camera.image);
+      }
+      camera_out.write(info_topic, t, stamp, messages.camera_info);
+    }
+
+    if (messages.lidar) {
+      lidar_out.write(cloud_topic, t, stamp, messages.lidar->cloud);
+      if (messages.lidar->depth_map) {
+        lidar_out.write(depth_map_topic, t, stamp, *messages.lidar->depth_map);
+      }
+    }
+    write_timer.stop();
+    stats.add_frames(1);
+    progress.add();
+    if (messages.lidar) {
+      const auto& cloud = messages.lidar->cloud;
+      stats.add_points(static_cast<uint64_t>(cloud.width) * cloud.height);
+      // the sink has its own copy now, so the next frame can refill the buffer
+      lidar_converter.recycle(*messages.lidar);
+    }
+
+    if (include_clock_topic) {
+      a2d2::ScopedStageTimer clock_timer(stats, a2d2::Stage::CLOCK_WRITE);
+      for (auto& clock : clocks) {
+        clock.write(t, stamp);
+      }
+    }
+    if (!checkpoints.update(t, (resumed_frames + idx + 1), sinks)) {
+      X_WARN("Failed to write checkpoint to: " << checkpoint_path);
+    }
+
+    if (verbose) {
+      X_INFO("Processed: " << selected.camera_basename);
+    }
+    return true;
+  };
+
+  X_INFO("Attempting to convert camera and lidar data using "
+         << num_jobs << " job(s). This may take a while...");
+
+  const auto converted = a2d2::ordered_parallel_for<FrameMessages>(
+      frames.size(), num_jobs, (2 * num_jobs), convert_frame, write_frame);
+  if (!converted) {
+    X_FATAL("Failed to convert camera and lidar data. Cannot continue.");
+    close_sinks();
+    return EXIT_FAILURE;
+  }
+
+  {
+    a2d2::ScopedStageTimer timer(stats, a2d2::Stage::BAG_CLOSE);
+    close_sinks();
+  }
+  if (!publish) {
+    // the bags are complete, so there is nothing left to resume
+    checkpoints.remove();
+  }
+
+  if (stats_json_path_opt) {
+    for (auto* sink : sinks) {
+      stats.add_bytes_out(sink->get_bytes_written());
+    }
+    if (!stats.write_json(*stats_json_path_opt, "camera_lidar")) {
+      X_FATAL("Failed to write run report to: " << *stats_json_path_opt);
+      return EXIT_FAILURE;
+    }
+    X_INFO("Wrote run report to: " << *stats_json_path_opt);
+  }
+
+  X_INFO("Done.");
+  return EXIT_SUCCESS;
+}
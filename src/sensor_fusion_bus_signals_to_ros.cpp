@@ -22,7 +22,9 @@
  * IN THE SOFTWARE.
  */
 #include <algorithm>
+#include <chrono>
 #include <limits>
+#include <memory>
 #include <set>
 #include <sstream>
 #include <tuple>
@@ -37,7 +39,6 @@
 #include <ros/ros.h>
 #include <rosbag/bag.h>
 #include <rosbag/view.h>
-#include <rosgraph_msgs/Clock.h>
 #include <tf2_msgs/TFMessage.h>
 #ifdef USE_FLOAT64
 #include <std_msgs/Float64.h>
@@ -47,57 +48,56 @@
 #include <std_msgs/Header.h>
 #include <std_msgs/String.h>
 
+#include "a2d2_to_ros/bag_utils.hpp"
+#include "a2d2_to_ros/bus_signal_reader.hpp"
+#include "a2d2_to_ros/converters.hpp"
 #include "a2d2_to_ros/json_utils.hpp"
 #include "a2d2_to_ros/lib_a2d2_to_ros.hpp"
 #include "a2d2_to_ros/log_build_options.hpp"
+#include "a2d2_to_ros/logger.hpp"
 #include "a2d2_to_ros/logging.hpp"
+#include "a2d2_to_ros/merge.hpp"
+#include "a2d2_to_ros/message_sink.hpp"
+#include "a2d2_to_ros/run_stats.hpp"
+#include "a2d2_to_ros/sensor_config.hpp"
+#include "a2d2_to_ros/transform_utils.hpp"
 #include "ros_cnpy/cnpy.h"
 
 ///
 /// Program constants and defaults.
 ///
 
-static constexpr auto EPS = 1e-8;
-static constexpr auto _TF_FREQUENCEY = 10.0;
 static constexpr auto _PROGRAM_OPTIONS_LINE_LENGTH = 120u;
 static constexpr auto _INCLUDE_ORIGINAL = false;
 static constexpr auto _INCLUDE_CONVERTED = true;
 static constexpr auto _INCLUDE_CLOCK_TOPIC = false;
+static constexpr auto _CLOCK_RATE = 0.0;
+static constexpr auto _LATCH_STATIC_TF = false;
+static constexpr auto _TF_RATE = 0.0;
 static constexpr auto _CLOCK_TOPIC = "/clock";
 static constexpr auto _BUS_FRAME_NAME = "wheels";
 static constexpr auto _OUTPUT_PATH = ".";
+static constexpr auto _NODE_NAME = "a2d2_bus_signal_converter";
 static constexpr auto _DATASET_NAMESPACE = "/a2d2";
-static constexpr auto _ORIGINAL_VALUE_TOPIC = "original_value";
-static constexpr auto _ORIGINAL_UNITS_TOPIC = "original_units";
-static constexpr auto _VALUE_TOPIC = "value";
-static constexpr auto _HEADER_TOPC = "header";
 static constexpr auto _START_TIME = static_cast<uint64_t>(0);
 static constexpr auto _MIN_TIME_OFFSET = 0.0;
 static constexpr auto _VERBOSE = false;
+static constexpr auto _LOG_LEVEL = "info";
+static constexpr auto _PROGRESS = 0u;
 static constexpr auto _DURATION = std::numeric_limits<double>::max();
+static constexpr auto _SPLIT_DURATION = 0.0;
+static constexpr auto _COMPRESSION = "none";
+static constexpr auto _CHUNK_THRESHOLD =
+    a2d2_to_ros::BagOptions::DEFAULT_CHUNK_THRESHOLD;
+static constexpr auto _SINK = "bag";
+static constexpr auto _PUBLISH_SPEED = 1.0;
 static constexpr auto _SENSOR_CONFIG_FILENAME = "cams_lidars.json";
+static constexpr auto _SENSOR_CONFIG_CACHE = true;
 
 ///
 /// Executable specific stuff
 ///
 
-#define VERIFY_BASIS_ORIGIN(basis, origin, sensors, frame)                  \
-  {                                                                         \
-    if (!a2d2::vector_is_valid(origin)) {                                   \
-      X_FATAL("Origin for " << sensors << "::" << frame                     \
-                            << " is not valid. Origin must be finite and "  \
-                               "real valued. Cannot continue.");            \
-      return EXIT_FAILURE;                                                  \
-    }                                                                       \
-    if (basis.isZero(0.0)) {                                                \
-      X_FATAL(                                                              \
-          "Basis for "                                                      \
-          << sensors << "::" << frame                                       \
-          << " cannot be constructed. Check that the X/Y axes are valid."); \
-      return EXIT_FAILURE;                                                  \
-    }                                                                       \
-  }
-
 namespace {
 namespace a2d2 = a2d2_to_ros;
 namespace po = boost::program_options;
@@ -119,6 +119,7 @@ int main(int argc, char* argv[]) {
   boost::optional<std::string> json_path_opt;
   boost::optional<std::string> sensor_config_path_opt;
   boost::optional<std::string> sensor_config_schema_path_opt;
+  boost::optional<std::string> stats_json_path_opt;
 
   po::options_description desc(
       "Convert sequential bus signal data to rosbag for the A2D2 Sensor Fusion "
@@ -144,17 +145,66 @@ int main(int argc, char* argv[]) {
       "Optional: Seconds to skip ahead in the data before starting the bag.")(
       "duration,d", po::value<double>()->default_value(_DURATION),
       "Optional: Seconds after min-time-offset to include in bag file.")(
+      "split-duration", po::value<double>()->default_value(_SPLIT_DURATION),
+      "Optional: Seconds of data to write to each bag file before starting a "
+      "new one in a 'timespan_<start>s_<end>s' subdirectory of the output "
+      "path. Splitting is disabled if this is 0.")(
+      "compression", po::value<std::string>()->default_value(_COMPRESSION),
+      "Optional: Compression of the bag file chunks. One of 'none', 'bz2', or "
+      "'lz4'. Compressed chunks are written on a background thread.")(
+      "chunk-threshold",
+      po::value<uint32_t>()->default_value(_CHUNK_THRESHOLD),
+      "Optional: Bytes of messages to buffer before a chunk is written (and "
+      "compressed).")(
       "output-path,o", po::value<std::string>()->default_value(_OUTPUT_PATH),
       "Optional: Path for the output bag file.")(
+      "sink", po::value<std::string>()->default_value(_SINK),
+      "Optional: Where to write the messages. One of 'bag' (bag files in the "
+      "output path) or 'topics' (publish them to a running ROS master, paced "
+      "by their stamps).")(
+      "publish-speed", po::value<double>()->default_value(_PUBLISH_SPEED),
+      "Optional: Factor of real time to publish at with '--sink topics', e.g., "
+      "2 for twice as fast as recorded. Messages are published as fast as "
+      "possible if this is 0.")(
       "include-clock-topic,t",
       po::value<bool>()->default_value(_INCLUDE_CLOCK_TOPIC),
       "Optional: Write bus signal times to a /clock topic in the TF bag.")(
+      "clock-rate", po::value<double>()->default_value(_CLOCK_RATE),
+      "Optional: Maximum rate (Hz) of /clock messages. A message is written "
+      "for every unique timestamp if this is 0.")(
+      "latch-static-tf",
+      po::value<bool>()->default_value(_LATCH_STATIC_TF),
+      "Optional: Write /tf_static and the ego shape once per TF bag, latched "
+      "at the first TF time in the bag, instead of at every TF time. The "
+      "wheels->chassis transform is then only given by /tf.")(
+      "tf-rate", po::value<double>()->default_value(_TF_RATE),
+      "Optional: Rate (Hz) of /tf messages, e.g., 10. The roll and pitch "
+      "angles are resampled at this rate by linear interpolation, so they "
+      "need not share timestamps. If this is 0, a message is written for each "
+      "roll angle, and every roll angle needs a pitch angle with the same "
+      "timestamp.")(
       "include-original-values,i",
       po::value<bool>()->default_value(_INCLUDE_ORIGINAL),
       "Optional: Include data set values in their original units.")(
       "include-converted-values,r",
       po::value<bool>()->default_value(_INCLUDE_CONVERTED),
       "Optional: Include data set values converted to ROS standard units.")(
+      "sensor-config-cache",
+      po::value<bool>()->default_value(_SENSOR_CONFIG_CACHE),
+      "Optional: Cache what is built from the vehicle/sensor config in a "
+      "'.a2d2_sensor_config' file next to it, so that later runs do not need "
+      "to parse and validate it again. The cache is rebuilt when the config "
+      "or its schema changes.")(
+      "stats-json", po::value(&stats_json_path_opt),
+      "Optional: Write a JSON report of this run to this path: sample and "
+      "byte totals and rates, and the count, total, p50, and p99 latency of "
+      "each conversion stage.")(
+      "log-level", po::value<std::string>()->default_value(_LOG_LEVEL),
+      "Optional: Least severe messages to log. One of 'debug', 'info', "
+      "'warn', 'error', or 'fatal'.")(
+      "progress", po::value<unsigned>()->default_value(_PROGRESS),
+      "Optional: Log a progress line, with the rate, every this many samples. "
+      "Progress is not logged if this is 0.")(
       "verbose,v", po::value<bool>()->default_value(_VERBOSE),
       "Optional: Show name of each file after it is processed.");
 
@@ -176,6 +226,16 @@ int main(int argc, char* argv[]) {
     return EXIT_FAILURE;
   }
 
+  const auto log_level_opt =
+      a2d2::logging::get_level(vm["log-level"].as<std::string>());
+  if (!log_level_opt) {
+    X_FATAL("Log level '" << vm["log-level"].as<std::string>()
+                          << "' is not valid. It must be one of 'debug', "
+                             "'info', 'warn', 'error', or 'fatal'.");
+    return EXIT_FAILURE;
+  }
+  a2d2::logging::set_level(*log_level_opt);
+
   ///
   /// Get commandline parameters
   ///
@@ -189,28 +249,84 @@ int main(int argc, char* argv[]) {
   const auto include_original = vm["include-original-values"].as<bool>();
   const auto include_converted = vm["include-converted-values"].as<bool>();
   const auto include_clock_topic = vm["include-clock-topic"].as<bool>();
+  const auto clock_rate = vm["clock-rate"].as<double>();
+  const auto latch_static_tf = vm["latch-static-tf"].as<bool>();
+  const auto tf_rate = vm["tf-rate"].as<double>();
+  const auto use_sensor_config_cache = vm["sensor-config-cache"].as<bool>();
   const auto start_time = vm["start-time"].as<uint64_t>();
   const auto min_time_offset = vm["min-time-offset"].as<double>();
   const auto duration = vm["duration"].as<double>();
+  const auto split_duration = vm["split-duration"].as<double>();
+  const auto publish_speed = vm["publish-speed"].as<double>();
   const auto verbose = vm["verbose"].as<bool>();
+  const auto progress_interval = vm["progress"].as<unsigned>();
+
+  // stages are only timed if a report was requested
+  a2d2::RunStats stats(static_cast<bool>(stats_json_path_opt));
 
   const auto valid_min_offset = (std::isfinite(min_time_offset) &&
 
                                  a2d2::strictly_non_negative(min_time_offset));
   const auto valid_duration =
       (std::isfinite(duration) && a2d2::strictly_non_negative(duration));
-  if (!valid_min_offset || !valid_duration) {
+  const auto valid_split_duration =
+      (std::isfinite(split_duration) &&
+       a2d2::strictly_non_negative(split_duration));
+  if (!valid_min_offset || !valid_duration || !valid_split_duration) {
     X_FATAL(
         "Time constraints {min-time-offset: "
         << min_time_offset << ", duration: " << duration
+        << ", split-duration: " << split_duration
         << "} are not valid. They must be finite, real valued, and >= 0.0.");
     return EXIT_FAILURE;
   }
+  if (!std::isfinite(clock_rate) || !a2d2::strictly_non_negative(clock_rate)) {
+    X_FATAL("Clock rate " << clock_rate
+                          << " is not valid. It must be finite and >= 0.0.");
+    return EXIT_FAILURE;
+  }
+  if (!std::isfinite(tf_rate) || !a2d2::strictly_non_negative(tf_rate)) {
+    X_FATAL("TF rate " << tf_rate
+                       << " is not valid. It must be finite and >= 0.0.");
+    return EXIT_FAILURE;
+  }
+
+  const auto compression_opt =
+      a2d2::get_compression_type(vm["compression"].as<std::string>());
+  if (!compression_opt) {
+    X_FATAL("Compression '" << vm["compression"].as<std::string>()
+                            << "' is not valid. It must be one of 'none', "
+                               "'bz2', or 'lz4'.");
+    return EXIT_FAILURE;
+  }
+  const auto chunk_threshold = vm["chunk-threshold"].as<uint32_t>();
+  if (chunk_threshold == 0) {
+    X_FATAL("Chunk threshold must be > 0.");
+    return EXIT_FAILURE;
+  }
+  a2d2::BagOptions bag_options;
+  bag_options.compression = *compression_opt;
+  bag_options.chunk_threshold = chunk_threshold;
+
+  const auto sink_opt = a2d2::get_sink_type(vm["sink"].as<std::string>());
+  if (!sink_opt) {
+    X_FATAL("Sink '" << vm["sink"].as<std::string>()
+                     << "' is not valid. It must be one of 'bag' or 'topics'.");
+    return EXIT_FAILURE;
+  }
+  if (!std::isfinite(publish_speed) ||
+      !a2d2::strictly_non_negative(publish_speed)) {
+    X_FATAL("Publish speed " << publish_speed
+                             << " is not valid. It must be finite and >= 0.0.");
+    return EXIT_FAILURE;
+  }
+  const auto publish = (*sink_opt == a2d2::SinkType::TOPICS);
 
   ///
   /// Get the path for the bus signal JSON data
   /// There should be only one file in the directory, and it should be the data
   ///
+  a2d2::ScopedStageTimer scan_timer(stats, a2d2::Stage::SCAN);
   boost::filesystem::directory_iterator it{json_data_path};
   std::string json_path;
   auto iteration = 0;
@@ -227,6 +343,7 @@ int main(int argc, char* argv[]) {
       break;
     }
   }
+  scan_timer.stop();
 
   if (json_path.empty()) {
     X_FATAL(
@@ -246,361 +363,156 @@ int main(int argc, char* argv[]) {
   /// Get the JSON schema for the data set
   ///
 
-  auto d_schema_opt = a2d2::get_rapidjson_dom(schema_path);
-  if (!d_schema_opt) {
-    X_FATAL("Could not open '" << schema_path);
+  a2d2::BusSignalConverter::Options converter_options;
+  converter_options.topic_prefix = topic_prefix;
+  converter_options.include_converted = include_converted;
+  converter_options.start_time = start_time;
+  converter_options.min_time_offset = min_time_offset;
+  converter_options.duration = duration;
+  converter_options.verbose = verbose;
+  const auto converter =
+      a2d2::BusSignalConverter::load(schema_path, converter_options);
+  if (!converter) {
+    X_FATAL("Could not load the bus signal schema. Cannot continue.");
     return EXIT_FAILURE;
   }
-  auto& d_schema = *d_schema_opt;
-  rapidjson::SchemaDocument schema(d_schema);
 
   ///
-  /// Get the JSON data set
+  /// Get the ego vehicle shape and the sensor poses from the vehicle/sensor
+  /// config, either from its cache or by validating the JSON against its
+  /// schema
   ///
 
-  auto d_json_opt = a2d2::get_rapidjson_dom(json_path);
-  if (!d_json_opt) {
-    X_FATAL("Could not open '" << json_path);
+  const auto sensor_config_opt = a2d2::get_sensor_config(
+      sensor_config_path, sensor_config_schema_path, use_sensor_config_cache);
+  if (!sensor_config_opt) {
+    X_FATAL("Could not get the vehicle/sensor config from: "
+            << sensor_config_path);
     return EXIT_FAILURE;
   }
-  auto& d_json = *d_json_opt;
 
-  X_INFO("Loaded and parsed schema and data set successfully.");
-
-  ///
-  /// Validate the data set against the schema
-  ///
+  const auto& bbox = sensor_config_opt->ego_bbox;
+  const auto ego_shape_msg =
+      a2d2::build_ego_shape_msg(bbox.x_min, bbox.x_max, bbox.y_min, bbox.y_max,
+                                bbox.z_min, bbox.z_max);
 
-  {
-    rapidjson::SchemaValidator validator(schema);
-    if (!d_json.Accept(validator)) {
-      const auto err_string = a2d2::get_validator_error_string(validator);
-      X_FATAL(err_string);
-      return EXIT_FAILURE;
-    }
-    X_INFO("Validated: " << json_path);
+  // the sensor poses, plus the transform added below
+  tf2_msgs::TFMessage msgtf;
+  msgtf.transforms = sensor_config_opt->transforms;
+
+  // The identity wheels->chassis transform only stands in for the roll/pitch
+  // transforms on /tf, so it is left out when /tf_static is latched: a static
+  // transform would conflict with the dynamic one for the rest of the bag.
+  if (!latch_static_tf) {
+    geometry_msgs::Transform Tx_msg;
+    tf::transformEigenToMsg(Eigen::Affine3d::Identity(), Tx_msg);
+
+    geometry_msgs::TransformStamped Tx_stamped_msg;
+    Tx_stamped_msg.transform = Tx_msg;
+    Tx_stamped_msg.header.frame_id = "wheels";
+    Tx_stamped_msg.child_frame_id = "chassis";
+    msgtf.transforms.push_back(Tx_stamped_msg);
   }
 
   ///
-  /// Get the JSON for vehicle/sensor config
+  /// Stream the data set from its file, validating it against the schema on
+  /// the way. Each sample that falls in the requested timespan is spilled to a
+  /// temporary file, in time-sorted runs, rather than kept as messages, and
+  /// once every signal has been read, the runs are merged into a single
+  /// time-ordered stream of writes, so that each chunk of the bag covers a
+  /// short span of time.
   ///
 
-  auto d_sensor_config_opt = a2d2::get_rapidjson_dom(sensor_config_path);
-  if (!d_sensor_config_opt) {
-    X_FATAL("Could not open '" << sensor_config_path);
+  auto data_opt = converter->convert(json_path, stats);
+  if (!data_opt) {
+    X_FATAL("Failed to convert bus signal data in: " << json_path
+                                                     << ". Cannot continue.");
     return EXIT_FAILURE;
   }
-  auto& sensor_config_d = *d_sensor_config_opt;
+  X_INFO("Validated: " << json_path);
+  const auto& signals = data_opt->signals;
+  const auto& runs = data_opt->samples->get_runs();
+  const auto& run_signals = data_opt->run_signals;
+  auto& roll_angles = data_opt->roll_angles;
+  auto& pitch_angles = data_opt->pitch_angles;
+  // TF messages are split according to the offsets of the roll angle data
+  const auto& tf_first_time = data_opt->tf_first_time;
 
   ///
-  /// Get the JSON schema for the config JSON
+  /// Pair the roll and pitch angles for the TF messages
   ///
 
-  auto d_sensor_config_schema_opt =
-      a2d2::get_rapidjson_dom(sensor_config_schema_path);
-  if (!d_sensor_config_schema_opt) {
-    X_FATAL("Could not open '" << sensor_config_schema_path);
+  const auto roll_duplicate = a2d2::sort_angle_samples(roll_angles);
+  if (roll_duplicate) {
+    X_FATAL("Non unique values for roll angle time: " << *roll_duplicate
+                                                      << ". Cannot continue.");
     return EXIT_FAILURE;
   }
-  rapidjson::SchemaDocument config_schema(*d_sensor_config_schema_opt);
-
-  ///
-  /// Validate the sensor config against the schema
-  ///
-
-  {
-    rapidjson::SchemaValidator validator(config_schema);
-    if (!sensor_config_d.Accept(validator)) {
-      const auto err_string = a2d2::get_validator_error_string(validator);
-      X_FATAL(err_string);
-      return EXIT_FAILURE;
-    }
-    X_INFO("Validated: " << sensor_config_path);
-  }
-
-  ///
-  /// Build ego vehicle shape message
-  ///
-
-  const rapidjson::Value& ego_dims =
-      sensor_config_d["vehicle"]["ego-dimensions"];
-  const rapidjson::Value& x_dims = ego_dims["x-range"];
-  const rapidjson::Value& y_dims = ego_dims["y-range"];
-  const rapidjson::Value& z_dims = ego_dims["z-range"];
-
-  constexpr auto MIN_IDX = static_cast<rapidjson::SizeType>(0);
-  constexpr auto MAX_IDX = static_cast<rapidjson::SizeType>(1);
-  const auto x_min = x_dims[MIN_IDX].GetDouble();
-  const auto x_max = x_dims[MAX_IDX].GetDouble();
-  const auto y_min = y_dims[MIN_IDX].GetDouble();
-  const auto y_max = y_dims[MAX_IDX].GetDouble();
-  const auto z_min = z_dims[MIN_IDX].GetDouble();
-  const auto z_max = z_dims[MAX_IDX].GetDouble();
-
-  const auto ego_bbox_valid =
-      a2d2::verify_ego_bbox_params(x_min, x_max, y_min, y_max, z_min, z_max);
-  if (!ego_bbox_valid) {
-    X_FATAL(
-        "Ego bounding box parameters are invalid. They must be finite, "
-        "real-valued, and ordered: x: ["
-        << x_min << ", " << x_max << "], y: [" << y_min << ", " << y_max
-        << "], z: [" << z_min << ", " << z_max << "]");
+  const auto pitch_duplicate = a2d2::sort_angle_samples(pitch_angles);
+  if (pitch_duplicate) {
+    X_FATAL("Non unique values for pitch angle time: "
+            << *pitch_duplicate << ". Cannot continue.");
     return EXIT_FAILURE;
   }
 
-  const auto ego_shape_msg =
-      a2d2::build_ego_shape_msg(x_min, x_max, y_min, y_max, z_min, z_max);
-
-  ///
-  /// Get sensor poses
-  ///
-
-  const auto sensors = a2d2::sensors::Frames::get_sensors();
-
-  // each block will add its transform message to this container
-  tf2_msgs::TFMessage msgtf;
-
-  // For each sensor type...
-  for (const auto& name :
-       {a2d2::sensors::Names::CAMERAS, a2d2::sensors::Names::LIDARS}) {
-    const auto is_camera = (name == a2d2::sensors::Names::CAMERAS);
-    const auto is_lidar = (name == a2d2::sensors::Names::LIDARS);
-
-    // For each sensor position...
-    for (auto i = 0; i < sensors.size(); ++i) {
-      const auto& frame = sensors[i];
-
-      // No lidars at these positions
-      const auto is_side_left = (a2d2::sensors::Frames::SIDE_LEFT_IDX == i);
-      const auto is_side_right = (a2d2::sensors::Frames::SIDE_RIGHT_IDX == i);
-      const auto is_rear_center = (a2d2::sensors::Frames::REAR_CENTER_IDX == i);
-      if (is_lidar) {
-        if (is_side_left || is_side_right || is_rear_center) {
-          continue;
-        }
-      }
-
-      // No cameras at these positions
-      const auto is_rear_left = (a2d2::sensors::Frames::REAR_LEFT_IDX == i);
-      const auto is_rear_right = (a2d2::sensors::Frames::REAR_RIGHT_IDX == i);
-      if (is_camera) {
-        if (is_rear_left || is_rear_right) {
-          continue;
-        }
-      }
-
-      // compute transform between sensor and vehicle
-      const Eigen::Matrix3d basis =
-          a2d2::json_axes_to_eigen_basis(sensor_config_d, name, frame, EPS);
-      const Eigen::Vector3d origin =
-          a2d2::json_origin_to_eigen_vector(sensor_config_d, name, frame);
-      VERIFY_BASIS_ORIGIN(basis, origin, name, frame);
-
-      const Eigen::Affine3d Tx = a2d2::Tx_global_sensor(basis, origin);
-
-      {
-        geometry_msgs::Transform Tx_msg;
-        tf::transformEigenToMsg(Tx, Tx_msg);
-
-        geometry_msgs::TransformStamped Tx_stamped_msg;
-        Tx_stamped_msg.transform = Tx_msg;
-        Tx_stamped_msg.header.frame_id = "chassis";
-        Tx_stamped_msg.child_frame_id = a2d2::tf_frame_name(name, frame);
-        msgtf.transforms.push_back(Tx_stamped_msg);
-      }
-
-      // Lidar data lives in camera frames, but it is motion corrected, so it
-      // lives in 'wheels' not 'chassis'
-      if (is_camera) {
-        geometry_msgs::Transform Tx_msg;
-        tf::transformEigenToMsg(Tx, Tx_msg);
-
-        geometry_msgs::TransformStamped Tx_stamped_msg;
-        Tx_stamped_msg.transform = Tx_msg;
-        Tx_stamped_msg.header.frame_id = "wheels";
-        Tx_stamped_msg.child_frame_id =
-            a2d2::tf_motion_compensated_sensor_frame_name(name, frame);
-        msgtf.transforms.push_back(Tx_stamped_msg);
-      }
-
-      {
-        geometry_msgs::Transform Tx_msg;
-        tf::transformEigenToMsg(Eigen::Affine3d::Identity(), Tx_msg);
-
-        geometry_msgs::TransformStamped Tx_stamped_msg;
-        Tx_stamped_msg.transform = Tx_msg;
-        Tx_stamped_msg.header.frame_id = "wheels";
-        Tx_stamped_msg.child_frame_id = "chassis";
-        msgtf.transforms.push_back(Tx_stamped_msg);
-      }
+  std::vector<a2d2::ChassisAngles> chassis_angles;
+  if (a2d2::strictly_positive(tf_rate)) {
+    a2d2::resample_chassis_angles(roll_angles, pitch_angles, tf_rate,
+                                  chassis_angles);
+  } else {
+    const auto unpaired = a2d2::join_chassis_angles(roll_angles, pitch_angles,
+                                                    chassis_angles);
+    if (unpaired) {
+      X_FATAL("Timestamp " << *unpaired
+                           << " is not in both the roll and the pitch data. "
+                              "Cannot continue, unless a tf-rate is given.");
+      return EXIT_FAILURE;
     }
   }
+  roll_angles = std::vector<a2d2::AngleSample>();
+  pitch_angles = std::vector<a2d2::AngleSample>();
 
   ///
-  /// Get the field names from schema, retrieve data from DOM, write to bag.
-  /// This loop does not do error checking on the DOM because it should already
-  /// have been validated by the schema.
+  /// Write the samples of all signals to the bus signal bag in time order, and
+  /// the TF and clock messages to the TF bag along with them
   ///
 
-  std::map<uint64_t, float> roll_angles;
-  std::map<uint64_t, float> pitch_angles;
+  // each run of samples that the converter spilled is sorted by time
+  const auto sample_less = [](const a2d2::BusSignalSample& lhs,
+                              const a2d2::BusSignalSample& rhs) {
+    return (lhs.time < rhs.time);
+  };
 
-  std::set<ros::Time> stamps;
-  rosbag::Bag bus_signal_bag;
-  {
-    const auto bag_name = output_path + "/" + file_basename + ".bag";
-    bus_signal_bag.open(bag_name, rosbag::bagmode::Write);
-  }
-  const rapidjson::Value& r = d_schema["required"];
-  for (rapidjson::SizeType idx = 0; idx < r.Size(); ++idx) {
-    const auto name = std::string(r[idx].GetString());
-    if (verbose) {
-      X_INFO("Converting " << name << "...");
-    }
-
-    const rapidjson::Value& obj = d_json[name.c_str()].GetObject();
-    const rapidjson::Value& values = obj["values"];
-    const auto units = obj["unit"].IsNull() ? "null" : obj["unit"].GetString();
-
-    // publish data for each of the values in this field
-    auto no_units_yet = true;
-    boost::optional<ros::Time> first_time;
-    for (rapidjson::SizeType idx = 0; idx < values.Size(); ++idx) {
-      constexpr auto TIMESTAMP_IDX = static_cast<rapidjson::SizeType>(0);
-      constexpr auto VALUE_IDX = static_cast<rapidjson::SizeType>(1);
-      const rapidjson::Value& t_v = values[idx];
-      const auto time = t_v[TIMESTAMP_IDX].GetUint64();
-      if (!a2d2::valid_ros_timestamp(time)) {
-        X_FATAL("Timestamp "
-                << time
-                << " has unsupported magnitude: ROS does not support "
-                   "timestamps on or after 4294967296000000 "
-                   "(Sunday, February 7, 2106 6:28:16 AM GMT)\nCall "
-                   "Zager and Evans for details.");
-        return EXIT_FAILURE;
-      }
-
-      if (time < start_time) {
-        continue;
-      }
-
-      const auto value = t_v[VALUE_IDX].GetDouble();
-      const auto data = a2d2::DataPair::build(value, time, _BUS_FRAME_NAME);
-
-      const auto& stamp = data.header.stamp;
-      if (!first_time) {
-        if (start_time != _START_TIME) {
-          first_time = a2d2::a2d2_timestamp_to_ros_time(start_time);
-        } else {
-          first_time = stamp;
-        }
-      }
-
-      const auto time_since_begin = (stamp - *first_time).toSec();
-      if (time_since_begin < min_time_offset) {
-        continue;
-      }
-
-      const auto recorded_duration = (time_since_begin - min_time_offset);
-      if (recorded_duration > duration) {
-        break;
-      }
+  X_INFO((publish ? "Publishing bus signal and TF messages..."
+                   : "Writing bus signal and TF bag files..."));
 
-      if (name == "roll_angle") {
-        if (roll_angles.find(time) != std::end(roll_angles)) {
-          X_FATAL("Non unique values for roll angle time: "
-                  << time << ". Cannot continue.");
-          return EXIT_FAILURE;
-        }
-        roll_angles[time] = a2d2::to_ros_units(units, value);
-      }
-
-      if (name == "pitch_angle") {
-        if (pitch_angles.find(time) != std::end(pitch_angles)) {
-          X_FATAL("Non unique values for pitch angle time: "
-                  << time << ". Cannot continue.");
-          return EXIT_FAILURE;
-        }
-        pitch_angles[time] = a2d2::to_ros_units(units, value);
-      }
-
-      // TODO(jeff): typo _HEADER_TOPC
-      bus_signal_bag.write(topic_prefix + "/" + name + "/" + _HEADER_TOPC,
-                           stamp, data.header);
-      if (include_original) {
-        bus_signal_bag.write(
-            topic_prefix + "/" + name + "/" + _ORIGINAL_VALUE_TOPIC, stamp,
-            data.value);
-
-        if (no_units_yet) {
-          std_msgs::String units_msg;
-          units_msg.data = units;
-
-          bus_signal_bag.write(
-              topic_prefix + "/" + name + "/" + _ORIGINAL_UNITS_TOPIC, stamp,
-              units_msg);
-          no_units_yet = false;
-        }
-      }
-
-      if (include_converted) {
-        const auto is_lat_lon =
-            ((name == "longitude_degree") || (name == "latitude_degree"));
-        const auto ros_value =
-            (is_lat_lon ? data.value.data
-                        : a2d2::to_ros_units(units, data.value.data));
-        a2d2::DataPair::value_type ros_value_msg;
-        ros_value_msg.data = ros_value;
-        bus_signal_bag.write(topic_prefix + "/" + name + "/" + _VALUE_TOPIC,
-                             stamp, ros_value_msg);
-      }
-
-      if (include_clock_topic) {
-        stamps.insert(stamp);
-      }
-    }
-  }
-
-  ///
-  /// Finish the bus signal bag
-  ///
-
-  bus_signal_bag.close();
-
-  ///
-  /// Write TF bag
-  ///
-
-  // TODO(jeff)
-  if (roll_angles.size() != pitch_angles.size()) {
-    X_FATAL("roll/pitch angle size mismatch: "
-            << roll_angles.size() << " roll values, but " << pitch_angles.size()
-            << " pitch values. Cannot continue.");
-    return EXIT_FAILURE;
-  }
-
-  ///
-  /// Write all tf messages to the bag
-  ///
-
-  X_INFO("Writing TF bag file...");
-
-  rosbag::Bag tf_bag;
-  {
-    const auto bag_name = output_path + "/" + file_basename + "_tf.bag";
-    tf_bag.open(bag_name, rosbag::bagmode::Write);
-  }
-  for (const auto& p : roll_angles) {
-    const auto it_pitch = pitch_angles.find(p.first);
-    if (it_pitch == std::end(pitch_angles)) {
-      X_FATAL("Could not find timestamp "
-              << p.first << " from roll data in pitch data. Cannot continue.");
-      tf_bag.close();
+  std::unique_ptr<a2d2::TopicPublisher> publisher;
+  if (publish) {
+    ros::init(argc, argv, _NODE_NAME,
+              (ros::init_options::NoSigintHandler |
+               ros::init_options::AnonymousName));
+    if (!ros::master::check()) {
+      X_FATAL("Cannot publish messages. The ROS master is not running.");
       return EXIT_FAILURE;
     }
-    const auto ros_time = a2d2::a2d2_timestamp_to_ros_time(p.first);
-    const auto roll = p.second;
-    const auto pitch = it_pitch->second;
+    publisher.reset(new a2d2::TopicPublisher(publish_speed));
+  }
+  auto bus_signal_sink = a2d2::make_message_sink(
+      publisher.get(), output_path, (file_basename + ".bag"), min_time_offset,
+      split_duration, bag_options);
+  auto tf_sink = a2d2::make_message_sink(
+      publisher.get(), output_path, (file_basename + "_tf.bag"),
+      min_time_offset, split_duration, bag_options);
+  // samples are written in time order, so the clock is written along with them
+  a2d2::ClockWriter clock(tf_sink, _CLOCK_TOPIC, clock_rate);
+
+  // windows (i.e., TF bags) that the static messages have been written to
+  std::set<size_t> latched_windows;
+  const auto write_tf = [&](const a2d2::ChassisAngles& angles) {
+    const auto ros_time = a2d2::a2d2_timestamp_to_ros_time(angles.time);
+    const auto time_since_begin = (ros_time - *tf_first_time).toSec();
+    const auto roll = angles.roll;
+    const auto pitch = angles.pitch;
 
     {
       tf2_msgs::TFMessage chassistf;
@@ -623,30 +535,121 @@ int main(int argc, char* argv[]) {
         chassistf.transforms.push_back(Tx_stamped_msg);
       }
 
-      tf_bag.write("/tf", ros_time, chassistf);
+      a2d2::ScopedStageTimer timer(stats, a2d2::Stage::BAG_WRITE);
+      tf_sink.write("/tf", time_since_begin, ros_time, chassistf);
+    }
+
+    // the angles are in time order, so this is the first time in its bag
+    const auto first_in_bag =
+        latched_windows.insert(tf_sink.get_window(time_since_begin)).second;
+    if (latch_static_tf && !first_in_bag) {
+      return true;
     }
 
     for (auto& msg : msgtf.transforms) {
       msg.header.stamp = ros_time;
     }
-    tf_bag.write("/tf_static", ros_time, msgtf);
-    tf_bag.write("/a2d2/ego_shape", ros_time, ego_shape_msg);
-  }
+    a2d2::ScopedStageTimer timer(stats, a2d2::Stage::BAG_WRITE);
+    tf_sink.write("/tf_static", time_since_begin, ros_time, msgtf,
+                  latch_static_tf);
+    tf_sink.write("/a2d2/ego_shape", time_since_begin, ros_time,
+                  ego_shape_msg, latch_static_tf);
+    return true;
+  };
+
+  // writes the TF messages of every angle up to and including the time
+  auto it_angles = std::begin(chassis_angles);
+  const auto write_tf_until = [&](uint64_t time) {
+    for (; (it_angles != std::end(chassis_angles)) && (it_angles->time <= time);
+         ++it_angles) {
+      if (!write_tf(*it_angles)) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  // messages are reused for every sample
+  a2d2::MutableDataPair data(_BUS_FRAME_NAME);
+  a2d2::DataPair::value_type ros_value_msg;
+
+  // signals whose units have been written, with their first sample
+  std::vector<bool> units_written(signals.size(), false);
+
+  a2d2::logging::ProgressLogger progress(json_data_path, "samples",
+                                         data_opt->samples->size(),
+                                         progress_interval);
+  const auto write_sample = [&](size_t run_idx, size_t sample_idx) {
+    const auto signal_idx = run_signals[run_idx];
+    const auto& signal = signals[signal_idx];
+    const auto& sample = runs[run_idx][sample_idx];
+    if (!write_tf_until(sample.time)) {
+      return false;
+    }
 
-  ///
-  /// Write a clock message for every unique timestamp in the data set
-  ///
+    data.set(sample.value, sample.time);
+    const auto& stamp = data.header.stamp;
+    const auto time_since_begin = sample.time_since_begin;
+
+    a2d2::ScopedStageTimer write_timer(stats, a2d2::Stage::BAG_WRITE);
+    bus_signal_sink.write(signal.header_topic, time_since_begin, stamp,
+                          data.header);
+    if (include_original) {
+      bus_signal_sink.write(signal.original_value_topic, time_since_begin,
+                            stamp, data.value);
+
+      if (!units_written[signal_idx]) {
+        units_written[signal_idx] = true;
+        std_msgs::String units_msg;
+        units_msg.data = signal.unit;
+
+        bus_signal_sink.write(signal.original_units_topic, time_since_begin,
+                              stamp, units_msg);
+      }
+    }
+
+    if (include_converted) {
+      ros_value_msg.data = sample.ros_value;
+      bus_signal_sink.write(signal.value_topic, time_since_begin, stamp,
+                            ros_value_msg);
+    }
+    write_timer.stop();
+    stats.add_frames(1);
+    progress.add();
+
+    if (include_clock_topic) {
+      a2d2::ScopedStageTimer clock_timer(stats, a2d2::Stage::CLOCK_WRITE);
+      clock.write(time_since_begin, stamp);
+    }
+    return true;
+  };
 
-  // TODO(jeff): add this to tf bag
-  if (include_clock_topic) {
-    X_INFO("Adding " << _CLOCK_TOPIC << " topic to TF bag file...");
+  const auto written =
+      (a2d2::merge_sorted_runs(runs, sample_less, write_sample) &&
+       write_tf_until(std::numeric_limits<uint64_t>::max()));
+  {
+    a2d2::ScopedStageTimer timer(stats, a2d2::Stage::BAG_CLOSE);
+    bus_signal_sink.close();
+    tf_sink.close();
   }
-  for (const auto& stamp : stamps) {
-    rosgraph_msgs::Clock clock_msg;
-    clock_msg.clock = stamp;
-    tf_bag.write(_CLOCK_TOPIC, stamp, clock_msg);
+  if (!written) {
+    return EXIT_FAILURE;
+  }
+  if (!data_opt->samples->good()) {
+    X_FATAL("Failed to read bus signal samples from: "
+            << data_opt->samples->get_path() << ". Cannot continue.");
+    return EXIT_FAILURE;
+  }
+  stats.add_bytes_out(bus_signal_sink.get_bytes_written());
+
+  if (stats_json_path_opt) {
+    stats.add_bytes_out(tf_sink.get_bytes_written());
+    if (!stats.write_json(*stats_json_path_opt, "bus_signals")) {
+      X_FATAL("Failed to write run report to: " << *stats_json_path_opt);
+      return EXIT_FAILURE;
+    }
+    X_INFO("Wrote run report to: " << *stats_json_path_opt);
   }
 
-  tf_bag.close();
   return EXIT_SUCCESS;
 }
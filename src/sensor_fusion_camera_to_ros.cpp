@@ -22,26 +22,38 @@
  * IN THE SOFTWARE.
  */
 #include <algorithm>
+#include <chrono>
 #include <limits>
-#include <set>
+#include <memory>
+#include <sstream>
+#include <vector>
 
 #include <boost/filesystem/convenience.hpp>  // TODO(jeff): use std::filesystem in C++17
 #include <boost/optional.hpp>
 #include <boost/program_options.hpp>
 
-#include <cv_bridge/cv_bridge.h>
 #include <ros/ros.h>
 #include <rosbag/bag.h>
-#include <rosgraph_msgs/Clock.h>
 #include <sensor_msgs/CameraInfo.h>
+#include <sensor_msgs/CompressedImage.h>
 #include <sensor_msgs/Image.h>
-#include <opencv2/highgui/highgui.hpp>
-#include <opencv2/opencv.hpp>
 
+#include "a2d2_to_ros/bag_utils.hpp"
+#include "a2d2_to_ros/checkpoint.hpp"
+#include "a2d2_to_ros/converters.hpp"
+#include "a2d2_to_ros/dry_run.hpp"
+#include "a2d2_to_ros/frame_index.hpp"
 #include "a2d2_to_ros/json_utils.hpp"
 #include "a2d2_to_ros/lib_a2d2_to_ros.hpp"
 #include "a2d2_to_ros/log_build_options.hpp"
+#include "a2d2_to_ros/logger.hpp"
 #include "a2d2_to_ros/logging.hpp"
+#include "a2d2_to_ros/manifest.hpp"
+#include "a2d2_to_ros/message_sink.hpp"
+#include "a2d2_to_ros/parallel.hpp"
+#include "a2d2_to_ros/prefetch.hpp"
+#include "a2d2_to_ros/run_stats.hpp"
+#include "a2d2_to_ros/sensor_config.hpp"
 
 namespace {
 namespace a2d2 = a2d2_to_ros;
@@ -55,14 +67,37 @@ namespace po = boost::program_options;
 static constexpr auto _PROGRAM_OPTIONS_LINE_LENGTH = 120u;
 static constexpr auto _CLOCK_TOPIC = "/clock";
 static constexpr auto _OUTPUT_PATH = ".";
+static constexpr auto _NODE_NAME = "a2d2_camera_converter";
 static constexpr auto _DATASET_NAMESPACE = "/a2d2";
 static constexpr auto _DATASET_SUFFIX = "camera";
 static constexpr auto _VERBOSE = false;
+static constexpr auto _LOG_LEVEL = "info";
+static constexpr auto _PROGRESS = 0u;
 static constexpr auto _INCLUDE_CLOCK_TOPIC = false;
+static constexpr auto _CLOCK_RATE = 0.0;
 static constexpr auto _START_TIME = static_cast<uint64_t>(0);
 static constexpr auto _MIN_TIME_OFFSET = 0.0;
 static constexpr auto _DURATION = std::numeric_limits<double>::max();
+static constexpr auto _SPLIT_DURATION = 0.0;
+static constexpr auto _CHECKPOINT_INTERVAL = 0.0;
+static constexpr auto _RESUME = false;
+static constexpr auto _COMPRESSION = "none";
+static constexpr auto _CHUNK_THRESHOLD =
+    a2d2_to_ros::BagOptions::DEFAULT_CHUNK_THRESHOLD;
+static constexpr auto _SINK = "bag";
+static constexpr auto _PUBLISH_SPEED = 1.0;
+static constexpr auto _VALIDATION = "full";
+static constexpr auto _FRAME_INDEX = true;
+static constexpr auto _COMPRESSED = false;
+static constexpr auto _JOBS = 1u;
+static constexpr auto _PREFETCH =
+    static_cast<unsigned>(a2d2_to_ros::PrefetchOptions::DEFAULT_DEPTH);
+static constexpr auto _PREFETCH_MEMORY = static_cast<unsigned>(
+    a2d2_to_ros::PrefetchOptions::DEFAULT_MAX_BYTES / (1024 * 1024));
+static constexpr auto _DRY_RUN = false;
+static constexpr auto _DRY_RUN_SAMPLES = 16u;
 static constexpr auto _SENSOR_CONFIG_FILENAME = "cams_lidars.json";
+static constexpr auto _SENSOR_CONFIG_CACHE = true;
 
 int main(int argc, char* argv[]) {
   X_INFO("<Camera Converter>");
@@ -73,18 +108,23 @@ int main(int argc, char* argv[]) {
   ///
 
   // TODO(jeff): rename "reflectance" to "intensity" assuming that's what it is
-  boost::optional<std::string> camera_path_opt;
+  std::vector<std::string> camera_path_args;
   boost::optional<std::string> camera_frame_schema_path_opt;
   boost::optional<std::string> sensor_config_path_opt;
   boost::optional<std::string> sensor_config_schema_path_opt;
+  boost::optional<std::string> stats_json_path_opt;
   po::options_description desc(
       "Convert sequential camera data to rosbag for the A2D2 Sensor Fusion "
       "data set. See README.md for details.\nAvailable options are listed "
       "below. Arguments without default values are required",
       _PROGRAM_OPTIONS_LINE_LENGTH);
   desc.add_options()("help,h", "Print help and exit.")(
-      "camera-data-path,c", po::value(&camera_path_opt)->required(),
-      "Path to the camera data files.")(
+      "camera-data-path,c",
+      po::value(&camera_path_args)->multitoken()->required(),
+      "Path to the camera data files. Several paths may be given, and a path "
+      "may also be the root of a drive (the directory with the 'camera' "
+      "subdirectory), which stands for every camera of that drive. Each "
+      "camera is written to its own bag file.")(
       "frame-info-schema-path,f",
       po::value(&camera_frame_schema_path_opt)->required(),
       "Path to the JSON schema for camera frame info files.")(
@@ -96,14 +136,97 @@ int main(int argc, char* argv[]) {
       "include-clock-topic,t",
       po::value<bool>()->default_value(_INCLUDE_CLOCK_TOPIC),
       "Optional: Use timestamps from the data to write a /clock topic.")(
+      "clock-rate", po::value<double>()->default_value(_CLOCK_RATE),
+      "Optional: Maximum rate (Hz) of /clock messages. A message is written "
+      "for every unique timestamp if this is 0.")(
       "start-time,a", po::value<uint64_t>()->default_value(_START_TIME),
       "Optional: Start on or after this time.")(
       "min-time-offset,m", po::value<double>()->default_value(_MIN_TIME_OFFSET),
       "Optional: Seconds to skip ahead in the data before starting the bag.")(
       "duration,d", po::value<double>()->default_value(_DURATION),
       "Optional: Seconds after min-time-offset to include in bag file.")(
+      "split-duration", po::value<double>()->default_value(_SPLIT_DURATION),
+      "Optional: Seconds of data to write to each bag file before starting a "
+      "new one in a 'timespan_<start>s_<end>s' subdirectory of the output "
+      "path. Splitting is disabled if this is 0.")(
+      "checkpoint-interval",
+      po::value<double>()->default_value(_CHECKPOINT_INTERVAL),
+      "Optional: Seconds of data to write between checkpoints, which are "
+      "saved to a '<bag filename>.checkpoint' file in the output path, so "
+      "that an interrupted run can be continued with --resume. Checkpoints "
+      "are disabled if this is 0.")(
+      "resume", po::value<bool>()->default_value(_RESUME),
+      "Optional: Continue from the checkpoint of an interrupted run with the "
+      "same inputs and options, instead of starting over. Starts from the "
+      "first frame if there is no checkpoint.")(
+      "compression", po::value<std::string>()->default_value(_COMPRESSION),
+      "Optional: Compression of the bag file chunks. One of 'none', 'bz2', or "
+      "'lz4'. Compressed chunks are written on a background thread.")(
+      "chunk-threshold",
+      po::value<uint32_t>()->default_value(_CHUNK_THRESHOLD),
+      "Optional: Bytes of messages to buffer before a chunk is written (and "
+      "compressed).")(
       "output-path,o", po::value<std::string>()->default_value(_OUTPUT_PATH),
       "Optional: Path for the output bag file.")(
+      "sink", po::value<std::string>()->default_value(_SINK),
+      "Optional: Where to write the messages. One of 'bag' (bag files in the "
+      "output path) or 'topics' (publish them to a running ROS master, paced "
+      "by their stamps).")(
+      "publish-speed", po::value<double>()->default_value(_PUBLISH_SPEED),
+      "Optional: Factor of real time to publish at with '--sink topics', e.g., "
+      "2 for twice as fast as recorded. Messages are published as fast as "
+      "possible if this is 0.")(
+      "validation", po::value<std::string>()->default_value(_VALIDATION),
+      "Optional: Schema validation of the camera frame info files. One of "
+      "'full' (validate every file), 'sample:N' (validate only the first N "
+      "files), or 'none'.")(
+      "frame-index", po::value<bool>()->default_value(_FRAME_INDEX),
+      "Optional: Cache frame timestamps in a '.a2d2_index' file in the camera "
+      "data directory, so that later runs do not need to read the frame info "
+      "files again.")(
+      "sensor-config-cache",
+      po::value<bool>()->default_value(_SENSOR_CONFIG_CACHE),
+      "Optional: Cache what is built from the vehicle/sensor config in a "
+      "'.a2d2_sensor_config' file next to it, so that later runs do not need "
+      "to parse and validate it again. The cache is rebuilt when the config "
+      "or its schema changes.")(
+      "compressed", po::value<bool>()->default_value(_COMPRESSED),
+      "Optional: Write the original PNG data as CompressedImage messages on "
+      "'<topic>/compressed' instead of decoding it to raw Image messages.")(
+      "jobs", po::value<unsigned>()->default_value(_JOBS),
+      "Optional: Number of worker threads. Up to this many cameras are "
+      "converted at once, and the remaining threads decode the PNG files of "
+      "each camera in parallel. Use 0 to use one thread per hardware "
+      "thread.")(
+      "prefetch", po::value<unsigned>()->default_value(_PREFETCH),
+      "Optional: Number of files (PNG files, and frame info files that are "
+      "not in the frame index) to read into memory ahead of their "
+      "conversion on a background thread of each camera. Use 0 to read each "
+      "file when it is converted.")(
+      "prefetch-memory",
+      po::value<unsigned>()->default_value(_PREFETCH_MEMORY),
+      "Optional: Megabytes of files that may be held in memory after they are "
+      "prefetched, shared by the cameras that are converted at once.")(
+      "dry-run", po::value<bool>()->default_value(_DRY_RUN),
+      "Optional: Convert only a sample of the frames of each camera, without "
+      "writing anything, and log the projected size of each bag (and of each "
+      "split window), the time the run would take, and the memory it would "
+      "need. With --stats-json, the projection is written there instead of "
+      "the run report.")(
+      "dry-run-samples",
+      po::value<unsigned>()->default_value(_DRY_RUN_SAMPLES),
+      "Optional: Number of frames of each camera to convert in a dry run, "
+      "evenly spaced over the selected frames.")(
+      "stats-json", po::value(&stats_json_path_opt),
+      "Optional: Write a JSON report of this run to this path: frame and byte "
+      "totals and rates, and the count, total, p50, and p99 latency of each "
+      "conversion stage.")(
+      "log-level", po::value<std::string>()->default_value(_LOG_LEVEL),
+      "Optional: Least severe messages to log. One of 'debug', 'info', "
+      "'warn', 'error', or 'fatal'.")(
+      "progress", po::value<unsigned>()->default_value(_PROGRESS),
+      "Optional: Log a progress line, with the rate, every this many frames. "
+      "Progress is not logged if this is 0.")(
       "verbose,v", po::value<bool>()->default_value(_VERBOSE),
       "Optional: Show name of each file after it is processed.");
 
@@ -125,168 +248,156 @@ int main(int argc, char* argv[]) {
     return EXIT_FAILURE;
   }
 
+  const auto log_level_opt =
+      a2d2::logging::get_level(vm["log-level"].as<std::string>());
+  if (!log_level_opt) {
+    X_FATAL("Log level '" << vm["log-level"].as<std::string>()
+                          << "' is not valid. It must be one of 'debug', "
+                             "'info', 'warn', 'error', or 'fatal'.");
+    return EXIT_FAILURE;
+  }
+  a2d2::logging::set_level(*log_level_opt);
+
   ///
   /// Get commandline parameters
   ///
 
-  const auto camera_path = *camera_path_opt;
+  std::vector<std::string> camera_paths;
+  for (const auto& arg : camera_path_args) {
+    const auto paths = a2d2::get_sensor_data_paths(arg, "camera");
+    camera_paths.insert(std::end(camera_paths), std::begin(paths),
+                        std::end(paths));
+  }
+  if (camera_paths.empty()) {
+    X_FATAL("No camera data directories were found in: "
+            << camera_path_args.front());
+    return EXIT_FAILURE;
+  }
   const auto camera_frame_schema_path = *camera_frame_schema_path_opt;
   const auto sensor_config_path =
       *sensor_config_path_opt + "/" + _SENSOR_CONFIG_FILENAME;
   const auto sensor_config_schema_path = *sensor_config_schema_path_opt;
   const auto output_path = vm["output-path"].as<std::string>();
   const auto verbose = vm["verbose"].as<bool>();
+  const auto progress_interval = vm["progress"].as<unsigned>();
   const auto include_clock_topic = vm["include-clock-topic"].as<bool>();
+  const auto clock_rate = vm["clock-rate"].as<double>();
   const auto start_time = vm["start-time"].as<uint64_t>();
   const auto min_time_offset = vm["min-time-offset"].as<double>();
   const auto duration = vm["duration"].as<double>();
+  const auto split_duration = vm["split-duration"].as<double>();
+  const auto checkpoint_interval = vm["checkpoint-interval"].as<double>();
+  const auto resume = vm["resume"].as<bool>();
+  const auto publish_speed = vm["publish-speed"].as<double>();
+  const auto use_frame_index = vm["frame-index"].as<bool>();
+  const auto use_sensor_config_cache = vm["sensor-config-cache"].as<bool>();
+  const auto compressed = vm["compressed"].as<bool>();
+  const auto num_jobs = a2d2::get_num_jobs(vm["jobs"].as<unsigned>());
+  const auto dry_run = vm["dry-run"].as<bool>();
+  const auto dry_run_samples = vm["dry-run-samples"].as<unsigned>();
+  a2d2::PrefetchOptions prefetch_options;
+  prefetch_options.depth = vm["prefetch"].as<unsigned>();
+  prefetch_options.max_bytes =
+      (static_cast<size_t>(vm["prefetch-memory"].as<unsigned>()) * 1024 * 1024);
+
+  // stages are only timed if a report was requested
+  a2d2::RunStats stats(static_cast<bool>(stats_json_path_opt));
 
   const auto valid_min_offset = (std::isfinite(min_time_offset) &&
                                  a2d2::strictly_non_negative(min_time_offset));
   const auto valid_duration =
       (std::isfinite(duration) && a2d2::strictly_non_negative(duration));
-  if (!valid_min_offset || !valid_duration) {
+  const auto valid_split_duration =
+      (std::isfinite(split_duration) &&
+       a2d2::strictly_non_negative(split_duration));
+  if (!valid_min_offset || !valid_duration || !valid_split_duration) {
     X_FATAL(
         "Time constraints {min-time-offset: "
         << min_time_offset << ", duration: " << duration
+        << ", split-duration: " << split_duration
         << "} are not valid. They must be finite, real valued, and >= 0.0.");
     return EXIT_FAILURE;
   }
-
-  ///
-  /// Get the JSON for vehicle/sensor config
-  ///
-
-  auto d_sensor_config_opt = a2d2::get_rapidjson_dom(sensor_config_path);
-  if (!d_sensor_config_opt) {
-    X_FATAL("Could not open '" << sensor_config_path);
+  if (!std::isfinite(clock_rate) || !a2d2::strictly_non_negative(clock_rate)) {
+    X_FATAL("Clock rate " << clock_rate
+                          << " is not valid. It must be finite and >= 0.0.");
     return EXIT_FAILURE;
   }
-  auto& sensor_config_d = *d_sensor_config_opt;
-
-  ///
-  /// Get the JSON schema for the config JSON
-  ///
-
-  auto d_schema_opt = a2d2::get_rapidjson_dom(sensor_config_schema_path);
-  if (!d_schema_opt) {
-    X_FATAL("Could not open '" << sensor_config_schema_path);
+  if (!std::isfinite(checkpoint_interval) ||
+      !a2d2::strictly_non_negative(checkpoint_interval)) {
+    X_FATAL("Checkpoint interval "
+            << checkpoint_interval
+            << " is not valid. It must be finite and >= 0.0.");
     return EXIT_FAILURE;
   }
-  auto& schema_d = *d_schema_opt;
-  rapidjson::SchemaDocument config_schema(schema_d);
 
-  ///
-  /// Validate the data set against the schema
-  ///
-
-  {
-    rapidjson::SchemaValidator validator(config_schema);
-    if (!sensor_config_d.Accept(validator)) {
-      const auto err_string = a2d2::get_validator_error_string(validator);
-      X_FATAL(err_string);
-      return EXIT_FAILURE;
-    }
-    X_INFO("Validated: " << sensor_config_schema_path);
+  const auto compression_opt =
+      a2d2::get_compression_type(vm["compression"].as<std::string>());
+  if (!compression_opt) {
+    X_FATAL("Compression '" << vm["compression"].as<std::string>()
+                            << "' is not valid. It must be one of 'none', "
+                               "'bz2', or 'lz4'.");
+    return EXIT_FAILURE;
   }
-
-  ///
-  /// Generate camera info messages
-  ///
-  std::unordered_map<std::string, sensor_msgs::CameraInfo> camera_info_msgs;
-  {
-    const auto sensor_names = a2d2::sensors::Frames::get_sensors();
-    for (const auto& name : sensor_names) {
-      // No cameras at these positions
-      const auto is_rear_left = (name == "rear_left");
-      const auto is_rear_right = (name == "rear_right");
-      if (is_rear_left || is_rear_right) {
-        continue;
-      }
-      if (verbose) {
-        X_INFO("Getting camera info for: " << name);
-      }
-
-      camera_info_msgs[name] = sensor_msgs::CameraInfo();
-      auto& msg = camera_info_msgs[name];
-
-      const rapidjson::Value& camera =
-          sensor_config_d[a2d2::sensors::Names::CAMERAS.c_str()][name.c_str()];
-
-      const std::string camera_type = camera["Lens"].GetString();
-      const auto is_fisheye = (camera_type == "Fisheye");
-
-      // TODO(jeff): verify that this is right
-      msg.D.resize(5, 0.0);
-      const auto ROW_IDX = static_cast<rapidjson::SizeType>(0);
-      const auto D_size = static_cast<rapidjson::SizeType>(is_fisheye ? 4 : 5);
-      for (auto i = 0; i < D_size; ++i) {
-        const auto IDX = static_cast<rapidjson::SizeType>(i);
-        msg.D[i] = camera["Distortion"][ROW_IDX][IDX].GetDouble();
-      }
-
-      {
-        const rapidjson::Value& camera_matrix_raw = camera["CamMatrixOriginal"];
-        for (auto i = 0; i < camera_matrix_raw.Size(); ++i) {
-          const auto row_idx = static_cast<rapidjson::SizeType>(i);
-          for (auto j = 0; j < camera_matrix_raw[row_idx].Size(); ++j) {
-            const auto col_idx = static_cast<rapidjson::SizeType>(j);
-            const auto msg_idx = ((row_idx * 3) + col_idx);
-            msg.K[msg_idx] = camera_matrix_raw[row_idx][col_idx].GetDouble();
-          }
-        }
-      }
-
-      {
-        msg.P.fill(0.0);
-        const rapidjson::Value& camera_matrix = camera["CamMatrix"];
-        for (auto i = 0; i < camera_matrix.Size(); ++i) {
-          const auto row_idx = static_cast<rapidjson::SizeType>(i);
-          for (auto j = 0; j < camera_matrix[row_idx].Size(); ++j) {
-            const auto col_idx = static_cast<rapidjson::SizeType>(j);
-            const auto msg_idx = ((row_idx * 4) + col_idx);
-            msg.P[msg_idx] = camera_matrix[row_idx][col_idx].GetDouble();
-          }
-        }
-      }
-
-      constexpr auto WIDTH_IDX = static_cast<rapidjson::SizeType>(0);
-      constexpr auto HEIGHT_IDX = static_cast<rapidjson::SizeType>(1);
-      msg.width = camera["Resolution"][WIDTH_IDX].GetInt64();
-      msg.height = camera["Resolution"][HEIGHT_IDX].GetInt64();
-
-      msg.binning_x = 0;
-      msg.binning_y = 0;
-
-      msg.roi.x_offset = 0;
-      msg.roi.y_offset = 0;
-      msg.roi.height = 0;
-      msg.roi.width = 0;
-      msg.roi.do_rectify = false;
-    }
+  const auto chunk_threshold = vm["chunk-threshold"].as<uint32_t>();
+  if (chunk_threshold == 0) {
+    X_FATAL("Chunk threshold must be > 0.");
+    return EXIT_FAILURE;
+  }
+  a2d2::BagOptions bag_options;
+  bag_options.compression = *compression_opt;
+  bag_options.chunk_threshold = chunk_threshold;
+
+  const auto sink_opt = a2d2::get_sink_type(vm["sink"].as<std::string>());
+  if (!sink_opt) {
+    X_FATAL("Sink '" << vm["sink"].as<std::string>()
+                     << "' is not valid. It must be one of 'bag' or 'topics'.");
+    return EXIT_FAILURE;
+  }
+  if (!std::isfinite(publish_speed) ||
+      !a2d2::strictly_non_negative(publish_speed)) {
+    X_FATAL("Publish speed " << publish_speed
+                             << " is not valid. It must be finite and >= 0.0.");
+    return EXIT_FAILURE;
+  }
+  const auto publish = (*sink_opt == a2d2::SinkType::TOPICS);
+  if (publish && (resume || a2d2::strictly_positive(checkpoint_interval))) {
+    X_FATAL("Checkpoints and resuming only apply to bag files, not topics.");
+    return EXIT_FAILURE;
+  }
+  if (dry_run && (publish || resume)) {
+    X_FATAL("Dry runs only apply to new bag files, not topics or resuming.");
+    return EXIT_FAILURE;
+  }
+  if (dry_run_samples == 0) {
+    X_FATAL("Dry run samples must be > 0.");
+    return EXIT_FAILURE;
   }
 
-  boost::filesystem::path d(camera_path);
-  const auto timestamp = d.parent_path().parent_path().filename().string();
-
-  const auto file_basename =
-      (timestamp + "_" + boost::filesystem::basename(camera_path));
+  const auto validation_policy_opt =
+      a2d2::get_validation_policy(vm["validation"].as<std::string>());
+  if (!validation_policy_opt) {
+    X_FATAL("Validation policy '"
+            << vm["validation"].as<std::string>()
+            << "' is not valid. It must be 'full', 'sample:N', or 'none'.");
+    return EXIT_FAILURE;
+  }
+  const auto& validation_policy = *validation_policy_opt;
 
   ///
-  /// Get list of .png file names
+  /// Get the camera info messages from the vehicle/sensor config, either from
+  /// its cache or by validating the JSON against its schema
   ///
 
-  std::set<std::string> files;
-  boost::filesystem::directory_iterator it{d};
-  while (it != boost::filesystem::directory_iterator{}) {
-    const auto path = it->path().string();
-    const auto extension = it->path().extension().string();
-    ++it;
-    if (extension != ".png") {
-      continue;
-    }
-    files.insert(path);
+  const auto sensor_config_opt = a2d2::get_sensor_config(
+      sensor_config_path, sensor_config_schema_path, use_sensor_config_cache);
+  if (!sensor_config_opt) {
+    X_FATAL("Could not get the vehicle/sensor config from: "
+            << sensor_config_path);
+    return EXIT_FAILURE;
   }
+  const a2d2::CameraFrameConverter converter(
+      compressed, sensor_config_opt->camera_infos, stats);
 
   ///
   /// Get the JSON schema for the camera frame info files
@@ -302,164 +413,472 @@ int main(int argc, char* argv[]) {
   rapidjson::SchemaDocument camera_frame_schema(camera_frame_d);
 
   ///
-  /// Load each png file, convert to Image message, write to bag
+  /// Each camera directory is converted by its own lane, which has its own
+  /// frame index, prefetchers, and bag file. Lanes share nothing but the
+  /// (read-only) camera info messages and schema, the run stats, and the
+  /// publisher if there is one, so up to num_lanes of them run at once and
+  /// split the remaining jobs.
   ///
 
-  X_INFO("Attempting to convert camera data. This may take a while...");
+  std::unique_ptr<a2d2::TopicPublisher> publisher;
+  if (publish) {
+    ros::init(argc, argv, _NODE_NAME,
+              (ros::init_options::NoSigintHandler |
+               ros::init_options::AnonymousName));
+    if (!ros::master::check()) {
+      X_FATAL("Cannot publish messages. The ROS master is not running.");
+      return EXIT_FAILURE;
+    }
+    publisher.reset(new a2d2::TopicPublisher(publish_speed));
+  }
+
+  // when publishing, every camera is converted at once, so that the messages of
+  // all cameras are paced together
+  const auto num_lanes =
+      (publish ? camera_paths.size() : std::min(num_jobs, camera_paths.size()));
+  const auto lane_jobs = std::max(num_jobs / num_lanes, static_cast<size_t>(1));
+  auto lane_prefetch_options = prefetch_options;
+  lane_prefetch_options.max_bytes = (prefetch_options.max_bytes / num_lanes);
+
+  struct Frame {
+    std::string path;
+    std::string sensor_name;
+    uint64_t timestamp;
+  };  // struct Frame
+
+  // shared by the lanes of a dry run, each of which projects its own bag
+  a2d2::DryRun estimator(min_time_offset, split_duration);
+
+  // what is needed to write the messages of a camera, which is resolved once
+  // per directory; a directory only holds the frames of a single camera
+  struct CameraWriter {
+    std::string image_topic;
+    std::string info_topic;
+    // restamped and written along with every image
+    sensor_msgs::CameraInfo info;
+  };  // struct CameraWriter
+
+  // the converter is thread-safe, so lanes can share it
+  const auto convert_camera =
+      [&](size_t lane_idx) -> boost::optional<uint64_t> {
+    const auto& camera_path = camera_paths[lane_idx];
+    boost::filesystem::path d(camera_path);
+    const auto timestamp = d.parent_path().parent_path().filename().string();
+
+    const auto file_basename =
+        (timestamp + "_" + boost::filesystem::basename(camera_path));
 
-  std::set<ros::Time> stamps;
-  rosbag::Bag bag;
-  const auto bag_name = output_path + "/" + file_basename + "_" +
-                        std::string(_DATASET_SUFFIX) + ".bag";
-  X_INFO("Creating bag file at: " << bag_name);
-  bag.open(bag_name, rosbag::bagmode::Write);
-  boost::optional<ros::Time> first_time;
-  for (const auto& f : files) {
     ///
-    /// Get camera data file for timestamp information
+    /// Pair each .png file with its frame info file by sequence number, from a
+    /// single listing of the directory
     ///
 
-    ros::Time frame_timestamp_ros;
+    std::vector<a2d2::ManifestEntry> manifest;
     {
-      const auto p = boost::filesystem::path(f);
-      const auto b = boost::filesystem::basename(p);
-      const auto camera_data_file = (camera_path + "/" + b + ".json");
-      const auto json_string = a2d2::get_file_as_string(camera_data_file);
-      if (json_string.empty()) {
-        X_FATAL("'" << camera_data_file << "' failed to open or is empty.");
-        bag.close();
-        return EXIT_FAILURE;
+      a2d2::ScopedStageTimer timer(stats, a2d2::Stage::SCAN);
+      auto files_opt = a2d2::list_directory(camera_path);
+      if (!files_opt) {
+        X_FATAL("Could not open camera data directory: " << camera_path);
+        return boost::none;
       }
-
-      rapidjson::Document d_json;
-      if (d_json.Parse(json_string.c_str()).HasParseError()) {
-        X_FATAL("Error(offset "
-                << static_cast<unsigned>(d_json.GetErrorOffset()) << "): "
-                << rapidjson::GetParseError_En(d_json.GetParseError()));
-        bag.close();
-        return EXIT_FAILURE;
+      auto manifest_opt =
+          a2d2::build_manifest((*files_opt)[".png"], (*files_opt)[".json"]);
+      if (!manifest_opt) {
+        X_FATAL("Failed to match images to frame info files in: "
+                << camera_path);
+        return boost::none;
       }
+      manifest = std::move(*manifest_opt);
+    }
 
-      ///
-      /// Validate the data set against the schema
-      ///
+    ///
+    /// Get the timestamp of each camera frame, either from the frame index or
+    /// from its frame info file
+    ///
 
-      {
-        rapidjson::SchemaValidator validator(camera_frame_schema);
-        if (!d_json.Accept(validator)) {
-          const auto err_string = a2d2::get_validator_error_string(validator);
-          X_FATAL(err_string);
-          bag.close();
-          return EXIT_FAILURE;
+    auto frame_index = (use_frame_index ? a2d2::FrameIndex::load(camera_path)
+                                        : a2d2::FrameIndex());
+
+    // the frame info files that are not in the index are read ahead, in order
+    std::vector<std::string> camera_data_files;
+    for (const auto& entry : manifest) {
+      if (!frame_index.get_timestamp(entry.info_basename)) {
+        camera_data_files.push_back(entry.info_path);
+      }
+    }
+    a2d2::FilePrefetcher json_prefetcher(camera_data_files,
+                                         lane_prefetch_options);
+
+    a2d2::FrameTimestampReader timestamp_reader(camera_frame_schema);
+    size_t file_idx = 0;
+    std::vector<uint8_t> json_bytes;
+    std::vector<Frame> frames;
+    for (const auto& entry : manifest) {
+      const auto& b = entry.info_basename;
+
+      auto frame_timestamp_opt = frame_index.get_timestamp(b);
+      if (!frame_timestamp_opt) {
+        const auto& camera_data_file = camera_data_files[file_idx];
+        a2d2::ScopedStageTimer read_timer(stats, a2d2::Stage::JSON_READ);
+        const auto read = json_prefetcher.take(file_idx, json_bytes);
+        read_timer.stop();
+        if (!read || json_bytes.empty()) {
+          X_FATAL("'" << camera_data_file << "' failed to open or is empty.");
+          return boost::none;
+        }
+        stats.add_bytes_in(json_bytes.size());
+        // the text is parsed in place, which needs it to be null-terminated
+        json_bytes.push_back('\0');
+
+        const auto validate = validation_policy.should_validate(file_idx++);
+        a2d2::ScopedStageTimer parse_timer(
+            stats,
+            (validate ? a2d2::Stage::JSON_VALIDATE : a2d2::Stage::JSON_PARSE));
+        frame_timestamp_opt = timestamp_reader.read_insitu(
+            reinterpret_cast<char*>(json_bytes.data()), validate);
+        parse_timer.stop();
+        if (!frame_timestamp_opt) {
+          X_FATAL("'" << camera_data_file << "': "
+                      << timestamp_reader.get_error_string());
+          return boost::none;
         }
-        if (verbose) {
+        if (verbose && validate) {
           X_INFO("Validated: " << camera_data_file);
         }
+        frame_index.set_timestamp(b, *frame_timestamp_opt);
       }
 
-      const auto frame_timestamp = d_json["cam_tstamp"].GetUint64();
+      frames.push_back(
+          {entry.data_path, entry.sensor_name, *frame_timestamp_opt});
+    }
 
-      if (frame_timestamp < start_time) {
-        continue;
+    if (use_frame_index && frame_index.is_modified()) {
+      if (frame_index.save(camera_path)) {
+        X_INFO("Updated frame index in: " << camera_path);
+      } else {
+        X_WARN("Failed to write frame index to: " << camera_path);
       }
+    }
 
-      frame_timestamp_ros = a2d2::a2d2_timestamp_to_ros_time(frame_timestamp);
+    ///
+    /// Select the frames that fall in the requested timespan
+    ///
+
+    std::stable_sort(std::begin(frames), std::end(frames),
+                     [](const Frame& lhs, const Frame& rhs) {
+                       return (lhs.timestamp < rhs.timestamp);
+                     });
+
+    boost::optional<ros::Time> first_time;
+    {
+      std::vector<uint64_t> timestamps;
+      timestamps.reserve(frames.size());
+      for (const auto& frame : frames) {
+        timestamps.push_back(frame.timestamp);
+      }
+
+      const auto window = a2d2::get_frame_window(timestamps, start_time,
+                                                 min_time_offset, duration);
+      frames.erase(std::begin(frames) + window.end, std::end(frames));
+      frames.erase(std::begin(frames), std::begin(frames) + window.begin);
+      first_time = window.first_time;
     }
 
-    if (!first_time) {
-      if (start_time != _START_TIME) {
-        first_time = a2d2::a2d2_timestamp_to_ros_time(start_time);
-      } else {
-        first_time = frame_timestamp_ros;
+    ///
+    /// Skip the frames that an interrupted run already wrote, if resuming
+    ///
+
+    const auto bag_name =
+        (file_basename + "_" + std::string(_DATASET_SUFFIX) + ".bag");
+    const auto checkpoint_path =
+        (output_path + "/" + bag_name + a2d2::Checkpoint::FILENAME_SUFFIX);
+
+    // every option that the bag depends on, along with the selected frames
+    std::stringstream settings;
+    settings.precision(std::numeric_limits<double>::max_digits10);
+    settings << start_time << " " << min_time_offset << " " << duration << " "
+             << split_duration << " " << vm["compression"].as<std::string>()
+             << " " << chunk_threshold << " " << include_clock_topic << " "
+             << clock_rate << " " << compressed;
+    std::vector<std::string> frame_paths;
+    for (const auto& frame : frames) {
+      frame_paths.push_back(frame.path);
+    }
+    const auto checkpoint_key =
+        a2d2::get_checkpoint_key(settings.str(), frame_paths);
+
+    ///
+    /// In a dry run, keep the offsets of all frames to project the bag from,
+    /// but only convert a sample of them
+    ///
+
+    size_t dry_run_lane = 0;
+    if (dry_run) {
+      std::vector<double> frame_offsets;
+      for (const auto& frame : frames) {
+        frame_offsets.push_back(
+            (a2d2::a2d2_timestamp_to_ros_time(frame.timestamp) - *first_time)
+                .toSec());
       }
+      dry_run_lane = estimator.add_lane(std::move(frame_offsets),
+                                        (2 * lane_jobs), {bag_name});
+
+      std::vector<Frame> samples;
+      for (const auto idx :
+           a2d2::get_sample_indices(frames.size(), dry_run_samples)) {
+        samples.push_back(frames[idx]);
+      }
+      frames = std::move(samples);
     }
 
-    const auto time_since_begin = (frame_timestamp_ros - *first_time).toSec();
-    if (time_since_begin < min_time_offset) {
-      continue;
+    size_t resumed_frames = 0;
+    boost::optional<a2d2::Checkpoint> checkpoint_opt;
+    if (resume) {
+      checkpoint_opt = a2d2::get_resume_checkpoint(
+          checkpoint_path, checkpoint_key, frames.size());
+      if (!checkpoint_opt) {
+        X_FATAL("Cannot resume. Remove '" << checkpoint_path
+                                          << "' to start over.");
+        return boost::none;
+      }
+      resumed_frames = checkpoint_opt->next_frame;
+      frames.erase(std::begin(frames), std::begin(frames) + resumed_frames);
     }
 
-    const auto recorded_duration = (time_since_begin - min_time_offset);
-    if (recorded_duration > duration) {
-      break;
+    ///
+    /// Resolve the camera of the directory, and its topics
+    ///
+
+    CameraWriter writer;
+    writer.image_topic =
+        (std::string(_DATASET_NAMESPACE) + "/" + file_basename + "/" +
+         std::string(_DATASET_SUFFIX) + (compressed ? "/compressed" : ""));
+    writer.info_topic = (std::string(_DATASET_NAMESPACE) + "/" +
+                         file_basename + "/camera_info");
+    if (!frames.empty()) {
+      const auto& camera_name = frames.front().sensor_name;
+      const auto info_opt = converter.get_camera_info(camera_name);
+      if (!info_opt) {
+        X_FATAL("Did not find camera info for: " << camera_name
+                                                 << ". Cannot continue.");
+        return boost::none;
+      }
+      writer.info = *info_opt;
     }
 
     ///
-    /// Build image message
+    /// Load each png file and convert it to an Image message. This is done
+    /// by lane_jobs workers, and the results are written to the bag in order
+    /// by the lane's thread; rosbag::Bag is not thread-safe.
     ///
 
-    const auto camera_file_name = a2d2::frame_from_filename(f);
-    const auto camera_name =
-        a2d2::get_camera_name_from_frame_name(camera_file_name);
-    const auto frame =
-        a2d2::tf_frame_name(a2d2::sensors::Names::CAMERAS, camera_name);
-    if (frame.empty()) {
-      X_FATAL("Could not find frame name in filename: "
-              << f << ". Cannot continue.");
-      bag.close();
-      return EXIT_FAILURE;
+    std::vector<std::string> image_paths;
+    for (const auto& selected : frames) {
+      image_paths.push_back(selected.path);
     }
+    a2d2::FilePrefetcher image_prefetcher(image_paths, lane_prefetch_options);
+    // PNG buffers go back to the prefetcher once they have been decoded or
+    // written, so that it can read the next files into them
+    a2d2::ObjectPool<std::vector<uint8_t>> png_buffers;
+
+    const auto convert_frame =
+        [&](size_t idx) -> boost::optional<a2d2::CameraFrameMessages> {
+      const auto& f = frames[idx].path;
+
+      // taken first, since a later frame's take waits for this one
+      a2d2::ScopedStageTimer load_timer(stats, a2d2::Stage::IMAGE_LOAD);
+      auto png_bytes = png_buffers.take();
+      if (!image_prefetcher.take(idx, png_bytes)) {
+        X_FATAL("'" << f << "' failed to open. Cannot continue.");
+        return boost::none;
+      }
+      load_timer.stop();
+      stats.add_bytes_in(png_bytes.size());
 
-    std_msgs::Header header;
-    header.frame_id = frame;
-    header.stamp = frame_timestamp_ros;
+      ///
+      /// Build image message
+      ///
 
-    cv::Mat img = cv::imread(f);
-    auto msg_ptr = cv_bridge::CvImage(header, "bgr8", img).toImageMsg();
+      auto messages = converter.convert(
+          png_bytes, frames[idx].sensor_name,
+          a2d2::a2d2_timestamp_to_ros_time(frames[idx].timestamp));
+      if (!compressed) {
+        png_buffers.give(std::move(png_bytes));
+      }
+      if (!messages) {
+        X_FATAL("'" << f << "' failed to convert. Cannot continue.");
+      }
+      return messages;
+    };
 
-    auto it_cam_info = camera_info_msgs.find(camera_name);
-    if (std::end(camera_info_msgs) == it_cam_info) {
-      X_ERROR("Did not find camera info for: " << camera_name);
-    } else {
-      // X_INFO("Found camera info for: " << camera_name);
+    ///
+    /// In a dry run, convert the sampled frames one at a time to measure them,
+    /// instead of writing anything
+    ///
+
+    if (dry_run) {
+      for (size_t idx = 0; idx < frames.size(); ++idx) {
+        const auto start = a2d2::RunStats::Clock::now();
+        auto messages = convert_frame(idx);
+        if (!messages) {
+          return boost::none;
+        }
+        const auto seconds = std::chrono::duration<double>(
+                                 a2d2::RunStats::Clock::now() - start)
+                                 .count();
+        const auto image_bytes =
+            (compressed ? a2d2::get_bag_record_size(*messages->compressed_image)
+                        : a2d2::get_bag_record_size(*messages->image));
+        estimator.add_sample(
+            dry_run_lane, seconds,
+            {(image_bytes + a2d2::get_bag_record_size(writer.info))});
+      }
+      if (verbose) {
+        X_INFO("Sampled: " << camera_path);
+      }
+      return static_cast<uint64_t>(0);
     }
-    it_cam_info->second.header = msg_ptr->header;
 
     ///
-    /// Write message to bag file
+    /// Write messages to bag file, or publish them
     ///
 
-    // message time is the max timestamp of all points in the message
-    const auto image_topic =
-        (std::string(_DATASET_NAMESPACE) + "/" + file_basename + "/" +
-         std::string(_DATASET_SUFFIX));
-    const auto info_topic = (std::string(_DATASET_NAMESPACE) + "/" +
-                             file_basename + "/camera_info");
-    bag.write(image_topic, msg_ptr->header.stamp, *msg_ptr);
-    bag.write(info_topic, msg_ptr->header.stamp, it_cam_info->second);
-
-    if (include_clock_topic) {
-      stamps.insert(msg_ptr->header.stamp);
+    auto sink = a2d2::make_message_sink(publisher.get(), output_path, bag_name,
+                                        min_time_offset, split_duration,
+                                        bag_options);
+    if (checkpoint_opt && !sink.resume(checkpoint_opt->segments)) {
+      X_FATAL("Failed to resume the bag file(s) of: " << checkpoint_path);
+      return boost::none;
     }
+    a2d2::CheckpointWriter checkpoints(checkpoint_path, checkpoint_key,
+                                       checkpoint_interval);
+    // frames are written in time order, so the clock is written along with them
+    a2d2::ClockWriter clock(sink, _CLOCK_TOPIC, clock_rate);
+
+    // the message time is the same as the header stamp
+    a2d2::logging::ProgressLogger progress(
+        camera_path, "frames", frames.size(), progress_interval);
+    const auto write_frame = [&](size_t idx,
+                                 a2d2::CameraFrameMessages& messages) {
+      const auto& stamp = messages.header.stamp;
+      const auto time_since_begin = (stamp - *first_time).toSec();
+      {
+        a2d2::ScopedStageTimer timer(stats, a2d2::Stage::BAG_WRITE);
+        if (compressed) {
+          sink.write(writer.image_topic, time_since_begin, stamp,
+                     *messages.compressed_image);
+        } else {
+          sink.write(writer.image_topic, time_since_begin, stamp,
+                     *messages.image);
+        }
+        // the sink serializes the message right away, so it can be restamped
+        writer.info.header.stamp = stamp;
+        sink.write(writer.info_topic, time_since_begin, stamp, writer.info);
+      }
+      if (compressed) {
+        // the sink has its own copy now, so the buffer can be refilled
+        png_buffers.give(std::move(messages.compressed_image->data));
+      }
+      stats.add_frames(1);
+      progress.add();
 
-    if (verbose) {
-      X_INFO("Processed: " << f);
-    }
-  }
+      if (include_clock_topic) {
+        a2d2::ScopedStageTimer timer(stats, a2d2::Stage::CLOCK_WRITE);
+        clock.write(time_since_begin, stamp);
+      }
+      if (!checkpoints.update(time_since_begin, (resumed_frames + idx + 1),
+                              {&sink})) {
+        X_WARN("Failed to write checkpoint to: " << checkpoint_path);
+      }
 
-  ///
-  /// Write a clock message for every unique timestamp in the data set
-  ///
+      if (verbose) {
+        X_INFO("Processed: " << frames[idx].path);
+      }
+      return true;
+    };
+
+    const auto converted =
+        a2d2::ordered_parallel_for<a2d2::CameraFrameMessages>(
+            frames.size(), lane_jobs, (2 * lane_jobs), convert_frame,
+            write_frame);
+    if (!converted) {
+      X_FATAL("Failed to convert camera data in: " << camera_path);
+      sink.close();
+      return boost::none;
+    }
 
-  if (include_clock_topic) {
-    X_INFO("Adding " << _CLOCK_TOPIC << " topic...");
-    if (stamps.size() != files.size()) {
+    // frames are windowed (and resumed) before they are converted, so without
+    // a clock rate, there is a stamp for each one, unless stamps repeat
+    if (include_clock_topic && !a2d2::strictly_positive(clock_rate) &&
+        (clock.get_num_stamps() != frames.size())) {
       X_WARN("Number of frame timestamps ("
-             << stamps.size()
-             << ") is different than the total number of frames ("
-             << files.size()
-             << "). This should only happen if the min time offset and/or "
-                "duration excludes some parts of the data set.");
+             << clock.get_num_stamps()
+             << ") is different than the number of frames converted ("
+             << frames.size() << ") in " << camera_path
+             << ". Some frames repeat the timestamp of, or are older than, "
+                "the frame before them.");
+    }
+
+    {
+      a2d2::ScopedStageTimer timer(stats, a2d2::Stage::BAG_CLOSE);
+      sink.close();
+    }
+    if (!publish) {
+      // the bag is complete, so there is nothing left to resume
+      checkpoints.remove();
+    }
+
+    if (verbose) {
+      X_INFO("Finished: " << camera_path);
     }
+    return sink.get_bytes_written();
+  };
+
+  uint64_t bytes_written = 0;
+  const auto add_bytes_written = [&bytes_written](size_t, uint64_t bytes) {
+    bytes_written += bytes;
+    return true;
+  };
+
+  X_INFO("Attempting to convert camera data of "
+         << camera_paths.size() << " camera(s) using " << num_jobs
+         << " job(s). This may take a while...");
+
+  const auto converted = a2d2::ordered_parallel_for<uint64_t>(
+      camera_paths.size(), num_lanes, num_lanes, convert_camera,
+      add_bytes_written);
+  if (!converted) {
+    X_FATAL("Failed to convert camera data. Cannot continue.");
+    return EXIT_FAILURE;
   }
 
-  for (const auto& stamp : stamps) {
-    rosgraph_msgs::Clock clock_msg;
-    clock_msg.clock = stamp;
-    bag.write(_CLOCK_TOPIC, stamp, clock_msg);
+  if (dry_run) {
+    // prefetched files and the chunk of every open bag are held throughout
+    const auto prefetch_bytes =
+        ((prefetch_options.depth > 0) ? prefetch_options.max_bytes : 0);
+    const auto report = estimator.project(
+        num_jobs, (prefetch_bytes + (num_lanes * chunk_threshold)));
+    report.log();
+    if (stats_json_path_opt) {
+      if (!report.write_json(*stats_json_path_opt, _DATASET_SUFFIX)) {
+        X_FATAL("Failed to write dry run report to: " << *stats_json_path_opt);
+        return EXIT_FAILURE;
+      }
+      X_INFO("Wrote dry run report to: " << *stats_json_path_opt);
+    }
+
+    X_INFO("Done.");
+    return EXIT_SUCCESS;
   }
 
-  bag.close();
+  if (stats_json_path_opt) {
+    stats.add_bytes_out(bytes_written);
+    if (!stats.write_json(*stats_json_path_opt, _DATASET_SUFFIX)) {
+      X_FATAL("Failed to write run report to: " << *stats_json_path_opt);
+      return EXIT_FAILURE;
+    }
+    X_INFO("Wrote run report to: " << *stats_json_path_opt);
+  }
 
   X_INFO("Done.");
   return EXIT_SUCCESS;
@@ -22,8 +22,12 @@
  * IN THE SOFTWARE.
  */
 #include <algorithm>
+#include <chrono>
 #include <limits>
-#include <set>
+#include <memory>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
 
 #include <boost/filesystem/convenience.hpp>  // TODO(jeff): use std::filesystem in C++17
 #include <boost/optional.hpp>
@@ -32,14 +36,28 @@
 #include <ros/ros.h>
 #include <rosbag/bag.h>
 #include <rosbag/view.h>
-#include <rosgraph_msgs/Clock.h>
+#include <sensor_msgs/CameraInfo.h>
+#include <sensor_msgs/Image.h>
 #include <sensor_msgs/PointCloud2.h>
 #include <opencv2/opencv.hpp>
 
+#include "a2d2_to_ros/bag_utils.hpp"
+#include "a2d2_to_ros/checkpoint.hpp"
+#include "a2d2_to_ros/converters.hpp"
+#include "a2d2_to_ros/downsample.hpp"
+#include "a2d2_to_ros/dry_run.hpp"
+#include "a2d2_to_ros/frame_index.hpp"
 #include "a2d2_to_ros/json_utils.hpp"
 #include "a2d2_to_ros/lib_a2d2_to_ros.hpp"
 #include "a2d2_to_ros/log_build_options.hpp"
+#include "a2d2_to_ros/logger.hpp"
 #include "a2d2_to_ros/logging.hpp"
+#include "a2d2_to_ros/manifest.hpp"
+#include "a2d2_to_ros/message_sink.hpp"
+#include "a2d2_to_ros/parallel.hpp"
+#include "a2d2_to_ros/prefetch.hpp"
+#include "a2d2_to_ros/run_stats.hpp"
+#include "a2d2_to_ros/sensor_config.hpp"
 #include "ros_cnpy/cnpy.h"
 
 namespace {
@@ -54,14 +72,43 @@ namespace po = boost::program_options;
 static constexpr auto _PROGRAM_OPTIONS_LINE_LENGTH = 120u;
 static constexpr auto _CLOCK_TOPIC = "/clock";
 static constexpr auto _OUTPUT_PATH = ".";
+static constexpr auto _NODE_NAME = "a2d2_lidar_converter";
 static constexpr auto _DATASET_NAMESPACE = "/a2d2";
 static constexpr auto _DATASET_SUFFIX = "lidar";
+static constexpr auto _DEPTH_MAP_SUFFIX = "depth_map";
+static constexpr auto _SENSOR_CONFIG_FILENAME = "cams_lidars.json";
+static constexpr auto _SENSOR_CONFIG_CACHE = true;
 static constexpr auto _INCLUDE_CLOCK_TOPIC = false;
+static constexpr auto _CLOCK_RATE = 0.0;
 static constexpr auto _INCLUDE_DEPTH_MAP = false;
+static constexpr auto _FIELDS = "all";
+static constexpr auto _VOXEL_SIZE = 0.0;
+static constexpr auto _STRIDE = static_cast<size_t>(1);
+static constexpr auto _DROP_INVALID = false;
 static constexpr auto _VERBOSE = false;
+static constexpr auto _LOG_LEVEL = "info";
+static constexpr auto _PROGRESS = 0u;
+static constexpr auto _FRAME_STATS = false;
 static constexpr auto _START_TIME = static_cast<uint64_t>(0);
 static constexpr auto _MIN_TIME_OFFSET = 0.0;
 static constexpr auto _DURATION = std::numeric_limits<double>::max();
+static constexpr auto _SPLIT_DURATION = 0.0;
+static constexpr auto _CHECKPOINT_INTERVAL = 0.0;
+static constexpr auto _RESUME = false;
+static constexpr auto _COMPRESSION = "none";
+static constexpr auto _CHUNK_THRESHOLD =
+    a2d2_to_ros::BagOptions::DEFAULT_CHUNK_THRESHOLD;
+static constexpr auto _SINK = "bag";
+static constexpr auto _PUBLISH_SPEED = 1.0;
+static constexpr auto _VALIDATION = "full";
+static constexpr auto _FRAME_INDEX = true;
+static constexpr auto _JOBS = 1u;
+static constexpr auto _PREFETCH =
+    static_cast<unsigned>(a2d2_to_ros::PrefetchOptions::DEFAULT_DEPTH);
+static constexpr auto _PREFETCH_MEMORY = static_cast<unsigned>(
+    a2d2_to_ros::PrefetchOptions::DEFAULT_MAX_BYTES / (1024 * 1024));
+static constexpr auto _DRY_RUN = false;
+static constexpr auto _DRY_RUN_SAMPLES = 16u;
 
 int main(int argc, char* argv[]) {
   X_INFO("<Lidar Converter>");
@@ -74,6 +121,9 @@ int main(int argc, char* argv[]) {
   boost::optional<std::string> camera_frame_schema_path_opt;
   boost::optional<std::string> lidar_path_opt;
   boost::optional<std::string> camera_path_opt;
+  boost::optional<std::string> sensor_config_path_opt;
+  boost::optional<std::string> sensor_config_schema_path_opt;
+  boost::optional<std::string> stats_json_path_opt;
   po::options_description desc(
       "Convert sequential lidar data to rosbag for the A2D2 Sensor Fusion "
       "data set. See README.md for details.\nAvailable options are listed "
@@ -90,17 +140,123 @@ int main(int argc, char* argv[]) {
       "include-clock-topic,t",
       po::value<bool>()->default_value(_INCLUDE_CLOCK_TOPIC),
       "Optional: Use timestamps from the data to write a /clock topic.")(
+      "clock-rate", po::value<double>()->default_value(_CLOCK_RATE),
+      "Optional: Maximum rate (Hz) of /clock messages. A message is written "
+      "for every unique timestamp if this is 0.")(
       "start-time,a", po::value<uint64_t>()->default_value(_START_TIME),
       "Optional: Start on or after this time.")(
       "min-time-offset,m", po::value<double>()->default_value(_MIN_TIME_OFFSET),
       "Optional: Seconds to skip ahead in the data before starting the bag.")(
       "duration,d", po::value<double>()->default_value(_DURATION),
       "Optional: Seconds after min-time-offset to include in bag file.")(
+      "split-duration", po::value<double>()->default_value(_SPLIT_DURATION),
+      "Optional: Seconds of data to write to each bag file before starting a "
+      "new one in a 'timespan_<start>s_<end>s' subdirectory of the output "
+      "path. Splitting is disabled if this is 0.")(
+      "checkpoint-interval",
+      po::value<double>()->default_value(_CHECKPOINT_INTERVAL),
+      "Optional: Seconds of data to write between checkpoints, which are "
+      "saved to a '<bag filename>.checkpoint' file in the output path, so "
+      "that an interrupted run can be continued with --resume. Checkpoints "
+      "are disabled if this is 0.")(
+      "resume", po::value<bool>()->default_value(_RESUME),
+      "Optional: Continue from the checkpoint of an interrupted run with the "
+      "same inputs and options, instead of starting over. Starts from the "
+      "first frame if there is no checkpoint.")(
+      "compression", po::value<std::string>()->default_value(_COMPRESSION),
+      "Optional: Compression of the bag file chunks. One of 'none', 'bz2', or "
+      "'lz4'. Compressed chunks are written on a background thread.")(
+      "chunk-threshold",
+      po::value<uint32_t>()->default_value(_CHUNK_THRESHOLD),
+      "Optional: Bytes of messages to buffer before a chunk is written (and "
+      "compressed).")(
       "output-path,o", po::value<std::string>()->default_value(_OUTPUT_PATH),
       "Optional: Path for the output bag file.")(
+      "sink", po::value<std::string>()->default_value(_SINK),
+      "Optional: Where to write the messages. One of 'bag' (bag files in the "
+      "output path) or 'topics' (publish them to a running ROS master, paced "
+      "by their stamps).")(
+      "publish-speed", po::value<double>()->default_value(_PUBLISH_SPEED),
+      "Optional: Factor of real time to publish at with '--sink topics', e.g., "
+      "2 for twice as fast as recorded. Messages are published as fast as "
+      "possible if this is 0.")(
+      "validation", po::value<std::string>()->default_value(_VALIDATION),
+      "Optional: Schema validation of the camera frame info files. One of "
+      "'full' (validate every file), 'sample:N' (validate only the first N "
+      "files), or 'none'.")(
+      "frame-index", po::value<bool>()->default_value(_FRAME_INDEX),
+      "Optional: Cache frame timestamps in a '.a2d2_index' file in the camera "
+      "data directory, so that later runs do not need to read the frame info "
+      "files again.")(
+      "jobs", po::value<unsigned>()->default_value(_JOBS),
+      "Optional: Number of lidar frames to convert in parallel. Use 0 to "
+      "convert one frame per hardware thread.")(
+      "prefetch", po::value<unsigned>()->default_value(_PREFETCH),
+      "Optional: Number of files (lidar frames, and frame info files that are "
+      "not in the frame index) to read into memory ahead of their "
+      "conversion on a background thread. Use 0 to read each file when it is "
+      "converted.")(
+      "prefetch-memory",
+      po::value<unsigned>()->default_value(_PREFETCH_MEMORY),
+      "Optional: Megabytes of files that may be held in memory after they are "
+      "prefetched.")(
+      "sensor-config-cache",
+      po::value<bool>()->default_value(_SENSOR_CONFIG_CACHE),
+      "Optional: Cache what is built from the vehicle/sensor config in a "
+      "'.a2d2_sensor_config' file next to it, so that later runs do not need "
+      "to parse and validate it again. The cache is rebuilt when the config "
+      "or its schema changes.")(
+      "fields", po::value<std::string>()->default_value(_FIELDS),
+      "Optional: Comma separated point cloud fields to write. Either 'all', "
+      "or any of 'xyz', 'xyzi', 'x', 'y', 'z', 'intensity', and the A2D2 "
+      "attributes without their 'pcloud_attr.' prefix, e.g., "
+      "'xyz,reflectance,timestamp'. Selected fields are packed with "
+      "alignment, and 'timestamp' is written as an INT32 microsecond offset "
+      "from the message stamp.")(
+      "voxel-size", po::value<double>()->default_value(_VOXEL_SIZE),
+      "Optional: Edge length (meters) of the voxels that point clouds are "
+      "downsampled with: only the first point in each voxel is written, with "
+      "all of its attributes. Clouds are not voxelized if this is 0.")(
+      "stride", po::value<size_t>()->default_value(_STRIDE),
+      "Optional: Write only every this many points of each cloud, before "
+      "voxelizing. 1 writes every point.")(
+      "drop-invalid", po::value<bool>()->default_value(_DROP_INVALID),
+      "Optional: Do not write points that are flagged as not valid. Depth "
+      "maps are always built from every valid point of a frame.")(
       "include-depth-map,i",
       po::value<bool>()->default_value(_INCLUDE_DEPTH_MAP),
-      "Optional: Publish a depth map version of the lidar data.")(
+      "Optional: Publish a depth map version of the lidar data: a 32FC1 image "
+      "in the camera image grid with the depth of each valid point, and NaN "
+      "where there is none. Requires the sensor config options.")(
+      "sensor-config-path", po::value(&sensor_config_path_opt),
+      "Optional: Path to the JSON for vehicle/sensor config, which provides "
+      "the camera resolution for depth maps.")(
+      "sensor-config-schema-path", po::value(&sensor_config_schema_path_opt),
+      "Optional: Path to the JSON schema for the vehicle/sensor config.")(
+      "dry-run", po::value<bool>()->default_value(_DRY_RUN),
+      "Optional: Convert only a sample of the frames, without writing "
+      "anything, and log the projected size of the bag (and of each split "
+      "window), the time the run would take, and the memory it would need. "
+      "With --stats-json, the projection is written there instead of the run "
+      "report.")(
+      "dry-run-samples",
+      po::value<unsigned>()->default_value(_DRY_RUN_SAMPLES),
+      "Optional: Number of frames to convert in a dry run, evenly spaced over "
+      "the selected frames.")(
+      "stats-json", po::value(&stats_json_path_opt),
+      "Optional: Write a JSON report of this run to this path: frame, point, "
+      "and byte totals and rates, and the count, total, p50, and p99 latency "
+      "of each conversion stage.")(
+      "frame-stats", po::value<bool>()->default_value(_FRAME_STATS),
+      "Optional: Log the statistics of each frame after it is processed: its "
+      "number of points and invalid points, and the range of its point "
+      "timestamps, distances, and reflectances.")(
+      "log-level", po::value<std::string>()->default_value(_LOG_LEVEL),
+      "Optional: Least severe messages to log. One of 'debug', 'info', "
+      "'warn', 'error', or 'fatal'.")(
+      "progress", po::value<unsigned>()->default_value(_PROGRESS),
+      "Optional: Log a progress line, with the rate, every this many frames. "
+      "Progress is not logged if this is 0.")(
       "verbose,v", po::value<bool>()->default_value(_VERBOSE),
       "Optional: Show name of each file after it is processed.");
 
@@ -122,6 +278,16 @@ int main(int argc, char* argv[]) {
     return EXIT_FAILURE;
   }
 
+  const auto log_level_opt =
+      a2d2::logging::get_level(vm["log-level"].as<std::string>());
+  if (!log_level_opt) {
+    X_FATAL("Log level '" << vm["log-level"].as<std::string>()
+                          << "' is not valid. It must be one of 'debug', "
+                             "'info', 'warn', 'error', or 'fatal'.");
+    return EXIT_FAILURE;
+  }
+  a2d2::logging::set_level(*log_level_opt);
+
   ///
   /// Get commandline parameters
   ///
@@ -132,22 +298,164 @@ int main(int argc, char* argv[]) {
   const auto output_path = vm["output-path"].as<std::string>();
   const auto include_depth_map = vm["include-depth-map"].as<bool>();
   const auto include_clock_topic = vm["include-clock-topic"].as<bool>();
+  const auto clock_rate = vm["clock-rate"].as<double>();
   const auto verbose = vm["verbose"].as<bool>();
+  const auto progress_interval = vm["progress"].as<unsigned>();
+  const auto frame_stats = vm["frame-stats"].as<bool>();
   const auto start_time = vm["start-time"].as<uint64_t>();
   const auto min_time_offset = vm["min-time-offset"].as<double>();
   const auto duration = vm["duration"].as<double>();
+  const auto split_duration = vm["split-duration"].as<double>();
+  const auto checkpoint_interval = vm["checkpoint-interval"].as<double>();
+  const auto resume = vm["resume"].as<bool>();
+  const auto publish_speed = vm["publish-speed"].as<double>();
+  const auto use_frame_index = vm["frame-index"].as<bool>();
+  const auto use_sensor_config_cache = vm["sensor-config-cache"].as<bool>();
+  const auto num_jobs = a2d2::get_num_jobs(vm["jobs"].as<unsigned>());
+  const auto dry_run = vm["dry-run"].as<bool>();
+  const auto dry_run_samples = vm["dry-run-samples"].as<unsigned>();
+  a2d2::PrefetchOptions prefetch_options;
+  prefetch_options.depth = vm["prefetch"].as<unsigned>();
+  prefetch_options.max_bytes =
+      (static_cast<size_t>(vm["prefetch-memory"].as<unsigned>()) * 1024 * 1024);
+
+  // stages are only timed if a report was requested
+  a2d2::RunStats stats(static_cast<bool>(stats_json_path_opt));
 
   const auto valid_min_offset = (std::isfinite(min_time_offset) &&
                                  a2d2::strictly_non_negative(min_time_offset));
   const auto valid_duration =
       (std::isfinite(duration) && a2d2::strictly_non_negative(duration));
-  if (!valid_min_offset || !valid_duration) {
+  const auto valid_split_duration =
+      (std::isfinite(split_duration) &&
+       a2d2::strictly_non_negative(split_duration));
+  if (!valid_min_offset || !valid_duration || !valid_split_duration) {
     X_FATAL(
         "Time constraints {min-time-offset: "
         << min_time_offset << ", duration: " << duration
+        << ", split-duration: " << split_duration
         << "} are not valid. They must be finite, real valued, and >= 0.0.");
     return EXIT_FAILURE;
   }
+  if (!std::isfinite(clock_rate) || !a2d2::strictly_non_negative(clock_rate)) {
+    X_FATAL("Clock rate " << clock_rate
+                          << " is not valid. It must be finite and >= 0.0.");
+    return EXIT_FAILURE;
+  }
+  if (!std::isfinite(checkpoint_interval) ||
+      !a2d2::strictly_non_negative(checkpoint_interval)) {
+    X_FATAL("Checkpoint interval "
+            << checkpoint_interval
+            << " is not valid. It must be finite and >= 0.0.");
+    return EXIT_FAILURE;
+  }
+
+  const auto compression_opt =
+      a2d2::get_compression_type(vm["compression"].as<std::string>());
+  if (!compression_opt) {
+    X_FATAL("Compression '" << vm["compression"].as<std::string>()
+                            << "' is not valid. It must be one of 'none', "
+                               "'bz2', or 'lz4'.");
+    return EXIT_FAILURE;
+  }
+  const auto chunk_threshold = vm["chunk-threshold"].as<uint32_t>();
+  if (chunk_threshold == 0) {
+    X_FATAL("Chunk threshold must be > 0.");
+    return EXIT_FAILURE;
+  }
+  a2d2::BagOptions bag_options;
+  bag_options.compression = *compression_opt;
+  bag_options.chunk_threshold = chunk_threshold;
+
+  const auto sink_opt = a2d2::get_sink_type(vm["sink"].as<std::string>());
+  if (!sink_opt) {
+    X_FATAL("Sink '" << vm["sink"].as<std::string>()
+                     << "' is not valid. It must be one of 'bag' or 'topics'.");
+    return EXIT_FAILURE;
+  }
+  if (!std::isfinite(publish_speed) ||
+      !a2d2::strictly_non_negative(publish_speed)) {
+    X_FATAL("Publish speed " << publish_speed
+                             << " is not valid. It must be finite and >= 0.0.");
+    return EXIT_FAILURE;
+  }
+  const auto publish = (*sink_opt == a2d2::SinkType::TOPICS);
+  if (publish && (resume || a2d2::strictly_positive(checkpoint_interval))) {
+    X_FATAL("Checkpoints and resuming only apply to bag files, not topics.");
+    return EXIT_FAILURE;
+  }
+  if (dry_run && (publish || resume)) {
+    X_FATAL("Dry runs only apply to new bag files, not topics or resuming.");
+    return EXIT_FAILURE;
+  }
+  if (dry_run_samples == 0) {
+    X_FATAL("Dry run samples must be > 0.");
+    return EXIT_FAILURE;
+  }
+
+  const auto point_layout_opt =
+      a2d2::get_point_layout(vm["fields"].as<std::string>());
+  if (!point_layout_opt) {
+    X_FATAL("Fields '" << vm["fields"].as<std::string>()
+                       << "' are not valid. Each field must be known and "
+                          "appear only once, and 'all' must appear alone.");
+    return EXIT_FAILURE;
+  }
+  const auto point_layout = *point_layout_opt;
+
+  a2d2::DownsampleOptions downsample_options;
+  downsample_options.voxel_size = vm["voxel-size"].as<double>();
+  downsample_options.stride = vm["stride"].as<size_t>();
+  downsample_options.drop_invalid = vm["drop-invalid"].as<bool>();
+  if (!std::isfinite(downsample_options.voxel_size) ||
+      !a2d2::strictly_non_negative(downsample_options.voxel_size)) {
+    X_FATAL("Voxel size " << downsample_options.voxel_size
+                          << " is not valid. It must be finite and >= 0.0.");
+    return EXIT_FAILURE;
+  }
+  if (downsample_options.stride == 0) {
+    X_FATAL("Stride must be > 0.");
+    return EXIT_FAILURE;
+  }
+  const auto downsample = downsample_options.enabled();
+
+  const auto validation_policy_opt =
+      a2d2::get_validation_policy(vm["validation"].as<std::string>());
+  if (!validation_policy_opt) {
+    X_FATAL("Validation policy '"
+            << vm["validation"].as<std::string>()
+            << "' is not valid. It must be 'full', 'sample:N', or 'none'.");
+    return EXIT_FAILURE;
+  }
+  const auto& validation_policy = *validation_policy_opt;
+
+  ///
+  /// Get the camera resolutions for depth maps from the vehicle/sensor config
+  ///
+
+  a2d2::CameraInfoMap depth_camera_infos;
+  if (include_depth_map) {
+    if (!sensor_config_path_opt || !sensor_config_schema_path_opt) {
+      X_FATAL(
+          "include-depth-map requires sensor-config-path and "
+          "sensor-config-schema-path.");
+      return EXIT_FAILURE;
+    }
+    const auto sensor_config_path =
+        *sensor_config_path_opt + "/" + _SENSOR_CONFIG_FILENAME;
+    const auto& sensor_config_schema_path = *sensor_config_schema_path_opt;
+
+    const auto sensor_config_opt =
+        a2d2::get_sensor_config(sensor_config_path, sensor_config_schema_path,
+                                use_sensor_config_cache);
+    if (!sensor_config_opt) {
+      X_FATAL("Could not get the vehicle/sensor config from: "
+              << sensor_config_path);
+      return EXIT_FAILURE;
+    }
+
+    depth_camera_infos = sensor_config_opt->camera_infos;
+  }
 
   boost::filesystem::path d(lidar_path);
   const auto timestamp = d.parent_path().parent_path().filename().string();
@@ -156,19 +464,26 @@ int main(int argc, char* argv[]) {
       (timestamp + "_" + boost::filesystem::basename(lidar_path));
 
   ///
-  /// Get list of .npz file names
+  /// Pair each .npz file with its frame info file by sequence number, listing
+  /// the lidar and camera data directories once each
   ///
 
-  std::set<std::string> files;
-  boost::filesystem::directory_iterator it{d};
-  while (it != boost::filesystem::directory_iterator{}) {
-    const auto path = it->path().string();
-    const auto extension = it->path().extension().string();
-    ++it;
-    if (extension != ".npz") {
-      continue;
+  std::vector<a2d2::ManifestEntry> manifest;
+  {
+    a2d2::ScopedStageTimer timer(stats, a2d2::Stage::SCAN);
+    auto lidar_files_opt = a2d2::list_directory(lidar_path);
+    auto camera_files_opt = a2d2::list_directory(camera_path);
+    if (!lidar_files_opt || !camera_files_opt) {
+      X_FATAL("Could not open the lidar or camera data directory.");
+      return EXIT_FAILURE;
     }
-    files.insert(path);
+    auto manifest_opt = a2d2::build_manifest((*lidar_files_opt)[".npz"],
+                                             (*camera_files_opt)[".json"]);
+    if (!manifest_opt) {
+      X_FATAL("Failed to match lidar files to camera files. Cannot continue.");
+      return EXIT_FAILURE;
+    }
+    manifest = std::move(*manifest_opt);
   }
 
   ///
@@ -185,313 +500,416 @@ int main(int argc, char* argv[]) {
   rapidjson::SchemaDocument camera_frame_schema(camera_frame_d);
 
   ///
-  /// Load each npz file, convert to PointCloud2 message, write to bag
+  /// Get the timestamp of each lidar frame, either from the frame index or from
+  /// its camera data file
   ///
 
-  const auto fields = a2d2::npz::Fields::get_fields();
-
-  X_INFO("Attempting to convert point cloud data. This may take a while...");
-
-  std::set<ros::Time> stamps;
-  rosbag::Bag bag;
-  const auto bag_name = output_path + "/" + file_basename + "_" +
-                        std::string(_DATASET_SUFFIX) + ".bag";
-  X_INFO("Creating bag file at: " << bag_name);
-  bag.open(bag_name, rosbag::bagmode::Write);
-  boost::optional<ros::Time> first_time;
-  for (const auto& f : files) {
-    ///
-    /// Get camera data file for timestamp information
-    ///
-
-    ros::Time frame_timestamp_ros;
-    {
-      const auto p = boost::filesystem::path(f);
-      const auto b = boost::filesystem::basename(p);
-      const auto camera_basename = a2d2::camera_name_from_lidar_name(b);
-      if (camera_basename.empty()) {
-        X_FATAL("Failed to get camera file corresponding to lidar file: "
-                << f << ". Cannot continue.");
-        bag.close();
-        return EXIT_FAILURE;
-      }
-
-      const auto camera_data_file =
-          camera_path + "/" + camera_basename + ".json";
+  struct Frame {
+    std::string path;
+    std::string sensor_name;
+    uint64_t timestamp;
+    ros::Time stamp;
+    double time_since_begin;
+  };  // struct Frame
+
+  auto frame_index = (use_frame_index ? a2d2::FrameIndex::load(camera_path)
+                                      : a2d2::FrameIndex());
+
+  // the frame info files that are not in the index are read ahead, in order
+  std::vector<std::string> camera_data_files;
+  for (const auto& entry : manifest) {
+    if (!frame_index.get_timestamp(entry.info_basename)) {
+      camera_data_files.push_back(entry.info_path);
+    }
+  }
+  a2d2::FilePrefetcher json_prefetcher(camera_data_files, prefetch_options);
+
+  a2d2::FrameTimestampReader timestamp_reader(camera_frame_schema);
+  size_t file_idx = 0;
+  std::vector<uint8_t> json_bytes;
+  std::vector<Frame> frames;
+  for (const auto& entry : manifest) {
+    const auto& camera_basename = entry.info_basename;
+    auto frame_timestamp_opt = frame_index.get_timestamp(camera_basename);
+    if (!frame_timestamp_opt) {
+      const auto& camera_data_file = camera_data_files[file_idx];
       // get json file string
-      const auto json_string = a2d2::get_file_as_string(camera_data_file);
-      if (json_string.empty()) {
+      a2d2::ScopedStageTimer read_timer(stats, a2d2::Stage::JSON_READ);
+      const auto read = json_prefetcher.take(file_idx, json_bytes);
+      read_timer.stop();
+      if (!read || json_bytes.empty()) {
         X_FATAL("'" << camera_data_file << "' failed to open or is empty.");
-        bag.close();
         return EXIT_FAILURE;
       }
-
-      rapidjson::Document d_json;
-      if (d_json.Parse(json_string.c_str()).HasParseError()) {
-        X_FATAL("Error(offset "
-                << static_cast<unsigned>(d_json.GetErrorOffset()) << "): "
-                << rapidjson::GetParseError_En(d_json.GetParseError()));
-        bag.close();
+      stats.add_bytes_in(json_bytes.size());
+      // the text is parsed in place, which needs it to be null-terminated
+      json_bytes.push_back('\0');
+
+      const auto validate = validation_policy.should_validate(file_idx++);
+      a2d2::ScopedStageTimer parse_timer(
+          stats,
+          (validate ? a2d2::Stage::JSON_VALIDATE : a2d2::Stage::JSON_PARSE));
+      frame_timestamp_opt = timestamp_reader.read_insitu(
+          reinterpret_cast<char*>(json_bytes.data()), validate);
+      parse_timer.stop();
+      if (!frame_timestamp_opt) {
+        X_FATAL("'" << camera_data_file << "': "
+                    << timestamp_reader.get_error_string());
         return EXIT_FAILURE;
       }
+      frame_index.set_timestamp(camera_basename, *frame_timestamp_opt);
+    }
 
-      ///
-      /// Validate the data set against the schema
-      ///
+    frames.push_back({entry.data_path, entry.sensor_name, *frame_timestamp_opt,
+                      ros::Time(), 0.0});
+  }
 
-      rapidjson::SchemaValidator validator(camera_frame_schema);
-      if (!d_json.Accept(validator)) {
-        const auto err_string = a2d2::get_validator_error_string(validator);
-        X_FATAL(err_string);
-        bag.close();
-        return EXIT_FAILURE;
-      } else {
-        // X_INFO("Validated: " << camera_data_file);
-      }
+  if (use_frame_index && frame_index.is_modified()) {
+    if (frame_index.save(camera_path)) {
+      X_INFO("Updated frame index in: " << camera_path);
+    } else {
+      X_WARN("Failed to write frame index to: " << camera_path);
+    }
+  }
 
-      const auto frame_timestamp = d_json["cam_tstamp"].GetUint64();
+  ///
+  /// Select the frames that fall in the requested timespan
+  ///
 
-      if (frame_timestamp < start_time) {
-        continue;
-      }
+  // the bag writer consumes frames in order, so make that order chronological
+  std::stable_sort(std::begin(frames), std::end(frames),
+                   [](const Frame& lhs, const Frame& rhs) {
+                     return (lhs.timestamp < rhs.timestamp);
+                   });
 
-      frame_timestamp_ros = a2d2::a2d2_timestamp_to_ros_time(frame_timestamp);
+  boost::optional<ros::Time> first_time;
+  {
+    std::vector<uint64_t> timestamps;
+    timestamps.reserve(frames.size());
+    for (const auto& frame : frames) {
+      timestamps.push_back(frame.timestamp);
     }
 
-    if (!first_time) {
-      if (start_time != _START_TIME) {
-        first_time = a2d2::a2d2_timestamp_to_ros_time(start_time);
-      } else {
-        first_time = frame_timestamp_ros;
-      }
-    }
+    const auto window = a2d2::get_frame_window(timestamps, start_time,
+                                               min_time_offset, duration);
+    frames.erase(std::begin(frames) + window.end, std::end(frames));
+    frames.erase(std::begin(frames), std::begin(frames) + window.begin);
+    first_time = window.first_time;
+  }
 
-    const auto time_since_begin = (frame_timestamp_ros - *first_time).toSec();
-    if (time_since_begin < min_time_offset) {
-      continue;
-    }
+  for (auto& frame : frames) {
+    frame.stamp = a2d2::a2d2_timestamp_to_ros_time(frame.timestamp);
+    frame.time_since_begin = (frame.stamp - *first_time).toSec();
+  }
+
+  ///
+  /// Skip the frames that an interrupted run already wrote, if resuming
+  ///
+
+  const auto bag_name =
+      (file_basename + "_" + std::string(_DATASET_SUFFIX) + ".bag");
+  const auto checkpoint_path =
+      (output_path + "/" + bag_name + a2d2::Checkpoint::FILENAME_SUFFIX);
+
+  // every option that the bag depends on, along with the selected frames
+  std::stringstream settings;
+  settings.precision(std::numeric_limits<double>::max_digits10);
+  settings << start_time << " " << min_time_offset << " " << duration << " "
+           << split_duration << " " << vm["compression"].as<std::string>()
+           << " " << chunk_threshold << " " << include_clock_topic << " "
+           << clock_rate << " " << vm["fields"].as<std::string>() << " "
+           << include_depth_map << " " << downsample_options.voxel_size << " "
+           << downsample_options.stride << " "
+           << downsample_options.drop_invalid;
+  std::vector<std::string> frame_paths;
+  for (const auto& frame : frames) {
+    frame_paths.push_back(frame.path);
+  }
+  const auto checkpoint_key =
+      a2d2::get_checkpoint_key(settings.str(), frame_paths);
 
-    const auto recorded_duration = (time_since_begin - min_time_offset);
-    if (recorded_duration > duration) {
-      break;
+  ///
+  /// In a dry run, keep the offsets of all frames to project the bag from, but
+  /// only convert a sample of them
+  ///
+
+  a2d2::DryRun estimator(min_time_offset, split_duration);
+  size_t dry_run_lane = 0;
+  if (dry_run) {
+    std::vector<double> frame_offsets;
+    for (const auto& frame : frames) {
+      frame_offsets.push_back(frame.time_since_begin);
     }
+    dry_run_lane = estimator.add_lane(std::move(frame_offsets),
+                                      (2 * num_jobs), {bag_name});
 
-    ///
-    /// Load and verify the data
-    ///
+    std::vector<Frame> samples;
+    for (const auto idx :
+         a2d2::get_sample_indices(frames.size(), dry_run_samples)) {
+      samples.push_back(frames[idx]);
+    }
+    frames = std::move(samples);
+  }
 
-    cnpy::npz_t npz;
-    try {
-      npz = cnpy::npz_load(f);
-    } catch (const std::exception& e) {
-      X_FATAL(e.what());
-      bag.close();
+  size_t resumed_frames = 0;
+  boost::optional<a2d2::Checkpoint> checkpoint_opt;
+  if (resume) {
+    checkpoint_opt = a2d2::get_resume_checkpoint(
+        checkpoint_path, checkpoint_key, frames.size());
+    if (!checkpoint_opt) {
+      X_FATAL("Cannot resume. Remove '" << checkpoint_path
+                                        << "' to start over.");
       return EXIT_FAILURE;
     }
+    resumed_frames = checkpoint_opt->next_frame;
+    frames.erase(std::begin(frames), std::begin(frames) + resumed_frames);
+  }
 
-    const auto npz_structure_valid = a2d2::npz::verify_structure(npz);
-    if (!npz_structure_valid) {
-      X_FATAL("Encountered unexpected structure in the data. Cannot continue.");
-      bag.close();
-      return EXIT_FAILURE;
-    } else {
-      // X_INFO("Successfully loaded npz data from:\n" << f);
+  ///
+  /// Load each npz file and convert it to a PointCloud2 message. This is done
+  /// by a pool of workers, and the results are written to the bag in order by
+  /// this thread; rosbag::Bag is not thread-safe.
+  ///
+
+  const auto fields = a2d2::npz::Fields::get_fields();
+
+  // without prefetching, each npz file is mapped rather than read
+  std::vector<std::string> npz_paths;
+  if (prefetch_options.depth > 0) {
+    for (const auto& frame : frames) {
+      npz_paths.push_back(frame.path);
     }
+  }
+  a2d2::FilePrefetcher npz_prefetcher(npz_paths, prefetch_options);
+
+  a2d2::LidarFrameConverter::Options converter_options;
+  converter_options.layout = point_layout;
+  converter_options.downsample = downsample_options;
+  converter_options.include_depth_map = include_depth_map;
+  const a2d2::LidarFrameConverter converter(converter_options,
+                                            depth_camera_infos, stats);
+
+  struct FrameMessages {
+    a2d2::LidarFrameMessages lidar;
+    // logged once the frame is written, if frame stats are enabled
+    std::string stats;
+  };  // struct FrameMessages
+
+  // the converter is thread-safe, so workers can share it
+  const auto convert_frame =
+      [&](size_t idx) -> boost::optional<FrameMessages> {
+    const auto& f = frames[idx].path;
 
     ///
-    /// Build pointcloud message
+    /// Load the data
     ///
 
-    // capture these up front; they provide meta information about the data
-    const auto& points = npz[fields[a2d2::npz::Fields::POINTS_IDX]];
-    const auto& timestamp = npz[fields[a2d2::npz::Fields::TIMESTAMP_IDX]];
-    const auto& valid = npz[fields[a2d2::npz::Fields::VALID_IDX]];
-
-    const auto lidar_file_name = a2d2::frame_from_filename(f);
-    const auto lidar_name =
-        a2d2::get_camera_name_from_frame_name(lidar_file_name);
-    const auto frame = a2d2::tf_motion_compensated_sensor_frame_name(
-        a2d2::sensors::Names::CAMERAS, lidar_name);
-    if (frame.empty()) {
-      X_FATAL("Could not find frame name in filename: "
-              << f << ". Cannot continue.");
-      bag.close();
-      return EXIT_FAILURE;
+    a2d2::npz::MappedNpz npz;
+    a2d2::ScopedStageTimer load_timer(stats, a2d2::Stage::NPZ_LOAD);
+    auto opened = false;
+    if (prefetch_options.depth > 0) {
+      std::vector<uint8_t> bytes;
+      opened =
+          (npz_prefetcher.take(idx, bytes) && npz.open(std::move(bytes), f));
+    } else {
+      opened = npz.open(f);
     }
-
-    const auto is_dense = a2d2::npz::any_points_invalid(valid);
-    const auto n_points = points.shape[a2d2::npz::Fields::ROW_SHAPE_IDX];
-    auto msg = a2d2::build_pc2_msg(frame, frame_timestamp_ros, is_dense,
-                                   static_cast<uint32_t>(n_points));
+    if (!opened) {
+      X_FATAL("Failed to read npz file: " << f << ". Cannot continue.");
+      return boost::none;
+    }
+    load_timer.stop();
+    stats.add_bytes_in(npz.get_size());
 
     ///
-    /// Fill in the point cloud message
+    /// Verify it, and convert it to a point cloud message (and depth map)
     ///
 
-    auto iters = a2d2::A2D2_PointCloudIterators(msg, fields);
-    for (auto row = 0; row < n_points; ++row, ++iters) {
-      ///
-      /// Point data
-      ///
-
-      {
-        constexpr auto X_POS = 0;
-        constexpr auto Y_POS = 1;
-        constexpr auto Z_POS = 2;
-        const auto row_step = points.shape[a2d2::npz::Fields::COL_SHAPE_IDX];
-
-        const auto data = points.data<a2d2::npz::ReadTypes::Point>();
-        const auto x_idx = a2d2::flatten_2d_index(row_step, row, X_POS);
-        const auto y_idx = a2d2::flatten_2d_index(row_step, row, Y_POS);
-        const auto z_idx = a2d2::flatten_2d_index(row_step, row, Z_POS);
-
-        *(iters.x) = static_cast<a2d2::npz::WriteTypes::Point>(data[x_idx]);
-        *(iters.y) = static_cast<a2d2::npz::WriteTypes::Point>(data[y_idx]);
-        *(iters.z) = static_cast<a2d2::npz::WriteTypes::Point>(data[z_idx]);
-      }
-
-      ///
-      /// Scalar data
-      ///
-
-      {
-        const auto& azimuth = npz[fields[a2d2::npz::Fields::AZIMUTH_IDX]];
-        const auto data = azimuth.data<a2d2::npz::ReadTypes::Azimuth>();
-        *(iters.azimuth) = data[row];
-      }
-
-      {
-        const auto& boundary = npz[fields[a2d2::npz::Fields::BOUNDARY_IDX]];
-        const auto data = boundary.data<a2d2::npz::ReadTypes::Boundary>();
-        *(iters.boundary) =
-            static_cast<a2d2::npz::WriteTypes::Boundary>(data[row]);
+    auto lidar_opt =
+        converter.convert(npz, frames[idx].sensor_name, frames[idx].stamp);
+    if (!lidar_opt) {
+      X_FATAL("Failed to convert npz file: " << f << ". Cannot continue.");
+      return boost::none;
+    }
+    FrameMessages messages;
+    messages.lidar = std::move(*lidar_opt);
+
+    if (frame_stats) {
+      // the invalid count and timestamp range are already in the summary; the
+      // sweep is left untimed, so that the report does not count its own cost
+      const auto& summary = messages.lidar.summary;
+      const auto columns = a2d2::npz::get_columns(npz);
+      const auto n = columns.num_points;
+      const auto distances = a2d2::npz::get_column_stats(columns.distance, n);
+      const auto reflectances =
+          a2d2::npz::get_column_stats(columns.reflectance, n);
+      const auto& cloud = messages.lidar.cloud;
+      std::stringstream ss;
+      ss << n << " points (" << summary.num_invalid_points << " invalid)";
+      if (downsample) {
+        ss << ", " << (static_cast<uint64_t>(cloud.width) * cloud.height)
+           << " written";
       }
-
-      {
-        const auto& image_col = npz[fields[a2d2::npz::Fields::COL_IDX]];
-        const auto data = image_col.data<a2d2::npz::ReadTypes::Col>();
-        *(iters.col) = static_cast<a2d2::npz::WriteTypes::Col>(data[row]);
+      if (n > 0) {
+        ss << ", timestamp: [" << summary.min_timestamp << ", "
+           << summary.max_timestamp << "], distance: [" << distances.min << ", "
+           << distances.max << "], reflectance: [" << reflectances.min << ", "
+           << reflectances.max << "]";
       }
+      messages.stats = ss.str();
+    }
 
-      {
-        const auto& depth = npz[fields[a2d2::npz::Fields::DEPTH_IDX]];
-        const auto data = depth.data<a2d2::npz::ReadTypes::Depth>();
-        *(iters.depth) = static_cast<a2d2::npz::WriteTypes::Depth>(data[row]);
-      }
+    return messages;
+  };
 
-      {
-        const auto& distance = npz[fields[a2d2::npz::Fields::DISTANCE_IDX]];
-        const auto data = distance.data<a2d2::npz::ReadTypes::Distance>();
-        *(iters.distance) =
-            static_cast<a2d2::npz::WriteTypes::Distance>(data[row]);
-      }
+  ///
+  /// In a dry run, convert the sampled frames one at a time to measure them,
+  /// and report the projection instead of writing anything
+  ///
 
-      {
-        const auto& lidar_id = npz[fields[a2d2::npz::Fields::ID_IDX]];
-        const auto data = lidar_id.data<a2d2::npz::ReadTypes::LidarId>();
-        *(iters.lidar_id) =
-            static_cast<a2d2::npz::WriteTypes::LidarId>(data[row]);
+  if (dry_run) {
+    X_INFO("Dry run: converting " << frames.size() << " sampled frame(s).");
+    for (size_t idx = 0; idx < frames.size(); ++idx) {
+      const auto start = a2d2::RunStats::Clock::now();
+      auto messages = convert_frame(idx);
+      if (!messages) {
+        return EXIT_FAILURE;
       }
-
-      {
-        const auto& rectime = npz[fields[a2d2::npz::Fields::RECTIME_IDX]];
-        const auto data = rectime.data<a2d2::npz::ReadTypes::Rectime>();
-        *(iters.rectime) =
-            static_cast<a2d2::npz::WriteTypes::Rectime>(data[row]);
+      const auto seconds = std::chrono::duration<double>(
+                               a2d2::RunStats::Clock::now() - start)
+                               .count();
+      auto bytes = a2d2::get_bag_record_size(messages->lidar.cloud);
+      if (messages->lidar.depth_map) {
+        bytes += a2d2::get_bag_record_size(*messages->lidar.depth_map);
       }
+      estimator.add_sample(dry_run_lane, seconds, {bytes});
+      converter.recycle(messages->lidar);
+    }
 
-      {
-        const auto& reflectance =
-            npz[fields[a2d2::npz::Fields::REFLECTANCE_IDX]];
-        const auto data = reflectance.data<a2d2::npz::ReadTypes::Reflectance>();
-        *(iters.reflectance) =
-            static_cast<a2d2::npz::WriteTypes::Reflectance>(data[row]);
+    // prefetched files and the chunk of the open bag are held throughout
+    const auto prefetch_bytes =
+        ((prefetch_options.depth > 0) ? prefetch_options.max_bytes : 0);
+    const auto report =
+        estimator.project(num_jobs, (prefetch_bytes + chunk_threshold));
+    report.log();
+    if (stats_json_path_opt) {
+      if (!report.write_json(*stats_json_path_opt, _DATASET_SUFFIX)) {
+        X_FATAL("Failed to write dry run report to: " << *stats_json_path_opt);
+        return EXIT_FAILURE;
       }
+      X_INFO("Wrote dry run report to: " << *stats_json_path_opt);
+    }
 
-      {
-        const auto& image_row = npz[fields[a2d2::npz::Fields::ROW_IDX]];
-        const auto data = image_row.data<a2d2::npz::ReadTypes::Row>();
-        *(iters.row) = static_cast<a2d2::npz::WriteTypes::Row>(data[row]);
-      }
+    X_INFO("Done.");
+    return EXIT_SUCCESS;
+  }
 
-      {
-        const auto data = timestamp.data<a2d2::npz::ReadTypes::Timestamp>();
-        *(iters.timestamp) =
-            static_cast<a2d2::npz::WriteTypes::Timestamp>(data[row]);
-      }
+  ///
+  /// Write messages to bag file, or publish them
+  ///
 
-      {
-        const auto data = valid.data<a2d2::npz::ReadTypes::Valid>();
-        *(iters.valid) = static_cast<a2d2::npz::WriteTypes::Valid>(data[row]);
-      }
+  std::unique_ptr<a2d2::TopicPublisher> publisher;
+  if (publish) {
+    ros::init(argc, argv, _NODE_NAME,
+              (ros::init_options::NoSigintHandler |
+               ros::init_options::AnonymousName));
+    if (!ros::master::check()) {
+      X_FATAL("Cannot publish messages. The ROS master is not running.");
+      return EXIT_FAILURE;
     }
-
-#if 0
+    publisher.reset(new a2d2::TopicPublisher(publish_speed));
+  }
+  auto sink = a2d2::make_message_sink(publisher.get(), output_path, bag_name,
+                                      min_time_offset, split_duration,
+                                      bag_options);
+  if (checkpoint_opt && !sink.resume(checkpoint_opt->segments)) {
+    X_FATAL("Failed to resume the bag file(s) of: " << checkpoint_path);
+    return EXIT_FAILURE;
+  }
+  a2d2::CheckpointWriter checkpoints(checkpoint_path, checkpoint_key,
+                                     checkpoint_interval);
+  // frames are written in time order, so the clock is written along with them
+  a2d2::ClockWriter clock(sink, _CLOCK_TOPIC, clock_rate);
+
+  // message time is the max timestamp of all points in the message
+  const auto topic = (std::string(_DATASET_NAMESPACE) + "/" + file_basename +
+                      "/" + std::string(_DATASET_SUFFIX));
+  const auto depth_map_topic = (topic + "/" + std::string(_DEPTH_MAP_SUFFIX));
+  a2d2::logging::ProgressLogger progress(
+      lidar_path, "frames", frames.size(), progress_interval);
+  const auto write_frame = [&](size_t idx, FrameMessages& messages) {
+    const auto& msg = messages.lidar.cloud;
+    const auto stamp = msg.header.stamp;
     {
-      const auto& reflectance = npz[fields[a2d2::npz::Fields::REFLECTANCE_IDX]];
-      const auto max_reflectance =
-          a2d2::get_max_value<a2d2::npz::ReadTypes::Reflectance>(reflectance);
-      const auto min_reflectance =
-          a2d2::get_min_value<a2d2::npz::ReadTypes::Reflectance>(reflectance);
-      std::cout << "reflectance range: [" << min_reflectance << ", "
-                << max_reflectance << "]" << std::endl;
-      const auto& boundary = npz[fields[a2d2::npz::Fields::BOUNDARY_IDX]];
-      const auto max_boundary =
-          a2d2::get_max_value<a2d2::npz::ReadTypes::Boundary>(boundary);
-      const auto min_boundary =
-          a2d2::get_min_value<a2d2::npz::ReadTypes::Boundary>(boundary);
-      std::cout << "boundary range: [" << min_boundary << ", " << max_boundary
-                << "]" << std::endl;
-      auto test = a2d2::A2D2_PointCloudIterators(msg, fields);
-      for (auto row = 0; row < n_points; ++row, ++test) {
-        std::cout << test << std::endl;
+      a2d2::ScopedStageTimer timer(stats, a2d2::Stage::BAG_WRITE);
+      sink.write(topic, frames[idx].time_since_begin, stamp, msg);
+      if (messages.lidar.depth_map) {
+        sink.write(depth_map_topic, frames[idx].time_since_begin, stamp,
+                   *messages.lidar.depth_map);
       }
-      X_WARN("Finished debut output. Exiting.");
-      bag.close();
-      return EXIT_FAILURE;
     }
-#endif
-
-    ///
-    /// Write message to bag file
-    ///
-
-    // message time is the max timestamp of all points in the message
-    const auto topic = (std::string(_DATASET_NAMESPACE) + "/" + file_basename +
-                        "/" + std::string(_DATASET_SUFFIX));
-    bag.write(topic, msg.header.stamp, msg);
+    stats.add_frames(1);
+    progress.add();
+    stats.add_points(static_cast<uint64_t>(msg.width) * msg.height);
+    // the sink has its own copy now, so the next frame can refill the buffers
+    converter.recycle(messages.lidar);
     if (include_clock_topic) {
-      stamps.insert(msg.header.stamp);
+      a2d2::ScopedStageTimer timer(stats, a2d2::Stage::CLOCK_WRITE);
+      clock.write(frames[idx].time_since_begin, stamp);
+    }
+    if (!checkpoints.update(frames[idx].time_since_begin,
+                            (resumed_frames + idx + 1), {&sink})) {
+      X_WARN("Failed to write checkpoint to: " << checkpoint_path);
     }
 
     if (verbose) {
-      X_INFO("Processed: " << f);
+      X_INFO("Processed: " << frames[idx].path);
     }
-  }
+    if (!messages.stats.empty()) {
+      X_INFO("Frame stats of " << frames[idx].path << ": " << messages.stats);
+    }
+    return true;
+  };
 
-  ///
-  /// Write a clock message for every unique timestamp in the data set
-  ///
+  X_INFO("Attempting to convert point cloud data using "
+         << num_jobs << " job(s). This may take a while...");
 
-  if (include_clock_topic) {
-    X_INFO("Adding " << _CLOCK_TOPIC << " topic...");
-    if (stamps.size() != files.size()) {
-      X_WARN("Number of frame timestamps ("
-             << stamps.size()
-             << ") is different than the total number of frames ("
-             << files.size()
-             << "). This should only happen if the min time offset and/or "
-                "duration excludes some parts of the data set.");
-    }
+  const auto converted = a2d2::ordered_parallel_for<FrameMessages>(
+      frames.size(), num_jobs, (2 * num_jobs), convert_frame, write_frame);
+  if (!converted) {
+    X_FATAL("Failed to convert point cloud data. Cannot continue.");
+    sink.close();
+    return EXIT_FAILURE;
   }
 
-  for (const auto& stamp : stamps) {
-    rosgraph_msgs::Clock clock_msg;
-    clock_msg.clock = stamp;
-    bag.write(_CLOCK_TOPIC, stamp, clock_msg);
+  // frames are windowed (and resumed) before they are converted, so without
+  // a clock rate, there is a stamp for each one, unless stamps repeat
+  if (include_clock_topic && !a2d2::strictly_positive(clock_rate) &&
+      (clock.get_num_stamps() != frames.size())) {
+    X_WARN("Number of frame timestamps ("
+           << clock.get_num_stamps()
+           << ") is different than the number of frames converted ("
+           << frames.size() << "). Some frames repeat the timestamp "
+              "of, or are older than, the frame before them.");
   }
 
-  bag.close();
+  {
+    a2d2::ScopedStageTimer timer(stats, a2d2::Stage::BAG_CLOSE);
+    sink.close();
+  }
+  if (!publish) {
+    // the bag is complete, so there is nothing left to resume
+    checkpoints.remove();
+  }
+
+  if (stats_json_path_opt) {
+    stats.add_bytes_out(sink.get_bytes_written());
+    if (!stats.write_json(*stats_json_path_opt, _DATASET_SUFFIX)) {
+      X_FATAL("Failed to write run report to: " << *stats_json_path_opt);
+      return EXIT_FAILURE;
+    }
+    X_INFO("Wrote run report to: " << *stats_json_path_opt);
+  }
 
   X_INFO("Done.");
   return EXIT_SUCCESS;
@@ -0,0 +1,233 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <ros/message_traits.h>
+#include <rosbag/view.h>
+#include <std_msgs/String.h>
+
+#include "a2d2_to_ros/bag_utils.hpp"
+
+namespace a2d2_to_ros {
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_bag_utils, get_window_index) {
+  constexpr auto SPLIT_DURATION = 7.0;
+
+  EXPECT_EQ(0, get_window_index(0.0, SPLIT_DURATION));
+  EXPECT_EQ(0, get_window_index(6.999, SPLIT_DURATION));
+  EXPECT_EQ(1, get_window_index(7.0, SPLIT_DURATION));
+  EXPECT_EQ(1, get_window_index(13.5, SPLIT_DURATION));
+  EXPECT_EQ(106, get_window_index(745.9, SPLIT_DURATION));
+
+  // negative offsets belong to the first window
+  EXPECT_EQ(0, get_window_index(-1.0, SPLIT_DURATION));
+
+  EXPECT_EQ(3, get_window_index(1.6, 0.5));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_bag_utils, get_window_name) {
+  EXPECT_EQ("timespan_0s_7s", get_window_name(0.0, 7.0));
+  EXPECT_EQ("timespan_742s_749s", get_window_name(742.0, 749.0));
+  EXPECT_EQ("timespan_1.5s_3s", get_window_name(1.5, 3.0));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_bag_utils, get_bag_part_filename) {
+  EXPECT_EQ("lidar.bag", get_bag_part_filename("lidar.bag", 0));
+  EXPECT_EQ("lidar_part1.bag", get_bag_part_filename("lidar.bag", 1));
+  EXPECT_EQ("a_tf_part12.bag", get_bag_part_filename("a_tf.bag", 12));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_bag_utils, get_compression_type) {
+  EXPECT_EQ(rosbag::compression::Uncompressed, *get_compression_type("none"));
+  EXPECT_EQ(rosbag::compression::BZ2, *get_compression_type("bz2"));
+  EXPECT_EQ(rosbag::compression::LZ4, *get_compression_type("lz4"));
+
+  EXPECT_FALSE(get_compression_type(""));
+  EXPECT_FALSE(get_compression_type("LZ4"));
+  EXPECT_FALSE(get_compression_type("zstd"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_bag_utils, SplitBagWriter_get_window) {
+  // split writers only open bags when they are written to
+  SplitBagWriter writer("/tmp", "test.bag", 2.0, 5.0);
+  ASSERT_TRUE(writer.is_split());
+  EXPECT_EQ(0, writer.get_window(0.0));
+  EXPECT_EQ(0, writer.get_window(6.999));
+  EXPECT_EQ(1, writer.get_window(7.0));
+  EXPECT_EQ(3, writer.get_window(17.5));
+}
+
+//------------------------------------------------------------------------------
+
+namespace {
+void write_string(SplitBagWriter& writer, double time_since_begin,
+                  const std::string& data) {
+  std_msgs::String msg;
+  msg.data = data;
+  writer.write("/data", time_since_begin, ros::Time(1.0 + time_since_begin),
+               msg);
+}
+
+// the data of every message in the bags, in time order
+std::vector<std::string> read_strings(const std::vector<std::string>& paths) {
+  std::vector<std::unique_ptr<rosbag::Bag>> bags;
+  rosbag::View view;
+  for (const auto& path : paths) {
+    bags.emplace_back(new rosbag::Bag(path, rosbag::bagmode::Read));
+    view.addQuery(*bags.back());
+  }
+  std::vector<std::string> data;
+  for (const auto& m : view) {
+    data.push_back(m.instantiate<std_msgs::String>()->data);
+  }
+  return data;
+}
+}  // namespace
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_bag_utils, SplitBagWriter_write_latched) {
+  const auto dir = (boost::filesystem::temp_directory_path() /
+                    boost::filesystem::unique_path("a2d2_to_ros-%%%%%%"));
+  boost::filesystem::create_directories(dir);
+  const auto path = (dir / "test.bag").string();
+  constexpr auto UNSPLIT = std::numeric_limits<double>::infinity();
+
+  // compressed bags are written on a background thread, with the same headers
+  for (const auto compression :
+       {rosbag::compression::Uncompressed, rosbag::compression::BZ2}) {
+    BagOptions options;
+    options.compression = compression;
+    {
+      SplitBagWriter writer(dir.string(), "test.bag", 0.0, UNSPLIT, options);
+      std_msgs::String msg;
+      msg.data = "latched";
+      writer.write("/latched", 0.0, ros::Time(1.0), msg, true);
+      msg.data = "not latched";
+      writer.write("/data", 0.0, ros::Time(2.0), msg);
+    }
+
+    // latched connections keep the type of their messages
+    rosbag::Bag bag(path, rosbag::bagmode::Read);
+    rosbag::View view(bag);
+    std::vector<std::string> topics;
+    for (const auto& m : view) {
+      topics.push_back(m.getTopic());
+      EXPECT_EQ((m.getTopic() == "/latched"), m.isLatching());
+      EXPECT_EQ(ros::message_traits::datatype<std_msgs::String>(),
+                m.getDataType());
+      EXPECT_EQ(ros::message_traits::md5sum<std_msgs::String>(),
+                m.getMD5Sum());
+      const auto msg = m.instantiate<std_msgs::String>();
+      ASSERT_TRUE(msg);
+      EXPECT_EQ((m.isLatching() ? "latched" : "not latched"), msg->data);
+    }
+    EXPECT_EQ((std::vector<std::string>{"/latched", "/data"}), topics);
+  }
+  boost::filesystem::remove_all(dir);
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_bag_utils, SplitBagWriter_resume) {
+  const auto dir = (boost::filesystem::temp_directory_path() /
+                    boost::filesystem::unique_path("a2d2_to_ros-%%%%%%"));
+  boost::filesystem::create_directories(dir);
+  const auto path = (dir / "test.bag").string();
+  const auto part_path = (dir / "test_part1.bag").string();
+  constexpr auto UNSPLIT = std::numeric_limits<double>::infinity();
+
+  std::vector<BagSegment> segments;
+  uint64_t part_size = 0;
+  {
+    SplitBagWriter writer(dir.string(), "test.bag", 0.0, UNSPLIT);
+    write_string(writer, 0.0, "a");
+    write_string(writer, 1.0, "b");
+    segments = writer.checkpoint();
+    ASSERT_EQ(1, segments.size());
+    EXPECT_EQ(path, segments[0].path);
+    EXPECT_EQ(boost::filesystem::file_size(path), segments[0].size);
+
+    // writes after a checkpoint go to a new part; the bag is left as it was
+    write_string(writer, 2.0, "c");
+    write_string(writer, 3.0, "x");
+    writer.close();
+    EXPECT_EQ(segments[0].size, boost::filesystem::file_size(path));
+    part_size = boost::filesystem::file_size(part_path);
+    EXPECT_EQ((std::vector<std::string>{"c", "x"}),
+              read_strings({part_path}));
+  }
+
+  // the run is interrupted while the part is written, which leaves a bag
+  // without an index
+  boost::filesystem::resize_file(part_path, (part_size / 2));
+
+  {
+    SplitBagWriter writer(dir.string(), "test.bag", 0.0, UNSPLIT);
+    // segments of other writers are ignored
+    auto all_segments = segments;
+    all_segments.push_back({(dir / "test_tf.bag").string(), 1});
+    ASSERT_TRUE(writer.resume(all_segments));
+    // the incomplete part is removed, and started over by the next write
+    EXPECT_FALSE(boost::filesystem::exists(part_path));
+    write_string(writer, 2.0, "c");
+    write_string(writer, 3.0, "d");
+    writer.close();
+    EXPECT_EQ((std::vector<std::string>{"a", "b", "c", "d"}),
+              read_strings({path, part_path}));
+  }
+
+  // a bag that changed since the checkpoint cannot be resumed
+  {
+    boost::filesystem::resize_file(path, (segments[0].size - 1));
+    SplitBagWriter writer(dir.string(), "test.bag", 0.0, UNSPLIT);
+    EXPECT_FALSE(writer.resume(segments));
+  }
+  {
+    boost::filesystem::remove(path);
+    SplitBagWriter writer(dir.string(), "test.bag", 0.0, UNSPLIT);
+    EXPECT_FALSE(writer.resume(segments));
+  }
+  boost::filesystem::remove_all(dir);
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
@@ -0,0 +1,227 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+
+#include <tuple>
+
+#include "a2d2_to_ros/bus_signal_reader.hpp"
+
+namespace a2d2_to_ros {
+
+namespace {
+
+typedef std::tuple<std::string, std::string, uint64_t, double> Sample;
+
+/**
+ * @brief Feed the SAX events of a single signal object to the handler.
+ * @note The unit is emitted before the values if unit_first is set.
+ */
+bool emit_signal(BusSignalHandler& handler, const std::string& name,
+                 const char* unit, const std::vector<Sample>& samples,
+                 bool unit_first) {
+  const auto emit_unit = [&]() {
+    auto ok = handler.Key("unit", 4, true);
+    ok = ok && (unit ? handler.String(unit, std::string(unit).size(), true)
+                     : handler.Null());
+    return ok;
+  };
+
+  auto ok = handler.Key(name.c_str(), name.size(), true);
+  ok = ok && handler.StartObject();
+  if (unit_first) {
+    ok = ok && emit_unit();
+  }
+  ok = ok && handler.Key("values", 6, true);
+  ok = ok && handler.StartArray();
+  for (const auto& s : samples) {
+    ok = ok && handler.StartArray();
+    ok = ok && handler.Uint64(std::get<2>(s));
+    ok = ok && handler.Double(std::get<3>(s));
+    ok = ok && handler.EndArray(2);
+  }
+  ok = ok && handler.EndArray(samples.size());
+  if (!unit_first) {
+    ok = ok && emit_unit();
+  }
+  ok = ok && handler.EndObject(2);
+  return ok;
+}
+
+}  // namespace
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_bus_signal_reader, BusSignalHandler) {
+  std::vector<std::string> signals;
+  std::vector<Sample> samples;
+  const auto on_signal = [&](const std::string& name) {
+    signals.push_back(name);
+    return true;
+  };
+  size_t num_chunks = 0;
+  const auto on_samples = [&](const std::string& name, const std::string& unit,
+                              const std::vector<uint64_t>& times,
+                              const std::vector<double>& values) {
+    EXPECT_EQ(times.size(), values.size());
+    for (size_t i = 0; i < times.size(); ++i) {
+      samples.emplace_back(name, unit, times[i], values[i]);
+    }
+    ++num_chunks;
+    return true;
+  };
+
+  BusSignalHandler handler({"roll_angle", "vehicle_speed"}, on_signal,
+                           on_samples);
+
+  const std::vector<Sample> roll = {
+      Sample("roll_angle", "DegreOfArc", 10, 1.5),
+      Sample("roll_angle", "DegreOfArc", 20, 2.5)};
+  const std::vector<Sample> speed = {Sample("vehicle_speed", "null", 15, 3.0)};
+  const std::vector<Sample> ignored = {Sample("pitch_angle", "null", 5, 4.0)};
+
+  ASSERT_TRUE(handler.StartObject());
+  ASSERT_TRUE(emit_signal(handler, "roll_angle", "DegreOfArc", roll, true));
+  ASSERT_TRUE(emit_signal(handler, "pitch_angle", nullptr, ignored, true));
+  // samples are buffered until the unit is known
+  ASSERT_TRUE(emit_signal(handler, "vehicle_speed", nullptr, speed, false));
+  ASSERT_TRUE(handler.EndObject(3));
+  EXPECT_TRUE(handler.get_error_string().empty());
+
+  const std::vector<std::string> signals_expected = {"roll_angle",
+                                                     "vehicle_speed"};
+  EXPECT_EQ(signals_expected, signals);
+
+  auto samples_expected = roll;
+  samples_expected.insert(std::end(samples_expected), std::begin(speed),
+                          std::end(speed));
+  EXPECT_EQ(samples_expected, samples);
+  // one chunk per signal
+  EXPECT_EQ(2, num_chunks);
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_bus_signal_reader, BusSignalHandler_chunks) {
+  std::vector<size_t> chunk_sizes;
+  std::vector<uint64_t> times;
+  const auto on_signal = [](const std::string&) { return true; };
+  const auto on_samples = [&](const std::string&, const std::string&,
+                              const std::vector<uint64_t>& t,
+                              const std::vector<double>&) {
+    chunk_sizes.push_back(t.size());
+    times.insert(std::end(times), std::begin(t), std::end(t));
+    return true;
+  };
+
+  constexpr auto NUM_SAMPLES = ((2 * BusSignalHandler::CHUNK_SIZE) + 3);
+  std::vector<Sample> samples;
+  for (uint64_t i = 0; i < NUM_SAMPLES; ++i) {
+    samples.emplace_back("vehicle_speed", "null", i, 1.0);
+  }
+
+  for (const auto unit_first : {true, false}) {
+    chunk_sizes.clear();
+    times.clear();
+    BusSignalHandler handler({}, on_signal, on_samples);
+    ASSERT_TRUE(handler.StartObject());
+    ASSERT_TRUE(
+        emit_signal(handler, "vehicle_speed", nullptr, samples, unit_first));
+    ASSERT_TRUE(handler.EndObject(1));
+
+    const auto expected_sizes =
+        (unit_first ? std::vector<size_t>{BusSignalHandler::CHUNK_SIZE,
+                                          BusSignalHandler::CHUNK_SIZE, 3}
+                    : std::vector<size_t>{NUM_SAMPLES});
+    EXPECT_EQ(expected_sizes, chunk_sizes);
+    ASSERT_EQ(NUM_SAMPLES, times.size());
+    for (uint64_t i = 0; i < NUM_SAMPLES; ++i) {
+      EXPECT_EQ(i, times[i]);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_bus_signal_reader, BusSignalHandler_failures) {
+  const auto on_signal = [](const std::string&) { return true; };
+  const auto on_samples = [](const std::string&, const std::string&,
+                             const std::vector<uint64_t>&,
+                             const std::vector<double>&) { return true; };
+
+  // signal without a unit
+  {
+    BusSignalHandler handler({}, on_signal, on_samples);
+    ASSERT_TRUE(handler.StartObject());
+    ASSERT_TRUE(handler.Key("roll_angle", 10, true));
+    ASSERT_TRUE(handler.StartObject());
+    EXPECT_FALSE(handler.EndObject(0));
+    EXPECT_FALSE(handler.get_error_string().empty());
+  }
+
+  // timestamp that is not an unsigned integer
+  {
+    BusSignalHandler handler({}, on_signal, on_samples);
+    ASSERT_TRUE(handler.StartObject());
+    ASSERT_TRUE(handler.Key("roll_angle", 10, true));
+    ASSERT_TRUE(handler.StartObject());
+    ASSERT_TRUE(handler.Key("values", 6, true));
+    ASSERT_TRUE(handler.StartArray());
+    ASSERT_TRUE(handler.StartArray());
+    EXPECT_FALSE(handler.Double(1.5));
+    EXPECT_FALSE(handler.get_error_string().empty());
+  }
+
+  // sample that is not a pair
+  {
+    BusSignalHandler handler({}, on_signal, on_samples);
+    ASSERT_TRUE(handler.StartObject());
+    ASSERT_TRUE(handler.Key("roll_angle", 10, true));
+    ASSERT_TRUE(handler.StartObject());
+    ASSERT_TRUE(handler.Key("unit", 4, true));
+    ASSERT_TRUE(handler.Null());
+    ASSERT_TRUE(handler.Key("values", 6, true));
+    ASSERT_TRUE(handler.StartArray());
+    ASSERT_TRUE(handler.StartArray());
+    ASSERT_TRUE(handler.Uint(10));
+    EXPECT_FALSE(handler.EndArray(1));
+    EXPECT_FALSE(handler.get_error_string().empty());
+  }
+
+  // callback stops parsing
+  {
+    const auto stop = [](const std::string&, const std::string&,
+                         const std::vector<uint64_t>&,
+                         const std::vector<double>&) { return false; };
+    BusSignalHandler handler({}, on_signal, stop);
+    ASSERT_TRUE(handler.StartObject());
+    // samples are passed on when the signal ends
+    EXPECT_FALSE(emit_signal(handler, "roll_angle", "null",
+                             {Sample("roll_angle", "null", 10, 1.0)}, true));
+    EXPECT_FALSE(handler.get_error_string().empty());
+  }
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
@@ -0,0 +1,117 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "a2d2_to_ros/checkpoint.hpp"
+
+namespace a2d2_to_ros {
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_checkpoint, get_checkpoint_key) {
+  const std::vector<std::string> paths = {"a.npz", "b.npz"};
+  const auto key = get_checkpoint_key("split-duration: 0", paths);
+  EXPECT_EQ(key, get_checkpoint_key("split-duration: 0", paths));
+  EXPECT_NE(key, get_checkpoint_key("split-duration: 60", paths));
+  EXPECT_NE(key, get_checkpoint_key("split-duration: 0", {"a.npz"}));
+  // strings are separated, so moving characters between them changes the key
+  EXPECT_NE(get_checkpoint_key("", {"ab", "c"}),
+            get_checkpoint_key("", {"a", "bc"}));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_checkpoint, save_load) {
+  const auto path = (boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path("a2d2_to_ros-%%%%%%"))
+                        .string();
+
+  Checkpoint checkpoint;
+  checkpoint.key = 0x0123456789abcdefull;
+  checkpoint.next_frame = 42;
+  checkpoint.segments.push_back({"/data/timespan_0s_60s/lidar.bag", 1234});
+  checkpoint.segments.push_back({"/data/with space/lidar.bag", 5678});
+  ASSERT_TRUE(save_checkpoint(path, checkpoint));
+
+  const auto loaded_opt = load_checkpoint(path);
+  ASSERT_TRUE(loaded_opt);
+  EXPECT_EQ(checkpoint.key, loaded_opt->key);
+  EXPECT_EQ(checkpoint.next_frame, loaded_opt->next_frame);
+  ASSERT_EQ(checkpoint.segments.size(), loaded_opt->segments.size());
+  for (size_t i = 0; i < checkpoint.segments.size(); ++i) {
+    EXPECT_EQ(checkpoint.segments[i].path, loaded_opt->segments[i].path);
+    EXPECT_EQ(checkpoint.segments[i].size, loaded_opt->segments[i].size);
+  }
+
+  // a checkpoint for other inputs is not resumed
+  EXPECT_TRUE(get_resume_checkpoint(path, checkpoint.key, 42));
+  EXPECT_FALSE(get_resume_checkpoint(path, (checkpoint.key + 1), 42));
+  EXPECT_FALSE(get_resume_checkpoint(path, checkpoint.key, 41));
+
+  // a malformed checkpoint is not loaded
+  { std::ofstream(path, std::ios::app) << "not a size\n"; }
+  EXPECT_FALSE(load_checkpoint(path));
+
+  boost::filesystem::remove(path);
+  EXPECT_FALSE(load_checkpoint(path));
+
+  // without a checkpoint, a conversion starts from the first frame
+  const auto empty_opt = get_resume_checkpoint(path, checkpoint.key, 42);
+  ASSERT_TRUE(empty_opt);
+  EXPECT_EQ(0, empty_opt->next_frame);
+  EXPECT_TRUE(empty_opt->segments.empty());
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_checkpoint, CheckpointWriter_update) {
+  const auto path = (boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path("a2d2_to_ros-%%%%%%"))
+                        .string();
+
+  CheckpointWriter writer(path, 7, 10.0);
+  EXPECT_TRUE(writer.update(5.0, 1, {}));
+  EXPECT_TRUE(writer.update(14.9, 2, {}));
+  EXPECT_FALSE(load_checkpoint(path));
+
+  // an interval after the first frame
+  EXPECT_TRUE(writer.update(15.0, 3, {}));
+  const auto checkpoint_opt = load_checkpoint(path);
+  ASSERT_TRUE(checkpoint_opt);
+  EXPECT_EQ(7, checkpoint_opt->key);
+  EXPECT_EQ(3, checkpoint_opt->next_frame);
+
+  writer.remove();
+  EXPECT_FALSE(load_checkpoint(path));
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
@@ -23,6 +23,8 @@
  */
 #include <gtest/gtest.h>
 
+#include <vector>
+
 #include "a2d2_to_ros/conversions.hpp"
 
 static constexpr auto EPS = 1e-8;
@@ -153,5 +155,41 @@ TEST(A2D2_to_ROS_conversions, to_ros_units) {
 
 //------------------------------------------------------------------------------
 
+TEST(A2D2_to_ROS_conversions, to_ros_units_batch) {
+  const std::vector<double> in = {-180.0, -12.5, 0.0, 0.3, 36.37, 99.1, 720.0};
+  for (const auto& unit :
+       {"null", "Unit_Bar", "Unit_PerCent", "Unit_DegreOfArc",
+        "Unit_KiloMeterPerHour", "Unit_MeterPerSeconSquar",
+        "Unit_DegreOfArcPerSecon"}) {
+    const auto units = get_unit_enum(unit);
+
+    std::vector<double> out(in.size());
+    to_ros_units(units, in.data(), out.data(), in.size());
+    for (size_t i = 0; i < in.size(); ++i) {
+      EXPECT_EQ(to_ros_units(unit, in[i]), out[i]);
+      EXPECT_EQ(to_ros_units(units, in[i]), out[i]);
+    }
+
+    // in place
+    auto in_place = in;
+    to_ros_units(units, in_place.data(), in_place.data(), in_place.size());
+    EXPECT_EQ(out, in_place);
+  }
+
+  {
+    std::vector<float> out(in.size());
+    const std::vector<float> in_f(std::begin(in), std::end(in));
+    to_ros_units(Units::UNKNOWN, in_f.data(), out.data(), in_f.size());
+    for (const auto& v : out) {
+      EXPECT_TRUE(std::isnan(v));
+    }
+  }
+
+  // nothing to do
+  to_ros_units<double>(Units::Unit_DegreOfArc, nullptr, nullptr, 0);
+}
+
+//------------------------------------------------------------------------------
+
 }  // namespace a2d2_to_ros
 
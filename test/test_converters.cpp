@@ -0,0 +1,89 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "a2d2_to_ros/converters.hpp"
+
+namespace a2d2_to_ros {
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_converters, CameraFrameConverter_compressed) {
+  RunStats stats(false);
+  CameraInfoMap camera_infos;
+  camera_infos["front_center"].width = 1920;
+  camera_infos["front_center"].height = 1208;
+  const CameraFrameConverter converter(true, camera_infos, stats);
+  EXPECT_TRUE(converter.is_compressed());
+
+  // a compressed image takes the PNG bytes as they are
+  const std::vector<uint8_t> png = {0x89, 'P', 'N', 'G'};
+  auto bytes = png;
+  const auto messages =
+      converter.convert(bytes, "front_center", ros::Time(2, 0));
+  ASSERT_TRUE(messages);
+  EXPECT_EQ("cameras_front_center", messages->header.frame_id);
+  EXPECT_EQ(ros::Time(2, 0), messages->header.stamp);
+  EXPECT_FALSE(messages->image);
+  ASSERT_TRUE(messages->compressed_image);
+  EXPECT_EQ("png", messages->compressed_image->format);
+  EXPECT_EQ(messages->header.frame_id,
+            messages->compressed_image->header.frame_id);
+  EXPECT_EQ(png, messages->compressed_image->data);
+
+  const auto info = converter.get_camera_info("front_center");
+  ASSERT_TRUE(info);
+  EXPECT_EQ(1920, info->width);
+  EXPECT_EQ(1208, info->height);
+  EXPECT_EQ("cameras_front_center", info->header.frame_id);
+  EXPECT_FALSE(converter.get_camera_info("rear_center"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_converters, LidarFrameConverter_rejects_invalid_frames) {
+  RunStats stats(false);
+  LidarFrameConverter::Options options;
+  options.include_depth_map = true;
+  options.downsample.stride = 2;
+  const LidarFrameConverter converter(options, CameraInfoMap(), stats);
+  EXPECT_TRUE(converter.get_options().include_depth_map);
+  EXPECT_EQ(2, converter.get_options().downsample.stride);
+
+  // a file that was never opened has none of the lidar arrays
+  npz::MappedNpz npz;
+  EXPECT_FALSE(converter.convert(npz, "front_center", ros::Time(1, 0)));
+
+  // messages without a depth map have nothing to recycle
+  LidarFrameMessages messages;
+  messages.sensor_name = "front_center";
+  converter.recycle(messages);
+  EXPECT_FALSE(messages.depth_map);
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
@@ -0,0 +1,192 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "a2d2_to_ros/downsample.hpp"
+
+namespace a2d2_to_ros {
+
+namespace {
+
+/** @brief Columns of a synthetic frame, with every attribute set from xyz. */
+struct Frame {
+  explicit Frame(const std::vector<double>& xyz)
+      : points(xyz), num_points(xyz.size() / 3) {
+    for (size_t i = 0; i < num_points; ++i) {
+      const auto d = static_cast<double>(i);
+      const auto n = static_cast<int64_t>(i);
+      azimuth.push_back(d);
+      boundary.push_back(n);
+      col.push_back(d);
+      depth.push_back(d);
+      distance.push_back(d);
+      lidar_id.push_back(n);
+      rectime.push_back(n);
+      reflectance.push_back(n);
+      row.push_back(d);
+      timestamp.push_back(n);
+    }
+    valid.reset(new bool[num_points]);
+    std::fill(valid.get(), (valid.get() + num_points), true);
+  }
+
+  npz::Columns get_columns() const {
+    npz::Columns columns;
+    columns.points = points.data();
+    columns.azimuth = azimuth.data();
+    columns.boundary = boundary.data();
+    columns.col = col.data();
+    columns.depth = depth.data();
+    columns.distance = distance.data();
+    columns.lidar_id = lidar_id.data();
+    columns.rectime = rectime.data();
+    columns.reflectance = reflectance.data();
+    columns.row = row.data();
+    columns.timestamp = timestamp.data();
+    columns.valid = valid.get();
+    columns.num_points = num_points;
+    return columns;
+  }
+
+  std::vector<double> points;
+  std::vector<double> azimuth, col, depth, distance, row;
+  std::vector<int64_t> boundary, lidar_id, rectime, reflectance, timestamp;
+  std::unique_ptr<bool[]> valid;
+  size_t num_points;
+};  // struct Frame
+
+}  // namespace
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_downsample, DownsampleOptions_enabled) {
+  DownsampleOptions options;
+  EXPECT_FALSE(options.enabled());
+  options.stride = 0;
+  EXPECT_FALSE(options.enabled());
+  options.voxel_size = std::numeric_limits<double>::infinity();
+  EXPECT_FALSE(options.enabled());
+  options.voxel_size = -1.0;
+  EXPECT_FALSE(options.enabled());
+
+  options.voxel_size = 0.1;
+  EXPECT_TRUE(options.enabled());
+  options = DownsampleOptions();
+  options.stride = 2;
+  EXPECT_TRUE(options.enabled());
+  options = DownsampleOptions();
+  options.drop_invalid = true;
+  EXPECT_TRUE(options.enabled());
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_downsample, select_points) {
+  const auto nan = std::numeric_limits<double>::quiet_NaN();
+  // two points in the voxel at the origin, one next to it across the negative
+  // x boundary, one far away, and one without coordinates
+  Frame frame({0.1, 0.1, 0.1, 0.9, 0.5, 0.2, -0.1, 0.1, 0.1, 100.0, 0.0, 0.0,
+               nan, 0.0, 0.0});
+  const auto columns = frame.get_columns();
+  std::vector<uint32_t> indices = {42};
+
+  DownsampleOptions options;
+  select_points(columns, options, indices);
+  EXPECT_EQ(std::vector<uint32_t>({0, 1, 2, 3, 4}), indices);
+
+  options.stride = 2;
+  select_points(columns, options, indices);
+  EXPECT_EQ(std::vector<uint32_t>({0, 2, 4}), indices);
+
+  // the first point of a voxel is kept
+  options.stride = 1;
+  options.voxel_size = 1.0;
+  select_points(columns, options, indices);
+  EXPECT_EQ(std::vector<uint32_t>({0, 2, 3}), indices);
+
+  // the stride is applied to the points that remain after dropping invalid
+  // ones
+  frame.valid[0] = false;
+  options.voxel_size = 0.0;
+  options.stride = 2;
+  options.drop_invalid = true;
+  select_points(columns, options, indices);
+  EXPECT_EQ(std::vector<uint32_t>({1, 3}), indices);
+
+  options.stride = 1;
+  options.voxel_size = 1.0;
+  select_points(columns, options, indices);
+  EXPECT_EQ(std::vector<uint32_t>({1, 2, 3}), indices);
+
+  Frame empty({});
+  select_points(empty.get_columns(), options, indices);
+  EXPECT_TRUE(indices.empty());
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_downsample, SelectedColumns_gather) {
+  Frame frame({1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0});
+  frame.valid[2] = false;
+  const auto columns = frame.get_columns();
+
+  SelectedColumns selected;
+  const auto& gathered = selected.gather(columns, {2, 0});
+  ASSERT_EQ(2, gathered.num_points);
+  EXPECT_EQ(7.0, gathered.points[0]);
+  EXPECT_EQ(9.0, gathered.points[2]);
+  EXPECT_EQ(1.0, gathered.points[3]);
+  EXPECT_EQ(3.0, gathered.points[5]);
+  EXPECT_EQ(2.0, gathered.azimuth[0]);
+  EXPECT_EQ(2, gathered.boundary[0]);
+  EXPECT_EQ(2.0, gathered.col[0]);
+  EXPECT_EQ(2.0, gathered.depth[0]);
+  EXPECT_EQ(2.0, gathered.distance[0]);
+  EXPECT_EQ(2, gathered.lidar_id[0]);
+  EXPECT_EQ(2, gathered.rectime[0]);
+  EXPECT_EQ(2, gathered.reflectance[0]);
+  EXPECT_EQ(2.0, gathered.row[0]);
+  EXPECT_EQ(0, gathered.timestamp[1]);
+  EXPECT_FALSE(gathered.valid[0]);
+  EXPECT_TRUE(gathered.valid[1]);
+
+  // buffers are reused, and the view follows them
+  const auto& regathered = selected.gather(columns, {1, 2, 0});
+  ASSERT_EQ(3, regathered.num_points);
+  EXPECT_EQ(4.0, regathered.points[0]);
+  EXPECT_TRUE(regathered.valid[0]);
+  EXPECT_FALSE(regathered.valid[1]);
+
+  EXPECT_EQ(0, selected.gather(columns, {}).num_points);
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
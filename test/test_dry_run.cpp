@@ -0,0 +1,131 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "a2d2_to_ros/dry_run.hpp"
+
+namespace a2d2_to_ros {
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_dry_run, get_sample_indices) {
+  EXPECT_TRUE(get_sample_indices(0, 4).empty());
+  EXPECT_TRUE(get_sample_indices(10, 0).empty());
+  EXPECT_EQ(std::vector<size_t>({0, 1, 2}), get_sample_indices(3, 4));
+  EXPECT_EQ(std::vector<size_t>({0, 1, 2}), get_sample_indices(3, 3));
+  EXPECT_EQ(std::vector<size_t>({0}), get_sample_indices(10, 1));
+  EXPECT_EQ(std::vector<size_t>({0, 4, 9}), get_sample_indices(10, 3));
+  EXPECT_EQ(std::vector<size_t>({0, 24, 49, 74, 99}),
+            get_sample_indices(100, 5));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_dry_run, DryRun_unsplit) {
+  DryRun dry_run(0.0, 0.0);
+  const auto lane =
+      dry_run.add_lane({0.0, 0.1, 0.2, 0.3}, 2, {"camera.bag", "lidar.bag"});
+  EXPECT_TRUE(dry_run.add_sample(lane, 0.5, {1000, 300}));
+  EXPECT_TRUE(dry_run.add_sample(lane, 1.5, {3000, 100}));
+  EXPECT_FALSE(dry_run.add_sample(lane, 1.0, {1000}));
+
+  const auto report = dry_run.project(2, 500);
+  ASSERT_EQ(2, report.bags.size());
+  const auto& camera = report.bags[0];
+  EXPECT_EQ("camera.bag", camera.name);
+  EXPECT_EQ(4, camera.num_frames);
+  EXPECT_EQ(2, camera.num_samples);
+  EXPECT_DOUBLE_EQ(2000.0, camera.mean_frame_bytes);
+  EXPECT_EQ(3000, camera.max_frame_bytes);
+  EXPECT_EQ(8000, camera.bytes);
+  EXPECT_TRUE(camera.windows.empty());
+  EXPECT_EQ(800, report.bags[1].bytes);
+
+  EXPECT_EQ(4, report.num_frames);
+  EXPECT_EQ(2, report.num_samples);
+  EXPECT_DOUBLE_EQ(1.0, report.mean_frame_s);
+  EXPECT_EQ(8800, report.bytes);
+  // four frames of 1 s each, split between two jobs
+  EXPECT_DOUBLE_EQ(2.0, report.seconds);
+  EXPECT_DOUBLE_EQ(2.0, report.frames_per_s);
+  EXPECT_DOUBLE_EQ(4400.0, report.bytes_per_s);
+  // two frames of the largest messages in flight, plus what is buffered
+  EXPECT_EQ((500 + (2 * (3000 + 300))), report.peak_memory_bytes);
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_dry_run, DryRun_split) {
+  DryRun dry_run(1.0, 2.0);
+  const auto first = dry_run.add_lane({1.0, 1.5, 3.2, 6.0}, 1, {"a.bag"});
+  const auto second = dry_run.add_lane({2.0}, 1, {"b.bag"});
+  // a lane without samples is projected as empty
+  dry_run.add_lane({1.0, 2.0}, 1, {"c.bag"});
+  EXPECT_TRUE(dry_run.add_sample(first, 1.0, {100}));
+  EXPECT_TRUE(dry_run.add_sample(second, 3.0, {10}));
+
+  const auto report = dry_run.project(1, 0);
+  ASSERT_EQ(3, report.bags.size());
+  const auto& a = report.bags[0];
+  ASSERT_EQ(3, a.windows.size());
+  EXPECT_EQ("timespan_1s_3s", a.windows[0].first);
+  EXPECT_EQ(200, a.windows[0].second);
+  EXPECT_EQ("timespan_3s_5s", a.windows[1].first);
+  EXPECT_EQ(100, a.windows[1].second);
+  EXPECT_EQ("timespan_5s_7s", a.windows[2].first);
+  EXPECT_EQ(100, a.windows[2].second);
+  EXPECT_EQ(400, a.bytes);
+
+  EXPECT_EQ(0, report.bags[2].bytes);
+  EXPECT_EQ(7, report.num_frames);
+  EXPECT_EQ(410, report.bytes);
+  EXPECT_DOUBLE_EQ(7.0, report.seconds);
+  EXPECT_DOUBLE_EQ(2.0, report.mean_frame_s);
+  EXPECT_EQ(110, report.peak_memory_bytes);
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_dry_run, DryRunReport_to_json) {
+  DryRun dry_run(0.0, 10.0);
+  const auto lane = dry_run.add_lane({0.0, 12.0}, 2, {"lidar.bag"});
+  dry_run.add_sample(lane, 0.25, {1000});
+  const auto json = dry_run.project(1, 0).to_json("lidar");
+
+  EXPECT_NE(std::string::npos, json.find("\"converter\": \"lidar\""));
+  EXPECT_NE(std::string::npos, json.find("\"dry_run\": true"));
+  EXPECT_NE(std::string::npos, json.find("\"bytes\": 2000"));
+  EXPECT_NE(std::string::npos, json.find("\"peak_memory_bytes\": 2000"));
+  EXPECT_NE(std::string::npos, json.find("\"name\": \"lidar.bag\""));
+  EXPECT_NE(std::string::npos,
+            json.find("{\"name\": \"timespan_10s_20s\", \"bytes\": 1000}"));
+
+  const auto empty = DryRunReport().to_json("lidar");
+  EXPECT_NE(std::string::npos, empty.find("\"bags\": []"));
+}
+
+}  // namespace a2d2_to_ros
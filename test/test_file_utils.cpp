@@ -23,6 +23,10 @@
  */
 #include <gtest/gtest.h>
 
+#include <fstream>
+
+#include <boost/filesystem.hpp>
+
 #include "a2d2_to_ros/file_utils.hpp"
 
 namespace a2d2_to_ros {
@@ -133,5 +137,87 @@ TEST(A2D2_to_ROS_file_utils, frame_from_filename) {
 
 //------------------------------------------------------------------------------
 
-}  // namespace a2d2_to_ros
+TEST(A2D2_to_ROS_file_utils, get_file_as_bytes) {
+  const auto path = (boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path("a2d2_to_ros-%%%%%%.bin"))
+                        .string();
+  const std::vector<uint8_t> expected = {0x89, 'P', 'N', 'G', 0x00, 0x0a, 0xff};
+  {
+    std::ofstream ofs(path, std::ios::binary);
+    ofs.write(reinterpret_cast<const char*>(expected.data()), expected.size());
+  }
+
+  // previous contents are replaced
+  std::vector<uint8_t> bytes = {1, 2, 3};
+  EXPECT_TRUE(get_file_as_bytes(path, bytes));
+  EXPECT_EQ(expected, bytes);
+
+  boost::filesystem::remove(path);
+  EXPECT_FALSE(get_file_as_bytes(path, bytes));
+  EXPECT_TRUE(bytes.empty());
+}
 
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_file_utils, get_file_as_string) {
+  const auto path = (boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path("a2d2_to_ros-%%%%%%.json"))
+                        .string();
+  const std::string expected = "{\"cam_tstamp\": 1554121593909500}\n";
+  {
+    std::ofstream ofs(path, std::ios::binary);
+    ofs << expected;
+  }
+  EXPECT_EQ(expected, get_file_as_string(path));
+
+  // previous contents are replaced, and a larger buffer is reused
+  std::string contents(4096, 'x');
+  const auto capacity = contents.capacity();
+  EXPECT_TRUE(get_file_as_string(path, contents));
+  EXPECT_EQ(expected, contents);
+  EXPECT_EQ(capacity, contents.capacity());
+
+  boost::filesystem::remove(path);
+  EXPECT_EQ("", get_file_as_string(path));
+  EXPECT_FALSE(get_file_as_string(path, contents));
+  EXPECT_TRUE(contents.empty());
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_file_utils, get_sensor_data_paths) {
+  const auto tmp = (boost::filesystem::temp_directory_path() /
+                    boost::filesystem::unique_path("a2d2_to_ros-%%%%%%"));
+  const auto root = (tmp / "20190401_145936");
+  const auto camera_path = (root / "camera");
+  boost::filesystem::create_directories(camera_path / "cam_side_left");
+  boost::filesystem::create_directories(camera_path / "cam_front_center");
+  // files next to the sensor directories are not sensor data directories
+  { std::ofstream ofs((camera_path / "notes.txt").string()); }
+
+  // a drive root lists its sensor directories in sorted order
+  {
+    const std::vector<std::string> expected = {
+        (camera_path / "cam_front_center").string(),
+        (camera_path / "cam_side_left").string()};
+    EXPECT_EQ(expected, get_sensor_data_paths(root.string(), "camera"));
+  }
+
+  // anything else is a sensor data directory itself
+  {
+    const auto path = (camera_path / "cam_side_left").string();
+    const std::vector<std::string> expected = {path};
+    EXPECT_EQ(expected, get_sensor_data_paths(path, "camera"));
+    EXPECT_EQ(expected, get_sensor_data_paths(path, "lidar"));
+  }
+  {
+    const std::vector<std::string> expected = {root.string()};
+    EXPECT_EQ(expected, get_sensor_data_paths(root.string(), "lidar"));
+  }
+
+  boost::filesystem::remove_all(tmp);
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
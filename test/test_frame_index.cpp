@@ -0,0 +1,148 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <limits>
+
+#include <boost/filesystem.hpp>
+
+#include "a2d2_to_ros/conversions.hpp"
+#include "a2d2_to_ros/frame_index.hpp"
+
+namespace a2d2_to_ros {
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_frame_index, FrameIndex) {
+  const auto directory =
+      (boost::filesystem::temp_directory_path() /
+       boost::filesystem::unique_path("a2d2_to_ros-%%%%%%"));
+  ASSERT_TRUE(boost::filesystem::create_directories(directory));
+  const auto dir = directory.string();
+
+  // nothing to load yet
+  auto index = FrameIndex::load(dir);
+  EXPECT_EQ(0, index.size());
+  EXPECT_FALSE(index.is_modified());
+  EXPECT_FALSE(index.get_timestamp("frame_a"));
+
+  index.set_timestamp("frame_a", 1554121593909500u);
+  index.set_timestamp("frame_b", 1554121594009500u);
+  EXPECT_TRUE(index.is_modified());
+  ASSERT_TRUE(index.save(dir));
+
+  {
+    auto loaded = FrameIndex::load(dir);
+    EXPECT_EQ(2, loaded.size());
+    EXPECT_FALSE(loaded.is_modified());
+    ASSERT_TRUE(loaded.get_timestamp("frame_a"));
+    EXPECT_EQ(1554121593909500u, *loaded.get_timestamp("frame_a"));
+    ASSERT_TRUE(loaded.get_timestamp("frame_b"));
+    EXPECT_EQ(1554121594009500u, *loaded.get_timestamp("frame_b"));
+
+    // setting an existing value is not a modification
+    loaded.set_timestamp("frame_a", 1554121593909500u);
+    EXPECT_FALSE(loaded.is_modified());
+    loaded.set_timestamp("frame_a", 1554121593909501u);
+    EXPECT_TRUE(loaded.is_modified());
+  }
+
+  // a malformed index is ignored entirely
+  {
+    std::ofstream ofs(dir + "/" + FrameIndex::FILENAME, std::ios::app);
+    ofs << "not_a_timestamp frame_c\n";
+  }
+  EXPECT_EQ(0, FrameIndex::load(dir).size());
+
+  boost::filesystem::remove_all(directory);
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_frame_index, get_frame_window) {
+  // one frame every 0.1 seconds
+  constexpr uint64_t T0 = 1554121593900000u;
+  constexpr uint64_t DT = 100000u;
+  std::vector<uint64_t> timestamps;
+  for (uint64_t i = 0; i < 100; ++i) {
+    timestamps.push_back(T0 + (i * DT));
+  }
+
+  constexpr auto MAX_DURATION = std::numeric_limits<double>::max();
+
+  {
+    const auto window = get_frame_window(timestamps, 0, 0.0, MAX_DURATION);
+    EXPECT_EQ(0, window.begin);
+    EXPECT_EQ(100, window.end);
+    ASSERT_TRUE(window.first_time);
+    EXPECT_EQ(a2d2_timestamp_to_ros_time(T0), *window.first_time);
+  }
+
+  {
+    const auto window = get_frame_window(timestamps, 0, 1.0, 2.0);
+    EXPECT_EQ(10, window.begin);
+    EXPECT_EQ(31, window.end);
+    ASSERT_TRUE(window.first_time);
+    EXPECT_EQ(a2d2_timestamp_to_ros_time(T0), *window.first_time);
+  }
+
+  // offsets are measured from the start time, not from the first frame
+  {
+    const auto start_time = (T0 + (20 * DT) + 1);
+    const auto window =
+        get_frame_window(timestamps, start_time, 0.5, MAX_DURATION);
+    EXPECT_EQ(26, window.begin);
+    EXPECT_EQ(100, window.end);
+    ASSERT_TRUE(window.first_time);
+    EXPECT_EQ(a2d2_timestamp_to_ros_time(start_time), *window.first_time);
+  }
+
+  // nothing after the start time
+  {
+    const auto window =
+        get_frame_window(timestamps, (T0 + (100 * DT)), 0.0, MAX_DURATION);
+    EXPECT_EQ(window.begin, window.end);
+    EXPECT_FALSE(window.first_time);
+  }
+
+  // window past the end of the data
+  {
+    const auto window = get_frame_window(timestamps, 0, 20.0, 1.0);
+    EXPECT_EQ(100, window.begin);
+    EXPECT_EQ(100, window.end);
+  }
+
+  // no data
+  {
+    const auto window = get_frame_window({}, 0, 0.0, MAX_DURATION);
+    EXPECT_EQ(0, window.begin);
+    EXPECT_EQ(0, window.end);
+    EXPECT_FALSE(window.first_time);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
@@ -0,0 +1,132 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+
+#include "a2d2_to_ros/json_utils.hpp"
+
+namespace a2d2_to_ros {
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_json_utils, get_validation_policy) {
+  {
+    const auto policy = get_validation_policy("full");
+    ASSERT_TRUE(policy);
+    EXPECT_EQ(ValidationPolicy::Mode::FULL, policy->mode);
+    EXPECT_TRUE(policy->should_validate(0));
+    EXPECT_TRUE(policy->should_validate(1000000));
+  }
+
+  {
+    const auto policy = get_validation_policy("none");
+    ASSERT_TRUE(policy);
+    EXPECT_EQ(ValidationPolicy::Mode::NONE, policy->mode);
+    EXPECT_FALSE(policy->should_validate(0));
+    EXPECT_FALSE(policy->should_validate(1000000));
+  }
+
+  {
+    const auto policy = get_validation_policy("sample:3");
+    ASSERT_TRUE(policy);
+    EXPECT_EQ(ValidationPolicy::Mode::SAMPLE, policy->mode);
+    EXPECT_EQ(3, policy->num_samples);
+    EXPECT_TRUE(policy->should_validate(0));
+    EXPECT_TRUE(policy->should_validate(2));
+    EXPECT_FALSE(policy->should_validate(3));
+  }
+
+  {
+    const auto policy = get_validation_policy("sample:0");
+    ASSERT_TRUE(policy);
+    EXPECT_FALSE(policy->should_validate(0));
+  }
+
+  EXPECT_FALSE(get_validation_policy(""));
+  EXPECT_FALSE(get_validation_policy("Full"));
+  EXPECT_FALSE(get_validation_policy("sample"));
+  EXPECT_FALSE(get_validation_policy("sample:"));
+  EXPECT_FALSE(get_validation_policy("sample:-1"));
+  EXPECT_FALSE(get_validation_policy("sample:2x"));
+  EXPECT_FALSE(get_validation_policy("sample:99999999999999999999999"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_json_utils, FrameTimestampReader) {
+  rapidjson::Document schema_d;
+  schema_d.Parse(
+      "{\"type\": \"object\", \"required\": [\"cam_tstamp\"], "
+      "\"properties\": {\"cam_tstamp\": {\"type\": \"integer\", "
+      "\"minimum\": 0}}}");
+  ASSERT_FALSE(schema_d.HasParseError());
+  rapidjson::SchemaDocument schema(schema_d);
+  FrameTimestampReader reader(schema);
+
+  const auto valid =
+      "{\"cam_name\": \"front_center\", \"nested\": {\"cam_tstamp\": 7}, "
+      "\"lidar_ids\": [1, 2], \"cam_tstamp\": 1554121593909500}";
+  for (const auto validate : {true, false}) {
+    const auto stamp = reader.read(valid, validate);
+    ASSERT_TRUE(stamp);
+    EXPECT_EQ(1554121593909500u, *stamp);
+    EXPECT_TRUE(reader.get_error_string().empty());
+  }
+
+  // fails the schema, but the timestamp is still readable
+  const auto negative = "{\"cam_tstamp\": -5}";
+  EXPECT_FALSE(reader.read(negative, true));
+  EXPECT_FALSE(reader.get_error_string().empty());
+  EXPECT_FALSE(reader.read(negative, false));
+
+  const auto missing = "{\"nested\": {\"cam_tstamp\": 7}}";
+  EXPECT_FALSE(reader.read(missing, true));
+  EXPECT_FALSE(reader.read(missing, false));
+  EXPECT_FALSE(reader.get_error_string().empty());
+
+  const auto malformed = "{\"cam_tstamp\": ";
+  EXPECT_FALSE(reader.read(malformed, true));
+  EXPECT_FALSE(reader.read(malformed, false));
+
+  // the validator is reusable after a failure
+  const auto stamp = reader.read(valid, true);
+  ASSERT_TRUE(stamp);
+  EXPECT_EQ(1554121593909500u, *stamp);
+
+  // parsing in place gives the same results
+  for (const auto validate : {true, false}) {
+    std::string buffer(valid);
+    const auto insitu_stamp = reader.read_insitu(&buffer[0], validate);
+    ASSERT_TRUE(insitu_stamp);
+    EXPECT_EQ(1554121593909500u, *insitu_stamp);
+
+    buffer = negative;
+    EXPECT_FALSE(reader.read_insitu(&buffer[0], validate));
+    buffer = malformed;
+    EXPECT_FALSE(reader.read_insitu(&buffer[0], validate));
+  }
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
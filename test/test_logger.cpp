@@ -0,0 +1,96 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+#include "a2d2_to_ros/logger.hpp"
+
+namespace a2d2_to_ros {
+namespace logging {
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_logger, get_level) {
+  EXPECT_EQ(Level::DEBUG, *get_level("debug"));
+  EXPECT_EQ(Level::INFO, *get_level("info"));
+  EXPECT_EQ(Level::WARN, *get_level("warn"));
+  EXPECT_EQ(Level::ERROR, *get_level("error"));
+  EXPECT_EQ(Level::FATAL, *get_level("fatal"));
+
+  EXPECT_FALSE(get_level(""));
+  EXPECT_FALSE(get_level("INFO"));
+  EXPECT_FALSE(get_level("warning"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_logger, set_level) {
+  EXPECT_FALSE(is_enabled(Level::DEBUG));
+  EXPECT_TRUE(is_enabled(Level::INFO));
+
+  set_level(Level::ERROR);
+  EXPECT_FALSE(is_enabled(Level::WARN));
+  EXPECT_TRUE(is_enabled(Level::ERROR));
+  EXPECT_TRUE(is_enabled(Level::FATAL));
+
+  set_level(Level::INFO);
+  EXPECT_TRUE(is_enabled(Level::INFO));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_logger, ProgressLogger_add) {
+  ProgressLogger progress("test", "frames", 250, 100);
+  EXPECT_FALSE(progress.add(99));
+  EXPECT_TRUE(progress.add());
+  EXPECT_FALSE(progress.add());
+  // lines are logged once per multiple of the interval that is crossed
+  EXPECT_TRUE(progress.add(120));
+  EXPECT_FALSE(progress.add(28));
+  // and once the total is reached
+  EXPECT_TRUE(progress.add());
+  EXPECT_FALSE(progress.add());
+
+  ProgressLogger disabled("test", "frames", 10, 0);
+  EXPECT_FALSE(disabled.add(10));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_logger, ProgressLogger_get_line) {
+  const auto start = ProgressLogger::Clock::now();
+  ProgressLogger progress("cam_front_center", "frames", 200, 100);
+  EXPECT_EQ("cam_front_center: 50/200 frames (25.0%), 12.5 frames/s",
+            progress.get_line(50, start + std::chrono::seconds(4)));
+
+  ProgressLogger unknown_total("bus", "samples", 0, 100);
+  EXPECT_EQ("bus: 300 samples, 150.0 samples/s",
+            unknown_total.get_line(300, start + std::chrono::seconds(2)));
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace logging
+}  // namespace a2d2_to_ros
@@ -0,0 +1,122 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "a2d2_to_ros/manifest.hpp"
+
+namespace a2d2_to_ros {
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_manifest, parse_frame_name) {
+  {
+    const auto name_opt =
+        parse_frame_name("20190401145936_lidar_frontcenter_000000080");
+    ASSERT_TRUE(name_opt);
+    EXPECT_EQ("20190401145936", name_opt->recording);
+    EXPECT_EQ("lidar", name_opt->modality);
+    EXPECT_EQ("frontcenter", name_opt->frame);
+    EXPECT_EQ(80, name_opt->sequence);
+  }
+
+  EXPECT_TRUE(parse_frame_name("20190401145936_camera_sideleft_000000080"));
+
+  EXPECT_FALSE(parse_frame_name(""));
+  EXPECT_FALSE(parse_frame_name("20190401145936_lidar_frontcenter"));
+  EXPECT_FALSE(parse_frame_name("20190401145936_lidar_front_center_000000080"));
+  EXPECT_FALSE(parse_frame_name("20190401145936_lidar_frontcenter_00000008a"));
+  EXPECT_FALSE(parse_frame_name("20190401145936_lidar_frontcenter_"));
+  // too long to be a sequence number
+  EXPECT_FALSE(parse_frame_name("20190401145936_lidar_frontcenter_" +
+                                std::string(20, '9')));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_manifest, build_manifest) {
+  const std::vector<std::string> npz_paths = {
+      "/lidar/20190401145936_lidar_frontcenter_000000100.npz",
+      "/lidar/20190401145936_lidar_frontcenter_000000080.npz"};
+  const std::vector<std::string> json_paths = {
+      "/camera/20190401145936_camera_frontcenter_000000080.json",
+      "/camera/20190401145936_camera_frontcenter_000000090.json",
+      "/camera/20190401145936_camera_frontcenter_000000100.json"};
+
+  const auto manifest_opt = build_manifest(npz_paths, json_paths);
+  ASSERT_TRUE(manifest_opt);
+  const auto& manifest = *manifest_opt;
+  ASSERT_EQ(2, manifest.size());
+
+  // sorted by sequence number
+  EXPECT_EQ(80, manifest[0].sequence);
+  EXPECT_EQ(npz_paths[1], manifest[0].data_path);
+  EXPECT_EQ(json_paths[0], manifest[0].info_path);
+  EXPECT_EQ("20190401145936_camera_frontcenter_000000080",
+            manifest[0].info_basename);
+  EXPECT_EQ("front_center", manifest[0].sensor_name);
+  EXPECT_EQ(100, manifest[1].sequence);
+  EXPECT_EQ(npz_paths[0], manifest[1].data_path);
+  EXPECT_EQ(json_paths[2], manifest[1].info_path);
+
+  // every data file needs a frame info file of the same sensor
+  EXPECT_FALSE(build_manifest(
+      {"/lidar/20190401145936_lidar_frontcenter_000000110.npz"}, json_paths));
+  EXPECT_FALSE(build_manifest(
+      {"/lidar/20190401145936_lidar_sideleft_000000080.npz"}, json_paths));
+  EXPECT_FALSE(build_manifest({"/lidar/notes.npz"}, json_paths));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_manifest, list_directory) {
+  const auto tmp = (boost::filesystem::temp_directory_path() /
+                    boost::filesystem::unique_path("a2d2_to_ros-%%%%%%"));
+  EXPECT_FALSE(list_directory(tmp.string()));
+
+  boost::filesystem::create_directories(tmp);
+  for (const auto* filename : {"b.json", "a.json", "a.png", "notes"}) {
+    std::ofstream ofs((tmp / filename).string());
+  }
+
+  const auto paths_opt = list_directory(tmp.string());
+  ASSERT_TRUE(paths_opt);
+  ASSERT_EQ(3, paths_opt->size());
+  const std::vector<std::string> expected_json = {(tmp / "a.json").string(),
+                                                  (tmp / "b.json").string()};
+  EXPECT_EQ(expected_json, paths_opt->at(".json"));
+  EXPECT_EQ(1, paths_opt->at(".png").size());
+  EXPECT_EQ(1, paths_opt->at("").size());
+
+  boost::filesystem::remove_all(tmp);
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
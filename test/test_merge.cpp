@@ -0,0 +1,134 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+#include "a2d2_to_ros/merge.hpp"
+
+namespace a2d2_to_ros {
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_merge, merge_sorted_runs) {
+  const std::vector<std::vector<int>> runs = {
+      {1, 4, 4, 9}, {}, {2, 4, 10}, {0}, {3, 5, 6, 7, 8}};
+  const auto less = [](int lhs, int rhs) { return (lhs < rhs); };
+
+  std::vector<std::pair<size_t, size_t>> visited;
+  const auto visit = [&visited](size_t run, size_t idx) {
+    visited.emplace_back(run, idx);
+    return true;
+  };
+  EXPECT_TRUE(merge_sorted_runs(runs, less, visit));
+
+  // ties are visited in run order
+  const std::vector<std::pair<size_t, size_t>> expected = {
+      {3, 0}, {0, 0}, {2, 0}, {4, 0}, {0, 1}, {0, 2}, {2, 1},
+      {4, 1}, {4, 2}, {4, 3}, {4, 4}, {0, 3}, {2, 2}};
+  EXPECT_EQ(expected, visited);
+
+  // visiting stops at the first failure
+  size_t num_visited = 0;
+  const auto visit_some = [&num_visited](size_t, size_t) {
+    return (++num_visited < 5);
+  };
+  EXPECT_FALSE(merge_sorted_runs(runs, less, visit_some));
+  EXPECT_EQ(5, num_visited);
+
+  // nothing to merge
+  EXPECT_TRUE(merge_sorted_runs(std::vector<std::vector<int>>(), less, visit));
+  EXPECT_TRUE(merge_sorted_runs(std::vector<std::vector<int>>(3), less, visit));
+  EXPECT_EQ(expected.size(), visited.size());
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_merge, run_file) {
+  struct Sample {
+    uint64_t time;
+    double value;
+  };  // struct Sample
+
+  std::string path;
+  {
+    // a small chunk size, so that the runs span several chunks
+    RunFile<Sample> file(3);
+    ASSERT_TRUE(file.good());
+    path = file.get_path();
+    EXPECT_TRUE(boost::filesystem::exists(path));
+
+    const std::vector<std::vector<uint64_t>> times = {
+        {1, 4, 4, 9, 11, 12, 13}, {2, 4, 10}, {0}, {3, 5, 6, 7, 8}};
+    for (size_t r = 0; r < times.size(); ++r) {
+      file.begin_run();
+      for (const auto time : times[r]) {
+        EXPECT_TRUE(file.push_back({time, (100.0 * r + time)}));
+      }
+    }
+    ASSERT_TRUE(file.flush());
+    EXPECT_EQ(16, file.size());
+    EXPECT_EQ(16 * sizeof(Sample), boost::filesystem::file_size(path));
+
+    const auto& runs = file.get_runs();
+    ASSERT_EQ(times.size(), runs.size());
+    for (size_t r = 0; r < times.size(); ++r) {
+      EXPECT_EQ(times[r].size(), runs[r].size());
+    }
+
+    const auto less = [](const Sample& lhs, const Sample& rhs) {
+      return (lhs.time < rhs.time);
+    };
+    std::vector<std::pair<uint64_t, double>> visited;
+    const auto visit = [&](size_t run, size_t idx) {
+      visited.emplace_back(runs[run][idx].time, runs[run][idx].value);
+      return true;
+    };
+    EXPECT_TRUE(merge_sorted_runs(runs, less, visit));
+    EXPECT_TRUE(file.good());
+
+    // ties are visited in run order
+    const std::vector<std::pair<uint64_t, double>> expected = {
+        {0, 200.0},  {1, 1.0},    {2, 102.0},  {3, 303.0},
+        {4, 4.0},    {4, 4.0},    {4, 104.0},  {5, 305.0},
+        {6, 306.0},  {7, 307.0},  {8, 308.0},  {9, 9.0},
+        {10, 110.0}, {11, 11.0},  {12, 12.0},  {13, 13.0}};
+    EXPECT_EQ(expected, visited);
+
+    // elements can also be read out of order
+    EXPECT_EQ(13, runs[0][6].time);
+    EXPECT_EQ(1, runs[0][0].time);
+    EXPECT_EQ(10, runs[1][2].time);
+  }
+  // the file is removed with the runs
+  EXPECT_FALSE(boost::filesystem::exists(path));
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
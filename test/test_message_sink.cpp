@@ -0,0 +1,114 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+#include <boost/filesystem.hpp>
+
+#include "a2d2_to_ros/message_sink.hpp"
+
+namespace a2d2_to_ros {
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_message_sink, get_sink_type) {
+  EXPECT_EQ(SinkType::BAG, *get_sink_type("bag"));
+  EXPECT_EQ(SinkType::TOPICS, *get_sink_type("topics"));
+
+  EXPECT_FALSE(get_sink_type(""));
+  EXPECT_FALSE(get_sink_type("Bag"));
+  EXPECT_FALSE(get_sink_type("topic"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_message_sink, Pacer_get_wait) {
+  using std::chrono::milliseconds;
+  const auto start = Pacer::Clock::now();
+
+  // the first stamp is due right away, and the others relative to it
+  Pacer pacer(2.0);
+  EXPECT_EQ(Pacer::Clock::duration::zero(),
+            pacer.get_wait(ros::Time(10, 0), start));
+  EXPECT_EQ(milliseconds(500), pacer.get_wait(ros::Time(11, 0), start));
+  EXPECT_EQ(milliseconds(300),
+            pacer.get_wait(ros::Time(11, 0), start + milliseconds(200)));
+  // late stamps are overdue
+  EXPECT_EQ(-milliseconds(100),
+            pacer.get_wait(ros::Time(11, 0), start + milliseconds(600)));
+
+  // without a speed, every stamp is due right away
+  Pacer unpaced(0.0);
+  EXPECT_EQ(Pacer::Clock::duration::zero(),
+            unpaced.get_wait(ros::Time(10, 0), start));
+  EXPECT_EQ(Pacer::Clock::duration::zero(),
+            unpaced.get_wait(ros::Time(20, 0), start));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_message_sink, ClockWriter_write) {
+  const auto tmp = (boost::filesystem::temp_directory_path() /
+                    boost::filesystem::unique_path("a2d2_to_ros-%%%%%%"));
+  boost::filesystem::create_directories(tmp);
+  auto sink = make_message_sink(nullptr, tmp.string(), "test_clock.bag", 0.0,
+                                0.0);
+  ClockWriter clock(sink, "/clock");
+  EXPECT_TRUE(clock.write(0.0, ros::Time(10, 0)));
+  EXPECT_FALSE(clock.write(0.0, ros::Time(10, 0)));
+  EXPECT_TRUE(clock.write(0.001, ros::Time(10, 1000000)));
+  // out of order stamps are dropped as well
+  EXPECT_FALSE(clock.write(0.0, ros::Time(10, 0)));
+  EXPECT_EQ(2, clock.get_num_stamps());
+  EXPECT_EQ(2, clock.get_num_written());
+  sink.close();
+  boost::filesystem::remove_all(tmp);
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_message_sink, ClockWriter_write_rate) {
+  const auto tmp = (boost::filesystem::temp_directory_path() /
+                    boost::filesystem::unique_path("a2d2_to_ros-%%%%%%"));
+  boost::filesystem::create_directories(tmp);
+  // windows are [0, 1), [1, 2), ...
+  auto sink = make_message_sink(nullptr, tmp.string(), "test_clock.bag", 0.0,
+                                1.0);
+  ClockWriter clock(sink, "/clock", 10.0);
+  EXPECT_TRUE(clock.write(0.0, ros::Time(10, 0)));
+  EXPECT_FALSE(clock.write(0.05, ros::Time(10, 50000000)));
+  EXPECT_TRUE(clock.write(0.1, ros::Time(10, 100000000)));
+  EXPECT_FALSE(clock.write(0.15, ros::Time(10, 150000000)));
+  // the first stamp of a new window is always written
+  EXPECT_TRUE(clock.write(1.0, ros::Time(11, 0)));
+  EXPECT_EQ(5, clock.get_num_stamps());
+  EXPECT_EQ(3, clock.get_num_written());
+  sink.close();
+  boost::filesystem::remove_all(tmp);
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
@@ -23,10 +23,55 @@
  */
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <sensor_msgs/point_cloud2_iterator.h>
+
 #include "a2d2_to_ros/msg_utils.hpp"
 
 namespace a2d2_to_ros {
 
+namespace {
+
+/** @brief Build a single-column npz array with the given values. */
+template <typename T>
+cnpy::NpyArray make_column(const std::vector<T>& vals) {
+  cnpy::NpyArray arr({vals.size()}, sizeof(T), false);
+  std::copy(std::begin(vals), std::end(vals), arr.data<T>());
+  return arr;
+}
+
+/** @brief Build a synthetic lidar frame with two points. */
+cnpy::npz_t make_npz() {
+  const auto fields = npz::Fields::get_fields();
+  cnpy::npz_t npz;
+
+  cnpy::NpyArray points({2, 3}, sizeof(double), false);
+  const std::vector<double> xyz = {1.0, 2.0, 3.0, -4.0, -5.0, -6.0};
+  std::copy(std::begin(xyz), std::end(xyz), points.data<double>());
+  npz[fields[npz::Fields::POINTS_IDX]] = points;
+
+  npz[fields[npz::Fields::AZIMUTH_IDX]] = make_column<double>({0.5, 1.5});
+  npz[fields[npz::Fields::BOUNDARY_IDX]] = make_column<int64_t>({0, 1});
+  npz[fields[npz::Fields::COL_IDX]] = make_column<double>({10.0, 20.0});
+  npz[fields[npz::Fields::DEPTH_IDX]] = make_column<double>({3.5, 4.5});
+  npz[fields[npz::Fields::DISTANCE_IDX]] = make_column<double>({5.5, 6.5});
+  npz[fields[npz::Fields::ID_IDX]] = make_column<int64_t>({2, 4});
+  npz[fields[npz::Fields::RECTIME_IDX]] =
+      make_column<int64_t>({1554121595035037, 1554121595035038});
+  npz[fields[npz::Fields::REFLECTANCE_IDX]] = make_column<int64_t>({7, 255});
+  npz[fields[npz::Fields::ROW_IDX]] = make_column<double>({30.0, 40.0});
+  npz[fields[npz::Fields::TIMESTAMP_IDX]] =
+      make_column<int64_t>({1554121595035039, 1554121595035040});
+  npz[fields[npz::Fields::VALID_IDX]] = make_column<bool>({true, false});
+  return npz;
+}
+
+}  // namespace
+
 //------------------------------------------------------------------------------
 
 TEST(A2D2_to_ROS_msg_utils, build_ego_shape_msg) {
@@ -65,5 +110,331 @@ TEST(A2D2_to_ROS_msg_utils, build_ego_shape_msg) {
 
 //------------------------------------------------------------------------------
 
+TEST(A2D2_to_ROS_msg_utils, fill_pc2_from_npz) {
+  typedef npz::WriteTypes W;
+  const auto fields = npz::Fields::get_fields();
+  const auto npz = make_npz();
+  ASSERT_TRUE(npz::verify_structure(npz));
+
+  auto msg = build_pc2_msg("frame", ros::Time(1, 0), false, 2);
+  ASSERT_TRUE(fill_pc2_from_npz(npz, msg));
+
+  sensor_msgs::PointCloud2ConstIterator<W::Point> x(msg, "x");
+  sensor_msgs::PointCloud2ConstIterator<W::Point> z(msg, "z");
+  sensor_msgs::PointCloud2ConstIterator<W::Boundary> boundary(
+      msg, fields[npz::Fields::BOUNDARY_IDX]);
+  sensor_msgs::PointCloud2ConstIterator<W::Depth> depth(
+      msg, fields[npz::Fields::DEPTH_IDX]);
+  sensor_msgs::PointCloud2ConstIterator<W::Reflectance> reflectance(
+      msg, fields[npz::Fields::REFLECTANCE_IDX]);
+  sensor_msgs::PointCloud2ConstIterator<W::Timestamp> timestamp(
+      msg, fields[npz::Fields::TIMESTAMP_IDX]);
+  sensor_msgs::PointCloud2ConstIterator<W::Valid> valid(
+      msg, fields[npz::Fields::VALID_IDX]);
+
+  EXPECT_EQ(*x, 1.0);
+  EXPECT_EQ(*z, 3.0);
+  EXPECT_FALSE(*boundary);
+  EXPECT_EQ(*depth, 3.5);
+  EXPECT_EQ(*reflectance, 7);
+  EXPECT_EQ(*timestamp, 1554121595035039);
+  EXPECT_TRUE(*valid);
+
+  ++x;
+  ++z;
+  ++boundary;
+  ++depth;
+  ++reflectance;
+  ++timestamp;
+  ++valid;
+
+  EXPECT_EQ(*x, -4.0);
+  EXPECT_EQ(*z, -6.0);
+  EXPECT_TRUE(*boundary);
+  EXPECT_EQ(*depth, 4.5);
+  EXPECT_EQ(*reflectance, 255);
+  EXPECT_EQ(*timestamp, 1554121595035040);
+  EXPECT_FALSE(*valid);
+
+  // size mismatch between the message and the data
+  auto wrong_size_msg = build_pc2_msg("frame", ros::Time(1, 0), false, 3);
+  EXPECT_FALSE(fill_pc2_from_npz(npz, wrong_size_msg));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_msg_utils, fill_pc2_msg_depth_image) {
+  constexpr uint32_t WIDTH = 32;
+  constexpr uint32_t HEIGHT = 48;
+  const auto pixel = [](const sensor_msgs::Image& img, size_t r, size_t c) {
+    float d;
+    std::memcpy(&d, &img.data[(r * img.step) + (c * sizeof(float))],
+                sizeof(float));
+    return d;
+  };
+  const auto count_set = [&pixel](const sensor_msgs::Image& img) {
+    size_t num_set = 0;
+    for (size_t r = 0; r < img.height; ++r) {
+      for (size_t c = 0; c < img.width; ++c) {
+        num_set += (std::isnan(pixel(img, r, c)) ? 0 : 1);
+      }
+    }
+    return num_set;
+  };
+
+  auto depth = build_depth_image_msg("camera", ros::Time(1, 0), WIDTH, HEIGHT);
+  EXPECT_EQ("camera", depth.header.frame_id);
+  EXPECT_EQ("32FC1", depth.encoding);
+  EXPECT_EQ(WIDTH, depth.width);
+  EXPECT_EQ(HEIGHT, depth.height);
+  EXPECT_EQ(WIDTH * sizeof(float), depth.step);
+  ASSERT_EQ(depth.step * HEIGHT, depth.data.size());
+  EXPECT_TRUE(std::isnan(pixel(depth, 0, 0)));
+
+  // only the first point is valid: row 30, col 10, depth 3.5
+  const auto npz = make_npz();
+  auto columns = npz::get_columns(npz);
+  auto msg = build_pc2_msg("frame", ros::Time(1, 0), false, 2);
+  ASSERT_TRUE(fill_pc2_msg(columns, msg, depth));
+  EXPECT_EQ(3.5f, pixel(depth, 30, 10));
+  EXPECT_TRUE(std::isnan(pixel(depth, 40, 20)));
+  EXPECT_EQ(1, count_set(depth));
+
+  // the nearest point wins, and points outside of the image are skipped
+  const std::vector<double> rows = {5.4, 4.6};
+  const std::vector<double> cols = {7.0, 6.5};
+  const std::vector<double> depths = {2.0, 1.0};
+  const bool valid[] = {true, true};
+  columns.row = rows.data();
+  columns.col = cols.data();
+  columns.depth = depths.data();
+  columns.valid = valid;
+  depth = build_depth_image_msg("camera", ros::Time(1, 0), WIDTH, HEIGHT,
+                                std::move(depth.data));
+  ASSERT_TRUE(fill_pc2_msg(columns, msg, depth));
+  EXPECT_EQ(1.0f, pixel(depth, 5, 7));
+  // the reused buffer was cleared
+  EXPECT_EQ(1, count_set(depth));
+
+  const std::vector<double> outside_cols = {-0.6, 31.5};
+  columns.col = outside_cols.data();
+  depth = build_depth_image_msg("camera", ros::Time(1, 0), WIDTH, HEIGHT,
+                                std::move(depth.data));
+  ASSERT_TRUE(fill_pc2_msg(columns, msg, depth));
+  EXPECT_EQ(0, count_set(depth));
+
+  // the image must match its declared size
+  depth.data.pop_back();
+  EXPECT_FALSE(fill_pc2_msg(columns, msg, depth));
+  EXPECT_FALSE(fill_depth_image(columns, depth));
+
+  // depths can be scattered without filling a cloud
+  columns.col = cols.data();
+  depth = build_depth_image_msg("camera", ros::Time(1, 0), WIDTH, HEIGHT);
+  ASSERT_TRUE(fill_depth_image(columns, depth));
+  EXPECT_EQ(1.0f, pixel(depth, 5, 7));
+  EXPECT_EQ(1, count_set(depth));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_msg_utils, get_point_layout) {
+  typedef sensor_msgs::PointField PF;
+  const auto fields = npz::Fields::get_fields();
+
+  const auto full = get_point_layout("all");
+  ASSERT_TRUE(full);
+  EXPECT_TRUE(full->full);
+  EXPECT_EQ(14, full->fields.size());
+  const auto msg = build_pc2_msg("frame", ros::Time(1, 0), false, 2);
+  EXPECT_EQ(msg.point_step, full->point_step);
+  ASSERT_EQ(msg.fields.size(), full->fields.size());
+  for (size_t i = 0; i < msg.fields.size(); ++i) {
+    EXPECT_EQ(msg.fields[i].name, full->fields[i].name);
+    EXPECT_EQ(msg.fields[i].offset, full->fields[i].offset);
+  }
+  EXPECT_EQ(msg.width * msg.point_step, msg.row_step);
+
+  const auto xyz = get_point_layout("xyz");
+  ASSERT_TRUE(xyz);
+  EXPECT_FALSE(xyz->full);
+  ASSERT_EQ(3, xyz->fields.size());
+  EXPECT_EQ("z", xyz->fields[2].name);
+  EXPECT_EQ(8, xyz->fields[2].offset);
+  EXPECT_EQ(12, xyz->point_step);
+
+  const auto xyzi = get_point_layout("xyzi");
+  ASSERT_TRUE(xyzi);
+  ASSERT_EQ(4, xyzi->fields.size());
+  EXPECT_EQ("intensity", xyzi->fields[3].name);
+  EXPECT_EQ(PF::FLOAT32, xyzi->fields[3].datatype);
+  EXPECT_EQ(16, xyzi->point_step);
+
+  // each field is aligned to its size, and so is the point
+  const auto mixed = get_point_layout("reflectance,rectime,xyz,timestamp");
+  ASSERT_TRUE(mixed);
+  ASSERT_EQ(6, mixed->fields.size());
+  EXPECT_EQ(fields[npz::Fields::REFLECTANCE_IDX], mixed->fields[0].name);
+  EXPECT_EQ(PF::UINT8, mixed->fields[0].datatype);
+  EXPECT_EQ(0, mixed->fields[0].offset);
+  EXPECT_EQ(fields[npz::Fields::RECTIME_IDX], mixed->fields[1].name);
+  EXPECT_EQ(8, mixed->fields[1].offset);
+  EXPECT_EQ(16, mixed->fields[2].offset);
+  EXPECT_EQ("timestamp_offset", mixed->fields[5].name);
+  EXPECT_EQ(PF::INT32, mixed->fields[5].datatype);
+  EXPECT_EQ(28, mixed->fields[5].offset);
+  EXPECT_EQ(32, mixed->point_step);
+
+  EXPECT_FALSE(get_point_layout(""));
+  EXPECT_FALSE(get_point_layout("xyz,all"));
+  EXPECT_FALSE(get_point_layout("xyz,x"));
+  EXPECT_FALSE(get_point_layout("xyz,pcloud_attr.depth"));
+  EXPECT_FALSE(get_point_layout("xyz,"));
+  EXPECT_FALSE(get_point_layout("xyz,bogus"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_msg_utils, fill_pc2_msg_layout) {
+  const auto fields = npz::Fields::get_fields();
+  const auto npz = make_npz();
+  auto columns = npz::get_columns(npz);
+
+  const auto layout_opt = get_point_layout("xyzi,valid,timestamp");
+  ASSERT_TRUE(layout_opt);
+  const auto layout = *layout_opt;
+
+  // the stamp is 39 and 40 microseconds before the points
+  const auto stamp = ros::Time(1554121595, 35000000);
+  auto msg = build_pc2_msg(layout, "frame", stamp, false, 2);
+  EXPECT_EQ(2 * layout.point_step, msg.row_step);
+  ASSERT_EQ(msg.row_step, msg.data.size());
+  ASSERT_TRUE(fill_pc2_msg(layout, columns, msg));
+
+  sensor_msgs::PointCloud2ConstIterator<float> x(msg, "x");
+  sensor_msgs::PointCloud2ConstIterator<float> z(msg, "z");
+  sensor_msgs::PointCloud2ConstIterator<float> intensity(msg, "intensity");
+  sensor_msgs::PointCloud2ConstIterator<uint8_t> valid(
+      msg, fields[npz::Fields::VALID_IDX]);
+  sensor_msgs::PointCloud2ConstIterator<int32_t> offset(msg,
+                                                        "timestamp_offset");
+
+  EXPECT_EQ(*x, 1.0f);
+  EXPECT_EQ(*z, 3.0f);
+  EXPECT_EQ(*intensity, 7.0f);
+  EXPECT_EQ(*valid, 1);
+  EXPECT_EQ(*offset, 39);
+
+  ++x;
+  ++z;
+  ++intensity;
+  ++valid;
+  ++offset;
+
+  EXPECT_EQ(*x, -4.0f);
+  EXPECT_EQ(*z, -6.0f);
+  EXPECT_EQ(*intensity, 255.0f);
+  EXPECT_EQ(*valid, 0);
+  EXPECT_EQ(*offset, 40);
+
+  // offsets that do not fit in an INT32
+  auto late_msg = build_pc2_msg(layout, "frame", ros::Time(1, 0), false, 2);
+  EXPECT_FALSE(fill_pc2_msg(layout, columns, late_msg));
+
+  // messages that do not match the layout or data
+  auto full_msg = build_pc2_msg("frame", stamp, false, 2);
+  EXPECT_FALSE(fill_pc2_msg(layout, columns, full_msg));
+  auto wrong_size_msg = build_pc2_msg(layout, "frame", stamp, false, 3);
+  EXPECT_FALSE(fill_pc2_msg(layout, columns, wrong_size_msg));
+
+  // depth is still scattered for layouts without depth
+  auto depth = build_depth_image_msg("camera", stamp, 32, 48);
+  ASSERT_TRUE(fill_pc2_msg(layout, columns, msg, depth));
+  float d;
+  std::memcpy(&d, &depth.data[(30 * depth.step) + (10 * sizeof(float))],
+              sizeof(float));
+  EXPECT_EQ(3.5f, d);
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_msg_utils, fill_pc2_msg_layout_rectime) {
+  const auto fields = npz::Fields::get_fields();
+  const auto npz = make_npz();
+  const auto columns = npz::get_columns(npz);
+
+  const auto layout = *get_point_layout("x,rectime");
+  auto msg = build_pc2_msg(layout, "frame", ros::Time(1554121595, 35000000),
+                           false, 2);
+  ASSERT_TRUE(fill_pc2_msg(layout, columns, msg));
+
+  // the field reads back as the type that it is labelled with
+  ASSERT_EQ(2, msg.fields.size());
+  const auto& field = msg.fields[1];
+  EXPECT_EQ(fields[npz::Fields::RECTIME_IDX], field.name);
+  ASSERT_EQ(sensor_msgs::PointField::FLOAT64, field.datatype);
+  EXPECT_EQ(0, field.offset % sizeof(double));
+  sensor_msgs::PointCloud2ConstIterator<double> rectime(msg, field.name);
+  EXPECT_EQ(1554121595035037.0, *rectime);
+  ++rectime;
+  EXPECT_EQ(1554121595035038.0, *rectime);
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_msg_utils, rebuild_pc2_msg) {
+  // 'x' and 'reflectance' are followed by three bytes of padding
+  const auto layout = *get_point_layout("x,reflectance");
+  ASSERT_EQ(8, layout.point_step);
+  const auto built = build_pc2_msg(layout, "frame", ros::Time(1, 0), false, 2);
+
+  sensor_msgs::PointCloud2 msg;
+  rebuild_pc2_msg(layout, "frame", ros::Time(1, 0), false, 2, msg);
+  ASSERT_EQ(built.fields.size(), msg.fields.size());
+  EXPECT_EQ(built.fields[1].name, msg.fields[1].name);
+  EXPECT_EQ(built.fields[1].offset, msg.fields[1].offset);
+  EXPECT_EQ(built.point_step, msg.point_step);
+  EXPECT_EQ(built.row_step, msg.row_step);
+  EXPECT_EQ(std::vector<uint8_t>(16, 0), msg.data);
+
+  // a message of the same layout keeps its fields and storage, and only bytes
+  // past the old size are zeroed
+  std::fill(std::begin(msg.data), std::end(msg.data), 0xff);
+  msg.data.reserve(32);
+  const auto* fields = msg.fields.data();
+  const auto* data = msg.data.data();
+  rebuild_pc2_msg(layout, "other", ros::Time(2, 0), true, 1, msg);
+  EXPECT_EQ("other", msg.header.frame_id);
+  EXPECT_EQ(ros::Time(2, 0), msg.header.stamp);
+  EXPECT_TRUE(msg.is_dense);
+  EXPECT_EQ(1, msg.width);
+  EXPECT_EQ(8, msg.row_step);
+  EXPECT_EQ(fields, msg.fields.data());
+  EXPECT_EQ(data, msg.data.data());
+  EXPECT_EQ(std::vector<uint8_t>(8, 0xff), msg.data);
+
+  rebuild_pc2_msg(layout, "other", ros::Time(2, 0), true, 3, msg);
+  EXPECT_EQ(data, msg.data.data());
+  ASSERT_EQ(24, msg.data.size());
+  EXPECT_EQ(0xff, msg.data[7]);
+  EXPECT_EQ(0, msg.data[8]);
+  EXPECT_EQ(0, msg.data[23]);
+
+  // another layout rebuilds the fields and zeroes all data
+  const auto full = build_pc2_msg("frame", ros::Time(1, 0), false, 1);
+  rebuild_pc2_msg(get_full_point_layout(), "frame", ros::Time(1, 0), false, 1,
+                  msg);
+  ASSERT_EQ(full.fields.size(), msg.fields.size());
+  for (size_t i = 0; i < full.fields.size(); ++i) {
+    EXPECT_EQ(full.fields[i].name, msg.fields[i].name);
+    EXPECT_EQ(full.fields[i].offset, msg.fields[i].offset);
+    EXPECT_EQ(full.fields[i].datatype, msg.fields[i].datatype);
+  }
+  EXPECT_EQ(full.point_step, msg.point_step);
+  EXPECT_EQ(std::vector<uint8_t>(full.data.size(), 0), msg.data);
+}
+
+//------------------------------------------------------------------------------
+
 }  // namespace a2d2_to_ros
 
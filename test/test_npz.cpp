@@ -0,0 +1,520 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+
+#include <zlib.h>
+
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "a2d2_to_ros/npz.hpp"
+
+namespace a2d2_to_ros {
+namespace npz {
+
+namespace {
+
+void append_u16(std::string& s, uint16_t v) {
+  s += static_cast<char>(v & 0xFF);
+  s += static_cast<char>(v >> 8);
+}
+
+void append_u32(std::string& s, uint32_t v) {
+  append_u16(s, static_cast<uint16_t>(v & 0xFFFF));
+  append_u16(s, static_cast<uint16_t>(v >> 16));
+}
+
+/** @brief Build a .npy file with a 1.0 header, padded the way numpy does. */
+template <typename T>
+std::string make_npy(const std::string& descr, const std::string& shape,
+                     const std::vector<T>& values) {
+  auto header = ("{'descr': '" + descr +
+                 "', 'fortran_order': False, 'shape': " + shape + ", }");
+  const auto unpadded_size = (10 + header.size() + 1);
+  header.append((64 - (unpadded_size % 64)) % 64, ' ');
+  header += '\n';
+
+  std::string npy("\x93NUMPY\x01\x00", 8);
+  append_u16(npy, static_cast<uint16_t>(header.size()));
+  npy += header;
+  npy.append(reinterpret_cast<const char*>(values.data()),
+             values.size() * sizeof(T));
+  return npy;
+}
+
+struct Member {
+  std::string name;
+  std::string npy;
+  bool deflate;
+};  // struct Member
+
+std::string deflate_raw(const std::string& data) {
+  z_stream stream;
+  std::memset(&stream, 0, sizeof(stream));
+  deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+               Z_DEFAULT_STRATEGY);
+  std::string out(deflateBound(&stream, data.size()), '\0');
+  stream.next_in =
+      reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in = static_cast<uInt>(data.size());
+  stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+  stream.avail_out = static_cast<uInt>(out.size());
+  deflate(&stream, Z_FINISH);
+  out.resize(stream.total_out);
+  deflateEnd(&stream);
+  return out;
+}
+
+/** @brief Build a zip archive the way numpy.savez(_compressed) does. */
+std::string make_zip(const std::vector<Member>& members) {
+  std::string zip;
+  std::string directory;
+  for (const auto& m : members) {
+    const auto payload = m.deflate ? deflate_raw(m.npy) : m.npy;
+    const auto crc = static_cast<uint32_t>(
+        crc32(0, reinterpret_cast<const Bytef*>(m.npy.data()),
+              static_cast<uInt>(m.npy.size())));
+    const auto method = static_cast<uint16_t>(m.deflate ? 8 : 0);
+    const auto offset = static_cast<uint32_t>(zip.size());
+
+    append_u32(zip, 0x04034b50);
+    append_u16(zip, 20);  // version needed
+    append_u16(zip, 0);   // flags
+    append_u16(zip, method);
+    append_u32(zip, 0);  // time and date
+    append_u32(zip, crc);
+    append_u32(zip, static_cast<uint32_t>(payload.size()));
+    append_u32(zip, static_cast<uint32_t>(m.npy.size()));
+    append_u16(zip, static_cast<uint16_t>(m.name.size()));
+    append_u16(zip, 0);  // extra field length
+    zip += m.name;
+    zip += payload;
+
+    append_u32(directory, 0x02014b50);
+    append_u16(directory, 20);  // version made by
+    append_u16(directory, 20);  // version needed
+    append_u16(directory, 0);   // flags
+    append_u16(directory, method);
+    append_u32(directory, 0);  // time and date
+    append_u32(directory, crc);
+    append_u32(directory, static_cast<uint32_t>(payload.size()));
+    append_u32(directory, static_cast<uint32_t>(m.npy.size()));
+    append_u16(directory, static_cast<uint16_t>(m.name.size()));
+    append_u16(directory, 0);  // extra field length
+    append_u16(directory, 0);  // comment length
+    append_u16(directory, 0);  // disk number
+    append_u16(directory, 0);  // internal attributes
+    append_u32(directory, 0);  // external attributes
+    append_u32(directory, offset);
+    directory += m.name;
+  }
+
+  const auto directory_offset = static_cast<uint32_t>(zip.size());
+  zip += directory;
+  append_u32(zip, 0x06054b50);
+  append_u16(zip, 0);  // disk number
+  append_u16(zip, 0);  // disk with the central directory
+  append_u16(zip, static_cast<uint16_t>(members.size()));
+  append_u16(zip, static_cast<uint16_t>(members.size()));
+  append_u32(zip, static_cast<uint32_t>(directory.size()));
+  append_u32(zip, directory_offset);
+  append_u16(zip, 0);  // comment length
+  return zip;
+}
+
+std::string write_temp_file(const std::string& contents) {
+  const auto path = (boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path("a2d2_to_ros-%%%%%%.npz"))
+                        .string();
+  std::ofstream ofs(path, std::ios::binary);
+  ofs << contents;
+  return path;
+}
+
+/** @brief Build the members of a lidar frame with the given timestamps. */
+std::vector<Member> make_lidar_members(const std::vector<int64_t>& timestamps,
+                                       bool deflate) {
+  const auto n = timestamps.size();
+  const auto shape = ("(" + std::to_string(n) + ",)");
+  const auto f8 = [&](double offset) {
+    std::vector<double> v(n);
+    for (size_t i = 0; i < n; ++i) {
+      v[i] = (offset + static_cast<double>(i));
+    }
+    return make_npy("<f8", shape, v);
+  };
+  const auto i8 = [&](int64_t offset) {
+    std::vector<int64_t> v(n);
+    for (size_t i = 0; i < n; ++i) {
+      v[i] = (offset + static_cast<int64_t>(i));
+    }
+    return make_npy("<i8", shape, v);
+  };
+
+  std::vector<double> points(3 * n);
+  for (size_t i = 0; i < points.size(); ++i) {
+    points[i] = (0.5 * static_cast<double>(i));
+  }
+  const std::vector<bool> valid_bits(n, true);
+  const std::vector<uint8_t> valid(std::begin(valid_bits),
+                                   std::end(valid_bits));
+
+  const auto fields = Fields::get_fields();
+  std::vector<Member> members(fields.size());
+  members[Fields::POINTS_IDX].npy =
+      make_npy("<f8", "(" + std::to_string(n) + ", 3)", points);
+  members[Fields::AZIMUTH_IDX].npy = f8(10.0);
+  members[Fields::BOUNDARY_IDX].npy = i8(0);
+  members[Fields::COL_IDX].npy = f8(20.0);
+  members[Fields::DEPTH_IDX].npy = f8(30.0);
+  members[Fields::DISTANCE_IDX].npy = f8(40.0);
+  members[Fields::ID_IDX].npy = i8(1);
+  members[Fields::RECTIME_IDX].npy = i8(1000);
+  members[Fields::REFLECTANCE_IDX].npy = i8(50);
+  members[Fields::ROW_IDX].npy = f8(60.0);
+  members[Fields::TIMESTAMP_IDX].npy = make_npy("<i8", shape, timestamps);
+  members[Fields::VALID_IDX].npy = make_npy("|b1", shape, valid);
+  for (size_t i = 0; i < fields.size(); ++i) {
+    members[i].name = (fields[i] + ".npy");
+    members[i].deflate = deflate;
+  }
+  return members;
+}
+
+}  // namespace
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_npz, MappedNpz_reads_stored_and_deflated_members) {
+  const std::vector<double> doubles = {1.5, -2.0, 3.25};
+  const std::vector<int64_t> ints = {7, 8, 9, 10, 11, 12};
+  const auto path = write_temp_file(
+      make_zip({{"doubles.npy", make_npy("<f8", "(3,)", doubles), false},
+                {"ints.npy", make_npy("<i8", "(2, 3)", ints), true}}));
+
+  MappedNpz npz;
+  ASSERT_TRUE(npz.open(path));
+  EXPECT_EQ(2, npz.get_arrays().size());
+  EXPECT_EQ(nullptr, npz.get("doubles.npy"));
+  EXPECT_EQ(nullptr, npz.get("missing"));
+
+  const auto d = npz.get("doubles");
+  ASSERT_NE(nullptr, d);
+  EXPECT_EQ('f', d->kind);
+  EXPECT_EQ(8, d->word_size);
+  EXPECT_FALSE(d->fortran_order);
+  ASSERT_EQ(1, d->shape.size());
+  EXPECT_EQ(3, d->shape[0]);
+  ASSERT_EQ(3, d->num_vals);
+  for (size_t i = 0; i < doubles.size(); ++i) {
+    EXPECT_EQ(doubles[i], d->data<double>()[i]);
+  }
+
+  const auto i = npz.get("ints");
+  ASSERT_NE(nullptr, i);
+  EXPECT_EQ('i', i->kind);
+  ASSERT_EQ(2, i->shape.size());
+  EXPECT_EQ(2, i->shape[0]);
+  EXPECT_EQ(3, i->shape[1]);
+  ASSERT_EQ(6, i->num_vals);
+  for (size_t j = 0; j < ints.size(); ++j) {
+    EXPECT_EQ(ints[j], i->data<int64_t>()[j]);
+  }
+
+  npz.close();
+  EXPECT_EQ(0, npz.get_arrays().size());
+  EXPECT_EQ(nullptr, npz.get("doubles"));
+
+  boost::filesystem::remove(path);
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_npz, MappedNpz_rejects_bad_files) {
+  MappedNpz npz;
+  EXPECT_FALSE(npz.open("/a2d2_to_ros/does/not/exist.npz"));
+
+  const auto not_zip = write_temp_file("this is not a zip archive");
+  EXPECT_FALSE(npz.open(not_zip));
+  boost::filesystem::remove(not_zip);
+
+  const auto not_npy =
+      write_temp_file(make_zip({{"a.npy", "not an array", false}}));
+  EXPECT_FALSE(npz.open(not_npy));
+  EXPECT_EQ(0, npz.get_arrays().size());
+  boost::filesystem::remove(not_npy);
+
+  // the header promises more data than there is
+  auto npy = make_npy("<f8", "(3,)", std::vector<double>{1.0, 2.0, 3.0});
+  npy.resize(npy.size() - 1);
+  const auto truncated = write_temp_file(make_zip({{"a.npy", npy, false}}));
+  EXPECT_FALSE(npz.open(truncated));
+  boost::filesystem::remove(truncated);
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_npz, MappedNpz_lidar_columns) {
+  const std::vector<int64_t> timestamps = {1554121593909500, 1554121593909600,
+                                           1554121593909700};
+  for (const auto deflate : {false, true}) {
+    const auto path =
+        write_temp_file(make_zip(make_lidar_members(timestamps, deflate)));
+
+    MappedNpz npz;
+    ASSERT_TRUE(npz.open(path));
+    ASSERT_TRUE(verify_structure(npz));
+
+    const auto c = get_columns(npz);
+    ASSERT_EQ(timestamps.size(), c.num_points);
+    for (size_t i = 0; i < c.num_points; ++i) {
+      for (size_t j = 0; j < 3; ++j) {
+        EXPECT_EQ(0.5 * static_cast<double>(3 * i + j), c.points[3 * i + j]);
+      }
+      EXPECT_EQ(10.0 + i, c.azimuth[i]);
+      EXPECT_EQ(static_cast<int64_t>(i), c.boundary[i]);
+      EXPECT_EQ(20.0 + i, c.col[i]);
+      EXPECT_EQ(30.0 + i, c.depth[i]);
+      EXPECT_EQ(40.0 + i, c.distance[i]);
+      EXPECT_EQ(static_cast<int64_t>(1 + i), c.lidar_id[i]);
+      EXPECT_EQ(static_cast<int64_t>(1000 + i), c.rectime[i]);
+      EXPECT_EQ(static_cast<int64_t>(50 + i), c.reflectance[i]);
+      EXPECT_EQ(60.0 + i, c.row[i]);
+      EXPECT_EQ(timestamps[i], c.timestamp[i]);
+      EXPECT_TRUE(c.valid[i]);
+    }
+
+    const auto summary = verify_frame(npz);
+    EXPECT_TRUE(summary.valid);
+    EXPECT_TRUE(summary.is_dense);
+    EXPECT_EQ(0, summary.num_invalid_points);
+    EXPECT_EQ(timestamps.front(), summary.min_timestamp);
+    EXPECT_EQ(timestamps.back(), summary.max_timestamp);
+
+    boost::filesystem::remove(path);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_npz, MappedNpz_open_bytes) {
+  const std::vector<int64_t> timestamps = {1554121593909500, 1554121593909600};
+  for (const auto deflate : {false, true}) {
+    const auto zip = make_zip(make_lidar_members(timestamps, deflate));
+    std::vector<uint8_t> bytes(std::begin(zip), std::end(zip));
+
+    MappedNpz npz;
+    ASSERT_TRUE(npz.open(std::move(bytes), "in-memory.npz"));
+    EXPECT_EQ(zip.size(), npz.get_size());
+    ASSERT_TRUE(verify_structure(npz));
+
+    const auto c = get_columns(npz);
+    ASSERT_EQ(timestamps.size(), c.num_points);
+    EXPECT_EQ(timestamps.back(), c.timestamp[1]);
+    EXPECT_EQ(20.0, c.col[0]);
+
+    npz.close();
+    EXPECT_EQ(0, npz.get_size());
+    EXPECT_EQ(0, npz.get_arrays().size());
+  }
+
+  const std::string not_zip = "this is not a zip archive";
+  MappedNpz npz;
+  EXPECT_FALSE(npz.open(std::vector<uint8_t>(std::begin(not_zip),
+                                             std::end(not_zip)),
+                        "not_zip.npz"));
+  EXPECT_FALSE(npz.open(std::vector<uint8_t>(), "empty.npz"));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_npz, MappedNpz_verify_structure) {
+  const std::vector<int64_t> timestamps = {1554121593909500, 1554121593909600};
+  const auto fields = Fields::get_fields();
+  MappedNpz npz;
+
+  // missing field
+  {
+    auto members = make_lidar_members(timestamps, false);
+    members.pop_back();
+    const auto path = write_temp_file(make_zip(members));
+    ASSERT_TRUE(npz.open(path));
+    EXPECT_FALSE(verify_structure(npz));
+    boost::filesystem::remove(path);
+  }
+
+  // wrong type
+  {
+    auto members = make_lidar_members(timestamps, false);
+    members[Fields::TIMESTAMP_IDX].npy =
+        make_npy("<f8", "(2,)", std::vector<double>{1.0, 2.0});
+    const auto path = write_temp_file(make_zip(members));
+    ASSERT_TRUE(npz.open(path));
+    EXPECT_FALSE(verify_structure(npz));
+    boost::filesystem::remove(path);
+  }
+
+  // wrong number of rows
+  {
+    auto members = make_lidar_members(timestamps, false);
+    members[Fields::DEPTH_IDX].npy =
+        make_npy("<f8", "(3,)", std::vector<double>{1.0, 2.0, 3.0});
+    const auto path = write_temp_file(make_zip(members));
+    ASSERT_TRUE(npz.open(path));
+    EXPECT_FALSE(verify_structure(npz));
+    boost::filesystem::remove(path);
+  }
+
+  // negative depth, including NaN
+  for (const auto depth : {-1.0, std::numeric_limits<double>::quiet_NaN()}) {
+    auto members = make_lidar_members(timestamps, false);
+    members[Fields::DEPTH_IDX].npy =
+        make_npy("<f8", "(2,)", std::vector<double>{1.0, depth});
+    const auto path = write_temp_file(make_zip(members));
+    ASSERT_TRUE(npz.open(path));
+    EXPECT_FALSE(verify_structure(npz));
+    boost::filesystem::remove(path);
+  }
+
+  // timestamp too large for ROS
+  {
+    const auto path = write_temp_file(
+        make_zip(make_lidar_members({4294967296000000, 0}, false)));
+    ASSERT_TRUE(npz.open(path));
+    EXPECT_FALSE(verify_structure(npz));
+    boost::filesystem::remove(path);
+  }
+
+  // negative timestamp
+  {
+    const auto path = write_temp_file(
+        make_zip(make_lidar_members({1554121593909500, -1}, false)));
+    ASSERT_TRUE(npz.open(path));
+    EXPECT_FALSE(verify_structure(npz));
+    boost::filesystem::remove(path);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_npz, verify_frame_summary) {
+  const std::vector<int64_t> timestamps = {1554121593909700, 1554121593909500,
+                                           1554121593909600};
+  auto members = make_lidar_members(timestamps, false);
+  members[Fields::VALID_IDX].npy =
+      make_npy("|b1", "(3,)", std::vector<uint8_t>{1, 0, 0});
+  const auto path = write_temp_file(make_zip(members));
+
+  MappedNpz npz;
+  ASSERT_TRUE(npz.open(path));
+  const auto summary = verify_frame(npz);
+  EXPECT_TRUE(summary.valid);
+  EXPECT_FALSE(summary.is_dense);
+  EXPECT_EQ(2, summary.num_invalid_points);
+  EXPECT_EQ(1554121593909500, summary.min_timestamp);
+  EXPECT_EQ(1554121593909700, summary.max_timestamp);
+
+  // the same checks apply to the columns alone
+  const auto c = get_columns(npz);
+  const auto column_summary = verify_columns(c);
+  EXPECT_TRUE(column_summary.valid);
+  EXPECT_EQ(summary.num_invalid_points, column_summary.num_invalid_points);
+
+  // an empty frame is valid and dense
+  auto empty = c;
+  empty.num_points = 0;
+  const auto empty_summary = verify_columns(empty);
+  EXPECT_TRUE(empty_summary.valid);
+  EXPECT_TRUE(empty_summary.is_dense);
+  EXPECT_EQ(0, empty_summary.min_timestamp);
+  EXPECT_EQ(0, empty_summary.max_timestamp);
+
+  boost::filesystem::remove(path);
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_npz, get_column_stats) {
+  const auto nan = std::numeric_limits<double>::quiet_NaN();
+  const std::vector<double> distances = {2.5, nan, 0.5, 7.0, nan};
+  const auto distance_stats = get_column_stats(distances.data(), 5);
+  EXPECT_EQ(0.5, distance_stats.min);
+  EXPECT_EQ(7.0, distance_stats.max);
+  EXPECT_EQ(2, distance_stats.num_invalid);
+  // NaN values are not non-negative
+  EXPECT_FALSE(distance_stats.all_non_negative);
+  EXPECT_TRUE(get_column_stats(distances.data(), 1).all_non_negative);
+
+  // the maximum of negative doubles is not clamped to the smallest double
+  const std::vector<double> negatives = {-3.0, -1.5};
+  const auto negative_stats = get_column_stats(negatives.data(), 2);
+  EXPECT_EQ(-3.0, negative_stats.min);
+  EXPECT_EQ(-1.5, negative_stats.max);
+  EXPECT_EQ(0, negative_stats.num_invalid);
+  EXPECT_FALSE(negative_stats.all_non_negative);
+
+  const std::vector<int64_t> reflectances = {12, 0, 255, 3};
+  const auto reflectance_stats = get_column_stats(reflectances.data(), 4);
+  EXPECT_EQ(0, reflectance_stats.min);
+  EXPECT_EQ(255, reflectance_stats.max);
+  EXPECT_EQ(0, reflectance_stats.num_invalid);
+  EXPECT_TRUE(reflectance_stats.all_non_negative);
+
+  const auto empty_stats = get_column_stats(reflectances.data(), 0);
+  EXPECT_EQ(std::numeric_limits<int64_t>::max(), empty_stats.min);
+  EXPECT_EQ(std::numeric_limits<int64_t>::lowest(), empty_stats.max);
+  EXPECT_TRUE(empty_stats.all_non_negative);
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_npz, NpyArray_reductions) {
+  cnpy::NpyArray field({3}, sizeof(double), false);
+  auto* vals = field.data<double>();
+  vals[0] = -0.25;
+  vals[1] = -4.0;
+  vals[2] = -1.0;
+  EXPECT_EQ(-4.0, get_min_value<double>(field));
+  EXPECT_EQ(-0.25, get_max_value<double>(field));
+  EXPECT_FALSE(all_non_negative<double>(field));
+
+  cnpy::NpyArray valid({3}, sizeof(bool), false);
+  auto* v = valid.data<bool>();
+  v[0] = true;
+  v[1] = true;
+  v[2] = true;
+  EXPECT_FALSE(any_points_invalid(valid));
+  v[1] = false;
+  EXPECT_TRUE(any_points_invalid(valid));
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace npz
+}  // namespace a2d2_to_ros
@@ -0,0 +1,220 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include "a2d2_to_ros/parallel.hpp"
+
+namespace a2d2_to_ros {
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_parallel, get_num_jobs) {
+  EXPECT_EQ(1, get_num_jobs(1));
+  EXPECT_EQ(4, get_num_jobs(4));
+  EXPECT_GE(get_num_jobs(0), 1);
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_parallel, ordered_parallel_for) {
+  constexpr size_t N = 200;
+  const auto square = [](size_t i) -> boost::optional<size_t> {
+    return (i * i);
+  };
+
+  for (const size_t num_jobs : {0, 1, 2, 8}) {
+    std::vector<size_t> consumed;
+    const auto collect = [&](size_t i, size_t item) {
+      EXPECT_EQ(consumed.size(), i);
+      consumed.push_back(item);
+      return true;
+    };
+    EXPECT_TRUE(ordered_parallel_for<size_t>(N, num_jobs, (2 * num_jobs),
+                                             square, collect));
+    ASSERT_EQ(N, consumed.size());
+    for (size_t i = 0; i < N; ++i) {
+      EXPECT_EQ(i * i, consumed[i]);
+    }
+  }
+
+  // nothing to do
+  const auto never = [](size_t, size_t) {
+    ADD_FAILURE();
+    return true;
+  };
+  EXPECT_TRUE(ordered_parallel_for<size_t>(0, 4, 8, square, never));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_parallel, ordered_parallel_for_stops_on_failure) {
+  constexpr size_t N = 100;
+  constexpr size_t BAD_IDX = 37;
+
+  for (const size_t num_jobs : {1, 4}) {
+    // produce fails
+    {
+      size_t num_consumed = 0;
+      const auto produce = [](size_t i) -> boost::optional<size_t> {
+        if (i == BAD_IDX) {
+          return boost::none;
+        }
+        return i;
+      };
+      const auto consume = [&](size_t i, size_t) {
+        EXPECT_LT(i, BAD_IDX);
+        ++num_consumed;
+        return true;
+      };
+      EXPECT_FALSE(ordered_parallel_for<size_t>(N, num_jobs, (2 * num_jobs),
+                                                produce, consume));
+      EXPECT_EQ(BAD_IDX, num_consumed);
+    }
+
+    // produce throws
+    {
+      size_t num_consumed = 0;
+      const auto produce = [](size_t i) -> boost::optional<size_t> {
+        if (i == BAD_IDX) {
+          throw std::runtime_error("bad item");
+        }
+        return i;
+      };
+      const auto consume = [&](size_t, size_t) {
+        ++num_consumed;
+        return true;
+      };
+      EXPECT_FALSE(ordered_parallel_for<size_t>(N, num_jobs, (2 * num_jobs),
+                                                produce, consume));
+      EXPECT_EQ(BAD_IDX, num_consumed);
+    }
+
+    // consume fails
+    {
+      size_t num_consumed = 0;
+      const auto produce = [](size_t i) -> boost::optional<size_t> {
+        return i;
+      };
+      const auto consume = [&](size_t i, size_t) {
+        ++num_consumed;
+        return (i != BAD_IDX);
+      };
+      EXPECT_FALSE(ordered_parallel_for<size_t>(N, num_jobs, (2 * num_jobs),
+                                                produce, consume));
+      EXPECT_EQ(BAD_IDX + 1, num_consumed);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_parallel, ordered_parallel_for_bounds_in_flight) {
+  constexpr size_t N = 100;
+  constexpr size_t NUM_JOBS = 4;
+  constexpr size_t MAX_IN_FLIGHT = 3;
+
+  std::atomic<size_t> num_produced(0);
+  size_t num_consumed = 0;
+  const auto produce = [&](size_t i) -> boost::optional<size_t> {
+    ++num_produced;
+    return i;
+  };
+  const auto consume = [&](size_t, size_t) {
+    // items produced but not yet consumed, including this one
+    EXPECT_LE(num_produced.load() - num_consumed, MAX_IN_FLIGHT);
+    ++num_consumed;
+    return true;
+  };
+  EXPECT_TRUE(ordered_parallel_for<size_t>(N, NUM_JOBS, MAX_IN_FLIGHT, produce,
+                                           consume));
+  EXPECT_EQ(N, num_consumed);
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_parallel, task_queue_runs_tasks_in_order) {
+  constexpr size_t N = 1000;
+
+  std::vector<size_t> order;
+  TaskQueue queue(4);
+  for (size_t i = 0; i < N; ++i) {
+    queue.push([&order, i]() { order.push_back(i); });
+  }
+  queue.wait();
+
+  ASSERT_EQ(N, order.size());
+  for (size_t i = 0; i < N; ++i) {
+    EXPECT_EQ(i, order[i]);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_parallel, task_queue_rethrows_errors) {
+  size_t num_run = 0;
+  {
+    TaskQueue queue(1);
+    queue.push([&num_run]() { ++num_run; });
+    queue.push([]() { throw std::runtime_error("bad write"); });
+    EXPECT_THROW(
+        {
+          // tasks queued after the failure are dropped
+          for (size_t i = 0; i < 100; ++i) {
+            queue.push([&num_run]() { ++num_run; });
+          }
+          queue.wait();
+        },
+        std::runtime_error);
+
+    // the error is only reported once
+    EXPECT_NO_THROW(queue.wait());
+  }
+  EXPECT_LT(num_run, 100);
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_parallel, ObjectPool) {
+  ObjectPool<std::vector<int>> pool;
+  EXPECT_EQ(0, pool.size());
+  EXPECT_TRUE(pool.take().empty());
+
+  std::vector<int> buffer(100, 1);
+  const auto* const data = buffer.data();
+  pool.give(std::move(buffer));
+  EXPECT_EQ(1, pool.size());
+
+  // the same storage comes back out
+  const auto reused = pool.take();
+  EXPECT_EQ(data, reused.data());
+  EXPECT_EQ(0, pool.size());
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
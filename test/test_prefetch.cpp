@@ -0,0 +1,177 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "a2d2_to_ros/prefetch.hpp"
+
+namespace a2d2_to_ros {
+
+namespace {
+/** @brief Write numbered files to a temporary directory. */
+std::vector<std::string> write_files(const boost::filesystem::path& dir,
+                                     size_t n) {
+  boost::filesystem::create_directories(dir);
+  std::vector<std::string> paths;
+  for (size_t i = 0; i < n; ++i) {
+    const auto path = (dir / ("file_" + std::to_string(i))).string();
+    std::ofstream ofs(path, std::ios::binary);
+    ofs << "contents of file " << i;
+    paths.push_back(path);
+  }
+  return paths;
+}
+
+std::string as_string(const std::vector<uint8_t>& bytes) {
+  return std::string(std::begin(bytes), std::end(bytes));
+}
+}  // namespace
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_prefetch, FilePrefetcher_take) {
+  const auto dir = (boost::filesystem::temp_directory_path() /
+                    boost::filesystem::unique_path("a2d2_to_ros-%%%%%%"));
+  auto paths = write_files(dir, 20);
+  // placeholders and missing files are passed through in order
+  paths.insert(std::begin(paths) + 5, "");
+  paths.push_back((dir / "missing").string());
+
+  PrefetchOptions no_cap;
+  no_cap.max_bytes = 1024 * 1024;
+  PrefetchOptions tiny_cap;
+  tiny_cap.depth = 3;
+  tiny_cap.max_bytes = 1;
+  PrefetchOptions disabled;
+  disabled.depth = 0;
+
+  for (const auto& options : {no_cap, tiny_cap, disabled}) {
+    FilePrefetcher prefetcher(paths, options);
+    ASSERT_EQ(paths.size(), prefetcher.size());
+
+    std::vector<uint8_t> bytes;
+    for (size_t i = 0; (i + 1) < paths.size(); ++i) {
+      ASSERT_TRUE(prefetcher.take(i, bytes));
+      if (i == 5) {
+        EXPECT_TRUE(bytes.empty());
+      } else {
+        const auto n = ((i < 5) ? i : (i - 1));
+        EXPECT_EQ("contents of file " + std::to_string(n), as_string(bytes));
+      }
+    }
+    EXPECT_FALSE(prefetcher.take(paths.size() - 1, bytes));
+    EXPECT_FALSE(prefetcher.take(paths.size(), bytes));
+  }
+
+  boost::filesystem::remove_all(dir);
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_prefetch, FilePrefetcher_concurrent_take) {
+  constexpr size_t N = 64;
+  const auto dir = (boost::filesystem::temp_directory_path() /
+                    boost::filesystem::unique_path("a2d2_to_ros-%%%%%%"));
+  const auto paths = write_files(dir, N);
+
+  PrefetchOptions options;
+  options.depth = 2;
+  FilePrefetcher prefetcher(paths, options);
+
+  // two consumers take interleaved indices, as ordered workers would
+  std::vector<std::string> contents(N);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < 2; ++t) {
+    threads.emplace_back([&, t]() {
+      std::vector<uint8_t> bytes;
+      for (auto i = t; i < N; i += 2) {
+        if (prefetcher.take(i, bytes)) {
+          contents[i] = as_string(bytes);
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  for (size_t i = 0; i < N; ++i) {
+    EXPECT_EQ("contents of file " + std::to_string(i), contents[i]);
+  }
+
+  boost::filesystem::remove_all(dir);
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_prefetch, FilePrefetcher_reuses_buffers) {
+  const auto dir = (boost::filesystem::temp_directory_path() /
+                    boost::filesystem::unique_path("a2d2_to_ros-%%%%%%"));
+  const auto paths = write_files(dir, 4);
+
+  PrefetchOptions options;
+  options.depth = 1;
+  FilePrefetcher prefetcher(paths, options);
+
+  // with one file read ahead, the buffer given to the second take is the one
+  // the third file is read into
+  std::vector<uint8_t> bytes;
+  ASSERT_TRUE(prefetcher.take(0, bytes));
+  const auto* first_buffer = bytes.data();
+  ASSERT_TRUE(prefetcher.take(1, bytes));
+  ASSERT_TRUE(prefetcher.take(2, bytes));
+  EXPECT_EQ(first_buffer, bytes.data());
+  EXPECT_EQ("contents of file 2", as_string(bytes));
+
+  boost::filesystem::remove_all(dir);
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_prefetch, FilePrefetcher_destroy_early) {
+  const auto dir = (boost::filesystem::temp_directory_path() /
+                    boost::filesystem::unique_path("a2d2_to_ros-%%%%%%"));
+  const auto paths = write_files(dir, 32);
+  {
+    PrefetchOptions options;
+    options.depth = 4;
+    FilePrefetcher prefetcher(paths, options);
+    std::vector<uint8_t> bytes;
+    EXPECT_TRUE(prefetcher.take(0, bytes));
+    // a second take of the same index fails instead of waiting forever
+    EXPECT_FALSE(prefetcher.take(0, bytes));
+    // destruction with files still held (and being read) must not hang
+  }
+  boost::filesystem::remove_all(dir);
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
@@ -0,0 +1,155 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "a2d2_to_ros/run_stats.hpp"
+
+namespace a2d2_to_ros {
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_run_stats, summarize_latencies) {
+  const auto empty = summarize_latencies({});
+  EXPECT_EQ(0, empty.count);
+  EXPECT_DOUBLE_EQ(0.0, empty.p99);
+
+  std::vector<double> latencies;
+  for (auto i = 100; i > 0; --i) {
+    latencies.push_back(0.001 * i);
+  }
+  const auto summary = summarize_latencies(latencies);
+  EXPECT_EQ(100, summary.count);
+  EXPECT_NEAR(5.05, summary.total, 1e-9);
+  EXPECT_DOUBLE_EQ(0.050, summary.p50);
+  EXPECT_DOUBLE_EQ(0.099, summary.p99);
+  EXPECT_DOUBLE_EQ(0.100, summary.max);
+
+  const auto single = summarize_latencies({0.25});
+  EXPECT_DOUBLE_EQ(0.25, single.p50);
+  EXPECT_DOUBLE_EQ(0.25, single.p99);
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_run_stats, RunStats_disabled) {
+  RunStats stats(false);
+  {
+    ScopedStageTimer timer(stats, Stage::NPZ_LOAD);
+  }
+  stats.add_latency(Stage::BAG_WRITE, 1.0);
+  stats.add_frames(3);
+  stats.add_bytes_in(100);
+  EXPECT_EQ(0, stats.get_summary(Stage::NPZ_LOAD).count);
+  EXPECT_EQ(0, stats.get_summary(Stage::BAG_WRITE).count);
+  EXPECT_EQ(0, stats.get_frames());
+  EXPECT_EQ(0, stats.get_bytes_in());
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_run_stats, RunStats_concurrent) {
+  constexpr auto NUM_THREADS = 4;
+  constexpr auto NUM_FRAMES = 250;
+
+  RunStats stats(true);
+  std::vector<std::thread> threads;
+  for (auto t = 0; t < NUM_THREADS; ++t) {
+    threads.emplace_back([&stats]() {
+      for (auto i = 0; i < NUM_FRAMES; ++i) {
+        ScopedStageTimer timer(stats, Stage::MSG_BUILD);
+        stats.add_frames(1);
+        stats.add_points(10);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  EXPECT_EQ(NUM_THREADS * NUM_FRAMES, stats.get_frames());
+  EXPECT_EQ(10 * NUM_THREADS * NUM_FRAMES, stats.get_points());
+  const auto summary = stats.get_summary(Stage::MSG_BUILD);
+  EXPECT_EQ(NUM_THREADS * NUM_FRAMES, summary.count);
+  EXPECT_LE(summary.p50, summary.p99);
+  EXPECT_LE(summary.p99, summary.max);
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_run_stats, ScopedStageTimer_stop) {
+  RunStats stats(true);
+  {
+    ScopedStageTimer timer(stats, Stage::VERIFY);
+    timer.stop();
+    // stopping again (or destruction) must not record a second latency
+    timer.stop();
+  }
+  EXPECT_EQ(1, stats.get_summary(Stage::VERIFY).count);
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_run_stats, ScopedStageTimer_pause) {
+  RunStats stats(true);
+  {
+    ScopedStageTimer timer(stats, Stage::IMAGE_LOAD);
+    timer.pause();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    timer.resume();
+  }
+  const auto summary = stats.get_summary(Stage::IMAGE_LOAD);
+  EXPECT_EQ(1, summary.count);
+  // the paused time is left out
+  EXPECT_LT(summary.total, 0.025);
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_run_stats, RunStats_to_json) {
+  RunStats stats(true);
+  stats.add_latency(Stage::NPZ_LOAD, 0.5);
+  stats.add_latency(Stage::BAG_WRITE, 0.25);
+  stats.add_frames(2);
+  stats.add_bytes_out(1024);
+
+  const auto json = stats.to_json("lidar");
+  EXPECT_NE(std::string::npos, json.find("\"converter\": \"lidar\""));
+  EXPECT_NE(std::string::npos, json.find("\"frames\": 2"));
+  EXPECT_NE(std::string::npos, json.find("\"bytes_out\": 1024"));
+  EXPECT_NE(std::string::npos, json.find("\"npz_load\": {\"count\": 1"));
+  EXPECT_NE(std::string::npos, json.find("\"p99_s\": 0.25"));
+
+  // stages that never ran are left out, and stages keep pipeline order
+  EXPECT_EQ(std::string::npos, json.find("json_read"));
+  EXPECT_LT(json.find("npz_load"), json.find("bag_write"));
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
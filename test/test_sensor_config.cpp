@@ -0,0 +1,172 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Mapless AI, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include "a2d2_to_ros/sensor_config.hpp"
+
+namespace a2d2_to_ros {
+
+namespace {
+SensorConfig get_test_config() {
+  SensorConfig config;
+  config.ego_bbox.x_min = -1.5;
+  config.ego_bbox.x_max = 3.0;
+  config.ego_bbox.y_min = -0.9;
+  config.ego_bbox.y_max = 0.9;
+  config.ego_bbox.z_min = 0.0;
+  config.ego_bbox.z_max = 1.5;
+
+  auto& info = config.camera_infos["front_center"];
+  info.width = 1920;
+  info.height = 1208;
+  info.D = {-0.1, 0.2, 0.001, -0.002, 0.0};
+  for (size_t i = 0; i < info.K.size(); ++i) {
+    info.K[i] = (1000.0 + i);
+  }
+  for (size_t i = 0; i < info.P.size(); ++i) {
+    info.P[i] = (2000.0 + i);
+  }
+  config.camera_infos["side_left"] = info;
+  config.camera_infos["side_left"].D.resize(4);
+
+  geometry_msgs::TransformStamped tx;
+  tx.header.frame_id = "chassis";
+  tx.child_frame_id = "camera_front_center";
+  tx.transform.translation.x = 1.7;
+  tx.transform.translation.z = 0.9;
+  tx.transform.rotation.x = 0.5;
+  tx.transform.rotation.w = -0.5;
+  config.transforms.push_back(tx);
+  tx.header.frame_id = "wheels";
+  tx.child_frame_id = "lidar_front_center_motion_compensated";
+  config.transforms.push_back(tx);
+  return config;
+}
+
+void expect_eq(const SensorConfig& expected, const SensorConfig& actual) {
+  EXPECT_EQ(expected.ego_bbox.x_min, actual.ego_bbox.x_min);
+  EXPECT_EQ(expected.ego_bbox.x_max, actual.ego_bbox.x_max);
+  EXPECT_EQ(expected.ego_bbox.y_min, actual.ego_bbox.y_min);
+  EXPECT_EQ(expected.ego_bbox.y_max, actual.ego_bbox.y_max);
+  EXPECT_EQ(expected.ego_bbox.z_min, actual.ego_bbox.z_min);
+  EXPECT_EQ(expected.ego_bbox.z_max, actual.ego_bbox.z_max);
+
+  ASSERT_EQ(expected.camera_infos.size(), actual.camera_infos.size());
+  for (const auto& p : expected.camera_infos) {
+    const auto it = actual.camera_infos.find(p.first);
+    ASSERT_NE(std::end(actual.camera_infos), it);
+    EXPECT_EQ(p.second.width, it->second.width);
+    EXPECT_EQ(p.second.height, it->second.height);
+    EXPECT_EQ(p.second.D, it->second.D);
+    EXPECT_EQ(p.second.K, it->second.K);
+    EXPECT_EQ(p.second.R, it->second.R);
+    EXPECT_EQ(p.second.P, it->second.P);
+  }
+
+  ASSERT_EQ(expected.transforms.size(), actual.transforms.size());
+  for (size_t i = 0; i < expected.transforms.size(); ++i) {
+    const auto& e = expected.transforms[i];
+    const auto& a = actual.transforms[i];
+    EXPECT_EQ(e.header.frame_id, a.header.frame_id);
+    EXPECT_EQ(e.child_frame_id, a.child_frame_id);
+    EXPECT_EQ(e.transform.translation.x, a.transform.translation.x);
+    EXPECT_EQ(e.transform.translation.y, a.transform.translation.y);
+    EXPECT_EQ(e.transform.translation.z, a.transform.translation.z);
+    EXPECT_EQ(e.transform.rotation.x, a.transform.rotation.x);
+    EXPECT_EQ(e.transform.rotation.y, a.transform.rotation.y);
+    EXPECT_EQ(e.transform.rotation.z, a.transform.rotation.z);
+    EXPECT_EQ(e.transform.rotation.w, a.transform.rotation.w);
+  }
+}
+}  // namespace
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_sensor_config, fnv1a_hash) {
+  // reference values of the 64-bit FNV-1a hash
+  EXPECT_EQ(0xcbf29ce484222325ull, fnv1a_hash(nullptr, 0));
+  const std::string a = "a";
+  EXPECT_EQ(0xaf63dc4c8601ec8cull,
+            fnv1a_hash(reinterpret_cast<const uint8_t*>(a.data()), a.size()));
+  const std::string foobar = "foobar";
+  const auto foobar_hash = fnv1a_hash(
+      reinterpret_cast<const uint8_t*>(foobar.data()), foobar.size());
+  EXPECT_EQ(0x85944171f73967e8ull, foobar_hash);
+
+  // hashing can continue across buffers
+  const auto p = reinterpret_cast<const uint8_t*>(foobar.data());
+  EXPECT_EQ(foobar_hash, fnv1a_hash(p + 3, 3, fnv1a_hash(p, 3)));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_sensor_config, save_load) {
+  const auto path = (boost::filesystem::temp_directory_path() /
+                     boost::filesystem::unique_path("a2d2_to_ros-%%%%%%.bin"))
+                        .string();
+  const auto config = get_test_config();
+  constexpr auto KEY = 0x0123456789abcdefull;
+  ASSERT_TRUE(save_sensor_config(path, KEY, config));
+
+  {
+    const auto loaded = load_sensor_config(path, KEY);
+    ASSERT_TRUE(static_cast<bool>(loaded));
+    expect_eq(config, *loaded);
+  }
+
+  // a cache written for other files is not used
+  EXPECT_FALSE(static_cast<bool>(load_sensor_config(path, (KEY + 1))));
+
+  // neither is a truncated or extended one
+  std::vector<char> bytes;
+  {
+    std::ifstream ifs(path, std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(ifs),
+                 std::istreambuf_iterator<char>());
+  }
+  {
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    ofs.write(bytes.data(), (bytes.size() - 1));
+  }
+  EXPECT_FALSE(static_cast<bool>(load_sensor_config(path, KEY)));
+  {
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    ofs.write(bytes.data(), bytes.size());
+    ofs.put('\0');
+  }
+  EXPECT_FALSE(static_cast<bool>(load_sensor_config(path, KEY)));
+
+  boost::filesystem::remove(path);
+  EXPECT_FALSE(static_cast<bool>(load_sensor_config(path, KEY)));
+}
+
+//------------------------------------------------------------------------------
+
+}  // namespace a2d2_to_ros
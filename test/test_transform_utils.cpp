@@ -23,6 +23,8 @@
  */
 #include <gtest/gtest.h>
 
+#include <vector>
+
 #include "a2d2_to_ros/transform_utils.hpp"
 
 static constexpr auto EPS = 1e-8;
@@ -64,5 +66,91 @@ TEST(A2D2_to_ROS_transform_utils, get_orthonormal_basis) {
 
 //------------------------------------------------------------------------------
 
+TEST(A2D2_to_ROS_transform_utils, sort_angle_samples) {
+  std::vector<AngleSample> samples = {{3, 0.3}, {1, 0.1}, {2, 0.2}};
+  EXPECT_FALSE(sort_angle_samples(samples));
+  ASSERT_EQ(3, samples.size());
+  EXPECT_EQ(1, samples[0].time);
+  EXPECT_EQ(0.2, samples[1].angle);
+  EXPECT_EQ(3, samples[2].time);
+
+  samples.push_back({2, 0.25});
+  const auto duplicate = sort_angle_samples(samples);
+  ASSERT_TRUE(duplicate);
+  EXPECT_EQ(2, *duplicate);
+
+  samples.clear();
+  EXPECT_FALSE(sort_angle_samples(samples));
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_transform_utils, join_chassis_angles) {
+  const std::vector<AngleSample> roll = {{1, 0.1}, {2, 0.2}, {4, 0.4}};
+  std::vector<AngleSample> pitch = {{1, -0.1}, {2, -0.2}, {4, -0.4}};
+  std::vector<ChassisAngles> angles;
+  EXPECT_FALSE(join_chassis_angles(roll, pitch, angles));
+  ASSERT_EQ(3, angles.size());
+  EXPECT_EQ(2, angles[1].time);
+  EXPECT_EQ(0.2, angles[1].roll);
+  EXPECT_EQ(-0.2, angles[1].pitch);
+
+  // the first timestamp without a partner is reported
+  pitch[1].time = 3;
+  auto unpaired = join_chassis_angles(roll, pitch, angles);
+  ASSERT_TRUE(unpaired);
+  EXPECT_EQ(2, *unpaired);
+
+  pitch[1].time = 2;
+  pitch.pop_back();
+  unpaired = join_chassis_angles(roll, pitch, angles);
+  ASSERT_TRUE(unpaired);
+  EXPECT_EQ(4, *unpaired);
+  unpaired = join_chassis_angles(pitch, roll, angles);
+  ASSERT_TRUE(unpaired);
+  EXPECT_EQ(4, *unpaired);
+}
+
+//------------------------------------------------------------------------------
+
+TEST(A2D2_to_ROS_transform_utils, resample_chassis_angles) {
+  // timestamps are in microseconds, so 10 Hz is a period of 100000
+  const std::vector<AngleSample> roll = {
+      {1000000, 0.0}, {1200000, 0.2}, {1400000, 0.0}};
+  const std::vector<AngleSample> pitch = {{1050000, 1.0}, {1350000, 4.0}};
+  std::vector<ChassisAngles> angles;
+  resample_chassis_angles(roll, pitch, 10.0, angles);
+
+  // from the first time both signals have started, to the last time both
+  // have samples after
+  ASSERT_EQ(4, angles.size());
+  EXPECT_EQ(1050000, angles[0].time);
+  EXPECT_NEAR(0.05, angles[0].roll, EPS);
+  EXPECT_NEAR(1.0, angles[0].pitch, EPS);
+  EXPECT_EQ(1150000, angles[1].time);
+  EXPECT_NEAR(0.15, angles[1].roll, EPS);
+  EXPECT_NEAR(2.0, angles[1].pitch, EPS);
+  EXPECT_EQ(1250000, angles[2].time);
+  EXPECT_NEAR(0.15, angles[2].roll, EPS);
+  EXPECT_NEAR(3.0, angles[2].pitch, EPS);
+  EXPECT_EQ(1350000, angles[3].time);
+  EXPECT_NEAR(0.05, angles[3].roll, EPS);
+  EXPECT_NEAR(4.0, angles[3].pitch, EPS);
+
+  // a single shared sample is kept
+  resample_chassis_angles({{5, 0.5}}, {{5, -0.5}}, 10.0, angles);
+  ASSERT_EQ(1, angles.size());
+  EXPECT_EQ(0.5, angles[0].roll);
+  EXPECT_EQ(-0.5, angles[0].pitch);
+
+  // signals that do not overlap, or are empty, have no angles
+  resample_chassis_angles({{5, 0.5}}, {{6, -0.5}}, 10.0, angles);
+  EXPECT_TRUE(angles.empty());
+  resample_chassis_angles(roll, {}, 10.0, angles);
+  EXPECT_TRUE(angles.empty());
+}
+
+//------------------------------------------------------------------------------
+
 }  // namespace a2d2_to_ros
 